@@ -1,6 +1,7 @@
 add_library(pm3rrg_rdv4_hardnested_nosimd OBJECT
         hardnested/hardnested_bf_core.c
-        hardnested/hardnested_bitarray_core.c)
+        hardnested/hardnested_bitarray_core.c
+        hardnested/iclass_bs_core.c)
 
 target_compile_options(pm3rrg_rdv4_hardnested_nosimd PRIVATE -Wall -Werror -O3)
 set_property(TARGET pm3rrg_rdv4_hardnested_nosimd PROPERTY POSITION_INDEPENDENT_CODE ON)
@@ -30,7 +31,8 @@ if ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST X86_CPUS)
     ## x86 / MMX
     add_library(pm3rrg_rdv4_hardnested_mmx OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_mmx PRIVATE -Wall -Werror -O3)
     target_compile_options(pm3rrg_rdv4_hardnested_mmx BEFORE PRIVATE
@@ -45,7 +47,8 @@ if ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST X86_CPUS)
     ## x86 / SSE2
     add_library(pm3rrg_rdv4_hardnested_sse2 OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_sse2 PRIVATE -Wall -Werror -O3)
     target_compile_options(pm3rrg_rdv4_hardnested_sse2 BEFORE PRIVATE
@@ -60,7 +63,8 @@ if ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST X86_CPUS)
     ## x86 / AVX
     add_library(pm3rrg_rdv4_hardnested_avx OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_avx PRIVATE -Wall -Werror -O3)
     target_compile_options(pm3rrg_rdv4_hardnested_avx BEFORE PRIVATE
@@ -75,7 +79,8 @@ if ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST X86_CPUS)
     ## x86 / AVX2
     add_library(pm3rrg_rdv4_hardnested_avx2 OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_avx2 PRIVATE -Wall -Werror -O3)
     target_compile_options(pm3rrg_rdv4_hardnested_avx2 BEFORE PRIVATE
@@ -90,7 +95,8 @@ if ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST X86_CPUS)
     ## x86 / AVX512
     add_library(pm3rrg_rdv4_hardnested_avx512 OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_avx512 PRIVATE -Wall -Werror -O3)
     target_compile_options(pm3rrg_rdv4_hardnested_avx512 BEFORE PRIVATE
@@ -114,7 +120,8 @@ elseif ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST ARM64_CPUS)
     ## arm64 / NEON
     add_library(pm3rrg_rdv4_hardnested_neon OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_neon PRIVATE -Wall -Werror -O3)
     set_property(TARGET pm3rrg_rdv4_hardnested_neon PROPERTY POSITION_INDEPENDENT_CODE ON)
@@ -132,7 +139,8 @@ elseif ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST ARM32_CPUS)
     ## arm64 / NEON
     add_library(pm3rrg_rdv4_hardnested_neon OBJECT
             hardnested/hardnested_bf_core.c
-            hardnested/hardnested_bitarray_core.c)
+            hardnested/hardnested_bitarray_core.c
+            hardnested/iclass_bs_core.c)
 
     target_compile_options(pm3rrg_rdv4_hardnested_neon PRIVATE -Wall -Werror -O3)
     target_compile_options(pm3rrg_rdv4_hardnested_neon BEFORE PRIVATE
@@ -0,0 +1,318 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Microbenchmark of the hardnested bitarray kernels.
+// Runs every kernel in every instruction set variant the CPU supports,
+// checks the result against the NOSIMD variant and prints the throughput.
+//
+//   make -C client/deps/hardnested bench
+//   ./client/deps/hardnested/hardnested_bench [iterations]
+//-----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hardnested_bitarray_core.h"
+#include "hardnested_bf_core.h"
+
+#define BITARRAY_WORDS  (1 << 19)
+#define BITARRAY_BYTES  (BITARRAY_WORDS * sizeof(uint32_t))
+
+// the per instruction set variants are only declared inside hardnested_bitarray_core.c
+#define DECLARE_KERNELS(isa) \
+    uint32_t *malloc_bitarray_##isa(uint32_t x); \
+    void free_bitarray_##isa(uint32_t *x); \
+    uint32_t count_states_##isa(uint32_t *A); \
+    void bitarray_AND_##isa(uint32_t *A, uint32_t *B); \
+    void bitarray_low20_AND_##isa(uint32_t *A, uint32_t *B); \
+    uint32_t count_bitarray_AND_##isa(uint32_t *A, uint32_t *B); \
+    uint32_t count_bitarray_low20_AND_##isa(uint32_t *A, uint32_t *B); \
+    void bitarray_AND4_##isa(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D); \
+    void bitarray_OR_##isa(uint32_t *A, uint32_t *B); \
+    uint32_t count_bitarray_AND2_##isa(uint32_t *A, uint32_t *B); \
+    uint32_t count_bitarray_AND3_##isa(uint32_t *A, uint32_t *B, uint32_t *C); \
+    uint32_t count_bitarray_AND4_##isa(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D);
+
+#define KERNEL_TABLE(isa) { \
+    (void *)count_states_##isa, (void *)bitarray_AND_##isa, (void *)bitarray_low20_AND_##isa, \
+    (void *)count_bitarray_AND_##isa, (void *)count_bitarray_low20_AND_##isa, (void *)bitarray_AND4_##isa, \
+    (void *)bitarray_OR_##isa, (void *)count_bitarray_AND2_##isa, (void *)count_bitarray_AND3_##isa, \
+    (void *)count_bitarray_AND4_##isa }
+
+DECLARE_KERNELS(NOSIMD)
+#if defined(COMPILER_HAS_SIMD_X86)
+DECLARE_KERNELS(MMX)
+DECLARE_KERNELS(SSE2)
+DECLARE_KERNELS(AVX)
+DECLARE_KERNELS(AVX2)
+#endif
+#if defined(COMPILER_HAS_SIMD_AVX512)
+DECLARE_KERNELS(AVX512)
+#endif
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+uint32_t count_states_AVX512VPOPCNT(uint32_t *A);
+uint32_t count_bitarray_AND_AVX512VPOPCNT(uint32_t *A, uint32_t *B);
+uint32_t count_bitarray_low20_AND_AVX512VPOPCNT(uint32_t *A, uint32_t *B);
+uint32_t count_bitarray_AND2_AVX512VPOPCNT(uint32_t *A, uint32_t *B);
+uint32_t count_bitarray_AND3_AVX512VPOPCNT(uint32_t *A, uint32_t *B, uint32_t *C);
+uint32_t count_bitarray_AND4_AVX512VPOPCNT(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D);
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+DECLARE_KERNELS(NEON)
+#endif
+
+typedef enum {
+    K_COUNT_STATES,
+    K_AND,
+    K_LOW20_AND,
+    K_COUNT_AND,
+    K_COUNT_LOW20_AND,
+    K_AND4,
+    K_OR,
+    K_COUNT_AND2,
+    K_COUNT_AND3,
+    K_COUNT_AND4,
+    K_NUM
+} kernel_id_t;
+
+static const struct {
+    const char *name;
+    uint8_t arrays;         // bitarrays read
+    bool writes;            // A is written
+} kernels[K_NUM] = {
+    { "count_states",             1, false },
+    { "bitarray_AND",             2, true  },
+    { "bitarray_low20_AND",       2, true  },
+    { "count_bitarray_AND",       2, true  },
+    { "count_bitarray_low20_AND", 2, true  },
+    { "bitarray_AND4",            3, true  },
+    { "bitarray_OR",              2, true  },
+    { "count_bitarray_AND2",      2, false },
+    { "count_bitarray_AND3",      3, false },
+    { "count_bitarray_AND4",      4, false },
+};
+
+typedef struct {
+    const char *name;
+    bool (*supported)(void);
+    void *fn[K_NUM];
+} isa_t;
+
+static bool isa_always(void) {
+    return true;
+}
+
+#if defined(COMPILER_HAS_SIMD_X86)
+static bool isa_mmx(void) {
+    return __builtin_cpu_supports("mmx");
+}
+static bool isa_sse2(void) {
+    return __builtin_cpu_supports("sse2");
+}
+static bool isa_avx(void) {
+    return __builtin_cpu_supports("avx");
+}
+static bool isa_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+#if defined(COMPILER_HAS_SIMD_AVX512)
+static bool isa_avx512(void) {
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+static bool isa_avx512vpopcnt(void) {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+}
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+static bool isa_neon(void) {
+    return arm_has_neon();
+}
+#endif
+
+static const isa_t isas[] = {
+    { "NOSIMD", isa_always, KERNEL_TABLE(NOSIMD) },
+#if defined(COMPILER_HAS_SIMD_X86)
+    { "MMX", isa_mmx, KERNEL_TABLE(MMX) },
+    { "SSE2", isa_sse2, KERNEL_TABLE(SSE2) },
+    { "AVX", isa_avx, KERNEL_TABLE(AVX) },
+    { "AVX2", isa_avx2, KERNEL_TABLE(AVX2) },
+#endif
+#if defined(COMPILER_HAS_SIMD_AVX512)
+    { "AVX512", isa_avx512, KERNEL_TABLE(AVX512) },
+#endif
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+    {
+        "AVX512VPOPCNT", isa_avx512vpopcnt, {
+            [K_COUNT_STATES] = (void *)count_states_AVX512VPOPCNT,
+            [K_COUNT_AND] = (void *)count_bitarray_AND_AVX512VPOPCNT,
+            [K_COUNT_LOW20_AND] = (void *)count_bitarray_low20_AND_AVX512VPOPCNT,
+            [K_COUNT_AND2] = (void *)count_bitarray_AND2_AVX512VPOPCNT,
+            [K_COUNT_AND3] = (void *)count_bitarray_AND3_AVX512VPOPCNT,
+            [K_COUNT_AND4] = (void *)count_bitarray_AND4_AVX512VPOPCNT,
+        }
+    },
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+    { "NEON", isa_neon, KERNEL_TABLE(NEON) },
+#endif
+};
+
+typedef uint32_t count1_t(uint32_t *);
+typedef uint32_t count2_t(uint32_t *, uint32_t *);
+typedef uint32_t count3_t(uint32_t *, uint32_t *, uint32_t *);
+typedef uint32_t count4_t(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
+typedef void op2_t(uint32_t *, uint32_t *);
+typedef void op4_t(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
+
+static uint32_t *bitarray[4];
+static uint32_t *pristine;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t run_kernel(kernel_id_t k, void *fn) {
+    uint32_t *A = bitarray[0], *B = bitarray[1], *C = bitarray[2], *D = bitarray[3];
+    switch (k) {
+        case K_COUNT_STATES:
+            return ((count1_t *)fn)(A);
+        case K_AND:
+        case K_LOW20_AND:
+        case K_OR:
+            ((op2_t *)fn)(A, B);
+            return 0;
+        case K_COUNT_AND:
+        case K_COUNT_LOW20_AND:
+        case K_COUNT_AND2:
+            return ((count2_t *)fn)(A, B);
+        case K_AND4:
+            ((op4_t *)fn)(A, B, C, D);
+            return 0;
+        case K_COUNT_AND3:
+            return ((count3_t *)fn)(A, B, C);
+        case K_COUNT_AND4:
+            return ((count4_t *)fn)(A, B, C, D);
+        case K_NUM:
+            break;
+    }
+    return 0;
+}
+
+// first call on fresh data, returns the kernel result and leaves A for comparison
+static uint32_t reference_run(kernel_id_t k, void *fn) {
+    memcpy(bitarray[0], pristine, BITARRAY_BYTES);
+    return run_kernel(k, fn);
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = 200;
+    if (argc > 1)
+        iterations = atoi(argv[1]);
+    if (iterations <= 0) {
+        printf("syntax: %s [iterations]\n\n", argv[0]);
+        return 1;
+    }
+
+#if defined(COMPILER_HAS_SIMD_X86)
+    __builtin_cpu_init();
+#endif
+
+    // malloc_bitarray dispatches to the widest alignment the CPU needs
+    for (int i = 0; i < 4; i++) {
+        bitarray[i] = malloc_bitarray(BITARRAY_BYTES);
+        if (bitarray[i] == NULL) {
+            printf("Memory allocation error\n");
+            return 1;
+        }
+    }
+    pristine = malloc(BITARRAY_BYTES);
+    uint32_t *expected = malloc(BITARRAY_BYTES);
+    if (pristine == NULL || expected == NULL) {
+        printf("Memory allocation error\n");
+        return 1;
+    }
+
+    // dense random bits, with some all zero halfwords for the low20 kernels
+    srand(0x1337);
+    for (int i = 0; i < 4; i++) {
+        uint32_t *p = (i == 0) ? pristine : bitarray[i];
+        for (uint32_t j = 0; j < BITARRAY_WORDS; j++) {
+            p[j] = ((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ ((uint32_t)rand() << 30);
+            if ((rand() & 3) == 0)
+                p[j] &= 0xFFFF0000;
+            if ((rand() & 3) == 0)
+                p[j] &= 0x0000FFFF;
+        }
+    }
+
+    printf("hardnested bitarray kernel benchmark, %d iterations over %u kB bitarrays\n\n", iterations, (uint32_t)(BITARRAY_BYTES / 1024));
+    printf("%-26s", "kernel");
+    for (size_t s = 0; s < sizeof(isas) / sizeof(isas[0]); s++)
+        if (isas[s].supported())
+            printf("%14s", isas[s].name);
+    printf("   GB/s\n");
+
+    int failed = 0;
+    for (kernel_id_t k = 0; k < K_NUM; k++) {
+        uint32_t expected_result = reference_run(k, isas[0].fn[k]);
+        memcpy(expected, bitarray[0], BITARRAY_BYTES);
+
+        printf("%-26s", kernels[k].name);
+        for (size_t s = 0; s < sizeof(isas) / sizeof(isas[0]); s++) {
+            if (isas[s].supported() == false)
+                continue;
+            void *fn = isas[s].fn[k];
+            if (fn == NULL) {
+                printf("%14s", "-");
+                continue;
+            }
+
+            bool ok = (reference_run(k, fn) == expected_result);
+            ok &= (memcmp(bitarray[0], expected, BITARRAY_BYTES) == 0);
+
+            // A is rewritten on every call, the kernels are idempotent from here on
+            double t0 = now_sec();
+            for (int i = 0; i < iterations; i++)
+                run_kernel(k, fn);
+            double t = now_sec() - t0;
+
+            double bytes = (double)iterations * BITARRAY_BYTES * (kernels[k].arrays + (kernels[k].writes ? 1 : 0));
+            if (ok) {
+                printf("%14.2f", bytes / t / 1e9);
+            } else {
+                printf("%14s", "FAILED");
+                failed++;
+            }
+        }
+        printf("\n");
+    }
+
+    printf("\n%s\n", failed ? "Benchmark FAILED, results differ" : "Results match");
+
+    for (int i = 0; i < 4; i++)
+        free_bitarray(bitarray[i]);
+    free(pristine);
+    free(expected);
+    return failed ? 1 : 0;
+}
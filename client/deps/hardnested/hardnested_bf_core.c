@@ -108,24 +108,38 @@ typedef union {
 #if defined (__AVX512F__)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_AVX512
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_AVX512
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_AVX512
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_AVX512
 #elif defined (__AVX2__)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_AVX2
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_AVX2
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_AVX2
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_AVX2
 #elif defined (__AVX__)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_AVX
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_AVX
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_AVX
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_AVX
 #elif defined (__SSE2__)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_SSE2
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_SSE2
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_SSE2
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_SSE2
 #elif defined (__MMX__)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_MMX
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_MMX
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_MMX
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_MMX
 #elif defined (__ARM_NEON) && !defined(NOSIMD_BUILD)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_NEON
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_NEON
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_NEON
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_NEON
 #else
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_NOSIMD
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_NOSIMD
+#define CRYPTO1_BS_DICT_INIT crypto1_bs_dict_init_NOSIMD
+#define CRYPTO1_BS_DICT_NESTED crypto1_bs_dict_nested_NOSIMD
 #endif
 
 // typedefs and declaration of functions:
@@ -149,6 +163,24 @@ bitslice_test_nonces_t bitslice_test_nonces_NEON;
 bitslice_test_nonces_t bitslice_test_nonces_NOSIMD;
 bitslice_test_nonces_t bitslice_test_nonces_dispatch;
 
+typedef bool crypto1_bs_dict_init_t(crypto1_bs_dict_t *, const uint64_t *, uint32_t);
+crypto1_bs_dict_init_t crypto1_bs_dict_init_AVX512;
+crypto1_bs_dict_init_t crypto1_bs_dict_init_AVX2;
+crypto1_bs_dict_init_t crypto1_bs_dict_init_AVX;
+crypto1_bs_dict_init_t crypto1_bs_dict_init_SSE2;
+crypto1_bs_dict_init_t crypto1_bs_dict_init_MMX;
+crypto1_bs_dict_init_t crypto1_bs_dict_init_NEON;
+crypto1_bs_dict_init_t crypto1_bs_dict_init_NOSIMD;
+
+typedef uint32_t crypto1_bs_dict_nested_t(const crypto1_bs_dict_t *, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t *, uint32_t);
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_AVX512;
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_AVX2;
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_AVX;
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_SSE2;
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_MMX;
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_NEON;
+crypto1_bs_dict_nested_t crypto1_bs_dict_nested_NOSIMD;
+
 #if defined (_WIN32)
 #define malloc_bitslice(x) __builtin_assume_aligned(_aligned_malloc((x), MAX_BITSLICES / 8), MAX_BITSLICES / 8)
 #define free_bitslice(x) _aligned_free(x)
@@ -550,6 +582,157 @@ out:
 
 
 
+// Bitsliced dictionary for nested authentications seen in a trace.
+// The keys are loaded into crypto-1 states once, afterwards each authentication runs
+// the whole dictionary through the cipher MAX_BITSLICES keys at a time.
+// Layout of a state: state_p[2*i] is odd bit i and state_p[2*i+1] is even bit i.
+// A new bit is shifted in by decrementing state_p.
+
+// number of cipher steps for nt and nr, the reader answer follows
+#define NESTED_AUTH_SIZE 64
+
+static inline bitslice_value_t crypto1_bs_filter(const bitslice_t *restrict state_p) {
+    return f20c(f20a(state_p[38].value, state_p[36].value, state_p[34].value, state_p[32].value),
+                f20b(state_p[30].value, state_p[28].value, state_p[26].value, state_p[24].value),
+                f20b(state_p[22].value, state_p[20].value, state_p[18].value, state_p[16].value),
+                f20a(state_p[14].value, state_p[12].value, state_p[10].value, state_p[8].value),
+                f20b(state_p[6].value, state_p[4].value, state_p[2].value, state_p[0].value));
+}
+
+static inline bitslice_value_t crypto1_bs_feedback(const bitslice_t *restrict state_p) {
+    bitslice_value_t fb = {0};
+    for (uint32_t i = 0; i < STATE_SIZE / 2; i++) {
+        if (get_bit(i, LF_POLY_ODD)) {
+            fb ^= state_p[2 * i].value;
+        }
+        if (get_bit(i, LF_POLY_EVEN)) {
+            fb ^= state_p[2 * i + 1].value;
+        }
+    }
+    return fb;
+}
+
+static inline bool crypto1_bs_is_zero(const bitslice_t *b) {
+    uint64_t acc = 0;
+    for (uint32_t i = 0; i < MAX_BITSLICES / 64; i++) {
+        acc |= b->bytes64[i];
+    }
+    return acc == 0;
+}
+
+bool CRYPTO1_BS_DICT_INIT(crypto1_bs_dict_t *dict, const uint64_t *keys, uint32_t count) {
+
+    dict->count = count;
+    dict->slices = MAX_BITSLICES;
+    dict->blocks = (count + MAX_BITSLICES - 1) / MAX_BITSLICES;
+    dict->states = NULL;
+    if (count == 0) {
+        return false;
+    }
+
+    size_t size = (size_t)dict->blocks * STATE_SIZE * sizeof(bitslice_t);
+    bitslice_t *states = malloc_bitslice(size);
+    if (states == NULL) {
+        return false;
+    }
+    memset(states, 0, size);
+
+    for (uint32_t k = 0; k < count; k++) {
+        bitslice_t *state_p = &states[(k / MAX_BITSLICES) * STATE_SIZE];
+        uint32_t slice = k % MAX_BITSLICES;
+        struct Crypto1State s;
+        crypto1_init(&s, keys[k]);
+        for (uint32_t i = 0; i < STATE_SIZE / 2; i++) {
+            state_p[2 * i].bytes64[slice >> 6] |= (uint64_t)get_bit(i, s.odd) << (slice & 0x3f);
+            state_p[2 * i + 1].bytes64[slice >> 6] |= (uint64_t)get_bit(i, s.even) << (slice & 0x3f);
+        }
+    }
+
+    dict->states = states;
+    return true;
+}
+
+uint32_t CRYPTO1_BS_DICT_NESTED(const crypto1_bs_dict_t *dict, uint32_t first, uint32_t uid, uint32_t nt_enc, uint32_t nr_enc, uint32_t ar_enc,
+                                uint32_t *candidates, uint32_t max_candidates) {
+
+    // The reader answer is prng_successor(nt, 64), which is linear in nt. With nt = nt_enc ^ ks1 a key
+    // is a candidate if  ks2 ^ suc64(ks1) == ar_enc ^ suc64(nt_enc).  suc64_rows[j] holds the ks1 bits
+    // that make up bit j of suc64(ks1).
+    uint32_t suc64_rows[32] = {0};
+    for (uint32_t i = 0; i < 32; i++) {
+        uint32_t col = prng_successor(1u << i, 64);
+        for (uint32_t j = 0; j < 32; j++) {
+            suc64_rows[j] |= get_bit(j, col) << i;
+        }
+    }
+    uint32_t target = ar_enc ^ prng_successor(nt_enc, 64);
+    uint32_t nt_in = uid ^ nt_enc;
+
+    bitslice_t states[STATE_SIZE + NESTED_AUTH_SIZE + 32];
+    bitslice_value_t ks1[32];
+    uint32_t found = 0;
+
+    for (uint32_t block_idx = first / MAX_BITSLICES; block_idx < dict->blocks && found < max_candidates; block_idx++) {
+
+        // lanes still in the game, skip padding and keys before 'first'
+        bitslice_t alive;
+        memset(alive.bytes, 0xff, VECTOR_SIZE);
+        for (uint32_t slice = 0; slice < MAX_BITSLICES; slice++) {
+            uint32_t k = block_idx * MAX_BITSLICES + slice;
+            if (k < first || k >= dict->count) {
+                alive.bytes64[slice >> 6] &= ~(1ULL << (slice & 0x3f));
+            }
+        }
+
+        bitslice_t *restrict state_p = &states[NESTED_AUTH_SIZE + 32];
+        memcpy(state_p, &((const bitslice_t *)dict->states)[block_idx * STATE_SIZE], STATE_SIZE * sizeof(bitslice_t));
+
+        // uid ^ nt and nr are shifted in encrypted, bit order as in crypto1_word()
+        for (uint32_t i = 0; i < NESTED_AUTH_SIZE; i++) {
+            bitslice_value_t ks = crypto1_bs_filter(state_p);
+            bitslice_value_t in = ks ^ crypto1_bs_feedback(state_p);
+            uint32_t bit = (i < 32) ? BEBIT(nt_in, i) : BEBIT(nr_enc, i - 32);
+            if (bit) {
+                in = ~in;
+            }
+            if (i < 32) {
+                ks1[i ^ 24] = ks;
+            }
+            state_p--;
+            state_p[0].value = in;
+        }
+
+        // keystream for the reader answer, drop lanes as soon as one bit mismatches
+        for (uint32_t i = 0; i < 32; i++) {
+            uint32_t j = i ^ 24;
+            bitslice_value_t diff = crypto1_bs_filter(state_p);
+            for (uint32_t k = 0; k < 32; k++) {
+                if (get_bit(k, suc64_rows[j])) {
+                    diff ^= ks1[k];
+                }
+            }
+            if (get_bit(j, target)) {
+                diff = ~diff;
+            }
+            alive.value &= ~diff;
+            if (crypto1_bs_is_zero(&alive)) {
+                break;
+            }
+            bitslice_value_t in = crypto1_bs_feedback(state_p);
+            state_p--;
+            state_p[0].value = in;
+        }
+
+        for (uint32_t slice = 0; slice < MAX_BITSLICES && found < max_candidates; slice++) {
+            if (get_vector_bit(slice, alive)) {
+                candidates[found++] = block_idx * MAX_BITSLICES + slice;
+            }
+        }
+    }
+
+    return found;
+}
+
 #ifdef NOSIMD_BUILD
 
 // pointers to functions:
@@ -682,6 +865,76 @@ void bitslice_test_nonces_dispatch(uint32_t nonces_to_bruteforce, const uint32_t
     (*bitslice_test_nonces_function_p)(nonces_to_bruteforce, bf_test_nonce, bf_test_nonce_par);
 }
 
+// the dictionary remembers the instruction set it was built for, its block size depends on it
+bool crypto1_bs_dict_init(crypto1_bs_dict_t *dict, const uint64_t *keys, uint32_t count) {
+    dict->instr = GetSIMDInstrAuto();
+    switch (dict->instr) {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        case SIMD_AVX512:
+            return crypto1_bs_dict_init_AVX512(dict, keys, count);
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+        case SIMD_AVX2:
+            return crypto1_bs_dict_init_AVX2(dict, keys, count);
+        case SIMD_AVX:
+            return crypto1_bs_dict_init_AVX(dict, keys, count);
+        case SIMD_SSE2:
+            return crypto1_bs_dict_init_SSE2(dict, keys, count);
+        case SIMD_MMX:
+            return crypto1_bs_dict_init_MMX(dict, keys, count);
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            return crypto1_bs_dict_init_NEON(dict, keys, count);
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+            break;
+    }
+    dict->instr = SIMD_NONE;
+    return crypto1_bs_dict_init_NOSIMD(dict, keys, count);
+}
+
+uint32_t crypto1_bs_dict_nested(const crypto1_bs_dict_t *dict, uint32_t first, uint32_t uid, uint32_t nt_enc, uint32_t nr_enc, uint32_t ar_enc,
+                                uint32_t *candidates, uint32_t max_candidates) {
+    if (dict->states == NULL) {
+        return 0;
+    }
+    switch (dict->instr) {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        case SIMD_AVX512:
+            return crypto1_bs_dict_nested_AVX512(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+        case SIMD_AVX2:
+            return crypto1_bs_dict_nested_AVX2(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+        case SIMD_AVX:
+            return crypto1_bs_dict_nested_AVX(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+        case SIMD_SSE2:
+            return crypto1_bs_dict_nested_SSE2(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+        case SIMD_MMX:
+            return crypto1_bs_dict_nested_MMX(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            return crypto1_bs_dict_nested_NEON(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+            break;
+    }
+    return crypto1_bs_dict_nested_NOSIMD(dict, first, uid, nt_enc, nr_enc, ar_enc, candidates, max_candidates);
+}
+
+void crypto1_bs_dict_free(crypto1_bs_dict_t *dict) {
+    if (dict->states != NULL) {
+        free_bitslice(dict->states);
+    }
+    dict->states = NULL;
+    dict->count = 0;
+    dict->blocks = 0;
+}
+
 // Entries to dispatched function calls
 uint64_t crack_states_bitsliced(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found, uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce, uint8_t *bf_test_nonce_2nd_byte, noncelist_t *nonces) {
     return (*crack_states_bitsliced_function_p)(cuid, best_first_bytes, p, keys_found, num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, nonces);
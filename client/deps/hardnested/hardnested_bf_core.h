@@ -58,6 +58,9 @@ THE SOFTWARE.
 #  define COMPILER_HAS_SIMD_X86
 #  if defined(COMPILER_HAS_SIMD_X86) && ((__GNUC__ >= 5) && (__GNUC__ > 5 || __GNUC_MINOR__ > 2))
 #    define COMPILER_HAS_SIMD_AVX512
+#    if (__GNUC__ >= 8)
+#      define COMPILER_HAS_SIMD_AVX512_VPOPCNT
+#    endif
 #  endif
 #endif
 
@@ -93,4 +96,22 @@ SIMDExecInstr GetSIMDInstrAuto(void);
 uint64_t crack_states_bitsliced(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found, uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce, uint8_t *bf_test_nonce_2nd_byte, noncelist_t *nonces);
 void bitslice_test_nonces(uint32_t nonces_to_bruteforce, uint32_t *bf_test_nonce, uint8_t *bf_test_nonce_par);
 
+// A key dictionary loaded into bitsliced crypto-1 states, see crypto1_bs_dict_init()
+typedef struct {
+    uint32_t count;         // number of keys
+    uint32_t blocks;        // number of bitsliced blocks
+    uint32_t slices;        // keys per block
+    SIMDExecInstr instr;    // instruction set the states were built for
+    void *states;
+} crypto1_bs_dict_t;
+
+// Loads 'count' keys into a bitsliced dictionary. Returns false if out of memory.
+bool crypto1_bs_dict_init(crypto1_bs_dict_t *dict, const uint64_t *keys, uint32_t count);
+// Runs a nested authentication (uid, encrypted nt, nr and reader answer) against all keys
+// from index 'first' on. Writes the indices of the keys that produce a valid reader answer
+// in ascending order to 'candidates' and returns how many were found, at most 'max_candidates'.
+uint32_t crypto1_bs_dict_nested(const crypto1_bs_dict_t *dict, uint32_t first, uint32_t uid, uint32_t nt_enc, uint32_t nr_enc, uint32_t ar_enc,
+                                uint32_t *candidates, uint32_t max_candidates);
+void crypto1_bs_dict_free(crypto1_bs_dict_t *dict);
+
 #endif
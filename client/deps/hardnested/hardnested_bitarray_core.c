@@ -25,6 +25,13 @@
 #ifndef __APPLE__
 #include <malloc.h>
 #endif
+#if defined (__AVX512F__)
+#include <immintrin.h>
+// gcc 12 warns about _mm512_undefined_epi32() inside its own intrinsics
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#elif defined (__ARM_NEON) && !defined (NOSIMD_BUILD)
+#include <arm_neon.h>
+#endif
 
 // this needs to be compiled several times for each instruction set.
 // For each instruction set, define a dedicated function name:
@@ -137,25 +144,25 @@ free_bitarray_t free_bitarray_AVX512, free_bitarray_AVX2, free_bitarray_AVX, fre
 typedef uint32_t bitcount_t(uint32_t);
 bitcount_t bitcount_AVX512, bitcount_AVX2, bitcount_AVX, bitcount_SSE2, bitcount_MMX, bitcount_NOSIMD, bitcount_NEON, bitcount_dispatch;
 typedef uint32_t count_states_t(uint32_t *);
-count_states_t count_states_AVX512, count_states_AVX2, count_states_AVX, count_states_SSE2, count_states_MMX, count_states_NOSIMD, count_states_NEON, count_states_dispatch;
+count_states_t count_states_AVX512VPOPCNT, count_states_AVX512, count_states_AVX2, count_states_AVX, count_states_SSE2, count_states_MMX, count_states_NOSIMD, count_states_NEON, count_states_dispatch;
 typedef void bitarray_AND_t(uint32_t[], uint32_t[]);
 bitarray_AND_t bitarray_AND_AVX512, bitarray_AND_AVX2, bitarray_AND_AVX, bitarray_AND_SSE2, bitarray_AND_MMX, bitarray_AND_NOSIMD, bitarray_AND_NEON, bitarray_AND_dispatch;
 typedef void bitarray_low20_AND_t(uint32_t *, uint32_t *);
 bitarray_low20_AND_t bitarray_low20_AND_AVX512, bitarray_low20_AND_AVX2, bitarray_low20_AND_AVX, bitarray_low20_AND_SSE2, bitarray_low20_AND_MMX, bitarray_low20_AND_NOSIMD, bitarray_low20_AND_NEON, bitarray_low20_AND_dispatch;
 typedef uint32_t count_bitarray_AND_t(uint32_t *, uint32_t *);
-count_bitarray_AND_t count_bitarray_AND_AVX512, count_bitarray_AND_AVX2, count_bitarray_AND_AVX, count_bitarray_AND_SSE2, count_bitarray_AND_MMX, count_bitarray_AND_NOSIMD, count_bitarray_AND_NEON, count_bitarray_AND_dispatch;
+count_bitarray_AND_t count_bitarray_AND_AVX512VPOPCNT, count_bitarray_AND_AVX512, count_bitarray_AND_AVX2, count_bitarray_AND_AVX, count_bitarray_AND_SSE2, count_bitarray_AND_MMX, count_bitarray_AND_NOSIMD, count_bitarray_AND_NEON, count_bitarray_AND_dispatch;
 typedef uint32_t count_bitarray_low20_AND_t(uint32_t *, uint32_t *);
-count_bitarray_low20_AND_t count_bitarray_low20_AND_AVX512, count_bitarray_low20_AND_AVX2, count_bitarray_low20_AND_AVX, count_bitarray_low20_AND_SSE2, count_bitarray_low20_AND_MMX, count_bitarray_low20_AND_NOSIMD, count_bitarray_low20_AND_NEON, count_bitarray_low20_AND_dispatch;
+count_bitarray_low20_AND_t count_bitarray_low20_AND_AVX512VPOPCNT, count_bitarray_low20_AND_AVX512, count_bitarray_low20_AND_AVX2, count_bitarray_low20_AND_AVX, count_bitarray_low20_AND_SSE2, count_bitarray_low20_AND_MMX, count_bitarray_low20_AND_NOSIMD, count_bitarray_low20_AND_NEON, count_bitarray_low20_AND_dispatch;
 typedef void bitarray_AND4_t(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
 bitarray_AND4_t bitarray_AND4_AVX512, bitarray_AND4_AVX2, bitarray_AND4_AVX, bitarray_AND4_SSE2, bitarray_AND4_MMX, bitarray_AND4_NOSIMD, bitarray_AND4_NEON, bitarray_AND4_dispatch;
 typedef void bitarray_OR_t(uint32_t[], uint32_t[]);
 bitarray_OR_t bitarray_OR_AVX512, bitarray_OR_AVX2, bitarray_OR_AVX, bitarray_OR_SSE2, bitarray_OR_MMX, bitarray_OR_NOSIMD, bitarray_OR_NEON, bitarray_OR_dispatch;
 typedef uint32_t count_bitarray_AND2_t(uint32_t *, uint32_t *);
-count_bitarray_AND2_t count_bitarray_AND2_AVX512, count_bitarray_AND2_AVX2, count_bitarray_AND2_AVX, count_bitarray_AND2_SSE2, count_bitarray_AND2_MMX, count_bitarray_AND2_NOSIMD, count_bitarray_AND2_NEON, count_bitarray_AND2_dispatch;
+count_bitarray_AND2_t count_bitarray_AND2_AVX512VPOPCNT, count_bitarray_AND2_AVX512, count_bitarray_AND2_AVX2, count_bitarray_AND2_AVX, count_bitarray_AND2_SSE2, count_bitarray_AND2_MMX, count_bitarray_AND2_NOSIMD, count_bitarray_AND2_NEON, count_bitarray_AND2_dispatch;
 typedef uint32_t count_bitarray_AND3_t(uint32_t *, uint32_t *, uint32_t *);
-count_bitarray_AND3_t count_bitarray_AND3_AVX512, count_bitarray_AND3_AVX2, count_bitarray_AND3_AVX, count_bitarray_AND3_SSE2, count_bitarray_AND3_MMX, count_bitarray_AND3_NOSIMD, count_bitarray_AND3_NEON, count_bitarray_AND3_dispatch;
+count_bitarray_AND3_t count_bitarray_AND3_AVX512VPOPCNT, count_bitarray_AND3_AVX512, count_bitarray_AND3_AVX2, count_bitarray_AND3_AVX, count_bitarray_AND3_SSE2, count_bitarray_AND3_MMX, count_bitarray_AND3_NOSIMD, count_bitarray_AND3_NEON, count_bitarray_AND3_dispatch;
 typedef uint32_t count_bitarray_AND4_t(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
-count_bitarray_AND4_t count_bitarray_AND4_AVX512, count_bitarray_AND4_AVX2, count_bitarray_AND4_AVX, count_bitarray_AND4_SSE2, count_bitarray_AND4_MMX, count_bitarray_AND4_NOSIMD, count_bitarray_AND4_NEON, count_bitarray_AND4_dispatch;
+count_bitarray_AND4_t count_bitarray_AND4_AVX512VPOPCNT, count_bitarray_AND4_AVX512, count_bitarray_AND4_AVX2, count_bitarray_AND4_AVX, count_bitarray_AND4_SSE2, count_bitarray_AND4_MMX, count_bitarray_AND4_NOSIMD, count_bitarray_AND4_NEON, count_bitarray_AND4_dispatch;
 
 
 inline uint32_t *MALLOC_BITARRAY(uint32_t x) {
@@ -188,6 +195,325 @@ inline uint32_t BITCOUNT(uint32_t a) {
 }
 
 
+#if defined (__AVX512F__)
+
+// Explicit AVX-512F kernels. AVX-512F alone has neither a popcount nor 16 bit
+// compares, so the counting kernels use a SWAR popcount on 32 bit lanes and the
+// low20 kernels build their halfword masks with 32 bit tests.
+// CPUs with VPOPCNTDQ get dedicated counting kernels below.
+
+static inline __m512i popcount_epi32_AVX512(__m512i v) {
+    const __m512i m1 = _mm512_set1_epi32(0x55555555);
+    const __m512i m2 = _mm512_set1_epi32(0x33333333);
+    const __m512i m4 = _mm512_set1_epi32(0x0F0F0F0F);
+    v = _mm512_sub_epi32(v, _mm512_and_si512(_mm512_srli_epi32(v, 1), m1));
+    v = _mm512_add_epi32(_mm512_and_si512(v, m2), _mm512_and_si512(_mm512_srli_epi32(v, 2), m2));
+    v = _mm512_and_si512(_mm512_add_epi32(v, _mm512_srli_epi32(v, 4)), m4);
+    v = _mm512_add_epi32(v, _mm512_srli_epi32(v, 8));
+    v = _mm512_add_epi32(v, _mm512_srli_epi32(v, 16));
+    return _mm512_and_si512(v, _mm512_set1_epi32(0x3F));
+}
+
+// keeps the halfwords of A whose counterpart in B is not zero
+static inline __m512i low20_mask_AVX512(__m512i b) {
+    const __m512i lo = _mm512_set1_epi32(0x0000FFFF);
+    const __m512i hi = _mm512_set1_epi32(0xFFFF0000);
+    return _mm512_or_si512(_mm512_maskz_mov_epi32(_mm512_test_epi32_mask(b, lo), lo),
+                           _mm512_maskz_mov_epi32(_mm512_test_epi32_mask(b, hi), hi));
+}
+
+#define LOAD512(X) _mm512_loadu_si512((const void *)&(X)[i])
+#define STORE512(X, v) _mm512_storeu_si512((void *)&(X)[i], (v))
+
+inline uint32_t COUNT_STATES(uint32_t *A) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = _mm512_add_epi32(count, popcount_epi32_AVX512(LOAD512(A)));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+
+inline void BITARRAY_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        STORE512(A, _mm512_and_si512(LOAD512(A), LOAD512(B)));
+    }
+}
+
+
+inline void BITARRAY_LOW20_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        STORE512(A, _mm512_and_si512(LOAD512(A), low20_mask_AVX512(LOAD512(B))));
+    }
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(LOAD512(A), LOAD512(B));
+        STORE512(A, a);
+        count = _mm512_add_epi32(count, popcount_epi32_AVX512(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+
+inline uint32_t COUNT_BITARRAY_LOW20_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(LOAD512(A), low20_mask_AVX512(LOAD512(B)));
+        STORE512(A, a);
+        count = _mm512_add_epi32(count, popcount_epi32_AVX512(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+
+inline void BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        STORE512(A, _mm512_and_si512(_mm512_and_si512(LOAD512(B), LOAD512(C)), LOAD512(D)));
+    }
+}
+
+
+inline void BITARRAY_OR(uint32_t *restrict A, uint32_t *restrict B) {
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        STORE512(A, _mm512_or_si512(LOAD512(A), LOAD512(B)));
+    }
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND2(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = _mm512_add_epi32(count, popcount_epi32_AVX512(_mm512_and_si512(LOAD512(A), LOAD512(B))));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND3(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(_mm512_and_si512(LOAD512(A), LOAD512(B)), LOAD512(C));
+        count = _mm512_add_epi32(count, popcount_epi32_AVX512(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(_mm512_and_si512(LOAD512(A), LOAD512(B)), _mm512_and_si512(LOAD512(C), LOAD512(D)));
+        count = _mm512_add_epi32(count, popcount_epi32_AVX512(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+
+// Counting kernels for CPUs with AVX-512 VPOPCNTDQ (Ice Lake, Zen 4 and newer).
+// They live in the AVX512 object, the dispatcher selects them at runtime.
+
+#define VPOPCNT_TARGET __attribute__((target("avx512f,avx512vpopcntdq")))
+
+VPOPCNT_TARGET uint32_t count_states_AVX512VPOPCNT(uint32_t *A) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = _mm512_add_epi32(count, _mm512_popcnt_epi32(LOAD512(A)));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+VPOPCNT_TARGET uint32_t count_bitarray_AND_AVX512VPOPCNT(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(LOAD512(A), LOAD512(B));
+        STORE512(A, a);
+        count = _mm512_add_epi32(count, _mm512_popcnt_epi32(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+VPOPCNT_TARGET uint32_t count_bitarray_low20_AND_AVX512VPOPCNT(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(LOAD512(A), low20_mask_AVX512(LOAD512(B)));
+        STORE512(A, a);
+        count = _mm512_add_epi32(count, _mm512_popcnt_epi32(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+VPOPCNT_TARGET uint32_t count_bitarray_AND2_AVX512VPOPCNT(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = _mm512_add_epi32(count, _mm512_popcnt_epi32(_mm512_and_si512(LOAD512(A), LOAD512(B))));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+VPOPCNT_TARGET uint32_t count_bitarray_AND3_AVX512VPOPCNT(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(_mm512_and_si512(LOAD512(A), LOAD512(B)), LOAD512(C));
+        count = _mm512_add_epi32(count, _mm512_popcnt_epi32(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+VPOPCNT_TARGET uint32_t count_bitarray_AND4_AVX512VPOPCNT(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        __m512i a = _mm512_and_si512(_mm512_and_si512(LOAD512(A), LOAD512(B)), _mm512_and_si512(LOAD512(C), LOAD512(D)));
+        count = _mm512_add_epi32(count, _mm512_popcnt_epi32(a));
+    }
+    return _mm512_reduce_add_epi32(count);
+}
+
+#endif
+
+#elif defined (__ARM_NEON) && !defined (NOSIMD_BUILD)
+
+// Explicit NEON kernels. Popcounts are done per byte with VCNT, four vectors
+// (one cache line) are summed per byte before widening into the 32 bit counters.
+
+static inline uint32x4_t popcount_acc_NEON(uint32x4_t count, uint32x4_t v0, uint32x4_t v1, uint32x4_t v2, uint32x4_t v3) {
+    uint8x16_t c01 = vaddq_u8(vcntq_u8(vreinterpretq_u8_u32(v0)), vcntq_u8(vreinterpretq_u8_u32(v1)));
+    uint8x16_t c23 = vaddq_u8(vcntq_u8(vreinterpretq_u8_u32(v2)), vcntq_u8(vreinterpretq_u8_u32(v3)));
+    return vpadalq_u16(count, vpaddlq_u8(vaddq_u8(c01, c23)));
+}
+
+static inline uint32_t popcount_sum_NEON(uint32x4_t count) {
+    uint64x2_t sum = vpaddlq_u32(count);
+    return (uint32_t)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+// keeps the halfwords of A whose counterpart in B is not zero
+static inline uint32x4_t low20_and_NEON(uint32x4_t a, uint32x4_t b) {
+    uint16x8_t b_zero = vceqq_u16(vreinterpretq_u16_u32(b), vdupq_n_u16(0));
+    return vreinterpretq_u32_u16(vbicq_u16(vreinterpretq_u16_u32(a), b_zero));
+}
+
+#define LOAD128(X, n) vld1q_u32(&(X)[i + 4 * (n)])
+#define STORE128(X, n, v) vst1q_u32(&(X)[i + 4 * (n)], (v))
+
+inline uint32_t COUNT_STATES(uint32_t *A) {
+    uint32x4_t count = vdupq_n_u32(0);
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = popcount_acc_NEON(count, LOAD128(A, 0), LOAD128(A, 1), LOAD128(A, 2), LOAD128(A, 3));
+    }
+    return popcount_sum_NEON(count);
+}
+
+
+inline void BITARRAY_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    for (uint32_t i = 0; i < (1 << 19); i += 4) {
+        STORE128(A, 0, vandq_u32(LOAD128(A, 0), LOAD128(B, 0)));
+    }
+}
+
+
+inline void BITARRAY_LOW20_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    for (uint32_t i = 0; i < (1 << 19); i += 4) {
+        STORE128(A, 0, low20_and_NEON(LOAD128(A, 0), LOAD128(B, 0)));
+    }
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    uint32x4_t count = vdupq_n_u32(0);
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        uint32x4_t a0 = vandq_u32(LOAD128(A, 0), LOAD128(B, 0));
+        uint32x4_t a1 = vandq_u32(LOAD128(A, 1), LOAD128(B, 1));
+        uint32x4_t a2 = vandq_u32(LOAD128(A, 2), LOAD128(B, 2));
+        uint32x4_t a3 = vandq_u32(LOAD128(A, 3), LOAD128(B, 3));
+        STORE128(A, 0, a0);
+        STORE128(A, 1, a1);
+        STORE128(A, 2, a2);
+        STORE128(A, 3, a3);
+        count = popcount_acc_NEON(count, a0, a1, a2, a3);
+    }
+    return popcount_sum_NEON(count);
+}
+
+
+inline uint32_t COUNT_BITARRAY_LOW20_AND(uint32_t *restrict A, uint32_t *restrict B) {
+    uint32x4_t count = vdupq_n_u32(0);
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        uint32x4_t a0 = low20_and_NEON(LOAD128(A, 0), LOAD128(B, 0));
+        uint32x4_t a1 = low20_and_NEON(LOAD128(A, 1), LOAD128(B, 1));
+        uint32x4_t a2 = low20_and_NEON(LOAD128(A, 2), LOAD128(B, 2));
+        uint32x4_t a3 = low20_and_NEON(LOAD128(A, 3), LOAD128(B, 3));
+        STORE128(A, 0, a0);
+        STORE128(A, 1, a1);
+        STORE128(A, 2, a2);
+        STORE128(A, 3, a3);
+        count = popcount_acc_NEON(count, a0, a1, a2, a3);
+    }
+    return popcount_sum_NEON(count);
+}
+
+
+inline void BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+    for (uint32_t i = 0; i < (1 << 19); i += 4) {
+        STORE128(A, 0, vandq_u32(vandq_u32(LOAD128(B, 0), LOAD128(C, 0)), LOAD128(D, 0)));
+    }
+}
+
+
+inline void BITARRAY_OR(uint32_t *restrict A, uint32_t *restrict B) {
+    for (uint32_t i = 0; i < (1 << 19); i += 4) {
+        STORE128(A, 0, vorrq_u32(LOAD128(A, 0), LOAD128(B, 0)));
+    }
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND2(uint32_t *restrict A, uint32_t *restrict B) {
+    uint32x4_t count = vdupq_n_u32(0);
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = popcount_acc_NEON(count,
+                                  vandq_u32(LOAD128(A, 0), LOAD128(B, 0)),
+                                  vandq_u32(LOAD128(A, 1), LOAD128(B, 1)),
+                                  vandq_u32(LOAD128(A, 2), LOAD128(B, 2)),
+                                  vandq_u32(LOAD128(A, 3), LOAD128(B, 3)));
+    }
+    return popcount_sum_NEON(count);
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND3(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C) {
+    uint32x4_t count = vdupq_n_u32(0);
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = popcount_acc_NEON(count,
+                                  vandq_u32(vandq_u32(LOAD128(A, 0), LOAD128(B, 0)), LOAD128(C, 0)),
+                                  vandq_u32(vandq_u32(LOAD128(A, 1), LOAD128(B, 1)), LOAD128(C, 1)),
+                                  vandq_u32(vandq_u32(LOAD128(A, 2), LOAD128(B, 2)), LOAD128(C, 2)),
+                                  vandq_u32(vandq_u32(LOAD128(A, 3), LOAD128(B, 3)), LOAD128(C, 3)));
+    }
+    return popcount_sum_NEON(count);
+}
+
+
+inline uint32_t COUNT_BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+    uint32x4_t count = vdupq_n_u32(0);
+    for (uint32_t i = 0; i < (1 << 19); i += 16) {
+        count = popcount_acc_NEON(count,
+                                  vandq_u32(vandq_u32(LOAD128(A, 0), LOAD128(B, 0)), vandq_u32(LOAD128(C, 0), LOAD128(D, 0))),
+                                  vandq_u32(vandq_u32(LOAD128(A, 1), LOAD128(B, 1)), vandq_u32(LOAD128(C, 1), LOAD128(D, 1))),
+                                  vandq_u32(vandq_u32(LOAD128(A, 2), LOAD128(B, 2)), vandq_u32(LOAD128(C, 2), LOAD128(D, 2))),
+                                  vandq_u32(vandq_u32(LOAD128(A, 3), LOAD128(B, 3)), vandq_u32(LOAD128(C, 3), LOAD128(D, 3))));
+    }
+    return popcount_sum_NEON(count);
+}
+
+#else
+
+// plain C, vectorised by the compiler for the instruction set of this compile pass
+
 inline uint32_t COUNT_STATES(uint32_t *A) {
     uint32_t count = 0;
     for (uint32_t i = 0; i < (1 << 19); i++) {
@@ -300,6 +626,8 @@ inline uint32_t COUNT_BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B,
     return count;
 }
 
+#endif
+
 
 #ifdef NOSIMD_BUILD
 
@@ -394,6 +722,10 @@ uint32_t count_states_dispatch(uint32_t *bitarray) {
     else
 #endif
 
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) count_states_function_p = &count_states_AVX512VPOPCNT;
+        else
+#endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         if (__builtin_cpu_supports("avx512f")) count_states_function_p = &count_states_AVX512;
         else
@@ -463,6 +795,10 @@ uint32_t count_bitarray_AND_dispatch(uint32_t *A, uint32_t *B) {
     else
 #endif
 
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX512VPOPCNT;
+        else
+#endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         if (__builtin_cpu_supports("avx512f")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX512;
         else
@@ -486,6 +822,10 @@ uint32_t count_bitarray_low20_AND_dispatch(uint32_t *A, uint32_t *B) {
     else
 #endif
 
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX512VPOPCNT;
+        else
+#endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         if (__builtin_cpu_supports("avx512f")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX512;
         else
@@ -555,6 +895,10 @@ uint32_t count_bitarray_AND2_dispatch(uint32_t *A, uint32_t *B) {
     else
 #endif
 
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX512VPOPCNT;
+        else
+#endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         if (__builtin_cpu_supports("avx512f")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX512;
         else
@@ -578,6 +922,10 @@ uint32_t count_bitarray_AND3_dispatch(uint32_t *A, uint32_t *B, uint32_t *C) {
     else
 #endif
 
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX512VPOPCNT;
+        else
+#endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         if (__builtin_cpu_supports("avx512f")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX512;
         else
@@ -601,6 +949,10 @@ uint32_t count_bitarray_AND4_dispatch(uint32_t *A, uint32_t *B, uint32_t *C, uin
     else
 #endif
 
+#if defined(COMPILER_HAS_SIMD_AVX512_VPOPCNT)
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX512VPOPCNT;
+        else
+#endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         if (__builtin_cpu_supports("avx512f")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX512;
         else
@@ -80,6 +80,13 @@ THE SOFTWARE.
 
 #define MIN_BUCKETS_SIZE                128
 
+// work items are split until they are smaller than 1/BF_GRAIN_PER_THREAD of a thread's share of the work
+#define BF_GRAIN_PER_THREAD             16
+// Don't split below these sizes. Every item bitslices its even states again, which must stay small compared to
+// the brute force itself. Even ranges are split at multiples of the widest bitslice (AVX512).
+#define BF_MIN_SPLIT_ODD                1024
+#define BF_MIN_SPLIT_EVEN               (16 * 512)
+
 typedef enum {
     EVEN_STATE = 0,
     ODD_STATE = 1
@@ -143,6 +150,117 @@ bool verify_key(uint32_t cuid, noncelist_t *nonces, const uint8_t *best_first_by
     }
     return true;
 }
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// work stealing scheduler
+//
+// Every thread owns a deque of work items, a bucket or a range of its odd or even states. A thread takes its work
+// from the tail of its own deque and, when that runs empty, steals from the head of the others. Items bigger than
+// the grain size are halved when taken, the second half goes to the tail of the own deque where idle threads can
+// steal it. A few oversized buckets therefore no longer leave the other threads idle near the end.
+
+typedef struct {
+    statelist_t *bucket;
+    uint32_t start[2];
+    uint32_t len[2];
+} bf_work_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    bf_work_t *items;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t allocated;
+    uint64_t keys_tested;     // updated by this thread only
+    uint64_t busy_time;
+} __attribute__((aligned(64))) bf_queue_t;
+
+static bf_queue_t *bf_queues = NULL;
+static uint32_t bf_num_queues = 0;
+static uint64_t bf_grain = 0;
+
+static inline uint64_t bf_work_size(const bf_work_t *w) {
+    return (uint64_t)w->len[ODD_STATE] * w->len[EVEN_STATE];
+}
+
+static bool bf_push(bf_queue_t *q, const bf_work_t *w) {
+    pthread_mutex_lock(&q->lock);
+    if (q->tail == q->allocated) {
+        if (q->head > 0) {
+            memmove(q->items, q->items + q->head, (q->tail - q->head) * sizeof(bf_work_t));
+            q->tail -= q->head;
+            q->head = 0;
+        } else {
+            uint32_t alloc_sz = q->allocated ? q->allocated * 2 : MIN_BUCKETS_SIZE;
+            bf_work_t *items = realloc(q->items, alloc_sz * sizeof(bf_work_t));
+            if (items == NULL) {
+                pthread_mutex_unlock(&q->lock);
+                return false;
+            }
+            q->items = items;
+            q->allocated = alloc_sz;
+        }
+    }
+    q->items[q->tail++] = *w;
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+static bool bf_pop(bf_queue_t *q, bf_work_t *w, bool steal) {
+    bool found = false;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *w = steal ? q->items[q->head++] : q->items[--q->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+static bool bf_take(uint32_t thread_id, bf_work_t *w) {
+    if (bf_pop(&bf_queues[thread_id], w, false)) {
+        return true;
+    }
+    for (uint32_t i = 1; i < bf_num_queues; i++) {
+        if (bf_pop(&bf_queues[(thread_id + i) % bf_num_queues], w, true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// halve w while it is bigger than the grain, pushing the second halves to the thread's own deque
+static void bf_split(bf_queue_t *q, bf_work_t *w) {
+    while (bf_work_size(w) > bf_grain) {
+        bf_work_t rest = *w;
+        odd_even_t half;
+        uint32_t mid;
+        if (w->len[ODD_STATE] >= 2 * BF_MIN_SPLIT_ODD) {
+            half = ODD_STATE;
+            mid = w->len[ODD_STATE] / 2;
+        } else if (w->len[EVEN_STATE] >= 2 * BF_MIN_SPLIT_EVEN) {
+            half = EVEN_STATE;
+            mid = (w->len[EVEN_STATE] / 2) & ~(512 - 1);
+        } else {
+            break;
+        }
+        // w keeps [start, start + mid), rest takes the remainder
+        rest.start[half] = w->start[half] + mid;
+        rest.len[half] = w->len[half] - mid;
+        if (bf_push(q, &rest) == false) {
+            break;
+        }
+        w->len[half] = mid;
+    }
+}
+
+static uint64_t bf_keys_tested(void) {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < bf_num_queues; i++) {
+        sum += __atomic_load_n(&bf_queues[i].keys_tested, __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
 static void *
 #ifdef __has_attribute
 #if __has_attribute(force_align_arg_pointer)
@@ -156,43 +274,64 @@ crack_states_thread(void *x) {
         uint32_t cuid;
         uint32_t num_acquired_nonces;
         uint64_t maximum_states;
+        uint64_t start_time;
         noncelist_t *nonces;
         uint8_t *best_first_bytes;
     } *thread_arg;
 
-    const int num_brute_force_threads = NUM_BRUTE_FORCE_THREADS;
     thread_arg = (struct arg *)x;
     const int thread_id = thread_arg->thread_ID;
-    uint32_t current_bucket = thread_id;
-    while (current_bucket < bucket_count) {
-        statelist_t *bucket = buckets[current_bucket];
-        if (bucket) {
+    bf_queue_t *q = &bf_queues[thread_id];
+    bf_work_t w;
+
+    while (keys_found == 0 && bf_take(thread_id, &w)) {
+        bf_split(q, &w);
+
+        statelist_t part = {
+            .states = { w.bucket->states[EVEN_STATE] + w.start[EVEN_STATE], w.bucket->states[ODD_STATE] + w.start[ODD_STATE] },
+            .len = { w.len[EVEN_STATE], w.len[ODD_STATE] },
+            .next = NULL,
+        };
 #if defined (DEBUG_BRUTE_FORCE)
-            PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on bucket " _YELLOW_("%u") "\n", thread_id, current_bucket);
+        PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on %u odd x %u even states", thread_id, part.len[ODD_STATE], part.len[EVEN_STATE]);
 #endif
-            const uint64_t key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, bucket, &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
-            if (key != -1) {
-                __atomic_fetch_add(&keys_found, 1, __ATOMIC_SEQ_CST);
-                __atomic_fetch_add(&found_bs_key, key, __ATOMIC_SEQ_CST);
-
-                char progress_text[80];
-                char keystr[19];
-                snprintf(keystr, sizeof(keystr), "%012" PRIX64 "  ", key);
-                snprintf(progress_text, sizeof(progress_text), "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
-                hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, 0.0, 0);
-                break;
-            } else if (keys_found) {
-                break;
-            } else {
-                if (!thread_arg->silent) {
-                    char progress_text[80];
-                    snprintf(progress_text, sizeof(progress_text), "Brute force phase: %6.02f%%  ", 100.0 * (float)num_keys_tested / (float)(thread_arg->maximum_states));
-                    float remaining_bruteforce = thread_arg->nonces[thread_arg->best_first_bytes[0]].expected_num_brute_force - (float)num_keys_tested / 2;
-                    hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, remaining_bruteforce, 5000);
-                }
+        uint64_t t0 = msclock();
+        const uint64_t key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, &part, &keys_found, &q->keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
+        __atomic_fetch_add(&q->busy_time, msclock() - t0, __ATOMIC_RELAXED);
+
+        if (key != -1) {
+            __atomic_fetch_add(&keys_found, 1, __ATOMIC_SEQ_CST);
+            __atomic_fetch_add(&found_bs_key, key, __ATOMIC_SEQ_CST);
+
+            char progress_text[80];
+            char keystr[19];
+            snprintf(keystr, sizeof(keystr), "%012" PRIX64 "  ", key);
+            snprintf(progress_text, sizeof(progress_text), "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
+            hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, 0.0, 0);
+            break;
+        } else if (keys_found) {
+            break;
+        } else if (!thread_arg->silent) {
+            // live throughput: overall rate for the ETA, slowest and fastest thread to spot imbalance
+            uint64_t tested = bf_keys_tested();
+            uint64_t elapsed = msclock() - thread_arg->start_time;
+            float min_rate = -1, max_rate = 0;
+            for (uint32_t i = 0; i < bf_num_queues; i++) {
+                uint64_t busy = __atomic_load_n(&bf_queues[i].busy_time, __ATOMIC_RELAXED);
+                uint64_t keys = __atomic_load_n(&bf_queues[i].keys_tested, __ATOMIC_RELAXED);
+                float rate = busy ? (float)keys / busy / 1000.0 : 0;
+                min_rate = (min_rate < 0 || rate < min_rate) ? rate : min_rate;
+                max_rate = MAX(rate, max_rate);
             }
+            if (elapsed > 0) {
+                hardnested_update_brute_force_rate((float)tested / elapsed * 1000.0);
+            }
+            char progress_text[80];
+            snprintf(progress_text, sizeof(progress_text), "Brute force phase: %6.02f%%  %u threads %.0f-%.0fM/s", 100.0 * (float)tested / (float)(thread_arg->maximum_states), bf_num_queues, min_rate, max_rate);
+            float remaining_bruteforce = thread_arg->nonces[thread_arg->best_first_bytes[0]].expected_num_brute_force - (float)tested / 2;
+            remaining_bruteforce = MIN(remaining_bruteforce, (float)(thread_arg->maximum_states - MIN(tested, thread_arg->maximum_states)));
+            hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, remaining_bruteforce, 5000);
         }
-        current_bucket += num_brute_force_threads;
     }
     return NULL;
 }
@@ -335,6 +474,7 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
 
     // count number of states to go
     bucket_count = 0;
+    uint64_t total_states = 0;
     for (statelist_t *p = candidates; p != NULL; p = p->next) {
         if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
             if (!ensure_buckets_alloc(bucket_count + 1)) {
@@ -344,6 +484,7 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
 
             buckets[bucket_count] = p;
             bucket_count++;
+            total_states += (uint64_t)p->len[ODD_STATE] * p->len[EVEN_STATE];
         }
     }
 
@@ -354,6 +495,27 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
         return false;
 #endif
 
+    // deal the buckets to the threads' deques, they are split and stolen as needed
+    bf_num_queues = num_brute_force_threads;
+    bf_grain = MAX(total_states / ((uint64_t)num_brute_force_threads * BF_GRAIN_PER_THREAD), 1);
+    bf_queue_t queues[num_brute_force_threads];
+    memset(queues, 0, sizeof(queues));
+    bf_queues = queues;
+    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+        pthread_mutex_init(&queues[i].lock, NULL);
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < bucket_count && ok; i++) {
+        bf_work_t w = {
+            .bucket = buckets[i],
+            .start = {0, 0},
+            .len = { buckets[i]->len[EVEN_STATE], buckets[i]->len[ODD_STATE] },
+        };
+        if (bf_work_size(&w) > 0) {
+            ok = bf_push(&queues[i % num_brute_force_threads], &w);
+        }
+    }
+
     pthread_t threads[num_brute_force_threads];
     struct args {
         bool silent;
@@ -361,23 +523,36 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
         uint32_t cuid;
         uint32_t num_acquired_nonces;
         uint64_t maximum_states;
+        uint64_t start_time;
         noncelist_t *nonces;
         uint8_t *best_first_bytes;
     } thread_args[num_brute_force_threads];
 
-    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+    for (uint32_t i = 0; i < num_brute_force_threads && ok; i++) {
         thread_args[i].thread_ID = i;
         thread_args[i].silent = silent;
         thread_args[i].cuid = cuid;
         thread_args[i].num_acquired_nonces = num_acquired_nonces;
         thread_args[i].maximum_states = maximum_states;
+        thread_args[i].start_time = start_time;
         thread_args[i].nonces = nonces;
         thread_args[i].best_first_bytes = best_first_bytes;
         pthread_create(&threads[i], NULL, crack_states_thread, (void *)&thread_args[i]);
     }
-    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+    for (uint32_t i = 0; i < num_brute_force_threads && ok; i++) {
         pthread_join(threads[i], 0);
     }
+    if (ok == false) {
+        PrintAndLogEx(ERR, "Can't allocate work queues, abort!");
+    }
+
+    num_keys_tested = bf_keys_tested();
+    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+        pthread_mutex_destroy(&queues[i].lock);
+        free(queues[i].items);
+    }
+    bf_queues = NULL;
+    bf_num_queues = 0;
 
     free(buckets);
     buckets = NULL;
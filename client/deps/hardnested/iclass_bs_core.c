@@ -0,0 +1,280 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced iCLASS MAC calculation
+//
+// Evaluates the iCLASS cipher (see client/src/loclass/cipher.c) for many
+// diversified keys at once. Every bit of the cipher state is held in a vector
+// where bit n belongs to key n, so a single pass computes 64 (NOSIMD, MMX),
+// 128 (SSE2, AVX, NEON), 256 (AVX2) or 512 (AVX-512) MACs.
+//
+// Like hardnested_bf_core.c this file is compiled once per instruction set
+// and the matching variant is selected at runtime.
+//-----------------------------------------------------------------------------
+
+#include "iclass_bs_core.h"
+
+#include <stdint.h>
+#include <string.h>
+#include "hardnested_bf_core.h"     // SIMDExecInstr, GetSIMDInstrAuto
+
+#if defined(__AVX512F__)
+#define MAX_BITSLICES 512
+#elif defined(__AVX2__)
+#define MAX_BITSLICES 256
+#elif defined(__AVX__)
+#define MAX_BITSLICES 128
+#elif defined(__SSE2__)
+#define MAX_BITSLICES 128
+#elif defined(__ARM_NEON) && !defined(NOSIMD_BUILD)
+#define MAX_BITSLICES 128
+#else // MMX or NOSIMD
+#define MAX_BITSLICES 64
+#endif
+
+#define VECTOR_SIZE (MAX_BITSLICES/8)
+typedef uint32_t __attribute__((aligned(VECTOR_SIZE))) __attribute__((vector_size(VECTOR_SIZE))) bitslice_value_t;
+typedef union {
+    bitslice_value_t value;
+    uint64_t bytes64[MAX_BITSLICES / 64];
+} bitslice_t;
+
+// this needs to be compiled several times for each instruction set.
+// For each instruction set, define a dedicated function name:
+#if defined (__AVX512F__)
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_AVX512
+#elif defined (__AVX2__)
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_AVX2
+#elif defined (__AVX__)
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_AVX
+#elif defined (__SSE2__)
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_SSE2
+#elif defined (__MMX__)
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_MMX
+#elif defined (__ARM_NEON) && !defined(NOSIMD_BUILD)
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_NEON
+#else
+#define ICLASS_MAC_BITSLICED iclass_mac_bitsliced_NOSIMD
+#endif
+
+// typedefs and declaration of functions:
+typedef void iclass_mac_bitsliced_t(const uint8_t *, const uint8_t *, uint8_t *, uint32_t);
+iclass_mac_bitsliced_t iclass_mac_bitsliced_AVX512;
+iclass_mac_bitsliced_t iclass_mac_bitsliced_AVX2;
+iclass_mac_bitsliced_t iclass_mac_bitsliced_AVX;
+iclass_mac_bitsliced_t iclass_mac_bitsliced_SSE2;
+iclass_mac_bitsliced_t iclass_mac_bitsliced_MMX;
+iclass_mac_bitsliced_t iclass_mac_bitsliced_NEON;
+iclass_mac_bitsliced_t iclass_mac_bitsliced_NOSIMD;
+
+// 64x64 bit matrix transpose, afterwards bit n of a[m] is bit m of the former a[n]
+static void transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+// the cipher state, bit 0 of each register is its least significant bit
+typedef struct {
+    bitslice_value_t l[8];
+    bitslice_value_t r[8];
+    bitslice_value_t b[8];
+    bitslice_value_t t[16];
+} bs_state_t;
+
+// out = a + b (mod 256)
+static inline void bs_add8(bitslice_value_t *out, const bitslice_value_t *a, const bitslice_value_t *b) {
+    bitslice_value_t carry = a[0] & b[0];
+    out[0] = a[0] ^ b[0];
+    for (int i = 1; i < 8; i++) {
+        bitslice_value_t x = a[i] ^ b[i];
+        out[i] = x ^ carry;
+        carry = (a[i] & b[i]) | (carry & x);
+    }
+}
+
+static inline void bs_const8(bitslice_value_t *out, uint8_t c, bitslice_value_t zero) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = ((c >> i) & 1) ? ~zero : zero;
+    }
+}
+
+// successor state, see successor() in cipher.c. The paper numbers register bits
+// from the most significant end, so r0 is r[7] and r7 is r[0] here.
+static inline void bs_successor(bs_state_t *s, const bitslice_value_t k[8][8], bitslice_value_t y) {
+
+    const bitslice_value_t *r = s->r;
+
+    bitslice_value_t tt = s->t[15] ^ s->t[14] ^ s->t[10] ^ s->t[8] ^ s->t[5] ^ s->t[4] ^ s->t[1] ^ s->t[0];
+    bitslice_value_t bb = s->b[6] ^ s->b[5] ^ s->b[4] ^ s->b[0];
+
+    // select(T(t), y, r)
+    bitslice_value_t z0 = (r[7] & r[5]) ^ (r[6] & ~r[4]) ^ (r[5] | r[3]);
+    bitslice_value_t z1 = (r[7] | r[5]) ^ (r[2] | r[0]) ^ r[6] ^ r[1] ^ tt ^ y;
+    bitslice_value_t z2 = (r[4] & ~r[2]) ^ (r[3] & r[1]) ^ r[0] ^ tt;
+
+    bitslice_value_t t15 = tt ^ r[7] ^ r[3];
+    bitslice_value_t b7 = bb ^ r[0];
+
+    for (int i = 0; i < 15; i++) {
+        s->t[i] = s->t[i + 1];
+    }
+    s->t[15] = t15;
+    for (int i = 0; i < 7; i++) {
+        s->b[i] = s->b[i + 1];
+    }
+    s->b[7] = b7;
+
+    // k[select(...)] ^ b', the key byte is picked by an 8:1 multiplexer per bit
+    bitslice_value_t v[8];
+    for (int i = 0; i < 8; i++) {
+        bitslice_value_t m0 = k[0][i] ^ (z2 & (k[0][i] ^ k[1][i]));
+        bitslice_value_t m1 = k[2][i] ^ (z2 & (k[2][i] ^ k[3][i]));
+        bitslice_value_t m2 = k[4][i] ^ (z2 & (k[4][i] ^ k[5][i]));
+        bitslice_value_t m3 = k[6][i] ^ (z2 & (k[6][i] ^ k[7][i]));
+        bitslice_value_t n0 = m0 ^ (z1 & (m0 ^ m1));
+        bitslice_value_t n1 = m2 ^ (z1 & (m2 ^ m3));
+        v[i] = (n0 ^ (z0 & (n0 ^ n1))) ^ s->b[i];
+    }
+
+    // r' = v + l, l' = v + l + r
+    bitslice_value_t sum[8];
+    bs_add8(sum, v, s->l);
+    bs_add8(s->l, sum, s->r);
+    memcpy(s->r, sum, sizeof(sum));
+}
+
+void ICLASS_MAC_BITSLICED(const uint8_t *cc_nr, const uint8_t *div_keys, uint8_t *macs, uint32_t count) {
+
+    const bitslice_value_t zero = {0};
+    const bitslice_value_t ones = ~zero;
+
+    for (uint32_t base = 0; base < count; base += MAX_BITSLICES) {
+
+        uint32_t n = count - base;
+        if (n > MAX_BITSLICES) {
+            n = MAX_BITSLICES;
+        }
+
+        // transpose the keys into bitslices, one 64x64 block per 64 keys
+        bitslice_t ks[64];
+        for (uint32_t w = 0; w < MAX_BITSLICES / 64; w++) {
+            uint64_t block[64] = {0};
+            for (uint32_t j = 0; j < 64 && w * 64 + j < n; j++) {
+                const uint8_t *key = div_keys + 8 * (base + w * 64 + j);
+                for (int i = 0; i < 8; i++) {
+                    block[j] |= (uint64_t)key[i] << (8 * i);
+                }
+            }
+            transpose64(block);
+            for (int bit = 0; bit < 64; bit++) {
+                ks[bit].bytes64[w] = block[bit];
+            }
+        }
+
+        bitslice_value_t k[8][8];
+        for (int i = 0; i < 8; i++) {
+            for (int bit = 0; bit < 8; bit++) {
+                k[i][bit] = ks[i * 8 + bit].value;
+            }
+        }
+
+        // initial state, see init() in cipher.c
+        bs_state_t s;
+        bitslice_value_t k0[8], c[8];
+        for (int i = 0; i < 8; i++) {
+            k0[i] = ((0x4c >> i) & 1) ? ~k[0][i] : k[0][i];
+        }
+        bs_const8(c, 0xEC, zero);
+        bs_add8(s.l, k0, c);
+        bs_const8(c, 0x21, zero);
+        bs_add8(s.r, k0, c);
+        bs_const8(s.b, 0x4c, zero);
+        for (int i = 0; i < 16; i++) {
+            s.t[i] = ((0xE012 >> i) & 1) ? ones : zero;
+        }
+
+        // feed cc_nr, least significant bit of each byte first
+        for (int i = 0; i < 12 * 8; i++) {
+            bs_successor(&s, (const bitslice_value_t (*)[8])k, ((cc_nr[i >> 3] >> (i & 7)) & 1) ? ones : zero);
+        }
+
+        // clock out 32 bits of MAC, taken from r5
+        bitslice_t out[32];
+        for (int i = 0; i < 32; i++) {
+            out[i].value = s.r[2];
+            bs_successor(&s, (const bitslice_value_t (*)[8])k, zero);
+        }
+
+        // transpose back, bit i of the MAC is bit (i & 7) of mac byte (i >> 3)
+        for (uint32_t w = 0; w < MAX_BITSLICES / 64 && w * 64 < n; w++) {
+            uint64_t block[64] = {0};
+            for (int bit = 0; bit < 32; bit++) {
+                block[bit] = out[bit].bytes64[w];
+            }
+            transpose64(block);
+            for (uint32_t j = 0; j < 64 && w * 64 + j < n; j++) {
+                uint8_t *mac = macs + 4 * (base + w * 64 + j);
+                mac[0] = block[j] & 0xFF;
+                mac[1] = (block[j] >> 8) & 0xFF;
+                mac[2] = (block[j] >> 16) & 0xFF;
+                mac[3] = (block[j] >> 24) & 0xFF;
+            }
+        }
+    }
+}
+
+#ifdef NOSIMD_BUILD
+
+// determine the available instruction set at runtime and call the correct function
+void iclass_mac_bitsliced(const uint8_t *cc_nr, const uint8_t *div_keys, uint8_t *macs, uint32_t count) {
+    switch (GetSIMDInstrAuto()) {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        case SIMD_AVX512:
+            iclass_mac_bitsliced_AVX512(cc_nr, div_keys, macs, count);
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+        case SIMD_AVX2:
+            iclass_mac_bitsliced_AVX2(cc_nr, div_keys, macs, count);
+            break;
+        case SIMD_AVX:
+            iclass_mac_bitsliced_AVX(cc_nr, div_keys, macs, count);
+            break;
+        case SIMD_SSE2:
+            iclass_mac_bitsliced_SSE2(cc_nr, div_keys, macs, count);
+            break;
+        case SIMD_MMX:
+            iclass_mac_bitsliced_MMX(cc_nr, div_keys, macs, count);
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            iclass_mac_bitsliced_NEON(cc_nr, div_keys, macs, count);
+            break;
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+            iclass_mac_bitsliced_NOSIMD(cc_nr, div_keys, macs, count);
+            break;
+    }
+}
+
+#endif
@@ -0,0 +1,32 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced iCLASS MAC calculation
+//-----------------------------------------------------------------------------
+
+#ifndef ICLASS_BS_CORE_H__
+#define ICLASS_BS_CORE_H__
+
+#include <stdint.h>
+
+// callers should hand over keys in batches of this size to fill the widest vectors (AVX-512)
+#define ICLASS_BS_BATCH 512
+
+// Calculates the iCLASS MAC over the same 12 byte cc_nr for 'count' diversified keys.
+// div_keys holds count * 8 bytes, macs receives count * 4 bytes.
+// Results are identical to calling doMAC() once per key.
+void iclass_mac_bitsliced(const uint8_t *cc_nr, const uint8_t *div_keys, uint8_t *macs, uint32_t count);
+
+#endif
@@ -4,6 +4,7 @@ add_library(pm3rrg_rdv4_reveng STATIC
         reveng/model.c
         reveng/poly.c
         reveng/preset.c
+        reveng/psearch.c
         reveng/reveng.c
 )
 
@@ -11,7 +12,8 @@ target_compile_definitions(pm3rrg_rdv4_reveng PRIVATE PRESETS)
 target_include_directories(pm3rrg_rdv4_reveng PRIVATE
         cliparser
         ../src
-        ../../include)
+        ../../include
+        ../../common)
 target_include_directories(pm3rrg_rdv4_reveng INTERFACE reveng)
 target_compile_options(pm3rrg_rdv4_reveng PRIVATE -Wall -Werror -O3)
 set_property(TARGET pm3rrg_rdv4_reveng PROPERTY POSITION_INDEPENDENT_CODE ON)
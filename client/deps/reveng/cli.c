@@ -63,12 +63,15 @@
 #endif /* _WIN32 */
 
 #include "reveng.h"
+#include "util_posix.h"   // usclock
 
 static FILE *oread(const char *);
 static poly_t rdpoly(const char *, int, int);
 static void usage(void);
+static int bench(unsigned long maxwidth);
 
 static const char *myname = "reveng"; /* name of our program */
+static int quiet = 0;                  /* suppress results and progress */
 
 int reveng_main(int argc, char *argv[]) {
     /* Command-line interface for CRC RevEng.
@@ -102,7 +105,7 @@ int reveng_main(int argc, char *argv[]) {
     // Remember to consume always all the option string till getopt returns -1 !
     // else next invocations will be corrupted
     do {
-        c = getopt(argc, argv, "?A:BDFGLMP:SVXa:bcdefhi:k:lm:p:q:rstuvw:x:yz");
+        c = getopt(argc, argv, "?A:BDFGLMNP:STVXa:bcdefhi:k:lm:p:q:rstuvw:x:yz");
         switch (c) {
             case 'A': /* A: bits per output character */
             case 'a': /* a: bits per character */
@@ -130,6 +133,7 @@ int reveng_main(int argc, char *argv[]) {
             case 'd': /* d  dump CRC model */
             case 'e': /* e  echo arguments */
             case 's': /* s  search for algorithm */
+            case 'T': /* T  benchmark the search */
             case 'v': /* v  calculate reversed CRC */
                 if (mode) {
                     fprintf(stderr, "%s: more than one mode switch specified.  Use %s -h for help.\n", myname, myname);
@@ -202,6 +206,9 @@ int reveng_main(int argc, char *argv[]) {
             case 'M': /* M  non-augmenting algorithm */
                 model.flags &= ~P_MULXN;
                 break;
+            case 'N': /* N  arbitrary-precision search only */
+                rflags |= R_BITWISE;
+                break;
             case 'p': /* p: polynomial */
                 pptr = &model.spoly;
                 rflags &= ~R_HAVEQ;
@@ -514,6 +521,8 @@ ipqx:
                 uerror("no models found");
 
             break;
+        case 'T': /* T  benchmark the search */
+            return bench(width ? width : 16UL);
         default:  /* no mode specified */
             fprintf(stderr, "%s: no mode switch specified. Use %s -h for help.\n", myname, myname);
             return 0;
@@ -527,7 +536,7 @@ ufound(const model_t *model) {
     /* Callback function to report each model found */
     char *string;
 
-    if (!model) return;
+    if (!model || quiet) return;
     /* generated models will be canonical */
     string = mtostr(model);
     puts(string);
@@ -547,7 +556,7 @@ uprog(const poly_t gpoly, int flags, unsigned long seq) {
     char *string;
 
     /* Suppress first report in CLI */
-    if (!seq)
+    if (!seq || quiet)
         return;
     string = ptostr(gpoly, P_RTJUST, 4);
     fprintf(stderr, "%s: searching: width=%lu  poly=0x%s  refin=%s  refout=%s\n",
@@ -560,6 +569,108 @@ uprog(const poly_t gpoly, int flags, unsigned long seq) {
     free(string);
 }
 
+static int
+bench(unsigned long maxwidth) {
+    /* Times the native word search against the arbitrary-precision
+     * one.  For every preset algorithm up to maxwidth bits wide both
+     * search codewords of the same few messages,  and must agree and
+     * find the preset.
+     */
+    static const char *msgs[] = {"0123456789ab", "5a3c96e10f42", "31415926535897", "271828182845904523"};
+    const int nmsgs = sizeof(msgs) / sizeof(msgs[0]);
+    model_t pset = MZERO, guess = MZERO, *fast, *slow, *fptr, *sptr;
+    poly_t apolys[sizeof(msgs) / sizeof(msgs[0])], crc, xorout, qpoly = PZERO;
+    unsigned long width, alen;
+    uint64_t t0, t1, t2, tfast = 0, tslow = 0;
+    int psets, n, i, found, same, failed = 0;
+
+    psets = mcount();
+    if (!psets) {
+        uerror("no preset models available");
+        return 0;
+    }
+
+    fprintf(stderr, "%-24s width      native  arb.-precision  speedup", "algorithm");
+    quiet = 1;
+    for (n = 0; n < psets; ++n) {
+        mbynum(&pset, n);
+        width = plen(pset.spoly);
+        /* crossed-endian algorithms cannot be searched */
+        if (width > maxwidth || !(pset.flags & P_REFIN) != !(pset.flags & P_REFOUT))
+            continue;
+
+        /* codeword = message and CRC,  xorout follows refout as with -c */
+        xorout = pclone(pset.xorout);
+        if (pset.flags & P_REFOUT)
+            prev(&xorout);
+        for (i = 0; i < nmsgs; ++i) {
+            apolys[i] = strtop(msgs[i], pset.flags, 8);
+            crc = pcrc(apolys[i], pset.spoly, pset.init, xorout, pset.flags);
+            alen = plen(apolys[i]);
+            praloc(&apolys[i], alen + width);
+            psum(&apolys[i], crc, alen);
+            pfree(&crc);
+        }
+        pfree(&xorout);
+
+        palloc(&guess.spoly, width);
+        palloc(&guess.init, width);
+        palloc(&guess.xorout, width);
+        guess.flags = P_MULXN | (pset.flags & (P_REFIN | P_REFOUT));
+
+        t0 = usclock();
+        fast = reveng(&guess, qpoly, R_HAVERI | R_HAVERO, nmsgs, apolys);
+        t1 = usclock();
+        slow = reveng(&guess, qpoly, R_HAVERI | R_HAVERO | R_BITWISE, nmsgs, apolys);
+        t2 = usclock();
+        tfast += t1 - t0;
+        tslow += t2 - t1;
+
+        found = 0;
+        same = fast && slow;
+        for (fptr = fast, sptr = slow; same && plen(fptr->spoly); ++fptr, ++sptr) {
+            if (pcmp(&fptr->spoly, &sptr->spoly) || psncmp(&fptr->init, &sptr->init) || psncmp(&fptr->xorout, &sptr->xorout))
+                same = 0;
+            if (!pcmp(&fptr->spoly, &pset.spoly) && !psncmp(&fptr->init, &pset.init) && !psncmp(&fptr->xorout, &pset.xorout))
+                found = 1;
+        }
+        if (same && plen(sptr->spoly))
+            same = 0;
+        if (!same || !found)
+            ++failed;
+
+        fprintf(stderr, "%-24s %5lu %8.2f ms %12.2f ms %7.1fx  %s",
+                pset.name ? pset.name : "",
+                width,
+                (t1 - t0) / 1000.0,
+                (t2 - t1) / 1000.0,
+                (double)(t2 - t1) / (t1 > t0 ? t1 - t0 : 1),
+                !same ? "results differ" : !found ? "preset not found" : "ok"
+               );
+
+        for (fptr = fast; fptr && plen(fptr->spoly); ++fptr)
+            mfree(fptr);
+        free(fast);
+        for (sptr = slow; sptr && plen(sptr->spoly); ++sptr)
+            mfree(sptr);
+        free(slow);
+        for (i = 0; i < nmsgs; ++i)
+            pfree(&apolys[i]);
+    }
+    quiet = 0;
+    mfree(&pset);
+    mfree(&guess);
+
+    fprintf(stderr, "%-24s       %8.2f ms %12.2f ms %7.1fx  %s",
+            "total",
+            tfast / 1000.0,
+            tslow / 1000.0,
+            (double) tslow / (tfast ? tfast : 1),
+            failed ? "FAILED" : "ok"
+           );
+    return !failed;
+}
+
 static poly_t
 rdpoly(const char *name, int flags, int bperhx) {
     /* read poly from file in chunks and report errors */
@@ -612,7 +723,7 @@ usage(void) {
             "Usage:\t");
     fputs(myname, stderr);
     fprintf(stderr,
-            "\t-cdDesvhu? [-bBfFGlLMrStVXyz]\n"
+            "\t-cdDesTvhu? [-bBfFGlLMNrStVXyz]\n"
             "\t\t[-a BITS] [-A OBITS] [-i INIT] [-k KPOLY] [-m MODEL] [-p POLY]\n"
             "\t\t[-p POLY] [-P RPOLY] [-q QPOLY] [-w WIDTH] [-x XOROUT] [STRING...]\n"
             "Options:\n"
@@ -633,6 +744,7 @@ usage(void) {
             "\t-f read files named in STRINGs\t-F skip preset model check pass\n"
             "\t-G skip brute force search pass\t-l little-endian CRC\n"
             "\t-L little-endian CRC output\t-M non-augmenting algorithm\n"
+            "\t-N arbitrary-precision search only\n"
             "\t-r right-justified output\t-S print spaces between characters\n"
             "\t-t left-justified output\t-V reverse algorithm only\n"
             "\t-X print uppercase hexadecimal\t-y low bytes first in files\n"
@@ -642,6 +754,7 @@ usage(void) {
             "\t-c calculate CRCs\t\t-d dump algorithm parameters\n"
             "\t-D list preset algorithms\t-e echo (and reformat) input\n"
             "\t-s search for algorithm\t\t-v calculate reversed CRCs\n"
+            "\t-T benchmark the search on the preset algorithms up to WIDTH (16)\n"
             "\t-g search for alg given hex+crc\n"
             "\t-h | -u | -? show this help\n"
             "Common Use Examples:\n"
@@ -653,6 +766,9 @@ usage(void) {
             "\t      the crc on the end of the given hex string(s)\n"
             "\t   reveng -m CRC-8 -c 01020304\n"
             "\t      Calculates the crc-8 of the given hex string\n"
+            "\t   reveng -w 16 -T\n"
+            "\t      Times the native word search against the arbitrary-precision\n"
+            "\t      one on codewords of every preset up to 16 bits wide\n"
             "\t   reveng -D\n"
             "\t      Outputs a list of all known/common crc models with their\n"
             "\t      preset values\n"
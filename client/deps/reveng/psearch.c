@@ -0,0 +1,306 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Native word polynomial search for CRC RevEng,  widths up to 64 bits
+//-----------------------------------------------------------------------------
+
+/* reveng() tries every polynomial of the searched width and keeps the ones
+ * dividing all the differences between the arguments.  On poly_t that is a
+ * pcrc() with its allocations per candidate and per difference.  For widths
+ * up to 64 the remainder fits a machine word,  so here each candidate gets a
+ * 16 entry table of x^(w+i) mod P and the differences are divided four bits
+ * at a time.  The candidate range is handed out in chunks to one thread per
+ * cpu and the survivors are returned sorted,  in the same order as the
+ * arbitrary-precision loop would find them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "reveng.h"
+#include "util.h"            // num_CPUs
+
+/* candidates handed out to a thread at a time */
+#define PS_CHUNK        0x10000UL
+#define PS_MAXTHREADS   64
+
+typedef struct {
+    uint8_t *nibs;          /* the difference,  most significant nibble first */
+    unsigned long len;      /* number of nibbles */
+} psdiff_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    const psdiff_t *diffs;
+    unsigned long width;
+    uint64_t mask;
+    uint64_t first;         /* first candidate,  always odd */
+    uint64_t count;         /* candidates in the range */
+    uint64_t next;          /* index of the next candidate to hand out */
+    int flags;              /* for the progress reports */
+    uint64_t *cands;
+    unsigned long candc;
+    unsigned long cands_max;
+    int oom;
+} psstate_t;
+
+static uint64_t
+ptou(const poly_t poly) {
+    /* poly as a right-justified word,  poly must be at most 64 bits long */
+    uint64_t value = 0;
+    unsigned long iter;
+
+    for (iter = 0UL; iter < poly.length; ++iter)
+        value = (value << 1) | ((poly.bitmap[iter / BMP_BIT] >> (BMP_BIT - 1UL - iter % BMP_BIT)) & 1U);
+    return (value);
+}
+
+static poly_t
+utop(uint64_t value, unsigned long width) {
+    /* a CLEAN poly of width bits from a right-justified word */
+    poly_t poly = PZERO;
+    unsigned long iter;
+
+    palloc(&poly, width);
+    if (!poly.bitmap)
+        return (poly);
+    for (iter = 0UL; iter < width; ++iter) {
+        if ((value >> (width - 1UL - iter)) & 1U)
+            poly.bitmap[iter / BMP_BIT] |= BMP_C(1) << (BMP_BIT - 1UL - iter % BMP_BIT);
+    }
+    return (poly);
+}
+
+static inline uint64_t
+mulx(uint64_t rem, uint64_t gpoly, unsigned long width, uint64_t mask) {
+    /* rem * x mod (x^width + gpoly) */
+    return (((rem << 1) & mask) ^ (((rem >> (width - 1UL)) & 1U) ? gpoly : 0));
+}
+
+static int
+pdivs(const psdiff_t *diffs, uint64_t gpoly, unsigned long width, uint64_t mask) {
+    /* Returns nonzero if x^width + gpoly divides every difference.
+     * The differences come shortest first,  so most candidates are
+     * rejected by the first one.
+     */
+    const psdiff_t *dptr;
+    uint64_t tab[16], rem;
+    unsigned long iter;
+    int bit, i;
+
+    if (width < 4UL) {
+        for (dptr = diffs; dptr->len; ++dptr) {
+            rem = 0;
+            for (iter = 0UL; iter < dptr->len; ++iter) {
+                for (bit = 3; bit >= 0; --bit)
+                    rem = mulx(rem, gpoly, width, mask) ^ ((dptr->nibs[iter] >> bit) & 1U);
+            }
+            if (rem)
+                return (0);
+        }
+        return (1);
+    }
+
+    /* tab[i] = i * x^width mod P,  by linearity from the four single terms */
+    tab[0] = 0;
+    tab[1] = gpoly;
+    tab[2] = mulx(tab[1], gpoly, width, mask);
+    tab[4] = mulx(tab[2], gpoly, width, mask);
+    tab[8] = mulx(tab[4], gpoly, width, mask);
+    for (i = 3; i < 16; ++i) {
+        if (i & (i - 1))
+            tab[i] = tab[i & (i - 1)] ^ tab[i & -i];
+    }
+
+    for (dptr = diffs; dptr->len; ++dptr) {
+        rem = 0;
+        for (iter = 0UL; iter < dptr->len; ++iter)
+            rem = ((rem << 4) & mask) ^ tab[rem >> (width - 4UL)] ^ dptr->nibs[iter];
+        if (rem)
+            return (0);
+    }
+    return (1);
+}
+
+static void
+psrun(psstate_t *st, int report) {
+    /* take chunks of candidates until the range is exhausted.
+     * Only the calling thread reports progress.
+     */
+    uint64_t start, end, idx, gpoly, nextrep = 0;
+    uint64_t *found = NULL, *tmp;
+    unsigned long foundc = 0UL, found_max = 0UL, seq = 0UL;
+    poly_t ppoly;
+
+    for (;;) {
+        pthread_mutex_lock(&st->lock);
+        start = st->next;
+        end = (st->count - start > PS_CHUNK) ? start + PS_CHUNK : st->count;
+        st->next = end;
+        pthread_mutex_unlock(&st->lock);
+        if (start >= end)
+            break;
+
+        if (report && start >= nextrep) {
+            ppoly = utop(st->first + (start << 1), st->width);
+            uprog(ppoly, st->flags, seq++);
+            pfree(&ppoly);
+            nextrep = (start | R_SPMASK) + 1U;
+        }
+
+        for (idx = start; idx < end; ++idx) {
+            gpoly = st->first + (idx << 1);
+            if (!pdivs(st->diffs, gpoly, st->width, st->mask))
+                continue;
+            if (foundc == found_max) {
+                found_max = found_max ? found_max << 1 : 64UL;
+                tmp = realloc(found, found_max * sizeof(uint64_t));
+                if (!tmp) {
+                    st->oom = 1;
+                    free(found);
+                    return;
+                }
+                found = tmp;
+            }
+            found[foundc++] = gpoly;
+        }
+    }
+
+    if (!foundc)
+        return;
+
+    pthread_mutex_lock(&st->lock);
+    if (st->candc + foundc > st->cands_max) {
+        tmp = realloc(st->cands, (st->candc + foundc) * sizeof(uint64_t));
+        if (tmp) {
+            st->cands = tmp;
+            st->cands_max = st->candc + foundc;
+        } else {
+            st->oom = 1;
+        }
+    }
+    if (!st->oom) {
+        memcpy(st->cands + st->candc, found, foundc * sizeof(uint64_t));
+        st->candc += foundc;
+    }
+    pthread_mutex_unlock(&st->lock);
+    free(found);
+}
+
+static void *
+psworker(void *arg) {
+    psrun((psstate_t *) arg, 0);
+    return NULL;
+}
+
+static int
+ucmp(const void *a, const void *b) {
+    uint64_t ua = *(const uint64_t *) a, ub = *(const uint64_t *) b;
+    return (ua > ub) - (ua < ub);
+}
+
+poly_t *
+psearch(const poly_t gpoly, const poly_t qpoly, int rflags, int flags, const poly_t *pworks) {
+    /* Search the odd polynomials from gpoly up (to qpoly if R_HAVEQ) for
+     * divisors of every difference in pworks,  the way reveng() does.
+     * Returns the candidates in ascending order,  terminated by a zero
+     * length poly,  or NULL if the fast path does not apply and the
+     * caller has to fall back to the arbitrary-precision search.
+     */
+    unsigned long width = plen(gpoly), ndiffs, len, pad, iter, pos;
+    uint64_t last, q;
+    const poly_t *wptr;
+    psdiff_t *diffs;
+    psstate_t st;
+    pthread_t threads[PS_MAXTHREADS];
+    poly_t *result = NULL;
+    int nthreads, started, i;
+
+    if (rflags & R_BITWISE || width == 0UL || width > PS_MAXW)
+        return (NULL);
+
+    memset(&st, 0, sizeof(st));
+    st.width = width;
+    st.mask = (width == 64UL) ? UINT64_MAX : (((uint64_t) 1 << width) - 1U);
+    st.first = ptou(gpoly) | 1U;
+    st.flags = flags;
+
+    /* the polys compared as in pcmp(),  a longer qpoly never ends the range */
+    last = st.mask;
+    if (rflags & R_HAVEQ && plen(qpoly) < width) {
+        last = 0;
+    } else if (rflags & R_HAVEQ && plen(qpoly) == width) {
+        q = ptou(qpoly);
+        last = (q <= st.first) ? 0 : (q & 1U) ? q - 2U : q - 1U;
+    }
+    st.count = (last >= st.first) ? ((last - st.first) >> 1) + 1U : 0;
+
+    for (ndiffs = 0UL, wptr = pworks; plen(*wptr); ++wptr)
+        ++ndiffs;
+
+    diffs = calloc(ndiffs + 1UL, sizeof(psdiff_t));
+    if (!diffs)
+        return (NULL);
+
+    /* pad each difference with leading zeroes to whole nibbles */
+    for (iter = 0UL; iter < ndiffs; ++iter) {
+        len = plen(pworks[iter]);
+        pad = (4UL - (len & 3UL)) & 3UL;
+        diffs[iter].nibs = calloc((len + pad) >> 2, sizeof(uint8_t));
+        if (!diffs[iter].nibs)
+            goto out;
+        diffs[iter].len = (len + pad) >> 2;
+        for (pos = 0UL; pos < len; ++pos) {
+            if ((pworks[iter].bitmap[pos / BMP_BIT] >> (BMP_BIT - 1UL - pos % BMP_BIT)) & 1U)
+                diffs[iter].nibs[(pos + pad) >> 2] |= 1U << (3UL - ((pos + pad) & 3UL));
+        }
+    }
+    st.diffs = diffs;
+
+    nthreads = num_CPUs();
+    if (nthreads > PS_MAXTHREADS)
+        nthreads = PS_MAXTHREADS;
+    if (nthreads < 1 || st.count < (uint64_t) PS_CHUNK << 1)
+        nthreads = 1;
+
+    pthread_mutex_init(&st.lock, NULL);
+    for (started = 1; started < nthreads; ++started) {
+        if (pthread_create(&threads[started], NULL, psworker, &st))
+            break;
+    }
+    psrun(&st, 1);
+    for (i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&st.lock);
+
+    if (st.oom)
+        goto out;
+
+    qsort(st.cands, st.candc, sizeof(uint64_t), ucmp);
+    result = calloc(st.candc + 1UL, sizeof(poly_t));
+    if (!result)
+        goto out;
+    for (iter = 0UL; iter < st.candc; ++iter)
+        result[iter] = utop(st.cands[iter], width);
+
+out:
+    free(st.cands);
+    for (iter = 0UL; iter < ndiffs; ++iter)
+        free(diffs[iter].nibs);
+    free(diffs);
+    return (result);
+}
@@ -58,13 +58,14 @@ static void engini(int *resc, model_t **result, const poly_t divisor, int flags,
 static void calout(int *resc, model_t **result, const poly_t divisor, const poly_t init, int flags, int args, const poly_t *argpolys);
 static void calini(int *resc, model_t **result, const poly_t divisor, int flags, const poly_t xorout, int args, const poly_t *argpolys);
 static void chkres(int *resc, model_t **result, const poly_t divisor, const poly_t init, int flags, const poly_t xorout, int args, const poly_t *argpolys);
+static void candpol(int *resc, model_t **result, const poly_t gpoly, const model_t *guess, int rflags, int args, const poly_t *argpolys);
 
 static const poly_t pzero = PZERO;
 
 model_t *
 reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys) {
     /* Complete the parameters of a model by calculation or brute search. */
-    poly_t *pworks, *wptr, rem, gpoly;
+    poly_t *pworks, *wptr, *cands, *cptr, rem, gpoly;
     model_t *result = NULL, *rptr;
     int resc = 0;
     unsigned long spin = 0, seq = 0;
@@ -87,39 +88,40 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
         if (plen(gpoly))
             pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
 
-        while (piter(&gpoly) && (~rflags & R_HAVEQ || pcmp(&gpoly, &qpoly) < 0)) {
-            /* For each possible poly of this size, try
-             * dividing all the differences in the list.
-             */
-            if (!(spin++ & R_SPMASK)) {
-                uprog(gpoly, guess->flags, seq++);
+        /* Widths up to PS_MAXW are searched on machine words,
+         * which yields the same candidates in the same order.
+         */
+        if ((cands = psearch(gpoly, qpoly, rflags, guess->flags, pworks))) {
+            for (cptr = cands; plen(*cptr); ++cptr) {
+                candpol(&resc, &result, *cptr, guess, rflags, args, argpolys);
+                pfree(cptr);
             }
-            for (wptr = pworks; plen(*wptr); ++wptr) {
-                /* straight divide message by poly, don't multiply by x^n */
-                rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
-                if (ptst(rem)) {
-                    pfree(&rem);
+            free(cands);
+        } else {
+            while (piter(&gpoly) && (~rflags & R_HAVEQ || pcmp(&gpoly, &qpoly) < 0)) {
+                /* For each possible poly of this size, try
+                 * dividing all the differences in the list.
+                 */
+                if (!(spin++ & R_SPMASK)) {
+                    uprog(gpoly, guess->flags, seq++);
+                }
+                for (wptr = pworks; plen(*wptr); ++wptr) {
+                    /* straight divide message by poly, don't multiply by x^n */
+                    rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
+                    if (ptst(rem)) {
+                        pfree(&rem);
+                        break;
+                    } else
+                        pfree(&rem);
+                }
+                /* If gpoly divides all the differences, it is a
+                 * candidate.
+                 */
+                if (!plen(*wptr))
+                    candpol(&resc, &result, gpoly, guess, rflags, args, argpolys);
+                if (!piter(&gpoly))
                     break;
-                } else
-                    pfree(&rem);
-            }
-            /* If gpoly divides all the differences, it is a
-             * candidate.  Search for an Init value for this
-             * poly or if Init is known, log the result.
-             */
-            if (!plen(*wptr)) {
-                /* gpoly is a candidate poly */
-                if (rflags & R_HAVEI && rflags & R_HAVEX)
-                    chkres(&resc, &result, gpoly, guess->init, guess->flags, guess->xorout, args, argpolys);
-                else if (rflags & R_HAVEI)
-                    calout(&resc, &result, gpoly, guess->init, guess->flags, args, argpolys);
-                else if (rflags & R_HAVEX)
-                    calini(&resc, &result, gpoly, guess->flags, guess->xorout, args, argpolys);
-                else
-                    engini(&resc, &result, gpoly, guess->flags, args, argpolys);
             }
-            if (!piter(&gpoly))
-                break;
         }
         /* Finished with gpoly and the differences list, free them.
          */
@@ -157,6 +159,22 @@ requit:
     return (result);
 }
 
+static void
+candpol(int *resc, model_t **result, const poly_t gpoly, const model_t *guess, int rflags, int args, const poly_t *argpolys) {
+    /* gpoly divides all the differences, it is a candidate.
+     * Search for an Init value for this poly or if Init is
+     * known, log the result.
+     */
+    if (rflags & R_HAVEI && rflags & R_HAVEX)
+        chkres(resc, result, gpoly, guess->init, guess->flags, guess->xorout, args, argpolys);
+    else if (rflags & R_HAVEI)
+        calout(resc, result, gpoly, guess->init, guess->flags, args, argpolys);
+    else if (rflags & R_HAVEX)
+        calini(resc, result, gpoly, guess->flags, guess->xorout, args, argpolys);
+    else
+        engini(resc, result, gpoly, guess->flags, args, argpolys);
+}
+
 static poly_t *
 modpol(const poly_t init, int rflags, int args, const poly_t *argpolys) {
     /* Produce, in ascending length order, a list of differences
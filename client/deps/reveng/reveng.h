@@ -215,11 +215,17 @@ void mmatch(model_t *model, int flags);
 #define R_HAVERO     8
 #define R_HAVEX     16
 #define R_HAVEQ     32
+#define R_BITWISE   64
 
 #define R_SPMASK 0x7FFFFFFUL
 
 model_t *reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys);
 
+/* psearch.c */
+#define PS_MAXW     64
+
+poly_t *psearch(const poly_t gpoly, const poly_t qpoly, int rflags, int flags, const poly_t *pworks);
+
 /* cli.c */
 #define C_INFILE  1
 #define C_NOPCK   2
@@ -0,0 +1,3 @@
+#!/bin/bash
+
+../../pm3 -c "script run testembedded_capture.lua; script run testembedded_capture.py"
@@ -0,0 +1,14 @@
+local pm3 = require("pm3")
+local json = require("dkjson")
+
+p=pm3.pm3()
+p:console_capture("data load -f lf_EM4102-1.pm3")
+p:console_capture("lf search -1")
+local results = json.decode(p.results)
+print("tag:", results["lf.tag"])
+print("id:", results["em410x.id"])
+for _, rec in ipairs(json.decode(p.log)) do
+    if rec.level == "success" then
+        print(rec.text)
+    end
+end
@@ -0,0 +1,14 @@
+#!/usr/bin/env python3
+
+import json
+import pm3
+
+p=pm3.pm3()
+p.console_capture("data load -f lf_EM4102-1.pm3")
+p.console_capture("lf search -1")
+results = json.loads(p.results)
+print("tag:", results.get("lf.tag"))
+print("id:", results.get("em410x.id"))
+for rec in json.loads(p.log):
+    if rec["level"] == "success":
+        print(rec["text"])
@@ -23,4 +23,16 @@ int pm3_console(pm3 *dev, const char *cmd);
 const char *pm3_name_get(pm3 *dev);
 void pm3_close(pm3 *dev);
 pm3 *pm3_get_current_dev(void);
+
+// Like pm3_console(), but what the command prints is kept instead of written to stdout,
+// together with the typed results it reports. Device debug prints still go to stdout.
+int pm3_console_capture(pm3 *dev, const char *cmd);
+// What the last pm3_console_capture() of the calling thread kept,  valid until its next call.
+// text as printed, without colours
+const char *pm3_output_get(pm3 *dev);
+// JSON array of log records,  [{"level": "success", "text": " UID: 04 A1 B2 C3"}, ...]
+const char *pm3_log_get(pm3 *dev);
+// JSON object of the typed results,  {"hf14a.uid": "04A1B2C3", "hf14a.sak": 8, ...}
+// a key reported more than once holds an array of its values
+const char *pm3_results_get(pm3 *dev);
 #endif // LIBPM3_H
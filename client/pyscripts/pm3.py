@@ -71,7 +71,13 @@ class pm3(object):
 
     def console(self, cmd):
         return _pm3.pm3_console(self, cmd)
+
+    def console_capture(self, cmd):
+        return _pm3.pm3_console_capture(self, cmd)
     name = property(_pm3.pm3_name_get)
+    output = property(_pm3.pm3_output_get)
+    log = property(_pm3.pm3_log_get)
+    results = property(_pm3.pm3_results_get)
 
 # Register pm3 in _pm3:
 _pm3.pm3_swigregister(pm3)
@@ -36,6 +36,7 @@
 #include "cliparser.h"
 #include "generator.h"    // generate nuid
 #include "iso14b.h"       // defines for ETU conversions
+#include "util_posix.h"   // usclock
 
 static int CmdHelp(const char *Cmd);
 
@@ -272,23 +273,129 @@ static int CmdAnalyseLCR(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// crc types exercised by the benchmark, with the parameters for the bitwise reference Crc16()
+static const struct {
+    CrcType_t type;
+    const char *name;
+    uint16_t init;
+    bool refin;
+    bool refout;
+    uint16_t xorout;
+} crc_bench_types[] = {
+    { CRC_14443_A, "ISO14443 CRC-A", 0xC6C6, true,  true,  0x0000 },
+    { CRC_14443_B, "ISO14443 CRC-B", 0xFFFF, true,  true,  0xFFFF },
+    { CRC_15693,   "ISO15693",       0xFFFF, true,  true,  0xFFFF },
+    { CRC_ICLASS,  "iCLASS",         0x4807, true,  true,  0x0000 },
+    { CRC_FELICA,  "FeliCa",         0x0000, false, false, 0x0000 },
+    { CRC_CCITT,   "CCITT",          0xFFFF, false, false, 0x0000 },
+    { CRC_KERMIT,  "KERMIT",         0x0000, true,  true,  0x0000 },
+    { CRC_11784,   "FDX-B 11784",    0x0000, false, true,  0x0000 },
+};
+
+#define CRC_BENCH_FRAMES   200000
+#define CRC_BENCH_LARGE    (64 * 1024)
+#define CRC_BENCH_LARGE_N  50
+
+static double crc_bench_rate(uint64_t start, uint64_t count) {
+    uint64_t delta = usclock() - start;
+    return (double)count * 1e6 / (double)(delta ? delta : 1);
+}
+
+static int analyse_crc_bench(void) {
+    uint8_t *buf = calloc(CRC_BENCH_LARGE, sizeof(uint8_t));
+    if (buf == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint32_t lfsr = 0x12345678;
+    for (size_t i = 0; i < CRC_BENCH_LARGE; i++) {
+        lfsr = lfsr * 1103515245 + 12345;
+        buf[i] = (lfsr >> 16) & 0xFF;
+    }
+
+    PrintAndLogEx(INFO, "CRC benchmark, short frames of 4-18 bytes and %u kB buffers", CRC_BENCH_LARGE / 1024);
+    PrintAndLogEx(INFO, "------------------+-------------+-------------+------");
+    PrintAndLogEx(INFO, " type             |  Mframes/s  |  64 kB MB/s | check");
+    PrintAndLogEx(INFO, "------------------+-------------+-------------+------");
+
+    // volatile sink, keeps the compiler from dropping the loops
+    volatile uint32_t sink = 0;
+    bool all_ok = true;
+    size_t ntypes = ARRAYLEN(crc_bench_types);
+
+    for (size_t t = 0; t < ntypes; t++) {
+        CrcType_t ct = crc_bench_types[t].type;
+
+        uint64_t start = usclock();
+        for (uint32_t i = 0; i < CRC_BENCH_FRAMES; i++) {
+            uint8_t b1 = 0, b2 = 0;
+            compute_crc(ct, buf + (i & 0xFF), 4 + (i % 15), &b1, &b2);
+            sink += b1;
+        }
+        double frames = crc_bench_rate(start, CRC_BENCH_FRAMES);
+
+        start = usclock();
+        for (uint32_t i = 0; i < CRC_BENCH_LARGE_N; i++) {
+            sink += Crc16ex(ct, buf, CRC_BENCH_LARGE);
+        }
+        double large = crc_bench_rate(start, (uint64_t)CRC_BENCH_LARGE_N * CRC_BENCH_LARGE);
+
+        uint16_t ref = Crc16(buf, CRC_BENCH_LARGE, crc_bench_types[t].init, CRC16_POLY_CCITT,
+                             crc_bench_types[t].refin, crc_bench_types[t].refout) ^ crc_bench_types[t].xorout;
+        bool ok = (ref == Crc16ex(ct, buf, CRC_BENCH_LARGE));
+        all_ok &= ok;
+
+        PrintAndLogEx(INFO, " %-16s | %11.2f | %11.1f | %s", crc_bench_types[t].name, frames / 1e6, large / 1e6, ok ? _GREEN_("ok") : _RED_("fail"));
+    }
+
+    // frames of alternating types, like a trace mixing ISO14443-A, ISO14443-B and iCLASS
+    uint64_t start = usclock();
+    for (uint32_t i = 0; i < CRC_BENCH_FRAMES; i++) {
+        sink += check_crc(crc_bench_types[i % ntypes].type, buf + (i & 0xFF), 4 + (i % 15));
+    }
+    PrintAndLogEx(INFO, " %-16s | %11.2f | %11s |", "mixed types", crc_bench_rate(start, CRC_BENCH_FRAMES) / 1e6, "-");
+
+    start = usclock();
+    for (uint32_t i = 0; i < CRC_BENCH_LARGE_N; i++) {
+        uint8_t crc[4];
+        crc32_ex(buf, CRC_BENCH_LARGE, crc);
+        sink += crc[0];
+    }
+    PrintAndLogEx(INFO, " %-16s | %11s | %11.1f |", "CRC32", "-", crc_bench_rate(start, (uint64_t)CRC_BENCH_LARGE_N * CRC_BENCH_LARGE) / 1e6);
+    PrintAndLogEx(INFO, "------------------+-------------+-------------+------");
+    (void)sink;
+
+    free(buf);
+
+    if (all_ok == false) {
+        PrintAndLogEx(FAILED, "CRC implementations " _RED_("differ") " from the bitwise reference");
+        return PM3_ESOFT;
+    }
+    PrintAndLogEx(SUCCESS, "All CRC implementations match the bitwise reference");
+    return PM3_SUCCESS;
+}
+
 static int CmdAnalyseCRC(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "analyse crc",
                   "A stub method to test different crc implementations inside the PM3 sourcecode.\n"
                   "Just because you figured out the poly, doesn't mean you get the desired output",
-                  "analyse crc -d 137AF00A0A0D"
+                  "analyse crc -d 137AF00A0A0D\n"
+                  "analyse crc --bench        -> benchmark and verify the crc16 implementations"
                  );
 
     void *argtable[] = {
         arg_param_begin,
-        arg_str1("d", "data", "<hex>", "bytes to calc crc"),
+        arg_str0("d", "data", "<hex>", "bytes to calc crc"),
+        arg_lit0(NULL, "bench", "benchmark short frames and 64 kB buffers"),
         arg_param_end
     };
-    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
     int dlen = 0;
     uint8_t data[1024] = {0x00};
     int res = CLIParamHexToBuf(arg_get_str(ctx, 1), data, sizeof(data), &dlen);
+    bool bench = arg_get_lit(ctx, 2);
     CLIParserFree(ctx);
 
     if (res) {
@@ -296,6 +403,15 @@ static int CmdAnalyseCRC(const char *Cmd) {
         return PM3_EINVARG;
     }
 
+    if (bench) {
+        return analyse_crc_bench();
+    }
+
+    if (dlen == 0) {
+        PrintAndLogEx(FAILED, "Missing data, see `analyse crc -h`");
+        return PM3_EINVARG;
+    }
+
     PrintAndLogEx(INFO, "\nTests with (%d) | %s", dlen, sprint_hex(data, (size_t)dlen));
 
     // 51  f5  7a  d6
@@ -303,7 +419,6 @@ static int CmdAnalyseCRC(const char *Cmd) {
     init_table(CRC_LEGIC);
     uint8_t legic8 = CRC8Legic(uid, sizeof(uid)) & 0xFF;
     PrintAndLogEx(INFO, "Legic 16 | %X (EF6F expected) [legic8 = %02x]", crc16_legic(data, (size_t)dlen, legic8), legic8);
-    init_table(CRC_FELICA);
     PrintAndLogEx(INFO, "FeliCa | %X ", crc16_xmodem(data, (size_t)dlen));
 
     PrintAndLogEx(INFO, "\nTests of reflection. Current methods in source code");
@@ -1036,6 +1151,9 @@ static int CmdAnalyseFoo(const char *Cmd) {
     PrintAndLogEx(INFO, "Got:  %s", data3);
 
     ClearGraph(false);
+    if (reserveGraphBuffer(15000) == false) {
+        return PM3_EMALLOC;
+    }
     g_GraphTraceLen = 15000;
 
     for (int i = 0; i < 4095; i++) {
@@ -41,13 +41,10 @@
 #include "mbedtls/ctr_drbg.h"    // random generator
 #include "atrs.h"                // ATR lookup
 #include "crypto/libpcrypto.h"   // Cryptography
+#include "dsp.h"                 // signal kernels
+#include "util_posix.h"          // usclock
 
 
-uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN] = { 0x00 };
-size_t g_DemodBufferLen = 0;
-int32_t g_DemodStartIdx = 0;
-int g_DemodClock = 0;
-
 static int CmdHelp(const char *Cmd);
 
 
@@ -95,6 +92,9 @@ static char *commaprint(size_t n) {
 void setDemodBuff(const uint8_t *buff, size_t size, size_t start_idx) {
     if (buff == NULL) return;
 
+    // lets the demod cache see if a demod produced data
+    g_lfdemod_ctx->demod_generation++;
+
     if (size > MAX_DEMOD_BUF_LEN - start_idx)
         size = MAX_DEMOD_BUF_LEN - start_idx;
 
@@ -115,6 +115,164 @@ bool getDemodBuff(uint8_t *buff, size_t *size) {
     return true;
 }
 
+// Demodulation cache.
+// `lf search` runs every known decoder over the same samples and many of them ask for
+// the very same raw demodulation (clock detection included). While the cache is active
+// the result of ASKDemod_ext / ASKbiphaseDemod / FSKrawDemod / PSKDemod / NRZrawDemod
+// is kept per modulation and arguments and replayed into the g_DemodBuffer on the next call.
+// Verbose calls always run the demod so the user sees its output.
+// Each thread has its own cache, it follows the demodulation context selected on the thread.
+#define DEMOD_CACHE_SIZE 16
+
+typedef enum {
+    DEMOD_CACHE_ASK,
+    DEMOD_CACHE_BIPHASE,
+    DEMOD_CACHE_FSK,
+    DEMOD_CACHE_PSK,
+    DEMOD_CACHE_NRZ,
+} demod_cache_type_t;
+
+typedef struct {
+    demod_cache_type_t type;
+    int args[6];
+    bool valid;
+    int ret;                // return value of the demod
+    bool has_data;          // the demod set g_DemodBuffer and the clock grid
+    uint8_t *bits;
+    size_t len;
+    int clk;
+    int32_t start_idx;
+    bool st;                // ASK sequence terminator found
+    uint32_t st_start;
+    uint32_t st_end;
+    uint32_t generation;    // g_DemodBuffer generation before the demod ran
+} demod_cache_entry_t;
+
+static __thread struct {
+    bool active;
+    const lfdemod_ctx_t *ctx;
+    size_t graph_len;
+    uint32_t count;
+    uint32_t hits;
+    uint32_t misses;
+    demod_cache_entry_t entries[DEMOD_CACHE_SIZE];
+} gs_demod_cache;
+
+static void demodCacheFlush(void) {
+    for (uint32_t i = 0; i < gs_demod_cache.count; i++) {
+        free(gs_demod_cache.entries[i].bits);
+    }
+    memset(gs_demod_cache.entries, 0, sizeof(gs_demod_cache.entries));
+    gs_demod_cache.count = 0;
+}
+
+void demodCacheStart(void) {
+    demodCacheFlush();
+    gs_demod_cache.active = true;
+    gs_demod_cache.ctx = g_lfdemod_ctx;
+    gs_demod_cache.graph_len = g_GraphTraceLen;
+    gs_demod_cache.hits = 0;
+    gs_demod_cache.misses = 0;
+}
+
+void demodCacheStop(void) {
+    demodCacheFlush();
+    gs_demod_cache.active = false;
+}
+
+void demodCacheStats(uint32_t *hits, uint32_t *misses) {
+    *hits = gs_demod_cache.hits;
+    *misses = gs_demod_cache.misses;
+}
+
+// returns the entry for this demod,  with valid set if the result is known already.
+// NULL if the result must not be cached
+static demod_cache_entry_t *demodCacheGet(demod_cache_type_t type, const int *args, size_t argc, bool verbose) {
+    if (gs_demod_cache.active == false || verbose || g_debugMode) {
+        return NULL;
+    }
+
+    // samples changed under our feet
+    if (gs_demod_cache.ctx != g_lfdemod_ctx || gs_demod_cache.graph_len != g_GraphTraceLen) {
+        demodCacheFlush();
+        gs_demod_cache.ctx = g_lfdemod_ctx;
+        gs_demod_cache.graph_len = g_GraphTraceLen;
+    }
+
+    int key[ARRAYLEN(gs_demod_cache.entries[0].args)] = {0};
+    memcpy(key, args, argc * sizeof(int));
+
+    for (uint32_t i = 0; i < gs_demod_cache.count; i++) {
+        demod_cache_entry_t *e = &gs_demod_cache.entries[i];
+        if (e->type == type && memcmp(e->args, key, sizeof(key)) == 0) {
+            if (e->valid) {
+                gs_demod_cache.hits++;
+            } else {
+                gs_demod_cache.misses++;
+                e->generation = g_lfdemod_ctx->demod_generation;
+            }
+            return e;
+        }
+    }
+
+    if (gs_demod_cache.count == DEMOD_CACHE_SIZE) {
+        return NULL;
+    }
+
+    gs_demod_cache.misses++;
+    demod_cache_entry_t *e = &gs_demod_cache.entries[gs_demod_cache.count++];
+    e->type = type;
+    memcpy(e->args, key, sizeof(key));
+    e->generation = g_lfdemod_ctx->demod_generation;
+    return e;
+}
+
+// remember the outcome of a demod just run for entry e
+static void demodCachePut(demod_cache_entry_t *e, int ret, bool st) {
+    if (e == NULL) {
+        return;
+    }
+
+    if (ret == PM3_EMALLOC) {
+        return;
+    }
+
+    e->ret = ret;
+    e->has_data = (e->generation != g_lfdemod_ctx->demod_generation);
+    if (e->has_data) {
+        e->bits = malloc(g_DemodBufferLen);
+        if (e->bits == NULL) {
+            // stays invalid,  the next call demods again
+            return;
+        }
+        memcpy(e->bits, g_DemodBuffer, g_DemodBufferLen);
+        e->len = g_DemodBufferLen;
+        e->clk = g_DemodClock;
+        e->start_idx = g_DemodStartIdx;
+    }
+    e->st = st;
+    if (st && lfdemod_ctx_plotted()) {
+        e->st_start = g_MarkerC.pos;
+        e->st_end = g_MarkerD.pos;
+    }
+    e->valid = true;
+}
+
+static int demodCacheReplay(const demod_cache_entry_t *e, bool *stCheck) {
+    if (e->has_data) {
+        setDemodBuff(e->bits, e->len, 0);
+        setClockGrid(e->clk, e->start_idx);
+    }
+    if (e->st) {
+        *stCheck = true;
+    }
+    if (e->st && lfdemod_ctx_plotted()) {
+        g_MarkerC.pos = e->st_start;
+        g_MarkerD.pos = e->st_end;
+    }
+    return e->ret;
+}
+
 // include <math.h>
 // Root mean square
 /*
@@ -401,7 +559,7 @@ static int CmdConvertBitStream(const char *Cmd) {
 // verbose will print results and demoding messages
 // emSearch will auto search for EM410x format in bitstream
 // askType switches decode: ask/raw = 0, ask/manchester = 1
-int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, bool verbose, bool emSearch, uint8_t askType, bool *stCheck) {
+static int askDemodGraph(int clk, int invert, int maxErr, size_t maxlen, bool amplify, bool verbose, bool emSearch, uint8_t askType, bool *stCheck) {
     PrintAndLogEx(DEBUG, "DEBUG: (ASKDemod_ext) clk %i invert %i maxErr %i maxLen %zu amplify %i verbose %i emSearch %i askType %i "
                   , clk
                   , invert
@@ -417,7 +575,7 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
     if (maxlen == 0)
         maxlen = g_pm3_capabilities.bigbuf_size;
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(INFO, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -454,8 +612,10 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
 
     if (st) {
         *stCheck = st;
-        g_MarkerC.pos = ststart;
-        g_MarkerD.pos = stend;
+        if (lfdemod_ctx_plotted()) {
+            g_MarkerC.pos = ststart;
+            g_MarkerD.pos = stend;
+        }
         if (verbose)
             PrintAndLogEx(DEBUG, "Found Sequence Terminator - First one is shown by orange / blue graph markers");
     }
@@ -525,6 +685,22 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
     return PM3_SUCCESS;
 }
 
+int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, bool verbose, bool emSearch, uint8_t askType, bool *stCheck) {
+    int args[] = {clk, invert, maxErr, (int)maxlen, amplify, askType};
+    demod_cache_entry_t *e = demodCacheGet(DEMOD_CACHE_ASK, args, ARRAYLEN(args), verbose || emSearch);
+    if (e != NULL && e->valid) {
+        return demodCacheReplay(e, stCheck);
+    }
+
+    bool st = false;
+    int res = askDemodGraph(clk, invert, maxErr, maxlen, amplify, verbose, emSearch, askType, &st);
+    if (st) {
+        *stCheck = true;
+    }
+    demodCachePut(e, res, st);
+    return res;
+}
+
 int ASKDemod(int clk, int invert, int maxErr, size_t maxlen, bool amplify, bool verbose, bool emSearch, uint8_t askType) {
     bool st = false;
     return ASKDemod_ext(clk, invert, maxErr, maxlen, amplify, verbose, emSearch, askType, &st);
@@ -727,7 +903,7 @@ static int CmdBiphaseDecodeRaw(const char *Cmd) {
 }
 
 // ASK Demod then Biphase decode g_GraphBuffer samples
-int ASKbiphaseDemod(int offset, int clk, int invert, int maxErr, bool verbose) {
+static int askBiphaseDemodGraph(int offset, int clk, int invert, int maxErr, bool verbose) {
     //ask raw demod g_GraphBuffer first
 
     uint8_t *bs = calloc(MAX_DEMOD_BUF_LEN, sizeof(uint8_t));
@@ -778,6 +954,18 @@ int ASKbiphaseDemod(int offset, int clk, int invert, int maxErr, bool verbose) {
     return PM3_SUCCESS;
 }
 
+int ASKbiphaseDemod(int offset, int clk, int invert, int maxErr, bool verbose) {
+    int args[] = {offset, clk, invert, maxErr};
+    demod_cache_entry_t *e = demodCacheGet(DEMOD_CACHE_BIPHASE, args, ARRAYLEN(args), verbose);
+    if (e != NULL && e->valid) {
+        return demodCacheReplay(e, NULL);
+    }
+
+    int res = askBiphaseDemodGraph(offset, clk, invert, maxErr, verbose);
+    demodCachePut(e, res, false);
+    return res;
+}
+
 // see ASKbiphaseDemod
 static int Cmdaskbiphdemod(const char *Cmd) {
     CLIParserContext *ctx;
@@ -843,39 +1031,95 @@ static int Cmdaskrawdemod(const char *Cmd) {
     return ASKDemod_ext(clk, invert, max_err, max_len, amplify, true, false, 0, &st);
 }
 
-int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose) {
+// The autocovariance loop AutoCorrelate() used to run, O(len * lags). Still used for samples
+// dsp_autocov() can not take,  and as the reference in 'data bench'
+static void autocorr_series_ref(const int *in, size_t len, size_t lags, double mean, double *series) {
+    double autocv = 0.0;    // Autocovariance value
+    for (size_t i = 0; i < lags; ++i) {
+
+        for (size_t j = 0; j < (len - i); j++) {
+            autocv += (in[j] - mean) * (in[j + i] - mean);
+        }
+        autocv = (1.0 / (len - i)) * autocv;
+        series[i] = autocv;
+    }
+}
+
+// Same series as autocorr_series_ref(). The lag products are summed exactly by dsp_autocov()
+// on the samples minus an integer close to the mean,  only the rest of the mean is applied in
+// doubles. Returns false if dsp_autocov() could not take the samples.
+static bool autocorr_series(const int *in, size_t len, size_t lags, double mean, dsp_autocov_method_t method, double *series) {
+    int64_t *prod = calloc(MAX(lags, 1), sizeof(int64_t));
+    if (prod == NULL) {
+        return false;
+    }
+
+    int32_t offset = (int32_t)lround(mean);
+    if (dsp_autocov(in, len, lags, offset, method, prod) == false) {
+        free(prod);
+        return false;
+    }
+
+    // head sums the first len - i samples, tail the last len - i ones
+    int64_t head = 0;
+    for (size_t i = 0; i < len; i++) {
+        head += in[i] - offset;
+    }
+    int64_t tail = head;
+    double m = mean - offset;
+
+    double autocv = 0.0;
+    for (size_t i = 0; i < lags; ++i) {
+        // sum over j < len - i of (in[j] - mean) * (in[j + i] - mean)
+        double c = (double)prod[i] - m * (double)(head + tail) + (double)(len - i) * m * m;
+        autocv = (1.0 / (len - i)) * (autocv + c);
+        series[i] = autocv;
+
+        head -= in[len - 1 - i] - offset;
+        tail -= in[i] - offset;
+    }
+    free(prod);
+    return true;
+}
+
+// Autocorrelation over the lags below len - window. correl_buf (len entries) gets the
+// autocovariance of every lag and zeros past them. *distance is the shortest distance between
+// correlation peaks,  -1 if there is none. Returns false if memory runs out
+static bool autocorr_compute(const int *in, size_t len, size_t window, bool reference, int *correl_buf, int *distance) {
     // sanity check
     if (window > len) {
         window = len;
     }
-
-    //test
-    double autocv = 0.0;    // Autocovariance value
-    size_t correlation = 0;
-    int lastmax = 0;
+    size_t lags = len - window;
 
     // in, len, 4000
     double mean = compute_mean(in, len);
     // Computed variance
     double variance = compute_variance(in, len);
 
-    int *correl_buf = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int));
+    double *series = calloc(MAX(lags, 1), sizeof(double));
+    if (series == NULL) {
+        return false;
+    }
 
+    if (lags && (reference || autocorr_series(in, len, lags, mean, DSP_AUTOCOV_AUTO, series) == false)) {
+        autocorr_series_ref(in, len, lags, mean, series);
+    }
+
+    memset(correl_buf, 0x00, len * sizeof(int));
+
+    size_t correlation = 0;
+    int lastmax = 0;
     uint8_t peak_cnt = 0;
     size_t peaks[10] = {0};
 
-    for (size_t i = 0; i < len - window; ++i) {
+    for (size_t i = 0; i < lags; ++i) {
 
-        for (size_t j = 0; j < (len - i); j++) {
-            autocv += (in[j] - mean) * (in[j + i] - mean);
-        }
-        autocv = (1.0 / (len - i)) * autocv;
-
-        correl_buf[i] = autocv;
+        correl_buf[i] = series[i];
 
         // Computed autocorrelation value to be returned
         // Autocorrelation is autocovariance divided by variance
-        double ac_value = autocv / variance;
+        double ac_value = series[i] / variance;
 
         // keep track of which distance is repeating.
         // A value near 1.0 or more indicates a correlation in the signal
@@ -888,9 +1132,10 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
             }
         }
     }
+    free(series);
 
     // Find shorts distance between peaks
-    int distance = -1;
+    *distance = -1;
     for (size_t i = 0; i < ARRAYLEN(peaks); ++i) {
 
         PrintAndLogEx(DEBUG, "%zu | %zu", i, peaks[i]);
@@ -898,15 +1143,28 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
             continue;
         }
 
-        if (distance == -1) {
-            distance = peaks[i];
+        if (*distance == -1) {
+            *distance = peaks[i];
             continue;
         }
 
-        if (peaks[i] < distance) {
-            distance = peaks[i];
+        if (peaks[i] < *distance) {
+            *distance = peaks[i];
         }
     }
+    return true;
+}
+
+int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose) {
+
+    // results are collected aside and copied back at the end
+    int *correl_buf = calloc(MAX(len, 1), sizeof(int));
+    int distance = -1;
+    if (correl_buf == NULL || autocorr_compute(in, len, window, false, correl_buf, &distance) == false) {
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        free(correl_buf);
+        return -1;
+    }
 
     if (distance > -1) {
         if (verbose) {
@@ -914,6 +1172,7 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
         }
     } else {
         PrintAndLogEx(HINT, "No repeating pattern found, try increasing window size");
+        free(correl_buf);
         // return value -1, indication to increase window size
         return -1;
     }
@@ -987,6 +1246,10 @@ static int CmdBitsamples(const char *Cmd) {
         return PM3_ETIMEOUT;
     }
 
+    if (reserveGraphBuffer(sizeof(got) * 8) == false) {
+        return PM3_EMALLOC;
+    }
+
     for (size_t j = 0; j < ARRAYLEN(got); j++) {
         for (uint8_t k = 0; k < 8; k++) {
             if (got[j] & (1 << (7 - k)))
@@ -1070,29 +1333,33 @@ static int CmdUndecimate(const char *Cmd) {
     int factor = arg_get_int_def(ctx, 1, 2);
     CLIParserFree(ctx);
 
-    //We have memory, don't we?
-    int *swap = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int));
-    if (swap == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
+    if (factor < 2) {
+        PrintAndLogEx(WARNING, "factor must be at least 2");
+        return PM3_EINVARG;
+    }
+
+    // as many samples as fit in the graph
+    size_t len = MIN(g_GraphTraceLen, (MAX_GRAPH_TRACE_LEN - 1) / factor);
+    if (reserveGraphBuffer(len * factor) == false) {
         return PM3_EMALLOC;
     }
-    uint32_t g_index = 0, s_index = 0;
-    while (g_index < g_GraphTraceLen && s_index + factor < MAX_GRAPH_TRACE_LEN) {
-        int count = 0;
-        for (count = 0; count < factor && s_index + count < MAX_GRAPH_TRACE_LEN; count++) {
-            swap[s_index + count] = (
-                                        (double)(factor - count) / (factor - 1)) * g_GraphBuffer[g_index] +
-                                    ((double)count / factor) * g_GraphBuffer[g_index + 1]
-                                    ;
+
+    // expand in place, back to front. Sample g_index only moves to g_index * factor and up,
+    // so it is still unchanged when its turn comes
+    int32_t next = 0;
+    for (size_t g_index = len; g_index-- > 0;) {
+        int32_t cur = g_GraphBuffer[g_index];
+        for (int count = 0; count < factor; count++) {
+            g_GraphBuffer[g_index * factor + count] = (
+                                                          (double)(factor - count) / (factor - 1)) * cur +
+                                                      ((double)count / factor) * next
+                                                      ;
         }
-        s_index += count;
-        g_index++;
+        next = cur;
     }
 
-    memcpy(g_GraphBuffer, swap, s_index * sizeof(int));
-    g_GraphTraceLen = s_index;
+    g_GraphTraceLen = len * factor;
     RepaintGraphWindow();
-    free(swap);
     return PM3_SUCCESS;
 }
 
@@ -1232,7 +1499,7 @@ static int CmdDetectClockRate(const char *Cmd) {
 }
 
 static char *GetFSKType(uint8_t fchigh, uint8_t fclow, uint8_t invert) {
-    static char fType[8];
+    static __thread char fType[8];
     memset(fType, 0x00, 8);
     char *fskType = fType;
 
@@ -1259,7 +1526,7 @@ static char *GetFSKType(uint8_t fchigh, uint8_t fclow, uint8_t invert) {
 // fsk raw demod and print binary
 // takes 4 arguments - Clock, invert, fchigh, fclow
 // defaults: clock = 50, invert=1, fchigh=10, fclow=8 (RF/10 RF/8 (fsk2a))
-int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bool verbose) {
+static int fskDemodGraph(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bool verbose) {
     //raw fsk demod  no manchester decoding no start bit finding just get binary from wave
     if (getSignalProperties()->isnoise) {
         if (verbose) {
@@ -1268,7 +1535,7 @@ int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bo
         return PM3_ESOFT;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1328,6 +1595,18 @@ out:
     return PM3_SUCCESS;
 }
 
+int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bool verbose) {
+    int args[] = {rfLen, invert, fchigh, fclow};
+    demod_cache_entry_t *e = demodCacheGet(DEMOD_CACHE_FSK, args, ARRAYLEN(args), verbose);
+    if (e != NULL && e->valid) {
+        return demodCacheReplay(e, NULL);
+    }
+
+    int res = fskDemodGraph(rfLen, invert, fchigh, fclow, verbose);
+    demodCachePut(e, res, false);
+    return res;
+}
+
 // fsk raw demod and print binary
 // takes 4 arguments - Clock, invert, fchigh, fclow
 // defaults: clock = 50, invert=1, fchigh=10, fclow=8 (RF/10 RF/8 (fsk2a))
@@ -1363,7 +1642,7 @@ static int CmdFSKrawdemod(const char *Cmd) {
 }
 
 // attempt to psk1 demod graph buffer
-int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
+static int pskDemodGraph(int clk, int invert, int maxErr, bool verbose) {
     if (getSignalProperties()->isnoise) {
         if (verbose) {
             PrintAndLogEx(INFO, "signal looks like noise");
@@ -1371,7 +1650,7 @@ int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
         return PM3_ESOFT;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1407,10 +1686,22 @@ int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
     return PM3_SUCCESS;
 }
 
+int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
+    int args[] = {clk, invert, maxErr};
+    demod_cache_entry_t *e = demodCacheGet(DEMOD_CACHE_PSK, args, ARRAYLEN(args), verbose);
+    if (e != NULL && e->valid) {
+        return demodCacheReplay(e, NULL);
+    }
+
+    int res = pskDemodGraph(clk, invert, maxErr, verbose);
+    demodCachePut(e, res, false);
+    return res;
+}
+
 // takes 3 arguments - clock, invert, maxErr as integers
 // attempts to demodulate nrz only
 // prints binary found and saves in g_DemodBuffer for further commands
-int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
+static int nrzDemodGraph(int clk, int invert, int maxErr, bool verbose) {
 
     int errCnt = 0, clkStartIdx = 0;
 
@@ -1421,7 +1712,7 @@ int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
         return PM3_ESOFT;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1464,6 +1755,18 @@ int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
     return PM3_SUCCESS;
 }
 
+int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
+    int args[] = {clk, invert, maxErr};
+    demod_cache_entry_t *e = demodCacheGet(DEMOD_CACHE_NRZ, args, ARRAYLEN(args), verbose);
+    if (e != NULL && e->valid) {
+        return demodCacheReplay(e, NULL);
+    }
+
+    int res = nrzDemodGraph(clk, invert, maxErr, verbose);
+    demodCachePut(e, res, false);
+    return res;
+}
+
 static int CmdNRZrawDemod(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "data rawdemod --nr",
@@ -1653,6 +1956,9 @@ void setClockGrid(uint32_t clk, int offset) {
     if (offset > clk) offset %= clk;
     if (offset < 0) offset += clk;
 
+    // the grid belongs to the plot window
+    if (lfdemod_ctx_plotted() == false) return;
+
     if (offset > g_GraphTraceLen || offset < 0) return;
     if (clk < 8 || clk > g_GraphTraceLen) {
         g_GridLocked = false;
@@ -1804,20 +2110,10 @@ int CmdHpf(const char *Cmd) {
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
-    removeSignalOffset(bits, size);
-    // push it back to graph
-    setGraphBuffer(bits, size);
-    // set signal properties low/high/mean/amplitude and is_noise detection
-    computeSignalProperties(bits, size);
+    // in place on the graph, also sets signal properties low/high/mean/amplitude and is_noise detection
+    removeGraphSignalOffset();
 
     RepaintGraphWindow();
-    free(bits);
     return PM3_SUCCESS;
 }
 
@@ -1835,6 +2131,28 @@ static uint8_t getByte(uint8_t bits_per_sample, BitstreamOut_t *b) {
     return val;
 }
 
+// set signal properties of freshly loaded samples and refresh the plot
+static int finishSamples(void) {
+    // set signal properties low/high/mean/amplitude and is_noise detection
+    computeGraphSignalProperties();
+
+    setClockGrid(0, 0);
+    g_DemodBufferLen = 0;
+    RepaintGraphWindow();
+
+    return PM3_SUCCESS;
+}
+
+// converts 8 bits/sample data into the graph buffer while the download is still running
+// ctx points to the number of samples reserved in the graph
+static int samples_chunk_cb(const uint8_t *data, uint32_t offset, uint32_t len, void *ctx) {
+    uint32_t reserved = *(uint32_t *)ctx;
+    for (uint32_t i = 0; (i < len) && (offset + i < reserved); i++) {
+        g_GraphBuffer[offset + i] = ((int)data[i]) - 127;
+    }
+    return PM3_SUCCESS;
+}
+
 int getSamples(uint32_t n, bool verbose) {
     return getSamplesEx(0, n, verbose, false);
 }
@@ -1863,14 +2181,21 @@ int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_conf
         PrintAndLogEx(INFO, "Reading " _YELLOW_("%u") " bytes from device memory", n);
     }
 
+    if (reserveGraphBuffer(n) == false) {
+        return PM3_EMALLOC;
+    }
+
+    // samples are converted while the download is running, assuming 8 bits/sample
     PacketResponseNG resp;
-    if (GetFromDevice(BIG_BUF, got, n, start, NULL, 0, &resp, 10000, true) == false) {
+    download_stats_t stats;
+    if (GetFromDeviceStream(BIG_BUF, got, n, start, NULL, 0, &resp, 10000, true, samples_chunk_cb, &n, &stats) == false) {
         PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+        g_GraphTraceLen = 0;
         return PM3_ETIMEOUT;
     }
 
     if (verbose) {
-        PrintAndLogEx(SUCCESS, "Data fetched");
+        PrintAndLogEx(SUCCESS, "Data fetched ( %u bytes in %" PRIu64 " ms )", stats.bytes, stats.ms);
     }
 
     uint8_t bits_per_sample = 8;
@@ -1884,12 +2209,20 @@ int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_conf
         bits_per_sample = sc->bits_per_sample;
     }
 
-    return getSamplesFromBufEx(got, n, bits_per_sample, verbose);;
+    if (bits_per_sample < 8) {
+        return getSamplesFromBufEx(got, n, bits_per_sample, verbose);
+    }
+
+    g_GraphTraceLen = n;
+    return finishSamples();
 }
 
 int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sample, bool verbose) {
 
     size_t max_num = MIN(sample_num, MAX_GRAPH_TRACE_LEN);
+    if (reserveGraphBuffer(max_num) == false) {
+        return PM3_EMALLOC;
+    }
 
     if (bits_per_sample < 8) {
 
@@ -1912,21 +2245,7 @@ int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sampl
         g_GraphTraceLen = max_num;
     }
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
-    // set signal properties low/high/mean/amplitude and is_noise detection
-    computeSignalProperties(bits, size);
-    free(bits);
-
-    setClockGrid(0, 0);
-    g_DemodBufferLen = 0;
-    RepaintGraphWindow();
-
-    return PM3_SUCCESS;
+    return finishSamples();
 }
 
 static int CmdSamples(const char *Cmd) {
@@ -1952,6 +2271,12 @@ static int CmdSamples(const char *Cmd) {
 }
 
 
+// clamp loaded samples, remove their DC offset and measure the signal
+int fixGraphBuffer(void) {
+    removeGraphSignalOffset();
+    return PM3_SUCCESS;
+}
+
 static int CmdLoad(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1998,23 +2323,24 @@ static int CmdLoad(const char *Cmd) {
 
     g_GraphTraceLen = 0;
 
+    // the graph grows with the file, up to MAX_GRAPH_TRACE_LEN samples
     if (is_bin) {
         uint8_t val[2];
         while (fread(val, 1, 1, f)) {
+            if (reserveGraphBuffer(g_GraphTraceLen + 1) == false)
+                break;
+
             g_GraphBuffer[g_GraphTraceLen] = val[0] - 127;
             g_GraphTraceLen++;
-
-            if (g_GraphTraceLen >= MAX_GRAPH_TRACE_LEN)
-                break;
         }
     } else {
         char line[80];
         while (fgets(line, sizeof(line), f)) {
+            if (reserveGraphBuffer(g_GraphTraceLen + 1) == false)
+                break;
+
             g_GraphBuffer[g_GraphTraceLen] = atoi(line);
             g_GraphTraceLen++;
-
-            if (g_GraphTraceLen >= MAX_GRAPH_TRACE_LEN)
-                break;
         }
     }
     fclose(f);
@@ -2022,17 +2348,10 @@ static int CmdLoad(const char *Cmd) {
     PrintAndLogEx(SUCCESS, "loaded " _YELLOW_("%s") " samples", commaprint(g_GraphTraceLen));
 
     if (nofix == false) {
-        uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-        if (bits == NULL) {
-            PrintAndLogEx(FAILED, "failed to allocate memory");
-            return PM3_EMALLOC;
+        int res = fixGraphBuffer();
+        if (res != PM3_SUCCESS) {
+            return res;
         }
-        size_t size = getFromGraphBuffer(bits);
-
-        removeSignalOffset(bits, size);
-        setGraphBuffer(bits, size);
-        computeSignalProperties(bits, size);
-        free(bits);
     }
 
     setClockGrid(0, 0);
@@ -2140,6 +2459,37 @@ static int CmdMtrim(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// The loop CmdNorm() used to run,  the reference in 'data bench'
+static void norm_samples_ref(int *data, size_t len) {
+    int max = INT_MIN, min = INT_MAX;
+
+    // Find local min, max
+    for (uint32_t i = 10; i < len; ++i) {
+        if (data[i] > max) max = data[i];
+        if (data[i] < min) min = data[i];
+    }
+
+    if ((len > 10) && (max != min)) {
+        for (uint32_t i = 0; i < len; ++i) {
+            data[i] = ((long)(data[i] - ((max + min) / 2)) * 256) / (max - min);
+        }
+    }
+}
+
+static void norm_samples(int *data, size_t len) {
+    int max = INT_MIN, min = INT_MAX;
+
+    // Find local min, max
+    if (len > 10) {
+        dsp_minmax(data + 10, len - 10, &min, &max);
+    }
+
+    if ((len > 10) && (max != min)) {
+        //marshmelow: adjusted *1000 to *256 to make +/- 128 so demod commands still work
+        dsp_normalize(data, len, (max + min) / 2, max - min);
+    }
+}
+
 int CmdNorm(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -2154,32 +2504,12 @@ int CmdNorm(const char *Cmd) {
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
 
-    int max = INT_MIN, min = INT_MAX;
-
-    // Find local min, max
-    for (uint32_t i = 10; i < g_GraphTraceLen; ++i) {
-        if (g_GraphBuffer[i] > max) max = g_GraphBuffer[i];
-        if (g_GraphBuffer[i] < min) min = g_GraphBuffer[i];
-    }
+    norm_samples(g_GraphBuffer, g_GraphTraceLen);
 
-    if ((g_GraphTraceLen > 10) && (max != min)) {
-        for (uint32_t i = 0; i < g_GraphTraceLen; ++i) {
-            g_GraphBuffer[i] = ((long)(g_GraphBuffer[i] - ((max + min) / 2)) * 256) / (max - min);
-            //marshmelow: adjusted *1000 to *256 to make +/- 128 so demod commands still work
-        }
-    }
-
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
     // set signal properties low/high/mean/amplitude and is_noise detection
-    computeSignalProperties(bits, size);
+    computeGraphSignalProperties();
 
     RepaintGraphWindow();
-    free(bits);
     return PM3_SUCCESS;
 }
 
@@ -2320,17 +2650,9 @@ static int CmdDirectionalThreshold(const char *Cmd) {
     directionalThreshold(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen, up, down);
 
     // set signal properties low/high/mean/amplitude and isnoice detection
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
-    // set signal properties low/high/mean/amplitude and is_noice detection
-    computeSignalProperties(bits, size);
+    computeGraphSignalProperties();
 
     RepaintGraphWindow();
-    free(bits);
     return PM3_SUCCESS;
 }
 
@@ -2368,16 +2690,9 @@ static int CmdZerocrossings(const char *Cmd) {
         }
     }
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
     // set signal properties low/high/mean/amplitude and is_noise detection
-    computeSignalProperties(bits, size);
+    computeGraphSignalProperties();
     RepaintGraphWindow();
-    free(bits);
     return PM3_SUCCESS;
 }
 
@@ -2583,16 +2898,9 @@ static int CmdDataIIR(const char *Cmd) {
 
     iceSimple_Filter(g_GraphBuffer, g_GraphTraceLen, k);
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
     // set signal properties low/high/mean/amplitude and is_noise detection
-    computeSignalProperties(bits, size);
+    computeGraphSignalProperties();
     RepaintGraphWindow();
-    free(bits);
     return PM3_SUCCESS;
 }
 
@@ -3308,16 +3616,8 @@ static int CmdCenterThreshold(const char *Cmd) {
     centerThreshold(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen, up, down);
 
     // set signal properties low/high/mean/amplitude and isnoice detection
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
-    if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
-    }
-    size_t size = getFromGraphBuffer(bits);
-    // set signal properties low/high/mean/amplitude and is_noice detection
-    computeSignalProperties(bits, size);
+    computeGraphSignalProperties();
     RepaintGraphWindow();
-    free(bits);
     return PM3_SUCCESS;
 }
 
@@ -3358,19 +3658,257 @@ static int CmdEnvelope(const char *Cmd) {
 
     envelope_square(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen);
 
+    // set signal properties low/high/mean/amplitude and is_noice detection
+    computeGraphSignalProperties();
+    RepaintGraphWindow();
+    return PM3_SUCCESS;
+}
+
+// sample pairs the reference autocorrelation gets per signal,  about a second
+#define DSP_BENCH_REF_PAIRS  300000000ULL
+// default window of data autocorr
+#define DSP_BENCH_WINDOW     4000
+
+typedef enum {
+    DSP_BENCH_ASK,
+    DSP_BENCH_FSK,
+    DSP_BENCH_PSK,
+} dsp_bench_signal_t;
+
+// Synthetic signal repeating a 64 bit id,  +/-100 with some noise and a DC offset
+static void dsp_bench_signal(int *buf, size_t len, dsp_bench_signal_t type) {
+    const uint64_t id = 0xFF8C0A5E21D36B49ULL;
+    uint32_t lfsr = 0x12345678;
+    int phase = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        lfsr = lfsr * 1103515245 + 12345;
+        int noise = (int)((lfsr >> 16) % 17) - 8;
+        int v = 0;
+        switch (type) {
+            case DSP_BENCH_ASK: {
+                // manchester, RF/64
+                int bit = (id >> (63 - (i / 64) % 64)) & 1;
+                v = (bit ^ ((i % 64) < 32)) ? 100 : -100;
+                break;
+            }
+            case DSP_BENCH_FSK: {
+                // FSK2a, RF/50, fc 8 and 10
+                int bit = (id >> (63 - (i / 50) % 64)) & 1;
+                int fc = bit ? 10 : 8;
+                v = ((int)(i % fc) < fc / 2) ? 90 : -90;
+                break;
+            }
+            case DSP_BENCH_PSK: {
+                // PSK1, RF/32, fc 2, the phase turns on every one
+                if ((i % 32) == 0 && ((id >> (63 - (i / 32) % 64)) & 1)) {
+                    phase ^= 1;
+                }
+                v = ((i & 1) ^ phase) ? 100 : -100;
+                break;
+            }
+        }
+        buf[i] = v + noise + 12;
+    }
+}
+
+// the exact lag products must agree for every instruction set and method
+static bool dsp_bench_autocov(const int *sig, size_t len, size_t lags) {
+    int64_t *ref = calloc(lags, sizeof(int64_t));
+    int64_t *out = calloc(lags, sizeof(int64_t));
+    if (ref == NULL || out == NULL) {
+        free(ref);
+        free(out);
+        return false;
+    }
+
+    dsp_isa_t best = dsp_get_isa();
+    dsp_set_isa(DSP_ISA_NONE);
+    bool ok = dsp_autocov(sig, len, lags, 12, DSP_AUTOCOV_DIRECT, ref);
+
+    dsp_isa_t isas[] = {
+#if defined(DSP_HAS_SIMD_X86)
+        DSP_ISA_SSE2,
+        DSP_ISA_AVX2,
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+        DSP_ISA_NEON,
+#endif
+        DSP_ISA_NONE,
+    };
+    // the variants up to the one the cpu supports
+    for (size_t i = 0; i < ARRAYLEN(isas) && isas[i] != DSP_ISA_NONE; i++) {
+        dsp_set_isa(isas[i]);
+        ok &= dsp_autocov(sig, len, lags, 12, DSP_AUTOCOV_DIRECT, out);
+        ok &= (memcmp(ref, out, lags * sizeof(int64_t)) == 0);
+        if (isas[i] == best) {
+            break;
+        }
+    }
+
+    dsp_set_isa(DSP_ISA_AUTO);
+    ok &= dsp_autocov(sig, len, lags, 12, DSP_AUTOCOV_FFT, out);
+    ok &= (memcmp(ref, out, lags * sizeof(int64_t)) == 0);
+
+    free(ref);
+    free(out);
+    return ok;
+}
+
+// old data hpf, samples through removeSignalOffset() and back into the graph
+static void dsp_bench_hpf_ref(void) {
     uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
-        PrintAndLogEx(FAILED, "failed to allocate memory");
-        return PM3_EMALLOC;
+        return;
     }
     size_t size = getFromGraphBuffer(bits);
-    // set signal properties low/high/mean/amplitude and is_noice detection
+    removeSignalOffset(bits, size);
+    setGraphBuffer(bits, size);
     computeSignalProperties(bits, size);
-    RepaintGraphWindow();
     free(bits);
+}
+
+static double dsp_bench_ms(uint64_t start) {
+    return (double)(usclock() - start) / 1000;
+}
+
+// pairs of samples the autocorrelation multiplies over 'lags' lags
+static double dsp_bench_pairs(size_t len, size_t lags) {
+    return (double)lags * len - (double)lags * (lags - 1) / 2;
+}
+
+static int data_bench(size_t max_len) {
+    static const char *names[] = { "ASK", "FSK", "PSK" };
+    const size_t sizes[] = { 10000, 100000, 1000000 };
+
+    PrintAndLogEx(INFO, "Signal kernel benchmark, " _YELLOW_("%s") " kernels, times in ms", dsp_isa_name(DSP_ISA_AUTO));
+    PrintAndLogEx(INFO, "autocorr over the lags of 'data autocorr -w %u', the reference over the first lags only", DSP_BENCH_WINDOW);
+    PrintAndLogEx(INFO, "-----+---------+--------------------------------------+-------------------+-------------------+------");
+    PrintAndLogEx(INFO, " sig | samples |  lags     ref     new   all lags ref/new |   norm  ref / new |    hpf  ref / new | check");
+    PrintAndLogEx(INFO, "-----+---------+--------------------------------------+-------------------+-------------------+------");
+
+    bool all_ok = true;
+    for (size_t s = 0; s < ARRAYLEN(sizes) && sizes[s] <= max_len; s++) {
+        size_t len = sizes[s];
+        int *sig = calloc(len, sizeof(int));
+        int *ref = calloc(len, sizeof(int));
+        int *out = calloc(len, sizeof(int));
+        lfdemod_ctx_t *ctx = lfdemod_ctx_create(NULL, 0);
+        if (sig == NULL || ref == NULL || out == NULL || ctx == NULL) {
+            free(sig);
+            free(ref);
+            free(out);
+            lfdemod_ctx_free(ctx);
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+        // the benchmark works on its own graph
+        lfdemod_ctx_t *prev = lfdemod_ctx_select(ctx);
+
+        for (dsp_bench_signal_t type = DSP_BENCH_ASK; type <= DSP_BENCH_PSK; type++) {
+            dsp_bench_signal(sig, len, type);
+            bool ok = true;
+
+            // autocorr,  the reference over as many lags as it gets through in about a second
+            size_t all = len - DSP_BENCH_WINDOW;
+            size_t lags = MIN(all, DSP_BENCH_REF_PAIRS / len);
+            int dist_ref = -1, dist_new = -1, dist_all = -1;
+
+            uint64_t start = usclock();
+            ok &= autocorr_compute(sig, len, len - lags, true, ref, &dist_ref);
+            double t_ref = dsp_bench_ms(start);
+
+            start = usclock();
+            ok &= autocorr_compute(sig, len, len - lags, false, out, &dist_new);
+            double t_new = dsp_bench_ms(start);
+            ok &= (dist_ref == dist_new) && (memcmp(ref, out, len * sizeof(int)) == 0);
+
+            start = usclock();
+            ok &= autocorr_compute(sig, len, DSP_BENCH_WINDOW, false, out, &dist_all);
+            double t_all = dsp_bench_ms(start);
+            ok &= (memcmp(ref, out, lags * sizeof(int)) == 0);
+            ok &= dsp_bench_autocov(sig, len, lags);
+
+            double t_all_ref = t_ref * dsp_bench_pairs(len, all) / dsp_bench_pairs(len, lags);
+
+            // norm
+            memcpy(ref, sig, len * sizeof(int));
+            start = usclock();
+            norm_samples_ref(ref, len);
+            double t_norm_ref = dsp_bench_ms(start);
+
+            memcpy(out, sig, len * sizeof(int));
+            start = usclock();
+            norm_samples(out, len);
+            double t_norm = dsp_bench_ms(start);
+            ok &= (memcmp(ref, out, len * sizeof(int)) == 0);
+
+            // hpf
+            reserveGraphBuffer(len);
+            memcpy(g_GraphBuffer, sig, len * sizeof(int));
+            g_GraphTraceLen = len;
+            start = usclock();
+            dsp_bench_hpf_ref();
+            double t_hpf_ref = dsp_bench_ms(start);
+            memcpy(ref, g_GraphBuffer, len * sizeof(int));
+            signal_t sp_ref = *getSignalProperties();
+
+            reserveGraphBuffer(len);
+            memcpy(g_GraphBuffer, sig, len * sizeof(int));
+            g_GraphTraceLen = len;
+            start = usclock();
+            removeGraphSignalOffset();
+            double t_hpf = dsp_bench_ms(start);
+            signal_t *sp = getSignalProperties();
+            ok &= (g_GraphTraceLen == len) && (memcmp(ref, g_GraphBuffer, len * sizeof(int)) == 0);
+            ok &= (sp->low == sp_ref.low) && (sp->high == sp_ref.high) && (sp->mean == sp_ref.mean) &&
+                  (sp->amplitude == sp_ref.amplitude) && (sp->isnoise == sp_ref.isnoise);
+
+            all_ok &= ok;
+            PrintAndLogEx(INFO, " %s | %7zu | %5zu %7.1f %7.1f %9.0f / %-7.1f | %7.2f / %-7.2f | %7.2f / %-7.2f | %s",
+                          names[type], len, lags, t_ref, t_new, t_all_ref, t_all,
+                          t_norm_ref, t_norm, t_hpf_ref, t_hpf,
+                          ok ? _GREEN_("ok") : _RED_("fail"));
+        }
+
+        lfdemod_ctx_select(prev);
+        lfdemod_ctx_free(ctx);
+        free(sig);
+        free(ref);
+        free(out);
+    }
+    PrintAndLogEx(INFO, "-----+---------+--------------------------------------+-------------------+-------------------+------");
+
+    if (all_ok == false) {
+        PrintAndLogEx(FAILED, "Signal kernels " _RED_("differ") " from the reference");
+        return PM3_ESOFT;
+    }
+    PrintAndLogEx(SUCCESS, "All signal kernels match the reference");
     return PM3_SUCCESS;
 }
 
+static int CmdDataBench(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "data bench",
+                  "Benchmark the signal kernels behind `data autocorr`, `data norm` and `data hpf` on synthetic\n"
+                  "ASK, FSK and PSK signals of 10k to 1M samples and check them against the reference code.\n"
+                  "On long signals the reference autocorrelation only runs the first lags, its time over\n"
+                  "all lags is extrapolated. The graph buffer is left alone.",
+                  "data bench\n"
+                  "data bench --max 100000"
+                 );
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0(NULL, "max", "<dec>", "largest signal in samples (def 1000000)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    size_t max_len = arg_get_u32_def(ctx, 1, 1000000);
+    CLIParserFree(ctx);
+
+    return data_bench(max_len);
+}
+
 static int CmdAtrLookup(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "data atr",
@@ -3881,6 +4419,7 @@ static command_t CommandTable[] = {
     {"-----------",      CmdHelp,                 AlwaysAvailable, "------------------------- " _CYAN_("Operations") "-------------------------"},
     {"asn1",             CmdAsn1Decoder,          AlwaysAvailable,  "ASN1 decoder"},
     {"atr",              CmdAtrLookup,            AlwaysAvailable,  "ATR lookup"},
+    {"bench",            CmdDataBench,            AlwaysAvailable,  "Benchmark the signal kernels against the reference code"},
     {"bitsamples",       CmdBitsamples,           IfPm3Present,     "Get raw samples as bitstring"},
     {"bmap",             CmdBinaryMap,            AlwaysAvailable,  "Convert hex value according a binary template"},
     {"crypto",           CmdCryptography,         AlwaysAvailable,  "Encrypt and decrypt data"},
@@ -21,6 +21,7 @@
 
 #include "common.h"
 #include <stdbool.h>
+#include "graph.h"      // lfdemod_ctx_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -76,6 +77,10 @@ int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bo
 int PSKDemod(int clk, int invert, int maxErr, bool verbose);                                    // used by cmd lf em4x, lf indala, lf keri, lf nexwatch, lf t55xx
 int NRZrawDemod(int clk, int invert, int maxErr, bool verbose);                                 // used by cmd lf pac, lf t55xx
 
+void demodCacheStart(void);                                                                     // used by cmd lf search
+void demodCacheStop(void);
+void demodCacheStats(uint32_t *hits, uint32_t *misses);
+
 
 int printDemodBuff(uint8_t offset, bool strip_leading, bool invert, bool print_hex);
 
@@ -83,6 +88,8 @@ void setDemodBuff(const uint8_t *buff, size_t size, size_t start_idx);
 bool getDemodBuff(uint8_t *buff, size_t *size);
 int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose);
 
+int fixGraphBuffer(void);
+
 int getSamples(uint32_t n, bool verbose);
 int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_config);
 int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sample, bool verbose);
@@ -93,11 +100,12 @@ int centerThreshold(const int *in, int *out, size_t len, int8_t up, int8_t down)
 int AskEdgeDetect(const int *in, int *out, int len, int threshold);
 
 #define MAX_DEMOD_BUF_LEN (1024*128)
-extern uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN];
-extern size_t g_DemodBufferLen;
+// the DemodBuffer of the selected demodulation context, see lfdemod_ctx_t in graph.h
+#define g_DemodBuffer    (g_lfdemod_ctx->demod)
+#define g_DemodBufferLen (g_lfdemod_ctx->demod_len)
 
-extern int g_DemodClock;
-extern int32_t g_DemodStartIdx;
+#define g_DemodClock     (g_lfdemod_ctx->demod_clock)
+#define g_DemodStartIdx  (g_lfdemod_ctx->demod_start_idx)
 
 #ifdef __cplusplus
 }
@@ -530,6 +530,10 @@ int handle_hf_plot(bool show_plot) {
         return PM3_ETIMEOUT;
     }
 
+    if (reserveGraphBuffer(FPGA_TRACE_SIZE) == false) {
+        return PM3_EMALLOC;
+    }
+
     for (size_t i = 0; i < FPGA_TRACE_SIZE; i++) {
         g_GraphBuffer[i] = ((int)buf[i]) - 128;
     }
@@ -419,6 +419,19 @@ static int CmdHf14AConfig(const char *Cmd) {
     return hf14a_setconfig(&config, verbose);
 }
 
+// UID, ATQA, SAK and ATS as results,  for callers capturing them
+static void hf14a_report_card(const iso14a_card_select_t *card) {
+    PrintAndLogResultHex("hf14a.uid", card->uid, card->uidlen);
+    uint8_t atqa[] = {card->atqa[1], card->atqa[0]};
+    PrintAndLogResultHex("hf14a.atqa", atqa, sizeof(atqa));
+    PrintAndLogResultInt("hf14a.sak", card->sak);
+
+    // a valid ATS consists of at least the length byte (TL) and 2 CRC bytes
+    if (card->ats_len >= 3) {
+        PrintAndLogResultHex("hf14a.ats", card->ats, (card->ats_len == card->ats[0] + 2) ? card->ats[0] : card->ats_len);
+    }
+}
+
 int Hf14443_4aGetCardData(iso14a_card_select_t *card) {
 
     SendCommandMIX(CMD_HF_ISO14443A_READER, ISO14A_CONNECT, 0, 0, NULL, 0);
@@ -456,6 +469,7 @@ int Hf14443_4aGetCardData(iso14a_card_select_t *card) {
     }
     PrintAndLogEx(SUCCESS, "ATQA: %02X %02X", card->atqa[1], card->atqa[0]);
     PrintAndLogEx(SUCCESS, " SAK: %02X [%" PRIu64 "]", card->sak, resp.oldarg[0]);
+    hf14a_report_card(card);
 
     // a valid ATS consists of at least the length byte (TL) and 2 CRC bytes
     if (card->ats_len < 3) {
@@ -622,6 +636,7 @@ static int CmdHF14AReader(const char *Cmd) {
             } else {
                 PrintAndLogEx(SUCCESS, " UID: " _GREEN_("%s"), sprint_hex(card.uid, card.uidlen));
             }
+            hf14a_report_card(&card);
 
             if (!(silent && continuous)) {
                 PrintAndLogEx(SUCCESS, "ATQA: " _GREEN_("%02X %02X"), card.atqa[1], card.atqa[0]);
@@ -2068,6 +2083,7 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
     }
     PrintAndLogEx(SUCCESS, "ATQA: " _GREEN_("%02X %02X"), card.atqa[1], card.atqa[0]);
     PrintAndLogEx(SUCCESS, " SAK: " _GREEN_("%02X [%" PRIu64 "]"), card.sak, resp.oldarg[0]);
+    hf14a_report_card(&card);
 
     bool isMifareMini = false;
     bool isMifareClassic = true;
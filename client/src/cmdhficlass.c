@@ -29,6 +29,7 @@
 #include "loclass/cipher.h"
 #include "loclass/ikeys.h"
 #include "loclass/elite_crack.h"
+#include "iclass_bs_core.h"          // iclass_mac_bitsliced
 #include "fileutils.h"
 #include "protocols.h"
 #include "cardhelper.h"
@@ -3910,6 +3911,7 @@ static int CmdHFiClassLookUp(const char *Cmd) {
 
 typedef struct {
     uint8_t thread_idx;
+    uint8_t thread_count;
     uint8_t use_raw;
     uint8_t use_elite;
     uint32_t keycnt;
@@ -3922,13 +3924,12 @@ typedef struct {
     } list;
 } PACKED iclass_thread_arg_t;
 
-static size_t iclass_tc = 1;
-
-static pthread_mutex_t generator_mutex = PTHREAD_MUTEX_INITIALIZER;
+// the loclass cipher and key diversification are re-entrant, workers need no locking
 static void *bf_generate_mac(void *thread_arg) {
 
     iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
     const uint8_t idx = targ->thread_idx;
+    const uint8_t tc = targ->thread_count;
     const uint8_t use_raw = targ->use_raw;
     const uint8_t use_elite = targ->use_elite;
     const uint32_t keycnt = targ->keycnt;
@@ -3942,35 +3943,44 @@ static void *bf_generate_mac(void *thread_arg) {
     memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
 
     uint8_t key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-    uint8_t div_key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t div_keys[ICLASS_BS_BATCH * 8];
+    uint8_t macs[ICLASS_BS_BATCH * 4];
 
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
+    for (uint32_t i = idx; i < keycnt;) {
 
-        memcpy(key, keys + 8 * i, 8);
+        uint32_t first = i;
+        uint32_t n = 0;
+        for (; n < ICLASS_BS_BATCH && i < keycnt; n++, i += tc) {
 
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw)
-            memcpy(div_key, key, 8);
-        else
-            HFiClassCalcDivKey(csn, key, div_key, use_elite);
+            memcpy(key, keys + 8 * i, 8);
+
+            if (use_raw)
+                memcpy(div_keys + 8 * n, key, 8);
+            else
+                HFiClassCalcDivKey(csn, key, div_keys + 8 * n, use_elite);
+        }
 
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+        iclass_mac_bitsliced(cc_nr, div_keys, macs, n);
+
+        for (uint32_t j = 0; j < n; j++) {
+            memcpy(list[first + j * tc].mac, macs + 4 * j, 4);
+        }
     }
     return NULL;
 }
 
-// precalc diversified keys and their MAC
-void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
+static int generate_mac_threads(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list, uint8_t tc) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
+    if (tc == 0) {
+        tc = 1;
+    }
 
-    iclass_tc = num_CPUs();
-    pthread_t threads[iclass_tc];
-    iclass_thread_arg_t args[iclass_tc];
+    pthread_t threads[tc];
+    iclass_thread_arg_t args[tc];
     // init thread arguments
-    for (size_t i = 0; i < iclass_tc; i++) {
+    for (size_t i = 0; i < tc; i++) {
         args[i].thread_idx = i;
+        args[i].thread_count = tc;
         args[i].use_raw = use_raw;
         args[i].use_elite = use_elite;
         args[i].keycnt = keycnt;
@@ -3981,23 +3991,31 @@ void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite,
         memcpy(args[i].cc_nr, CCNR, sizeof(args[i].cc_nr));
     }
 
-    for (int i = 0; i < iclass_tc; i++) {
+    for (int i = 0; i < tc; i++) {
         int res = pthread_create(&threads[i], NULL, bf_generate_mac, (void *)&args[i]);
         if (res) {
             PrintAndLogEx(NORMAL, "");
             PrintAndLogEx(WARNING, "Failed to create pthreads. Quitting");
-            return;
+            return PM3_ESOFT;
         }
     }
 
-    for (int i = 0; i < iclass_tc; i++)
+    for (int i = 0; i < tc; i++)
         pthread_join(threads[i], NULL);
+
+    return PM3_SUCCESS;
+}
+
+// precalc diversified keys and their MAC
+void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
+    generate_mac_threads(CSN, CCNR, use_raw, use_elite, keys, keycnt, list, MIN(num_CPUs(), UINT8_MAX));
 }
 
 static void *bf_generate_mackey(void *thread_arg) {
 
     iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
     const uint8_t idx = targ->thread_idx;
+    const uint8_t tc = targ->thread_count;
     const uint8_t use_raw = targ->use_raw;
     const uint8_t use_elite = targ->use_elite;
     const uint32_t keycnt = targ->keycnt;
@@ -4010,33 +4028,41 @@ static void *bf_generate_mackey(void *thread_arg) {
     memcpy(csn, targ->csn, sizeof(csn));
     memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
 
-    uint8_t div_key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t div_keys[ICLASS_BS_BATCH * 8];
+    uint8_t macs[ICLASS_BS_BATCH * 4];
 
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
+    for (uint32_t i = idx; i < keycnt;) {
 
-        memcpy(list[i].key, keys + 8 * i, 8);
+        uint32_t first = i;
+        uint32_t n = 0;
+        for (; n < ICLASS_BS_BATCH && i < keycnt; n++, i += tc) {
 
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw)
-            memcpy(div_key, list[i].key, 8);
-        else
-            HFiClassCalcDivKey(csn, list[i].key, div_key, use_elite);
+            memcpy(list[i].key, keys + 8 * i, 8);
+
+            if (use_raw)
+                memcpy(div_keys + 8 * n, list[i].key, 8);
+            else
+                HFiClassCalcDivKey(csn, list[i].key, div_keys + 8 * n, use_elite);
+        }
 
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+        iclass_mac_bitsliced(cc_nr, div_keys, macs, n);
+
+        for (uint32_t j = 0; j < n; j++) {
+            memcpy(list[first + j * tc].mac, macs + 4 * j, 4);
+        }
     }
     return NULL;
 }
 
 void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_prekey_t *list) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
-    iclass_tc = num_CPUs();
-    pthread_t threads[iclass_tc];
-    iclass_thread_arg_t args[iclass_tc];
+    uint8_t tc = MIN(num_CPUs(), UINT8_MAX);
+    pthread_t threads[tc];
+    iclass_thread_arg_t args[tc];
     // init thread arguments
-    for (size_t i = 0; i < iclass_tc; i++) {
+    for (size_t i = 0; i < tc; i++) {
         args[i].thread_idx = i;
+        args[i].thread_count = tc;
         args[i].use_raw = use_raw;
         args[i].use_elite = use_elite;
         args[i].keycnt = keycnt;
@@ -4047,7 +4073,7 @@ void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elit
         memcpy(args[i].cc_nr, CCNR, sizeof(args[i].cc_nr));
     }
 
-    for (size_t i = 0; i < iclass_tc; i++) {
+    for (size_t i = 0; i < tc; i++) {
         int res = pthread_create(&threads[i], NULL, bf_generate_mackey, (void *)&args[i]);
         if (res) {
             PrintAndLogEx(NORMAL, "");
@@ -4056,11 +4082,97 @@ void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elit
         }
     }
 
-    for (int i = 0; i < iclass_tc; i++)
+    for (int i = 0; i < tc; i++)
         pthread_join(threads[i], NULL);
 
 }
 
+static int CmdHFiClassBench(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf iclass bench",
+                  "Benchmark the offline key diversification and MAC precalculation used by `hf iclass chk`.\n"
+                  "Runs with one thread and with all threads, reports MACs/s in total and per thread",
+                  "hf iclass bench\n"
+                  "hf iclass bench --elite -n 20000\n"
+                  "hf iclass bench -t 4"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("n", "num", "<dec>", "Number of keys (def 100000)"),
+        arg_u64_0("t", "threads", "<dec>", "Number of threads (def all cores)"),
+        arg_lit0(NULL, "elite", "Elite computations applied to key"),
+        arg_lit0(NULL, "raw", "no computations applied to key"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t keycnt = arg_get_u32_def(ctx, 1, 100000);
+    uint32_t tc = arg_get_u32_def(ctx, 2, num_CPUs());
+    bool use_elite = arg_get_lit(ctx, 3);
+    bool use_raw = arg_get_lit(ctx, 4);
+    CLIParserFree(ctx);
+
+    if (keycnt == 0) {
+        PrintAndLogEx(ERR, "Number of keys must be larger than zero");
+        return PM3_EINVARG;
+    }
+
+    if (tc == 0 || tc > UINT8_MAX) {
+        PrintAndLogEx(ERR, "Number of threads must be between 1 and %u", UINT8_MAX);
+        return PM3_EINVARG;
+    }
+
+    uint8_t *keys = calloc(keycnt, 8);
+    iclass_premac_t *ref = calloc(keycnt, sizeof(iclass_premac_t));
+    iclass_premac_t *pre = calloc(keycnt, sizeof(iclass_premac_t));
+    if (keys == NULL || ref == NULL || pre == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(keys);
+        free(ref);
+        free(pre);
+        return PM3_EMALLOC;
+    }
+
+    for (uint32_t i = 0; i < keycnt * 8; i++) {
+        keys[i] = rand() & 0xFF;
+    }
+
+    uint8_t csn[8] = {0x96, 0x55, 0xa4, 0x00, 0xf8, 0xff, 0x12, 0xe0};
+    uint8_t cc_nr[12] = {0xf0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00};
+
+    PrintAndLogEx(INFO, "Generating " _YELLOW_("%u") " %s MACs", keycnt, (use_raw) ? "raw" : (use_elite) ? "elite" : "standard");
+
+    uint64_t t1 = msclock();
+    int res = generate_mac_threads(csn, cc_nr, use_raw, use_elite, keys, keycnt, ref, 1);
+    t1 = msclock() - t1;
+
+    uint64_t t2 = msclock();
+    if (res == PM3_SUCCESS) {
+        res = generate_mac_threads(csn, cc_nr, use_raw, use_elite, keys, keycnt, pre, tc);
+    }
+    t2 = msclock() - t2;
+
+    if (res == PM3_SUCCESS) {
+        float s1 = MAX(t1, 1) / 1000.0;
+        float s2 = MAX(t2, 1) / 1000.0;
+        PrintAndLogEx(SUCCESS, " 1 thread   %7.3f s  " _YELLOW_("%10.0f") " MACs/s", s1, keycnt / s1);
+        PrintAndLogEx(SUCCESS, "%2u threads  %7.3f s  " _YELLOW_("%10.0f") " MACs/s  ( %.0f MACs/s per thread )", tc, s2, keycnt / s2, keycnt / s2 / tc);
+        PrintAndLogEx(SUCCESS, "scaling     %.2fx", s1 / s2);
+
+        if (memcmp(ref, pre, keycnt * sizeof(iclass_premac_t)) == 0) {
+            PrintAndLogEx(SUCCESS, "MACs match ( " _GREEN_("ok") " )");
+        } else {
+            PrintAndLogEx(FAILED, "MACs match ( " _RED_("fail") " )");
+            res = PM3_ESOFT;
+        }
+    }
+
+    free(keys);
+    free(ref);
+    free(pre);
+    return res;
+}
+
 // print diversified keys
 void PrintPreCalcMac(uint8_t *keys, uint32_t keycnt, iclass_premac_t *pre_list) {
 
@@ -4649,6 +4761,7 @@ static command_t CommandTable[] = {
     {"chk",         CmdHFiClassCheckKeys,       IfPm3Iclass,     "Check keys"},
     {"loclass",     CmdHFiClass_loclass,        AlwaysAvailable, "Use loclass to perform bruteforce reader attack"},
     {"lookup",      CmdHFiClassLookUp,          AlwaysAvailable, "Uses authentication trace to check for key in dictionary file"},
+    {"bench",       CmdHFiClassBench,           AlwaysAvailable, "Benchmark MAC precalculation speed"},
     {"-----------", CmdHelp,                    IfPm3Iclass,     "-------------------- " _CYAN_("Simulation") " -------------------"},
     {"sim",         CmdHFiClassSim,             IfPm3Iclass,     "Simulate iCLASS tag"},
     {"eload",       CmdHFiClassELoad,           IfPm3Iclass,     "Upload file into emulator memory"},
@@ -30,6 +30,7 @@
 #include "crapto1/crapto1.h"
 #include "protocols.h"
 #include "cmdhficlass.h"
+#include "hardnested_bf_core.h"  // crypto1_bs_dict_t
 
 enum MifareAuthSeq {
     masNone,
@@ -41,9 +42,17 @@ enum MifareAuthSeq {
     masData,
     masError,
 };
-static enum MifareAuthSeq MifareAuthState;
 static AuthData_t AuthData;
 
+// ISO14443-A annotation state (MIFARE auth sequence, NTAG I2C sector select, UL-C authentication).
+// Thread local,  `trace list --threads` annotates chunks of a trace in parallel.
+// Every chunk starts at a REQA / WUPA,  which resets this state.
+static __thread enum MifareAuthSeq MifareAuthState = masNone;
+static __thread int gs_ntag_i2c_state = 0;
+static __thread int gs_mfuc_state = 0;
+static __thread uint8_t gs_mfuc_authdata[3][16] = {{0}};
+static __thread uint8_t *gs_mfuc_key = NULL;
+
 void ClearAuthData(void) {
     AuthData.uid = 0;
     AuthData.nt = 0;
@@ -53,11 +62,6 @@ void ClearAuthData(void) {
 }
 
 
-static int gs_ntag_i2c_state = 0;
-static int gs_mfuc_state = 0;
-static uint8_t gs_mfuc_authdata[3][16] = {{0}};
-static uint8_t *gs_mfuc_key = NULL;
-
 /**
  * @brief iso14443A_CRC_check Checks CRC in command or response
  * @param isResponse
@@ -222,6 +226,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
                 break;
             case ISO14443A_CMD_WUPA:
                 snprintf(exp, size, "WUPA");
+                gs_mfuc_state = 0;
+                gs_mfuc_key = NULL;
                 break;
             case ISO14443A_CMD_ANTICOLL_OR_SELECT: {
                 // 93 20 = Anticollision (usage: 9320 - answer: 4bytes UID+1byte UID-bytes-xor)
@@ -261,6 +267,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
             }
             case ISO14443A_CMD_REQA:
                 snprintf(exp, size, "REQA");
+                gs_mfuc_state = 0;
+                gs_mfuc_key = NULL;
                 break;
             case ISO14443A_CMD_READBLOCK:
                 snprintf(exp, size, "READBLOCK(" _MAGENTA_("%d") ")", cmd[1]);
@@ -461,6 +469,13 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
     return PM3_SUCCESS;
 }
 
+void annotateIso14443a_init(void) {
+    MifareAuthState = masNone;
+    gs_ntag_i2c_state = 0;
+    gs_mfuc_state = 0;
+    gs_mfuc_key = NULL;
+}
+
 void annotateIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool is_response) {
     applyIso14443a(exp, size, cmd, cmdsize, is_response);
 }
@@ -2111,6 +2126,55 @@ void annotateMifare(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize,
     }
 }
 
+// bitsliced copy of the dictionary handed to DecodeMifareData(), built on the first nested authentication
+static crypto1_bs_dict_t gs_mf_bs_dict;
+static const uint64_t *gs_mf_bs_dict_keys = NULL;
+
+void ClearMifareDictionary(void) {
+    crypto1_bs_dict_free(&gs_mf_bs_dict);
+    gs_mf_bs_dict_keys = NULL;
+}
+
+// find the first dictionary key that decrypts the nested authentication in AuthData
+static bool NestedCheckDictionary(const uint64_t *keys, uint32_t count, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, uint32_t *idx) {
+
+    if (gs_mf_bs_dict_keys != keys || gs_mf_bs_dict.count != count) {
+        ClearMifareDictionary();
+        if (crypto1_bs_dict_init(&gs_mf_bs_dict, keys, count)) {
+            gs_mf_bs_dict_keys = keys;
+        }
+    }
+
+    // out of memory,  test key by key
+    if (gs_mf_bs_dict_keys == NULL) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (NestedCheckKey(keys[i], &AuthData, cmd, cmdsize, parity)) {
+                *idx = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the bitsliced filter only checks the reader answer,  candidates get the full check
+    uint32_t candidates[64];
+    uint32_t first = 0;
+    uint32_t n;
+    while ((n = crypto1_bs_dict_nested(&gs_mf_bs_dict, first, AuthData.uid, AuthData.nt_enc, AuthData.nr_enc, AuthData.ar_enc, candidates, ARRAYLEN(candidates))) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (NestedCheckKey(keys[candidates[i]], &AuthData, cmd, cmdsize, parity)) {
+                *idx = candidates[i];
+                return true;
+            }
+        }
+        first = candidates[n - 1] + 1;
+    }
+
+    AuthData.ks2 = 0;
+    AuthData.ks3 = 0;
+    return false;
+}
+
 static void mf_get_paritybinstr(char *s, uint32_t val, uint8_t par) {
     uint8_t foo[4] = {0, 0, 0, 0};
     num_to_bytes(val, sizeof(uint32_t), foo);
@@ -2172,14 +2236,12 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
 
             // check default keys
             if (!traceCrypto1 && dicKeys != NULL && dicKeysCount > 0) {
-                for (int i = 0; i < dicKeysCount; i++) {
-                    if (NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
-                        PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
+                uint32_t i = 0;
+                if (NestedCheckDictionary(dicKeys, dicKeysCount, cmd, cmdsize, parity, &i)) {
+                    PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
 
-                        mfLastKey = dicKeys[i];
-                        traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-                        break;
-                    };
+                    mfLastKey = dicKeys[i];
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 }
             }
 
@@ -2198,6 +2198,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "hf mf hardnested -r\n"
                   "hf mf hardnested -r --tk a0a1a2a3a4a5\n"
                   "hf mf hardnested -t --tk a0a1a2a3a4a5\n"
+                  "hf mf hardnested -r --cache     --> decompressed tables are cached in user directory\n"
                   "hf mf hardnested --blk 0 -a -k a0a1a2a3a4a5 --tblk 4 --ta --tk FFFFFFFFFFFF\n"
                  );
 
@@ -2217,6 +2218,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         arg_lit0("s",  "slow",           "Slower acquisition (required by some non standard cards)"),
         arg_lit0("t",  "tests",          "Run tests"),
         arg_lit0("w",  "wr",             "Acquire nonces and UID, and write them to file `hf-mf-<UID>-nonces.bin`"),
+        arg_lit0(NULL, "cache",          "Keep decompressed tables in a memory-mapped cache file in user directory"),
 
         arg_lit0(NULL, "in", "None (use CPU regular instruction set)"),
 #if defined(COMPILER_HAS_SIMD_X86)
@@ -2277,22 +2279,25 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     bool slow = arg_get_lit(ctx, 12);
     bool tests = arg_get_lit(ctx, 13);
     bool nonce_file_write = arg_get_lit(ctx, 14);
+    bool use_cache = arg_get_lit(ctx, 15);
 
-    bool in = arg_get_lit(ctx, 15);
+    bool in = arg_get_lit(ctx, 16);
 #if defined(COMPILER_HAS_SIMD_X86)
-    bool im = arg_get_lit(ctx, 16);
-    bool is = arg_get_lit(ctx, 17);
-    bool ia = arg_get_lit(ctx, 18);
-    bool i2 = arg_get_lit(ctx, 19);
+    bool im = arg_get_lit(ctx, 17);
+    bool is = arg_get_lit(ctx, 18);
+    bool ia = arg_get_lit(ctx, 19);
+    bool i2 = arg_get_lit(ctx, 20);
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    bool i5 = arg_get_lit(ctx, 20);
+    bool i5 = arg_get_lit(ctx, 21);
 #endif
 #if defined(COMPILER_HAS_SIMD_NEON)
-    bool ie = arg_get_lit(ctx, 16);
+    bool ie = arg_get_lit(ctx, 17);
 #endif
     CLIParserFree(ctx);
 
+    hardnested_use_table_cache(use_cache);
+
     // set SIM instructions
     SetSIMDInstr(SIMD_AUTO);
 
@@ -3043,9 +3048,64 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
                                           slow ? "Yes" : "No");
                         }
 
+                        // Attack the remaining keys in one session, the current one first.
+                        // B keys of later sectors are only included once reading this sector's B key failed,
+                        // otherwise the loop may still read them with the A key.
+                        hardnested_target_t *hn_targets = calloc(sector_cnt * 2, sizeof(hardnested_target_t));
+                        if (hn_targets == NULL) {
+                            PrintAndLogEx(WARNING, "Failed to allocate memory");
+                            free(e_sector);
+                            free(fptr);
+                            return PM3_EMALLOC;
+                        }
+                        uint16_t hn_cnt = 0;
+                        for (int i = current_sector_i; i < sector_cnt; i++) {
+                            for (int j = MF_KEY_A; j <= MF_KEY_B; j++) {
+                                bool is_current = (i == current_sector_i && j == current_key_type_i);
+                                if (i == current_sector_i && j < current_key_type_i)
+                                    continue;
+                                if (is_current == false && (e_sector[i].foundKey[j] || (j == MF_KEY_B && current_key_type_i == MF_KEY_A)))
+                                    continue;
+
+                                hn_targets[hn_cnt].blockno = mfFirstBlockOfSector(i);
+                                hn_targets[hn_cnt].keytype = j;
+                                hn_cnt++;
+                            }
+                        }
+                        if (verbose && hn_cnt > 1) {
+                            PrintAndLogEx(INFO, "and %u more keys in the same session", hn_cnt - 1);
+                        }
+
                         foundkey = 0;
-                        isOK = mfnestedhard(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(current_sector_i), current_key_type_i, NULL, false, false, slow, 0, &foundkey, NULL);
+                        isOK = mfnestedhard_multi(mfFirstBlockOfSector(sectorno), keytype, key, hn_targets, hn_cnt, slow);
                         DropField();
+                        // keep every key found, whatever happened to the other targets
+                        bool hn_aborted = false;
+                        for (uint16_t i = 1; i < hn_cnt; i++) {
+                            if (hn_targets[i].status == PM3_EOPABORTED)
+                                hn_aborted = true;
+                            if (hn_targets[i].status != PM3_SUCCESS)
+                                continue;
+
+                            uint8_t s = mfSectorNum(hn_targets[i].blockno);
+                            e_sector[s].Key[hn_targets[i].keytype] = hn_targets[i].key;
+                            e_sector[s].foundKey[hn_targets[i].keytype] = 'H';
+                            PrintAndLogEx(SUCCESS, "target sector %3u key type %c -- found valid key [ " _GREEN_("%012" PRIx64) " ]",
+                                          s,
+                                          (hn_targets[i].keytype == MF_KEY_B) ? 'B' : 'A',
+                                          hn_targets[i].key
+                                         );
+                        }
+                        if (isOK == PM3_SUCCESS) {
+                            foundkey = hn_targets[0].key;
+                            e_sector[current_sector_i].Key[current_key_type_i] = foundkey;
+                            e_sector[current_sector_i].foundKey[current_key_type_i] = 'H';
+                        }
+                        // an abort during a later target still stops autopwn
+                        if (hn_aborted && (isOK == PM3_SUCCESS || isOK == PM3_EFAILED)) {
+                            isOK = PM3_EOPABORTED;
+                        }
+                        free(hn_targets);
                         if (isOK != PM3_SUCCESS) {
                             switch (isOK) {
                                 case PM3_ETIMEOUT: {
@@ -3061,12 +3121,6 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
 
                                     e_sector[current_sector_i].Key[current_key_type_i] = 0xffffffffffff;;
                                     e_sector[current_sector_i].foundKey[current_key_type_i] = false;
-
-                                    // Show the results to the user
-                                    PrintAndLogEx(NORMAL, "");
-                                    PrintAndLogEx(SUCCESS, _GREEN_("found keys:"));
-                                    printKeyTable(sector_cnt, e_sector);
-                                    PrintAndLogEx(NORMAL, "");
                                     break;
                                 }
                                 case PM3_EFAILED: {
@@ -3077,6 +3131,13 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
                                     break;
                                 }
                             }
+
+                            // Show the results to the user
+                            PrintAndLogEx(NORMAL, "");
+                            PrintAndLogEx(SUCCESS, _GREEN_("found keys:"));
+                            printKeyTable(sector_cnt, e_sector);
+                            PrintAndLogEx(NORMAL, "");
+
                             free(e_sector);
                             free(fptr);
                             return PM3_ESOFT;
@@ -3949,6 +4010,7 @@ void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, nonces_t data, bool
         }
     }
 
+    mfkey32_free_recovery();
     free(k_sector);
 }
 
@@ -7090,6 +7152,7 @@ static int mfc_furui_recovery(uint8_t items, uint8_t tracedata[FURUI_MAX_TRACES]
             }
         }
     }
+    mfkey32_free_recovery();
     return PM3_SUCCESS;
 }
 
@@ -7138,6 +7201,7 @@ static int mfc_supercard_gen2_recovery(uint8_t items, uint8_t tracedata[FURUI_MA
             }
         }
     }
+    mfkey32_free_recovery();
     return PM3_SUCCESS;
 }
 
@@ -7401,6 +7465,7 @@ static int CmdHf14AMfSuperCard(const char *Cmd) {
     } else {
         PrintAndLogEx(FAILED, "failed to recover any key");
     }
+    mfkey32_free_recovery();
     return PM3_SUCCESS;
 }
 
@@ -30,8 +30,13 @@
 #include <locale.h>
 #include <math.h>
 #include <time.h> // MingW
+#include <sys/stat.h>
+#include <unistd.h>
 #include <lz4frame.h>
 #include <bzlib.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "commonutil.h"  // ARRAYLEN
 #include "comms.h"
@@ -44,6 +49,7 @@
 #include "hardnested_bf_core.h"
 #include "hardnested_bitarray_core.h"
 #include "fileutils.h"
+#include "mifare/mifarehost.h"   // mfCheckKeys
 
 #define NUM_CHECK_BITFLIPS_THREADS      (num_CPUs())
 #define NUM_REDUCTION_WORKING_THREADS   (num_CPUs())
@@ -56,6 +62,14 @@
 #define STATE_FILE_TEMPLATE_LZ4         "bitflip_%d_%03" PRIx16 "_states.bin.lz4"
 #define STATE_FILE_TEMPLATE_BZ2         "bitflip_%d_%03" PRIx16 "_states.bin.bz2"
 
+#define BITFLIP_TABLE_SIZE              (sizeof(uint32_t) * (1 << 19))
+
+// optional cache of the decompressed tables in the user directory
+#define TABLE_CACHE_FILE                "hardnested_tables.bin"
+#define TABLE_CACHE_MAGIC               0x43544E48  // "HNTC"
+#define TABLE_CACHE_VERSION             1
+#define TABLE_CACHE_ALIGN               4096
+
 #define DEBUG_KEY_ELIMINATION
 // #define DEBUG_REDUCTION
 
@@ -135,6 +149,11 @@ static void print_progress_header(void) {
     PrintAndLogEx(INFO, "       0 |       0 | %-73s |                 |", progress_text);
 }
 
+// the brute force reports its measured rate, which then replaces the benchmark result for the time estimations
+void hardnested_update_brute_force_rate(float keys_per_second) {
+    brute_force_per_second = keys_per_second;
+}
+
 void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time) {
     static uint64_t last_print_time = 0;
     if (msclock() - last_print_time >= min_diff_print_time) {
@@ -254,47 +273,294 @@ static void init_bunzip2(bz_stream *compressed_stream, char *input_buffer, uint3
 
 }
 
+typedef enum {
+    STATE_FILE_NONE = 0,
+    STATE_FILE_RAW,
+    STATE_FILE_LZ4,
+    STATE_FILE_BZ2
+} state_file_t;
+
+//----------------------------------------------------------------------------
+// Find the table for odd_even/bitflip. Uncompressed files are preferred
+// over LZ4 and BZ2 compressed ones.
+//----------------------------------------------------------------------------
+static state_file_t search_state_file(odd_even_t odd_even, uint16_t bitflip, char *state_file_name, size_t name_len, char **path) {
+    for (state_file_t kind = STATE_FILE_RAW; kind <= STATE_FILE_BZ2; kind++) {
+        if (kind == STATE_FILE_RAW) {
+            snprintf(state_file_name, name_len, STATE_FILE_TEMPLATE_RAW, odd_even, bitflip);
+        } else if (kind == STATE_FILE_LZ4) {
+            snprintf(state_file_name, name_len, STATE_FILE_TEMPLATE_LZ4, odd_even, bitflip);
+        } else {
+            snprintf(state_file_name, name_len, STATE_FILE_TEMPLATE_BZ2, odd_even, bitflip);
+        }
+        char state_files_path[strlen(STATE_FILES_DIRECTORY) + name_len];
+        snprintf(state_files_path, sizeof(state_files_path), STATE_FILES_DIRECTORY "%s", state_file_name);
+        if (searchFile(path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
+            return kind;
+        }
+    }
+    return STATE_FILE_NONE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// table cache
+//
+// All effective bitflip tables, decompressed, in a single file. The header records where each table lives and
+// a signature over the source files it was built from. Tables start on page boundaries, which allows to map
+// the file read-only: concurrent client processes then share the same pages and startup needs no decompression.
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t signature;
+    uint32_t table_size;
+    uint32_t num_tables;
+    uint32_t count[2][0x400];    // 0 = no effective table for this bitflip
+    uint16_t slot[2][0x400];     // position of the table in the data area
+} table_cache_header_t;
+
+#define TABLE_CACHE_DATA_OFFSET  ((sizeof(table_cache_header_t) + TABLE_CACHE_ALIGN - 1) / TABLE_CACHE_ALIGN * TABLE_CACHE_ALIGN)
+
+static bool use_table_cache = false;
+static uint8_t *table_cache_map = NULL;
+static size_t table_cache_map_size = 0;
+
+void hardnested_use_table_cache(bool enable) {
+    use_table_cache = enable;
+}
+
+static uint64_t fnv1a64(uint64_t hash, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len--) {
+        hash ^= *p++;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// FNV-1a over type, size and modification time of all source tables. Any added, removed, replaced or touched
+// table file changes the signature and invalidates the cache.
+static uint64_t table_cache_signature(void) {
+    char state_file_name[MAX(strlen(STATE_FILE_TEMPLATE_RAW), MAX(strlen(STATE_FILE_TEMPLATE_LZ4), strlen(STATE_FILE_TEMPLATE_BZ2))) + 1];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint32_t threshold = (uint32_t)(IGNORE_BITFLIP_THRESHOLD * (1 << 24));
+    hash = fnv1a64(hash, &threshold, sizeof(threshold));
+
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            char *path = NULL;
+            uint8_t kind = search_state_file(odd_even, bitflip, state_file_name, sizeof(state_file_name), &path);
+            int64_t size = 0, mtime = 0;
+            if (kind != STATE_FILE_NONE) {
+                struct stat st;
+                if (stat(path, &st) == 0) {
+                    size = st.st_size;
+                    mtime = st.st_mtime;
+                }
+                free(path);
+            }
+            hash = fnv1a64(hash, &kind, sizeof(kind));
+            hash = fnv1a64(hash, &size, sizeof(size));
+            hash = fnv1a64(hash, &mtime, sizeof(mtime));
+        }
+    }
+    return hash;
+}
+
+// Set up bitflip_bitarrays from the cache file. Returns false if there is no valid cache for this signature.
+static bool load_table_cache(uint64_t signature) {
+    char *path = NULL;
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, TABLE_CACHE_FILE, false) != PM3_SUCCESS) {
+        return false;
+    }
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (f == NULL) {
+        return false;
+    }
+
+    table_cache_header_t *hdr = calloc(1, sizeof(table_cache_header_t));
+    if (hdr == NULL) {
+        fclose(f);
+        return false;
+    }
+    if (fread(hdr, 1, sizeof(table_cache_header_t), f) != sizeof(table_cache_header_t)
+            || hdr->magic != TABLE_CACHE_MAGIC
+            || hdr->version != TABLE_CACHE_VERSION
+            || hdr->signature != signature
+            || hdr->table_size != BITFLIP_TABLE_SIZE
+            || hdr->num_tables > 2 * 0x400) {
+        free(hdr);
+        fclose(f);
+        return false;
+    }
+
+    size_t size = TABLE_CACHE_DATA_OFFSET + (size_t)hdr->num_tables * BITFLIP_TABLE_SIZE;
+    uint8_t *map = NULL;
+#ifndef _WIN32
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || (size_t)st.st_size != size) {
+        free(hdr);
+        fclose(f);
+        return false;
+    }
+    map = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    fclose(f);
+    if (map == MAP_FAILED) {
+        free(hdr);
+        return false;
+    }
+#endif
+
+    memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+    bool ok = true;
+    for (odd_even_t odd_even = EVEN_STATE; ok && odd_even <= ODD_STATE; odd_even++) {
+        num_effective_bitflips[odd_even] = 0;
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            count_bitflip_bitarrays[odd_even][bitflip] = 1 << 24;
+            uint32_t count = hdr->count[odd_even][bitflip];
+            if (count == 0) {
+                continue;
+            }
+            uint16_t slot = hdr->slot[odd_even][bitflip];
+            if (slot >= hdr->num_tables) {
+                ok = false;
+                break;
+            }
+#ifndef _WIN32
+            uint32_t *bitset = (uint32_t *)(map + TABLE_CACHE_DATA_OFFSET + (size_t)slot * BITFLIP_TABLE_SIZE);
+#else
+            // no shared mapping here, but reading the decompressed tables still beats decompressing them
+            uint32_t *bitset = (uint32_t *)malloc_bitarray(BITFLIP_TABLE_SIZE);
+            if (bitset == NULL) {
+                ok = false;
+                break;
+            }
+            bitflip_bitarrays[odd_even][bitflip] = bitset;
+            if (fseek(f, TABLE_CACHE_DATA_OFFSET + slot * BITFLIP_TABLE_SIZE, SEEK_SET) != 0
+                    || fread(bitset, 1, BITFLIP_TABLE_SIZE, f) != BITFLIP_TABLE_SIZE) {
+                ok = false;
+                break;
+            }
+#endif
+            effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
+            bitflip_bitarrays[odd_even][bitflip] = bitset;
+            count_bitflip_bitarrays[odd_even][bitflip] = count;
+        }
+        effective_bitflip[odd_even][num_effective_bitflips[odd_even]] = 0x400; // EndOfList marker
+    }
+    free(hdr);
+
+#ifndef _WIN32
+    if (ok == false) {
+        munmap(map, size);
+        return false;
+    }
+#else
+    fclose(f);
+    if (ok == false) {
+        for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+            for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+                free_bitarray(bitflip_bitarrays[odd_even][bitflip]);
+                bitflip_bitarrays[odd_even][bitflip] = NULL;
+            }
+        }
+        return false;
+    }
+#endif
+    table_cache_map = map;
+    table_cache_map_size = size;
+    return true;
+}
+
+// Write the currently loaded tables to the cache file. A temporary file is renamed into place so that
+// concurrent readers never see a partial cache.
+static void save_table_cache(uint64_t signature) {
+    char *path = NULL;
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, TABLE_CACHE_FILE, true) != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Could not create table cache in user directory");
+        return;
+    }
+
+    char tmppath[strlen(path) + 16];
+    snprintf(tmppath, sizeof(tmppath), "%s.%d", path, (int)getpid());
+
+    table_cache_header_t *hdr = calloc(1, TABLE_CACHE_DATA_OFFSET);
+    if (hdr == NULL) {
+        free(path);
+        return;
+    }
+    hdr->magic = TABLE_CACHE_MAGIC;
+    hdr->version = TABLE_CACHE_VERSION;
+    hdr->signature = signature;
+    hdr->table_size = BITFLIP_TABLE_SIZE;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t i = 0; i < num_effective_bitflips[odd_even]; i++) {
+            uint16_t bitflip = effective_bitflip[odd_even][i];
+            hdr->count[odd_even][bitflip] = count_bitflip_bitarrays[odd_even][bitflip];
+            hdr->slot[odd_even][bitflip] = hdr->num_tables++;
+        }
+    }
+
+    bool ok = false;
+    FILE *f = fopen(tmppath, "wb");
+    if (f != NULL) {
+        ok = (fwrite(hdr, 1, TABLE_CACHE_DATA_OFFSET, f) == TABLE_CACHE_DATA_OFFSET);
+        for (odd_even_t odd_even = EVEN_STATE; ok && odd_even <= ODD_STATE; odd_even++) {
+            for (uint16_t i = 0; ok && i < num_effective_bitflips[odd_even]; i++) {
+                const uint32_t *bitset = bitflip_bitarrays[odd_even][effective_bitflip[odd_even][i]];
+                ok = (fwrite(bitset, 1, BITFLIP_TABLE_SIZE, f) == BITFLIP_TABLE_SIZE);
+            }
+        }
+        ok = (fclose(f) == 0) && ok;
+    }
+#ifdef _WIN32
+    if (ok) {
+        remove(path);
+    }
+#endif
+    if (ok && rename(tmppath, path) == 0) {
+        PrintAndLogEx(INFO, "Wrote %u tables ( " _YELLOW_("%zu") " MB ) to table cache " _YELLOW_("%s"),
+                      hdr->num_tables, (TABLE_CACHE_DATA_OFFSET + (size_t)hdr->num_tables * BITFLIP_TABLE_SIZE) >> 20, path);
+    } else {
+        PrintAndLogEx(WARNING, "Could not write table cache " _YELLOW_("%s"), path);
+        remove(tmppath);
+    }
+    free(hdr);
+    free(path);
+}
+
 static void init_bitflip_bitarrays(void) {
 #if defined (DEBUG_REDUCTION)
     uint8_t line = 0;
 #endif
     uint64_t init_bitflip_bitarrays_starttime = msclock();
 
+    uint64_t cache_signature = 0;
+    bool cache_loaded = false;
+    if (use_table_cache) {
+        cache_signature = table_cache_signature();
+        cache_loaded = load_table_cache(cache_signature);
+        if (cache_loaded) {
+            char progress_text[80];
+            snprintf(progress_text, sizeof(progress_text), "Loaded %u tables from cache in %"PRIu64" ms",
+                     num_effective_bitflips[EVEN_STATE] + num_effective_bitflips[ODD_STATE], msclock() - init_bitflip_bitarrays_starttime);
+            hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+        }
+    }
+
     char state_file_name[MAX(strlen(STATE_FILE_TEMPLATE_RAW), MAX(strlen(STATE_FILE_TEMPLATE_LZ4), strlen(STATE_FILE_TEMPLATE_BZ2))) + 1];
-    char state_files_path[strlen(get_my_executable_directory()) + strlen(STATE_FILES_DIRECTORY) + sizeof(state_file_name)];
     uint16_t nraw = 0, nlz4 = 0, nbz2 = 0;
-    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+    for (odd_even_t odd_even = EVEN_STATE; cache_loaded == false && odd_even <= ODD_STATE; odd_even++) {
         num_effective_bitflips[odd_even] = 0;
         for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
-            bool open_uncompressed = false;
-            bool open_lz4compressed = false;
-            bool open_bz2compressed = false;
-
             bitflip_bitarrays[odd_even][bitflip] = NULL;
             count_bitflip_bitarrays[odd_even][bitflip] = 1 << 24;
 
             char *path;
-            snprintf(state_file_name, sizeof(state_file_name), STATE_FILE_TEMPLATE_RAW, odd_even, bitflip);
-            strncpy(state_files_path, STATE_FILES_DIRECTORY, sizeof(state_files_path) - 1);
-            strncat(state_files_path, state_file_name, sizeof(state_files_path) - (strlen(STATE_FILES_DIRECTORY) + 1));
-            if (searchFile(&path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
-                open_uncompressed = true;
-            } else {
-                snprintf(state_file_name, sizeof(state_file_name), STATE_FILE_TEMPLATE_LZ4, odd_even, bitflip);
-                strncpy(state_files_path, STATE_FILES_DIRECTORY, sizeof(state_files_path) - 1);
-                strncat(state_files_path, state_file_name, sizeof(state_files_path) - (strlen(STATE_FILES_DIRECTORY) + 1));
-                if (searchFile(&path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
-                    open_lz4compressed = true;
-                } else {
-                    snprintf(state_file_name, sizeof(state_file_name), STATE_FILE_TEMPLATE_BZ2, odd_even, bitflip);
-                    strncpy(state_files_path, STATE_FILES_DIRECTORY, sizeof(state_files_path) - 1);
-                    strncat(state_files_path, state_file_name, sizeof(state_files_path) - (strlen(STATE_FILES_DIRECTORY) + 1));
-                    if (searchFile(&path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
-                        open_bz2compressed = true;
-                    } else {
-                        continue;
-                    }
-                }
+            state_file_t kind = search_state_file(odd_even, bitflip, state_file_name, sizeof(state_file_name), &path);
+            if (kind == STATE_FILE_NONE) {
+                continue;
             }
 
             FILE *statesfile = fopen(path, "rb");
@@ -313,7 +579,7 @@ static void init_bitflip_bitarrays(void) {
             uint32_t filesize = (uint32_t)fsize;
             rewind(statesfile);
 
-            if (open_uncompressed) {
+            if (kind == STATE_FILE_RAW) {
 
                 uint32_t count = 0;
                 size_t bytesread = fread(&count, 1, sizeof(count), statesfile);
@@ -354,7 +620,7 @@ static void init_bitflip_bitarrays(void) {
                 nraw++;
                 continue;
 
-            } else if (open_lz4compressed) {
+            } else if (kind == STATE_FILE_LZ4) {
 
                 char *compressed_data = calloc(filesize, sizeof(uint8_t));
                 if (compressed_data == NULL) {
@@ -432,7 +698,7 @@ static void init_bitflip_bitarrays(void) {
                 free(uncompressed_data);
                 nlz4++;
                 continue;
-            } else if (open_bz2compressed) {
+            } else if (kind == STATE_FILE_BZ2) {
 
                 char input_buffer[filesize];
                 size_t bytesread = fread(input_buffer, 1, filesize, statesfile);
@@ -485,10 +751,13 @@ static void init_bitflip_bitarrays(void) {
         }
         effective_bitflip[odd_even][num_effective_bitflips[odd_even]] = 0x400; // EndOfList marker
     }
-    {
+    if (cache_loaded == false) {
         char progress_text[80];
         snprintf(progress_text, sizeof(progress_text), "Loaded %u RAW / %u LZ4 / %u BZ2 in %"PRIu64" ms", nraw, nlz4, nbz2, msclock() - init_bitflip_bitarrays_starttime);
         hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+        if (use_table_cache) {
+            save_table_cache(cache_signature);
+        }
     }
     uint16_t i = 0;
     uint16_t j = 0;
@@ -532,6 +801,14 @@ static void init_bitflip_bitarrays(void) {
 }
 
 static void free_bitflip_bitarrays(void) {
+#ifndef _WIN32
+    if (table_cache_map != NULL) {
+        munmap(table_cache_map, table_cache_map_size);
+        table_cache_map = NULL;
+        memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+        return;
+    }
+#endif
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
         free_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
     }
@@ -1546,21 +1823,86 @@ static int simulate_acquire_nonces(void) {
     return PM3_SUCCESS;
 }
 
-static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename) {
+static bool reported_sum_a0 = false;
 
+static void reset_acquisition(void) {
     last_sample_clock = msclock();
     hardnested_stage = CHECK_1ST_BYTES;
     num_acquired_nonces = 0;
+    reported_sum_a0 = false;
 
     // initial rough estimate. Will be refined.
     sample_period = 2000;
+}
+
+//----------------------------------------------------------------------------
+// Add one batch of encrypted nonce pairs as delivered by the device
+// (9 bytes per pair) and update the key space estimation.
+//----------------------------------------------------------------------------
+static int add_nonce_batch(const uint8_t *bufp, uint16_t num_sampled_nonces, FILE *fnonces, bool time_budget, bool *acquisition_completed) {
+
+    for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
+        uint32_t nt_enc1 = bytes_to_num(bufp, 4);
+        uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
+        uint8_t par_enc = bytes_to_num(bufp + 8, 1);
+
+        //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
+        num_acquired_nonces += add_nonce(nt_enc1, par_enc >> 4);
+        //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
+        num_acquired_nonces += add_nonce(nt_enc2, par_enc & 0x0f);
+
+        if (fnonces != NULL) {
+            fwrite(bufp, 1, 9, fnonces);
+            fflush(fnonces);
+        }
+        bufp += 9;
+    }
+
+    float brute_force_depth;
+    if (first_byte_num == 256) {
+        if (hardnested_stage == CHECK_1ST_BYTES) {
+            bool got_match = false;
+            for (uint8_t i = 0; i < NUM_SUMS; i++) {
+                if (first_byte_Sum == sums[i]) {
+                    first_byte_Sum = i;
+                    got_match = true;
+                    break;
+                }
+            }
+
+            if (got_match == false) {
+                PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
+                return PM3_EWRONGANSWER;
+            }
+
+            hardnested_stage |= CHECK_2ND_BYTES;
+            apply_sum_a0();
+        }
+        update_nonce_data(time_budget);
+        *acquisition_completed = shrink_key_space(&brute_force_depth);
+        if (!reported_sum_a0) {
+            char progress_string[80];
+            snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
+            hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
+            reported_sum_a0 = true;
+        } else {
+            hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+        }
+    } else {
+        update_nonce_data(time_budget);
+        *acquisition_completed = shrink_key_space(&brute_force_depth);
+        hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+    }
+    return PM3_SUCCESS;
+}
+
+// Acquire nonces until the key space is small enough. Nonces which are already
+// known (see reset_acquisition() and add_nonce_batch()) are kept.
+static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename) {
 
     bool initialize = true;
     bool field_off = false;
     bool acquisition_completed = false;
-    bool reported_suma8 = false;
-
-    float brute_force_depth;
 
     FILE *fnonces = NULL;
 
@@ -1629,63 +1971,12 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
 
         if (initialize == false) {
 
-            uint16_t num_sampled_nonces = resp.oldarg[2];
-            uint8_t *bufp = resp.data.asBytes;
-
-            for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
-                uint32_t nt_enc1 = bytes_to_num(bufp, 4);
-                uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
-                uint8_t par_enc = bytes_to_num(bufp + 8, 1);
-
-                //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
-                num_acquired_nonces += add_nonce(nt_enc1, par_enc >> 4);
-                //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
-                num_acquired_nonces += add_nonce(nt_enc2, par_enc & 0x0f);
-
+            int res = add_nonce_batch(resp.data.asBytes, resp.oldarg[2], fnonces, true, &acquisition_completed);
+            if (res != PM3_SUCCESS) {
                 if (nonce_file_write) {
-                    fwrite(bufp, 1, 9, fnonces);
-                    fflush(fnonces);
-                }
-                bufp += 9;
-            }
-            //total_num_nonces += num_sampled_nonces;
-
-            if (first_byte_num == 256) {
-                if (hardnested_stage == CHECK_1ST_BYTES) {
-                    bool got_match = false;
-                    for (uint8_t i = 0; i < NUM_SUMS; i++) {
-                        if (first_byte_Sum == sums[i]) {
-                            first_byte_Sum = i;
-                            got_match = true;
-                            break;
-                        }
-                    }
-
-                    if (got_match == false) {
-                        PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
-                        if (nonce_file_write) {
-                            fclose(fnonces);
-                        }
-                        return PM3_EWRONGANSWER;
-                    }
-
-                    hardnested_stage |= CHECK_2ND_BYTES;
-                    apply_sum_a0();
-                }
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                if (!reported_suma8) {
-                    char progress_string[80];
-                    snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
-                    hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
-                    reported_suma8 = true;
-                } else {
-                    hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+                    fclose(fnonces);
                 }
-            } else {
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+                return res;
             }
         }
 
@@ -2352,6 +2643,81 @@ static void set_test_state(uint8_t byte) {
     crypto1_destroy(pcs);
 }
 
+//----------------------------------------------------------------------------
+// Reduce the candidate states for the acquired nonces and brute force the
+// remaining key space
+//----------------------------------------------------------------------------
+static bool search_key(uint8_t *trgkey, uint64_t *foundkey) {
+    char progress_text[80];
+
+    if (trgkey != NULL) {
+        known_target_key = bytes_to_num(trgkey, 6);
+        set_test_state(best_first_bytes[0]);
+    } else {
+        known_target_key = -1;
+    }
+
+    Tests();
+
+    bool key_found = false;
+    num_keys_tested = 0;
+    uint32_t num_odd = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
+    uint32_t num_even = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE];
+    float expected_brute_force1 = (float)num_odd * num_even / 2.0;
+    float expected_brute_force2 = nonces[best_first_bytes[0]].expected_num_brute_force;
+
+    if (expected_brute_force1 < expected_brute_force2) {
+        hardnested_print_progress(num_acquired_nonces, "(Ignoring Sum(a8) properties)", expected_brute_force1, 0);
+        set_test_state(best_first_byte_smallest_bitarray);
+        add_bitflip_candidates(best_first_byte_smallest_bitarray);
+        Tests2();
+        maximum_states = 0;
+
+        for (statelist_t *sl = candidates; sl != NULL; sl = sl->next) {
+            maximum_states += (uint64_t)sl->len[ODD_STATE] * sl->len[EVEN_STATE];
+        }
+
+        best_first_bytes[0] = best_first_byte_smallest_bitarray;
+        pre_XOR_nonces();
+        prepare_bf_test_nonces(nonces, best_first_bytes[0]);
+
+        key_found = brute_force(foundkey);
+        free(candidates->states[ODD_STATE]);
+        free(candidates->states[EVEN_STATE]);
+        free_candidates_memory(candidates);
+        candidates = NULL;
+    } else {
+
+        pre_XOR_nonces();
+        prepare_bf_test_nonces(nonces, best_first_bytes[0]);
+
+        for (uint8_t j = 0; j < NUM_SUMS && !key_found; j++) {
+            float expected_brute_force = nonces[best_first_bytes[0]].expected_num_brute_force;
+            snprintf(progress_text, sizeof(progress_text), "(%d. guess: Sum(a8) = %" PRIu16 ")", j + 1, sums[nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx]);
+            hardnested_print_progress(num_acquired_nonces, progress_text, expected_brute_force, 0);
+
+            if (trgkey != NULL && sums[nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx] != real_sum_a8) {
+                snprintf(progress_text, sizeof(progress_text), "(Estimated Sum(a8) is WRONG! Correct Sum(a8) = %" PRIu16 ")", real_sum_a8);
+                hardnested_print_progress(num_acquired_nonces, progress_text, expected_brute_force, 0);
+            }
+
+            generate_candidates(first_byte_Sum, nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx);
+            key_found = brute_force(foundkey);
+            free_statelist_cache();
+            free_candidates_memory(candidates);
+            candidates = NULL;
+            if (key_found == false) {
+                // update the statistics
+                nonces[best_first_bytes[0]].sum_a8_guess[j].prob = 0;
+                nonces[best_first_bytes[0]].sum_a8_guess[j].num_states = 0;
+                // and calculate new expected number of brute forces
+                update_expected_brute_force(best_first_bytes[0]);
+            }
+        }
+    }
+    return key_found;
+}
+
 static void init_it_all(void) {
     memset(nonces, 0, sizeof(nonces));
     maximum_states = 0;
@@ -2559,6 +2925,7 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             float brute_force_depth;
             shrink_key_space(&brute_force_depth);
         } else { // acquire nonces.
+            reset_acquisition();
             res = acquire_nonces(blockNo, keyType, key, trgBlockNo, trgKeyType, nonce_file_write, slow, filename);
             if (res != PM3_SUCCESS) {
                 free_bitflip_bitarrays();
@@ -2571,81 +2938,274 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             }
         }
 
-        if (trgkey != NULL) {
-            known_target_key = bytes_to_num(trgkey, 6);
-            set_test_state(best_first_bytes[0]);
-        } else {
-            known_target_key = -1;
+        free_bitflip_bitarrays();
+        bool key_found = search_key(trgkey, foundkey);
+
+        free_nonces_memory();
+        free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+        free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+        free_sum_bitarrays();
+        free_part_sum_bitarrays();
+
+        return (key_found) ? PM3_SUCCESS : PM3_EFAILED;
+    }
+
+    return PM3_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// multiple targets
+//
+// Nonce acquisition is bound by the device, the key search by the CPU. While the key of one target is searched,
+// a thread collects encrypted nonces for the following targets, round robin. These are replayed when the target
+// is analysed and live acquisition only continues if they don't suffice. The tables are loaded once for all targets.
+
+#define PREFETCH_MAX_PAIRS      2048    // encrypted nonce pairs buffered per target
+
+typedef struct {
+    uint8_t *buf;      // 9 bytes per pair, as delivered by the device
+    uint32_t pairs;
+    uint32_t cuid;
+} prefetch_buf_t;
+
+typedef struct {
+    uint8_t blockno;
+    uint8_t keytype;
+    uint8_t *key;
+    bool slow;
+    hardnested_target_t *targets;
+    prefetch_buf_t *bufs;
+    uint16_t count;
+    uint16_t first;
+    bool stop;
+    bool running;
+    int result;
+    pthread_t thread;
+} prefetch_t;
+
+// the prefetch thread reads the status of the targets while the main loop updates them
+static int target_status(const hardnested_target_t *target) {
+    return __atomic_load_n(&target->status, __ATOMIC_ACQUIRE);
+}
+
+static void set_target_status(hardnested_target_t *target, int status) {
+    __atomic_store_n(&target->status, status, __ATOMIC_RELEASE);
+}
+
+static void *prefetch_nonces_thread(void *arg) {
+    prefetch_t *pf = (prefetch_t *)arg;
+    PacketResponseNG resp;
+    bool initialize = true;
+    uint16_t num_targets = pf->count - pf->first;
+    uint16_t next = 0;
+
+    while (__atomic_load_n(&pf->stop, __ATOMIC_ACQUIRE) == false) {
+
+        // next target, round robin, which is still to be attacked and has buffer space left
+        uint16_t t = pf->count;
+        for (uint16_t i = 0; i < num_targets; i++) {
+            uint16_t j = pf->first + (next + i) % num_targets;
+            if (target_status(&pf->targets[j]) == PM3_ESOFT && pf->bufs[j].pairs + PM3_CMD_DATA_SIZE / 9 <= PREFETCH_MAX_PAIRS) {
+                t = j;
+                break;
+            }
+        }
+        if (t == pf->count) {
+            break;
+        }
+        next = (t - pf->first + 1) % num_targets;
+
+        uint32_t flags = 0;
+        flags |= initialize ? 0x0001 : 0;
+        flags |= pf->slow ? 0x0002 : 0;
+        clearCommandBuffer();
+        SendCommandMIX(CMD_HF_MIFARE_ACQ_ENCRYPTED_NONCES, pf->blockno + pf->keytype * 0x100, pf->targets[t].blockno + pf->targets[t].keytype * 0x100, flags, pf->key, 6);
+        if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
+            pf->result = PM3_ETIMEOUT;
+            break;
+        }
+        if (resp.oldarg[0]) {
+            pf->result = resp.oldarg[0];
+            break;
         }
+        initialize = false;
 
-        Tests();
+        uint32_t pairs = MIN(resp.oldarg[2] / 2, PM3_CMD_DATA_SIZE / 9);
+        memcpy(pf->bufs[t].buf + pf->bufs[t].pairs * 9, resp.data.asBytes, pairs * 9);
+        pf->bufs[t].pairs += pairs;
+        pf->bufs[t].cuid = resp.oldarg[1];
+    }
+    return NULL;
+}
 
-        free_bitflip_bitarrays();
-        bool key_found = false;
-        num_keys_tested = 0;
-        uint32_t num_odd = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
-        uint32_t num_even = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE];
-        float expected_brute_force1 = (float)num_odd * num_even / 2.0;
-        float expected_brute_force2 = nonces[best_first_bytes[0]].expected_num_brute_force;
-
-        if (expected_brute_force1 < expected_brute_force2) {
-            hardnested_print_progress(num_acquired_nonces, "(Ignoring Sum(a8) properties)", expected_brute_force1, 0);
-            set_test_state(best_first_byte_smallest_bitarray);
-            add_bitflip_candidates(best_first_byte_smallest_bitarray);
-            Tests2();
-            maximum_states = 0;
-
-            for (statelist_t *sl = candidates; sl != NULL; sl = sl->next) {
-                maximum_states += (uint64_t)sl->len[ODD_STATE] * sl->len[EVEN_STATE];
+static void prefetch_start(prefetch_t *pf, uint16_t first) {
+    pf->first = first;
+    pf->stop = false;
+    pf->result = PM3_SUCCESS;
+    pf->running = (first < pf->count) && (pthread_create(&pf->thread, NULL, prefetch_nonces_thread, pf) == 0);
+}
+
+static int prefetch_stop(prefetch_t *pf) {
+    if (pf->running == false) {
+        return PM3_SUCCESS;
+    }
+    __atomic_store_n(&pf->stop, true, __ATOMIC_RELEASE);
+    pthread_join(pf->thread, NULL);
+    pf->running = false;
+    return pf->result;
+}
+
+int mfnestedhard_multi(uint8_t blockNo, uint8_t keyType, uint8_t *key, hardnested_target_t *targets, uint16_t count, bool slow) {
+    char progress_text[80];
+
+    if (count == 0) {
+        return PM3_EINVARG;
+    }
+
+    prefetch_buf_t *bufs = calloc(count, sizeof(prefetch_buf_t));
+    if (bufs == NULL) {
+        return PM3_EMALLOC;
+    }
+    for (uint16_t t = 0; t < count; t++) {
+        bufs[t].buf = calloc(PREFETCH_MAX_PAIRS, 9);
+        if (bufs[t].buf == NULL) {
+            for (uint16_t i = 0; i < t; i++) {
+                free(bufs[i].buf);
             }
+            free(bufs);
+            return PM3_EMALLOC;
+        }
+        set_target_status(&targets[t], PM3_ESOFT);    // not attacked yet
+        targets[t].key = 0;
+    }
 
-            best_first_bytes[0] = best_first_byte_smallest_bitarray;
-            pre_XOR_nonces();
-            prepare_bf_test_nonces(nonces, best_first_bytes[0]);
+    // initialize static arrays
+    memset(part_sum_count, 0, sizeof(part_sum_count));
+    init_it_all();
 
-            key_found = brute_force(foundkey);
-            free(candidates->states[ODD_STATE]);
-            free(candidates->states[EVEN_STATE]);
-            free_candidates_memory(candidates);
-            candidates = NULL;
-        } else {
+    srand((unsigned) time(NULL));
+    brute_force_per_second = brute_force_benchmark();
 
-            pre_XOR_nonces();
-            prepare_bf_test_nonces(nonces, best_first_bytes[0]);
+    start_time = msclock();
+    print_progress_header();
+    snprintf(progress_text, sizeof(progress_text), "Brute force benchmark: %1.0f million (2^%1.1f) keys/s", brute_force_per_second / 1000000, log(brute_force_per_second) / log(2.0));
+    hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+    init_bitflip_bitarrays();
+    init_part_sum_bitarrays();
+    init_sum_bitarrays();
+
+    prefetch_t pf = {
+        .blockno = blockNo,
+        .keytype = keyType,
+        .key = key,
+        .slow = slow,
+        .targets = targets,
+        .bufs = bufs,
+        .count = count,
+        .running = false,
+    };
 
-            for (uint8_t j = 0; j < NUM_SUMS && !key_found; j++) {
-                float expected_brute_force = nonces[best_first_bytes[0]].expected_num_brute_force;
-                snprintf(progress_text, sizeof(progress_text), "(%d. guess: Sum(a8) = %" PRIu16 ")", j + 1, sums[nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx]);
-                hardnested_print_progress(num_acquired_nonces, progress_text, expected_brute_force, 0);
+    int res = PM3_SUCCESS;
+    bool aborted = false;
+    for (uint16_t t = 0; t < count; t++) {
 
-                if (trgkey != NULL && sums[nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx] != real_sum_a8) {
-                    snprintf(progress_text, sizeof(progress_text), "(Estimated Sum(a8) is WRONG! Correct Sum(a8) = %" PRIu16 ")", real_sum_a8);
-                    hardnested_print_progress(num_acquired_nonces, progress_text, expected_brute_force, 0);
-                }
+        if (prefetch_stop(&pf) == PM3_EOPABORTED) {
+            aborted = true;
+            break;
+        }
+        res = PM3_SUCCESS;
 
-                generate_candidates(first_byte_Sum, nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx);
-                key_found = brute_force(foundkey);
-                free_statelist_cache();
-                free_candidates_memory(candidates);
-                candidates = NULL;
-                if (key_found == false) {
-                    // update the statistics
-                    nonces[best_first_bytes[0]].sum_a8_guess[j].prob = 0;
-                    nonces[best_first_bytes[0]].sum_a8_guess[j].num_states = 0;
-                    // and calculate new expected number of brute forces
-                    update_expected_brute_force(best_first_bytes[0]);
-                }
+        // key already found on an earlier target
+        if (target_status(&targets[t]) != PM3_ESOFT) {
+            continue;
+        }
+
+        snprintf(progress_text, sizeof(progress_text), "Target %u/%u: block %u, key %c, %u prefetched nonces",
+                 t + 1, count, targets[t].blockno, targets[t].keytype == MF_KEY_B ? 'B' : 'A', bufs[t].pairs * 2);
+        hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+
+        init_allbitflips_array();
+        init_nonce_memory();
+        update_reduction_rate(0.0, true);
+        reset_acquisition();
+
+        bool acquisition_completed = false;
+        if (bufs[t].pairs) {
+            cuid = bufs[t].cuid;
+            res = add_nonce_batch(bufs[t].buf, bufs[t].pairs * 2, NULL, false, &acquisition_completed);
+        }
+        if (res == PM3_SUCCESS && acquisition_completed == false) {
+            res = acquire_nonces(blockNo, keyType, key, targets[t].blockno, targets[t].keytype, false, slow, NULL);
+        }
+        if (res != PM3_SUCCESS) {
+            free_nonces_memory();
+            free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+            free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+            // a failing target doesn't stop the others, PM3_ESOFT is kept for "not attacked yet"
+            set_target_status(&targets[t], (res == PM3_ESOFT) ? PM3_EFAILED : res);
+            if (res == PM3_EOPABORTED) {
+                aborted = true;
+                break;
             }
+            continue;
+        }
+
+        // collect nonces for the next targets while this one is cracked
+        prefetch_start(&pf, t + 1);
+
+        uint64_t foundkey = 0;
+        num_keys_tested = 0;
+        if (search_key(NULL, &foundkey)) {
+            set_target_status(&targets[t], PM3_SUCCESS);
+            targets[t].key = foundkey;
+        } else {
+            set_target_status(&targets[t], PM3_EFAILED);
         }
 
         free_nonces_memory();
         free_bitarray(all_bitflips_bitarray[ODD_STATE]);
         free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
-        free_sum_bitarrays();
-        free_part_sum_bitarrays();
 
-        return (key_found) ? PM3_SUCCESS : PM3_EFAILED;
+        if (target_status(&targets[t]) != PM3_SUCCESS) {
+            continue;
+        }
+
+        // keys are often reused, check the found key on all remaining targets
+        if (prefetch_stop(&pf) == PM3_EOPABORTED) {
+            aborted = true;
+            break;
+        }
+        uint8_t keyblock[6];
+        num_to_bytes(foundkey, 6, keyblock);
+        for (uint16_t i = t + 1; i < count; i++) {
+            uint64_t key64 = 0;
+            if (target_status(&targets[i]) == PM3_ESOFT && mfCheckKeys(targets[i].blockno, targets[i].keytype, true, 1, keyblock, &key64) == PM3_SUCCESS) {
+                set_target_status(&targets[i], PM3_SUCCESS);
+                targets[i].key = key64;
+            }
+        }
     }
 
-    return PM3_SUCCESS;
+    if (prefetch_stop(&pf) == PM3_EOPABORTED) {
+        aborted = true;
+    }
+    DropField();
+
+    // targets left over by an abort
+    for (uint16_t t = 0; t < count; t++) {
+        if (target_status(&targets[t]) == PM3_ESOFT) {
+            set_target_status(&targets[t], aborted ? PM3_EOPABORTED : PM3_EFAILED);
+        }
+    }
+    // the first target decides, the status of the others is reported per target
+    res = target_status(&targets[0]);
+
+    free_bitflip_bitarrays();
+    free_sum_bitarrays();
+    free_part_sum_bitarrays();
+    for (uint16_t t = 0; t < count; t++) {
+        free(bufs[t].buf);
+    }
+    free(bufs);
+    return res;
 }
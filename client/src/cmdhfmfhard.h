@@ -21,7 +21,21 @@
 
 #include "common.h"
 
+typedef struct {
+    uint8_t blockno;     // target block
+    uint8_t keytype;     // target key type
+    int status;          // PM3_SUCCESS if key was found, PM3_EFAILED if not, else the error of this target
+    uint64_t key;
+} hardnested_target_t;
+
 int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename);
+// keep decompressed bitflip tables in a memory-mapped cache file in the user directory
+void hardnested_use_table_cache(bool enable);
+// Attack several target keys in one session. Tables are loaded once, and nonces for the following targets are
+// acquired while the key of the current one is searched. Each target gets its own status, a failing target doesn't
+// stop the others. Returns the status of the first target, targets not attacked because of an abort get PM3_EOPABORTED.
+int mfnestedhard_multi(uint8_t blockNo, uint8_t keyType, uint8_t *key, hardnested_target_t *targets, uint16_t count, bool slow);
+void hardnested_update_brute_force_rate(float keys_per_second);
 void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time);
 
 #endif
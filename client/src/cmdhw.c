@@ -40,6 +40,7 @@
 #include "flash.h"          // reboot to bootloader mode
 #include "proxgui.h"
 #include "graph.h"          // for graph data
+#include "pm3emu.h"         // headless device emulator
 
 static int CmdHelp(const char *Cmd);
 
@@ -1068,6 +1069,9 @@ static int CmdTune(const char *Cmd) {
     // graph LF measurements
     // even here, these values has 3% error.
     uint16_t test1 = 0;
+    if (reserveGraphBuffer(256) == false) {
+        return PM3_EMALLOC;
+    }
     for (int i = 0; i < 256; i++) {
         g_GraphBuffer[i] = package->results[i] - 128;
         test1 += package->results[i];
@@ -1146,6 +1150,21 @@ static int CmdStatus(const char *Cmd) {
         PrintAndLogEx(WARNING, "Status command timeout. Communication speed test timed out");
         return PM3_ETIMEOUT;
     }
+
+    comm_rx_stats_t stats;
+    GetCommunicationRxStats(&stats);
+    PrintAndLogEx(INFO, "---- " _CYAN_("Client receive buffer") " ----");
+    PrintAndLogEx(INFO, "  Replies stored.......... %" PRIu64, stats.stored);
+    if (stats.dropped) {
+        PrintAndLogEx(INFO, "  Replies dropped......... " _RED_("%" PRIu64), stats.dropped);
+    } else {
+        PrintAndLogEx(INFO, "  Replies dropped......... 0");
+    }
+    PrintAndLogEx(INFO, "  Waits for room.......... %" PRIu64, stats.stalls);
+    PrintAndLogEx(INFO, "  Max fill................ %u / %u", stats.max_fill, CMD_BUFFER_SIZE - 1);
+    if (stats.consumed) {
+        PrintAndLogEx(INFO, "  Latency avg / max....... %" PRIu64 " / %" PRIu64 " us", stats.latency_us / stats.consumed, stats.max_latency_us);
+    }
     return PM3_SUCCESS;
 }
 
@@ -1393,6 +1412,234 @@ static int CmdConnect(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int CmdEmu(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw emu",
+                  "Start a headless device emulator inside the client and connect to it.\n"
+                  "It answers ping, capabilities and BigBuf downloads like the firmware does,\n"
+                  "so the communication path can be tested and benchmarked without a Proxmark3.\n"
+                  "Any other command gets an `unknown command` debug print",
+                  "hw emu                         --> start and connect\n"
+                  "hw emu --latency 200 --wtx 50  --> 200 us per frame, 50 ms waiting time extension\n"
+                  "hw emu --drop 7                --> lose every 7th download frame\n"
+                  "hw emu --stop                  --> disconnect and stop the emulator"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0(NULL, "bigbuf", "<dec>", "BigBuf size reported (def 40000)"),
+        arg_u64_0(NULL, "latency", "<us>", "delay before every reply frame"),
+        arg_u64_0(NULL, "wtx", "<ms>", "waiting time extension before every ping and download reply"),
+        arg_u64_0(NULL, "dbg", "<dec>", "debug print every n download frames"),
+        arg_u64_0(NULL, "drop", "<dec>", "drop every n-th download frame"),
+        arg_lit0(NULL, "crc", "CRC on replies like over FPC,  else the postamble magic like over USB"),
+        arg_lit0(NULL, "stop", "disconnect and stop the emulator"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    pm3emu_config_t cfg = {
+        .bigbuf_size = arg_get_u32_def(ctx, 1, 40000),
+        .latency_us = arg_get_u32_def(ctx, 2, 0),
+        .wtx_ms = MIN(arg_get_u32_def(ctx, 3, 0), 0xFFFF),
+        .dbg_every = arg_get_u32_def(ctx, 4, 0),
+        .drop_every = arg_get_u32_def(ctx, 5, 0),
+        .crc = arg_get_lit(ctx, 6),
+    };
+    bool stop = arg_get_lit(ctx, 7);
+    CLIParserFree(ctx);
+
+    if (cfg.drop_every == 1) {
+        PrintAndLogEx(WARNING, "Dropping every frame leaves nothing to download");
+        return PM3_EINVARG;
+    }
+
+    // restart with the new settings
+    if (pm3emu_port() != NULL) {
+        if (g_session.pm3_present && strcmp(g_conn.serial_port_name, pm3emu_port()) == 0) {
+            CloseProxmark(g_session.current_device);
+        }
+        pm3emu_stop();
+        PrintAndLogEx(INFO, "Device emulator stopped");
+    }
+    if (stop) {
+        return PM3_SUCCESS;
+    }
+
+    char port[FILE_PATH_SIZE] = {0};
+    int res = pm3emu_start(&cfg, port, sizeof(port));
+    if (res == PM3_ENOTIMPL) {
+        PrintAndLogEx(WARNING, "Device emulator needs `socket:` ports, not available on this platform");
+    }
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    if (g_session.pm3_present) {
+        CloseProxmark(g_session.current_device);
+    }
+
+    OpenProxmark(&g_session.current_device, port, false, 10, false, USART_BAUD_RATE);
+
+    if (g_session.pm3_present && (TestProxmark(g_session.current_device) != PM3_SUCCESS)) {
+        PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the device emulator\n");
+        CloseProxmark(g_session.current_device);
+    }
+    if (g_session.pm3_present == false) {
+        pm3emu_stop();
+        return PM3_ENOTTY;
+    }
+    return PM3_SUCCESS;
+}
+
+static int bench_download_cb(const uint8_t *data, uint32_t offset, uint32_t len, void *ctx) {
+    uint32_t *errors = ctx;
+    for (uint32_t i = 0; i < len; i++) {
+        if (data[i] != pm3emu_pattern(offset + i)) {
+            (*errors)++;
+        }
+    }
+    return PM3_SUCCESS;
+}
+
+static int CmdBench(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw bench",
+                  "Measure ping round trip times and BigBuf download throughput.\n"
+                  "Against `hw emu` the downloaded content is checked as well",
+                  "hw bench\n"
+                  "hw bench -n 1000 --len 512 --size 40000 --dl 5"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("n", NULL, "<dec>", "number of pings (def 100)"),
+        arg_u64_0("l", "len", "<dec>", "ping payload length (def 32)"),
+        arg_u64_0(NULL, "size", "<dec>", "bytes per download (def BigBuf size)"),
+        arg_u64_0(NULL, "dl", "<dec>", "number of downloads (def 3)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t pings = arg_get_u32_def(ctx, 1, 100);
+    uint32_t len = arg_get_u32_def(ctx, 2, 32);
+    uint32_t size = arg_get_u32_def(ctx, 3, g_pm3_capabilities.bigbuf_size);
+    uint32_t downloads = arg_get_u32_def(ctx, 4, 3);
+    CLIParserFree(ctx);
+
+    len = MIN(len, PM3_CMD_DATA_SIZE);
+
+    bool emulated = (pm3emu_port() != NULL) && (strcmp(g_conn.serial_port_name, pm3emu_port()) == 0);
+
+    comm_rx_stats_t rx_before;
+    GetCommunicationRxStats(&rx_before);
+
+    uint8_t data[PM3_CMD_DATA_SIZE] = {0};
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = i & 0xFF;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Ping") " ---------------------------");
+
+    uint32_t ok = 0, bad = 0, lost = 0;
+    uint64_t t_min = UINT64_MAX, t_max = 0, t_sum = 0;
+    uint64_t t_start = usclock();
+    for (uint32_t i = 0; i < pings; i++) {
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            pings = i;
+            break;
+        }
+
+        PacketResponseNG resp;
+        clearCommandBuffer();
+        uint64_t t = usclock();
+        SendCommandNG(CMD_PING, data, len);
+        if (WaitForResponseTimeoutW(CMD_PING, &resp, 1000, false) == false) {
+            lost++;
+            continue;
+        }
+        t = usclock() - t;
+
+        if (resp.length != len || memcmp(data, resp.data.asBytes, len) != 0) {
+            bad++;
+            continue;
+        }
+        ok++;
+        t_sum += t;
+        t_min = MIN(t_min, t);
+        t_max = MAX(t_max, t);
+    }
+    uint64_t t_total = usclock() - t_start;
+
+    PrintAndLogEx(INFO, "pings.......... " _YELLOW_("%u") " x " _YELLOW_("%u") " bytes", pings, len);
+    PrintAndLogEx(INFO, "answered....... " _YELLOW_("%u") "  bad %u  lost %u", ok, bad, lost);
+    if (ok) {
+        PrintAndLogEx(INFO, "round trip..... min " _YELLOW_("%" PRIu64) " us  avg " _YELLOW_("%" PRIu64) " us  max " _YELLOW_("%" PRIu64) " us"
+                      , t_min
+                      , t_sum / ok
+                      , t_max
+                     );
+        PrintAndLogEx(INFO, "rate........... %.0f pings/s", (t_total) ? (double)pings * 1000000 / t_total : 0.0);
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("BigBuf download") " ----------------");
+
+    bool dl_ok = true;
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < downloads && size; i++) {
+        download_stats_t stats;
+        bool res = GetFromDeviceStream(BIG_BUF, NULL, size, 0, NULL, 0, NULL, 2500, false,
+                                       emulated ? bench_download_cb : NULL, &errors, &stats);
+        if (res == false) {
+            dl_ok = false;
+        }
+        PrintAndLogEx(INFO, "#%u  %u bytes in " _YELLOW_("%" PRIu64) " ms ( " _YELLOW_("%.1f") " kB/s ), %u chunks, %u re-requests%s"
+                      , i + 1
+                      , stats.bytes
+                      , stats.ms
+                      , (stats.ms) ? (double)stats.bytes / stats.ms : 0.0
+                      , stats.chunks
+                      , stats.rerequests
+                      , (res) ? "" : _RED_(" failed")
+                     );
+    }
+    if (emulated && downloads && size) {
+        PrintAndLogEx((errors == 0 && dl_ok) ? SUCCESS : FAILED, "Download content ( %s )", (errors == 0 && dl_ok) ? _GREEN_("ok") : _RED_("fail"));
+    }
+
+    comm_rx_stats_t rx;
+    GetCommunicationRxStats(&rx);
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Receive buffer") " -----------------");
+    PrintAndLogEx(INFO, "replies........ %" PRIu64 "  dropped %" PRIu64 "  stalls %" PRIu64 "  max fill %u"
+                  , rx.stored - rx_before.stored
+                  , rx.dropped - rx_before.dropped
+                  , rx.stalls - rx_before.stalls
+                  , rx.max_fill
+                 );
+
+    if (emulated) {
+        pm3emu_stats_t es;
+        pm3emu_get_stats(&es);
+        PrintAndLogEx(INFO, "emulator....... %" PRIu64 " commands, %" PRIu64 " replies, %" PRIu64 " bytes, %" PRIu64 " frames dropped"
+                      , es.commands
+                      , es.replies
+                      , es.bytes
+                      , es.dropped
+                     );
+    }
+    PrintAndLogEx(NORMAL, "");
+
+    if (ok != pings || dl_ok == false || errors) {
+        return PM3_ESOFT;
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdBreak(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1458,10 +1705,12 @@ static command_t CommandTable[] = {
     {"timeout",       CmdTimeout,      AlwaysAvailable,  "Set the communication timeout on the client side"},
     {"version",       CmdVersion,      AlwaysAvailable,  "Show version information about the client and Proxmark3"},
     {"-------------", CmdHelp,         AlwaysAvailable,  "----------------------- " _CYAN_("Hardware") " -----------------------"},
+    {"bench",         CmdBench,        IfPm3Present,     "Measure ping round trip and download throughput"},
     {"break",         CmdBreak,        IfPm3Present,     "Send break loop usb command"},
     {"bootloader",    CmdBootloader,   IfPm3Present,     "Reboot into bootloader mode"},
     {"connect",       CmdConnect,      AlwaysAvailable,  "Connect to the device via serial port"},
     {"dbg",           CmdDbg,          IfPm3Present,     "Set device side debug level"},
+    {"emu",           CmdEmu,          AlwaysAvailable,  "Start a headless device emulator and connect to it"},
     {"fpgaoff",       CmdFPGAOff,      IfPm3Present,     "Turn off FPGA on device"},
     {"lcd",           CmdLCD,          IfPm3Lcd,         "Send command/data to LCD"},
     {"lcdreset",      CmdLCDReset,     IfPm3Lcd,         "Hardware reset LCD"},
@@ -67,6 +67,12 @@
 #include "cmdlfzx8211.h"    // for ZX8211 menu
 #include "crc.h"
 #include "pm3_cmd.h"        // for LF_CMDREAD_MAX_EXTRA_SYMBOLS
+#include "util_posix.h"     // usclock
+#include "util.h"           // num_CPUs
+#include "fileutils.h"      // loadFilePM3
+#include "scandir.h"
+#include "jansson.h"
+#include <pthread.h>
 
 static int CmdHelp(const char *Cmd);
 
@@ -514,6 +520,10 @@ int CmdFlexdemod(const char *Cmd) {
 
     // iceman,  use g_DemodBuffer?  blue line?
     // HACK writing back to graphbuffer.
+    if (reserveGraphBuffer(32 * 64) == false) {
+        free(data);
+        return PM3_EMALLOC;
+    }
     g_GraphTraceLen = 32 * 64;
     i = 0;
     for (bit = 0; bit < 64; bit++) {
@@ -1518,6 +1528,9 @@ int CmdVchDemod(const char *Cmd) {
 
     // clone
     if (strcmp(Cmd, "clone") == 0) {
+        if (reserveGraphBuffer(strlen(bits) * 16) == false) {
+            return PM3_EMALLOC;
+        }
         g_GraphTraceLen = 0;
         char *s;
         for (s = bits; *s; s++) {
@@ -1630,6 +1643,66 @@ static int check_autocorrelate(const char *prefix, int clock) {
     return PM3_EFAILED;
 }
 
+static int demodParadoxSearch(bool verbose) {
+    return demodParadox(verbose, false);
+}
+
+static int demodIdteckSearch(bool verbose) {
+    return demodIdteck(NULL, verbose);
+}
+
+// known tags tried by `lf search`,  in this order
+static const struct {
+    const char *name;
+    int (*demod)(bool verbose);
+} lf_search_decoders[] = {
+    // ask / man
+    {"EM410x ID",               demodEM410x},
+    {"FDX-A FECAVA Destron ID", demodDestron},      // to do before HID
+    {"GALLAGHER ID",            demodGallagher},
+    {"Noralsy ID",              demodNoralsy},
+    {"Presco ID",               demodPresco},
+    {"Securakey ID",            demodSecurakey},
+    {"Viking ID",               demodViking},
+    {"Visa2000 ID",             demodVisa2k},
+    // ask / bi
+    {"FDX-B ID",                demodFDXB},
+    {"Jablotron ID",            demodJablotron},
+    {"Guardall G-Prox II ID",   demodGuard},
+    {"NEDAP ID",                demodNedap},
+    // nrz
+    {"PAC/Stanley ID",          demodPac},
+    // fsk
+    {"HID Prox ID",             demodHID},
+    {"AWID ID",                 demodAWID},
+    {"IO Prox ID",              demodIOProx},
+    {"Pyramid ID",              demodPyramid},
+    {"Paradox ID",              demodParadoxSearch},
+    // psk
+    {"Idteck ID",               demodIdteckSearch},
+    {"KERI ID",                 demodKeri},
+    {"NexWatch ID",             demodNexWatch},
+    {"Indala ID",               demodIndala},
+};
+
+static void lf_search_print_timing(const uint64_t *timing, size_t n) {
+    uint32_t hits = 0, misses = 0;
+    demodCacheStats(&hits, &misses);
+
+    uint64_t total = 0;
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "-------------------------+-----------");
+    PrintAndLogEx(INFO, " decoder                 | time (us)");
+    PrintAndLogEx(INFO, "-------------------------+-----------");
+    for (size_t i = 0; i < n; i++) {
+        PrintAndLogEx(INFO, " %-23s | %9" PRIu64, lf_search_decoders[i].name, timing[i]);
+        total += timing[i];
+    }
+    PrintAndLogEx(INFO, "-------------------------+-----------");
+    PrintAndLogEx(INFO, " " _YELLOW_("%-23s") " | " _YELLOW_("%9" PRIu64), "total", total);
+    PrintAndLogEx(INFO, "demod cache... %u demodulations, %u reused", misses, hits);
+}
+
 int CmdLFfind(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1639,6 +1712,7 @@ int CmdLFfind(const char *Cmd) {
                   "lf search -u    -> try reading data from tag & search for known and unknown tag\n"
                   "lf search -1    -> use data from the GraphBuffer & search for known tag\n"
                   "lf search -1uc  -> use data from the GraphBuffer & search for known and unknown tag\n"
+                  "lf search -1c --timing -> use data from the GraphBuffer & show time spent per decoder\n"
                  );
 
     void *argtable[] = {
@@ -1646,12 +1720,14 @@ int CmdLFfind(const char *Cmd) {
         arg_lit0("1", NULL, "Use data from Graphbuffer to search (offline mode)"),
         arg_lit0("c", NULL, "Continue searching after successful match"),
         arg_lit0("u", NULL, "Search for unknown tags"),
+        arg_lit0(NULL, "timing", "Show time spent in each decoder"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     bool use_gb = arg_get_lit(ctx, 1);
     bool search_cont = arg_get_lit(ctx, 2);
     bool search_unk = arg_get_lit(ctx, 3);
+    bool show_timing = arg_get_lit(ctx, 4);
     CLIParserFree(ctx);
     int found = 0;
     bool is_online = (g_session.pm3_present && (use_gb == false));
@@ -1680,6 +1756,7 @@ int CmdLFfind(const char *Cmd) {
         if (IfPm3Hitag()) {
             if (readHitagUid() == PM3_SUCCESS) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Hitag") " found!");
+                PrintAndLogResultStr("lf.tag", "Hitag");
                 if (search_cont) {
                     found++;
                 } else {
@@ -1692,6 +1769,7 @@ int CmdLFfind(const char *Cmd) {
         if (IfPm3EM4x50()) {
             if (read_em4x50_uid() == PM3_SUCCESS) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM4x50 ID") " found!");
+                PrintAndLogResultStr("lf.tag", "EM4x50 ID");
                 if (search_cont) {
                     found++;
                 } else {
@@ -1708,6 +1786,7 @@ int CmdLFfind(const char *Cmd) {
             PrintAndLogEx(INPLACE, "Searching for MOTOROLA tag...");
             if (readMotorolaUid()) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Motorola FlexPass ID") " found!");
+                PrintAndLogResultStr("lf.tag", "Motorola FlexPass ID");
                 if (search_cont) {
                     found++;
                 } else {
@@ -1718,6 +1797,7 @@ int CmdLFfind(const char *Cmd) {
             PrintAndLogEx(INPLACE, "Searching for COTAG tag...");
             if (readCOTAGUid()) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("COTAG ID") " found!");
+                PrintAndLogResultStr("lf.tag", "COTAG ID");
                 if (search_cont) {
                     found++;
                 } else {
@@ -1737,191 +1817,34 @@ int CmdLFfind(const char *Cmd) {
 
     int retval = PM3_SUCCESS;
 
-    // ask / man
-    if (demodEM410x(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM410x ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodDestron(true) == PM3_SUCCESS) { // to do before HID
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-A FECAVA Destron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGallagher(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("GALLAGHER ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNoralsy(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Noralsy ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPresco(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Presco ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodSecurakey(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Securakey ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodViking(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Viking ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodVisa2k(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Visa2000 ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
+    // all decoders work on the same samples,  share their raw demodulations
+    demodCacheStart();
 
-    // ask / bi
-    if (demodFDXB(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-B ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodJablotron(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Jablotron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGuard(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Guardall G-Prox II ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNedap(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NEDAP ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
+    uint64_t timing[ARRAYLEN(lf_search_decoders)] = {0};
+    size_t n = 0;
+    bool stop = false;
+    for (; n < ARRAYLEN(lf_search_decoders) && stop == false; n++) {
+        uint64_t t = usclock();
+        int res = lf_search_decoders[n].demod(true);
+        timing[n] = usclock() - t;
 
-    // nrz
-    if (demodPac(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("PAC/Stanley ID") " found!");
-        if (search_cont) {
+        if (res == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("%s") " found!", lf_search_decoders[n].name);
+            PrintAndLogResultStr("lf.tag", "%s", lf_search_decoders[n].name);
             found++;
-        } else {
-            goto out;
+            stop = (search_cont == false);
         }
     }
 
-    // fsk
-    if (demodHID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("HID Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodAWID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("AWID ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIOProx(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("IO Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPyramid(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Pyramid ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodParadox(true, false) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Paradox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
+    if (show_timing) {
+        lf_search_print_timing(timing, n);
     }
+    demodCacheStop();
 
-    // psk
-    if (demodIdteck(NULL, true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Idteck ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodKeri(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("KERI ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNexWatch(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NexWatch ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIndala(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Indala ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
+    if (stop) {
+        goto out;
     }
+
     /*
     if (demodTI() == PM3_SUCCESS) {
         PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Texas Instrument ID") " found!");
@@ -2051,6 +1974,357 @@ out:
     return retval;
 }
 
+// `lf batch`: runs the `lf search` decoders over a directory of captures on a pool of threads.
+// Each worker has its own demodulation context and collects what the decoders print through a
+// print sink. The main thread writes one JSON line per file, in file order.
+
+typedef struct {
+    char *path;
+    char *json;         // result line,  set by the worker
+    bool found;
+    bool done;
+} lf_batch_item_t;
+
+typedef struct {
+    lf_batch_item_t *items;
+    size_t count;
+    size_t next;        // next file to pick up
+    bool abort;
+    bool search_cont;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} lf_batch_job_t;
+
+// what a decoder printed
+typedef struct {
+    json_t *lines;      // non empty lines
+    json_t *id;         // first success line,  usually holds the ID
+} lf_batch_capture_t;
+
+static void lf_batch_sink(void *arg, logLevel_t level, const char *text) {
+    if (level == DEBUG || level == HINT || level == INPLACE) {
+        return;
+    }
+
+    lf_batch_capture_t *cap = (lf_batch_capture_t *)arg;
+    char buf[MAX_PRINT_BUFFER];
+    snprintf(buf, sizeof(buf), "%s", text);
+
+    char *tmp_ptr = NULL;
+    for (char *line = strtok_r(buf, "\n", &tmp_ptr); line != NULL; line = strtok_r(NULL, "\n", &tmp_ptr)) {
+        // trim
+        while (*line == ' ') {
+            line++;
+        }
+        size_t len = strlen(line);
+        while (len && (line[len - 1] == ' ' || line[len - 1] == '\r' || line[len - 1] == NOLF[0])) {
+            line[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        json_t *str = json_string(line);
+        if (level == SUCCESS && cap->id == NULL) {
+            cap->id = json_incref(str);
+        }
+        json_array_append_new(cap->lines, str);
+    }
+}
+
+// loads and searches one capture on the calling thread's demodulation context
+static json_t *lf_batch_file(const char *path, bool search_cont, bool *found) {
+    json_t *root = json_object();
+    json_object_set_new(root, "file", json_string(path));
+
+    uint64_t t_start = usclock();
+
+    lf_batch_capture_t cap = { .lines = json_array() };
+    PrintAndLogSetSink(lf_batch_sink, &cap);
+
+    int *samples = NULL;
+    size_t len = 0;
+    int res;
+    if (str_endswith(path, ".wav")) {
+        res = loadFileWAVE(path, &samples, MAX_GRAPH_TRACE_LEN, &len);
+    } else {
+        res = loadFilePM3(path, &samples, MAX_GRAPH_TRACE_LEN, &len);
+    }
+
+    g_GraphTraceLen = 0;
+    g_DemodBufferLen = 0;
+    if (res == PM3_SUCCESS && reserveGraphBuffer(len) == false) {
+        res = PM3_EMALLOC;
+    }
+    if (res == PM3_SUCCESS && len) {
+        memcpy(g_GraphBuffer, samples, len * sizeof(int));
+        g_GraphTraceLen = len;
+    }
+    free(samples);
+
+    if (res == PM3_SUCCESS && g_GraphTraceLen) {
+        res = fixGraphBuffer();
+    }
+
+    json_object_set_new(root, "samples", json_integer(g_GraphTraceLen));
+
+    if (res != PM3_SUCCESS || g_GraphTraceLen < 2000) {
+        PrintAndLogSetSink(NULL, NULL);
+        const char *err = (res != PM3_SUCCESS) ? "failed to load samples" : "too few samples";
+        if (json_array_size(cap.lines)) {
+            err = json_string_value(json_array_get(cap.lines, 0));
+        }
+        json_object_set_new(root, "error", json_string(err));
+        json_decref(cap.lines);
+        json_decref(cap.id);
+        return root;
+    }
+
+    json_t *tags = json_array();
+
+    demodCacheStart();
+    for (size_t i = 0; i < ARRAYLEN(lf_search_decoders); i++) {
+        json_array_clear(cap.lines);
+        json_decref(cap.id);
+        cap.id = NULL;
+
+        uint64_t t = usclock();
+        res = lf_search_decoders[i].demod(true);
+        t = usclock() - t;
+
+        if (res != PM3_SUCCESS) {
+            continue;
+        }
+
+        json_t *tag = json_object();
+        json_object_set_new(tag, "type", json_string(lf_search_decoders[i].name));
+        if (cap.id) {
+            json_object_set(tag, "id", cap.id);
+        }
+        json_object_set_new(tag, "output", json_deep_copy(cap.lines));
+        json_object_set_new(tag, "time_us", json_integer(t));
+        json_array_append_new(tags, tag);
+
+        if (search_cont == false) {
+            break;
+        }
+    }
+    demodCacheStop();
+
+    PrintAndLogSetSink(NULL, NULL);
+    json_decref(cap.lines);
+    json_decref(cap.id);
+
+    *found = (json_array_size(tags) > 0);
+    json_object_set_new(root, "tags", tags);
+    json_object_set_new(root, "time_us", json_integer(usclock() - t_start));
+    return root;
+}
+
+static void *lf_batch_worker(void *arg) {
+    lf_batch_job_t *job = (lf_batch_job_t *)arg;
+
+    lfdemod_ctx_t *ctx = lfdemod_ctx_create(NULL, 0);
+    if (ctx) {
+        lfdemod_ctx_select(ctx);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        if (job->abort || job->next >= job->count) {
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+        lf_batch_item_t *item = &job->items[job->next++];
+        pthread_mutex_unlock(&job->lock);
+
+        bool found = false;
+        json_t *root;
+        if (ctx) {
+            root = lf_batch_file(item->path, job->search_cont, &found);
+        } else {
+            root = json_object();
+            json_object_set_new(root, "file", json_string(item->path));
+            json_object_set_new(root, "error", json_string("failed to allocate memory"));
+        }
+        char *json = json_dumps(root, JSON_COMPACT);
+        json_decref(root);
+
+        pthread_mutex_lock(&job->lock);
+        item->json = json;
+        item->found = found;
+        item->done = true;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    lfdemod_ctx_free(ctx);
+    return NULL;
+}
+
+static int lf_batch_filter(const struct dirent *entry) {
+    return str_endswith(entry->d_name, ".pm3") || str_endswith(entry->d_name, ".wav");
+}
+
+static int CmdLFBatch(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "lf batch",
+                  "Search for known tags in every .pm3 / .wav capture of a directory, offline.\n"
+                  "The captures are spread over a pool of threads,  one JSON line per file is written in file order\n"
+                  "with the samples, the decoders that matched with their output and the time spent.",
+                  "lf batch -d traces                      -> search all captures in traces/\n"
+                  "lf batch -d traces -c --threads 4       -> try all decoders on each capture,  with 4 threads\n"
+                  "lf batch -d traces -f results.jsonl     -> write the JSON lines to file"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1("d", "dir", "<path>", "directory with captures"),
+        arg_lit0("c", NULL, "Continue searching after successful match"),
+        arg_u64_0(NULL, "threads", "<dec>", "number of threads (def number of CPUs)"),
+        arg_str0("f", "file", "<fn>", "write the JSON lines to file"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+    int dlen = 0;
+    char dir[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)dir, FILE_PATH_SIZE - 1, &dlen);
+    bool search_cont = arg_get_lit(ctx, 2);
+    uint32_t threads = arg_get_u32_def(ctx, 3, num_CPUs());
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    CLIParserFree(ctx);
+
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    struct dirent **namelist;
+    int n = scandir(dir, &namelist, lf_batch_filter, alphasort);
+    if (n < 0) {
+        PrintAndLogEx(FAILED, "Can't read directory `" _YELLOW_("%s") "`", dir);
+        return PM3_EFILE;
+    }
+    if (n == 0) {
+        free(namelist);
+        PrintAndLogEx(WARNING, "No .pm3 / .wav captures in `" _YELLOW_("%s") "`", dir);
+        return PM3_EFILE;
+    }
+
+    size_t count = n;
+    lf_batch_item_t *items = calloc(count, sizeof(lf_batch_item_t));
+    if (items == NULL) {
+        for (size_t i = 0; i < count; i++) {
+            free(namelist[i]);
+        }
+        free(namelist);
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    bool add_sep = (dlen && dir[dlen - 1] != '/' && dir[dlen - 1] != PATHSEP[0]);
+    for (size_t i = 0; i < count; i++) {
+        size_t len = dlen + 1 + strlen(namelist[i]->d_name) + 1;
+        items[i].path = calloc(len, sizeof(char));
+        if (items[i].path) {
+            snprintf(items[i].path, len, "%s%s%s", dir, add_sep ? PATHSEP : "", namelist[i]->d_name);
+        }
+        free(namelist[i]);
+    }
+    free(namelist);
+
+    FILE *out = stdout;
+    if (fnlen) {
+        out = fopen(filename, "w");
+        if (out == NULL) {
+            PrintAndLogEx(FAILED, "Can't create file `" _YELLOW_("%s") "`", filename);
+            for (size_t i = 0; i < count; i++) {
+                free(items[i].path);
+            }
+            free(items);
+            return PM3_EFILE;
+        }
+    }
+
+    threads = MIN(threads, count);
+    PrintAndLogEx(INFO, "Searching " _YELLOW_("%zu") " captures with " _YELLOW_("%u") " threads", count, threads);
+
+    // jansson seeds its hash function on first use,  do it before the workers race for it
+    json_object_seed(0);
+
+    lf_batch_job_t job = {
+        .items = items,
+        .count = count,
+        .search_cont = search_cont,
+    };
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    uint64_t t_start = msclock();
+
+    pthread_t thread_ids[threads];
+    uint32_t started = 0;
+    for (; started < threads; started++) {
+        if (pthread_create(&thread_ids[started], NULL, lf_batch_worker, &job) != 0) {
+            break;
+        }
+    }
+
+    int res = PM3_SUCCESS;
+    if (started == 0) {
+        PrintAndLogEx(WARNING, "Failed to create pthreads");
+        res = PM3_ESOFT;
+    }
+
+    size_t done = 0, found = 0;
+    for (size_t i = 0; started && i < count; i++) {
+        pthread_mutex_lock(&job.lock);
+        while (items[i].done == false) {
+            pthread_cond_wait(&job.cond, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        if (items[i].json) {
+            fprintf(out, "%s\n", items[i].json);
+            fflush(out);
+        }
+        done++;
+        found += items[i].found;
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            pthread_mutex_lock(&job.lock);
+            job.abort = true;
+            pthread_mutex_unlock(&job.lock);
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(thread_ids[i], NULL);
+    }
+
+    uint64_t t_total = msclock() - t_start;
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(items[i].path);
+        free(items[i].json);
+    }
+    free(items);
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+
+    PrintAndLogEx(SUCCESS, "Searched " _YELLOW_("%zu") " captures, " _YELLOW_("%zu") " with known tags, in " _YELLOW_("%" PRIu64) " ms", done, found, t_total);
+    if (fnlen) {
+        PrintAndLogEx(SUCCESS, "Saved to `" _YELLOW_("%s") "`", filename);
+    }
+    return res;
+}
+
 static command_t CommandTable[] = {
     {"help",        CmdHelp,            AlwaysAvailable, "This help"},
     {"-----------", CmdHelp,            AlwaysAvailable, "-------------- " _CYAN_("Low Frequency") " --------------"},
@@ -2084,6 +2358,7 @@ static command_t CommandTable[] = {
     {"visa2000",    CmdLFVisa2k,        AlwaysAvailable, "{ Visa2000 RFIDs...          }"},
 //    {"zx",          CmdLFZx8211,        AlwaysAvailable, "{ ZX8211 RFIDs...            }"},
     {"-----------", CmdHelp,            AlwaysAvailable, "--------------------- " _CYAN_("General") " ---------------------"},
+    {"batch",       CmdLFBatch,         AlwaysAvailable, "Search for known tags in a directory of captures"},
     {"config",      CmdLFConfig,        IfPm3Lf,         "Get/Set config for LF sampling, bit/sample, decimation, frequency"},
     {"cmdread",     CmdLFCommandRead,   IfPm3Lf,         "Modulate LF reader field to send command before read"},
     {"read",        CmdLFRead,          IfPm3Lf,         "Read LF tag"},
@@ -40,7 +40,7 @@
 #include "cliparser.h"
 #include "cmdhw.h"
 
-static uint64_t gs_em410xid = 0;
+static __thread uint64_t gs_em410xid = 0;
 
 static int CmdHelp(const char *Cmd);
 /* Read the ID of an EM410x tag.
@@ -109,6 +109,16 @@ void printEM410x(uint32_t hi, uint64_t id, bool verbose, int type) {
 
     if (!id && !hi) return;
 
+    if (type & 0x1) { // Short ID
+        PrintAndLogResultStr("em410x.id", "%010" PRIX64, id);
+    }
+    if (type & 0x2) { // Long ID
+        PrintAndLogResultStr("em410x.xl_id", "%06X%016" PRIX64, hi, id);
+    }
+    if (type & 0x4) { // Short Extended ID
+        PrintAndLogResultStr("em410x.id", "%010" PRIX64, ((uint64_t)hi << 16) | (id >> 48));
+    }
+
     if (verbose == false) {
         if (type & 0x1) { // Short ID
             PrintAndLogEx(SUCCESS, "EM 410x ID "_GREEN_("%010" PRIX64), id);
@@ -164,6 +164,7 @@ int demodHID(bool verbose) {
         printDemodBuff(0, false, false, true);
     }
     PrintAndLogEx(INFO, "raw: " _GREEN_("%08x%08x%08x"), hi2, hi, lo);
+    PrintAndLogResultStr("hid.raw", "%08x%08x%08x", hi2, hi, lo);
 
     PrintAndLogEx(DEBUG, "DEBUG: HID idx: %d, Len: %zu, Printing DemodBuffer: ", idx, size);
     if (g_debugMode) {
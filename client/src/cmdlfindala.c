@@ -401,9 +401,9 @@ static int CmdIndalaDemodAlt(const char *Cmd) {
     int count = 0;
     int i, j;
 
-    // worst case with g_GraphTraceLen=40000 is < 4096
+    // worst case with g_GraphTraceLen=40000 is < 4096, longer captures stop filling rawbits there
     // under normal conditions it's < 2048
-    uint8_t *data = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *data = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (data == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -425,7 +425,7 @@ static int CmdIndalaDemodAlt(const char *Cmd) {
         if ((data[i] > data[i + 1]) && (state != 1)) {
             // appears redundant - marshmellow
             if (state == 0) {
-                for (j = 0; j <  count - 8; j += 16) {
+                for (j = 0; j <  count - 8 && rawbit < ARRAYLEN(rawbits); j += 16) {
                     rawbits[rawbit++] = 0;
                 }
                 if ((abs(count - j)) > worst) {
@@ -438,7 +438,7 @@ static int CmdIndalaDemodAlt(const char *Cmd) {
         } else if ((data[i] < data[i + 1]) && (state != 0)) {
             //appears redundant
             if (state == 1) {
-                for (j = 0; j <  count - 8; j += 16) {
+                for (j = 0; j <  count - 8 && rawbit < ARRAYLEN(rawbits); j += 16) {
                     rawbits[rawbit++] = 1;
                 }
                 if ((abs(count - j)) > worst) {
@@ -579,6 +579,9 @@ static int CmdIndalaDemodAlt(const char *Cmd) {
     // Remodulating for tag cloning
     // HACK: 2015-01-04 this will have an impact on our new way of seening lf commands (demod)
     // since this changes graphbuffer data.
+    if (reserveGraphBuffer(32 * uidlen) == false) {
+        return PM3_EMALLOC;
+    }
     g_GraphTraceLen = 32 * uidlen;
     i = 0;
     int phase;
@@ -1409,11 +1409,15 @@ bool t55xxTryDetectModulationEx(uint8_t downlink_mode, bool print_config, uint32
 
         clk = GetPskClock("", false);
         if (clk > 0) {
-            // allow undo
-            buffer_savestate_t saveState = save_bufferS32(g_GraphBuffer, g_GraphTraceLen);
-            saveState.offset = g_GridOffset;
             // skip first 160 samples to allow antenna to settle in (psk gets inverted occasionally otherwise)
-            CmdLtrim("-i 160");
+            // the PSK attempts run on a view of the samples past that point,  nothing to trim or undo
+            lfdemod_ctx_t *psk_ctx = NULL, *prev_ctx = NULL;
+            if (g_GraphTraceLen > 160) {
+                psk_ctx = lfdemod_ctx_create(g_GraphBuffer + 160, g_GraphTraceLen - 160);
+            }
+            if (psk_ctx) {
+                prev_ctx = lfdemod_ctx_select(psk_ctx);
+            }
             if ((PSKDemod(0, 0, 6, false) == PM3_SUCCESS) && test(DEMOD_PSK1, &tests[hits].offset, &bitRate, clk, &tests[hits].Q5)) {
                 tests[hits].modulation = DEMOD_PSK1;
                 tests[hits].bitrate = bitRate;
@@ -1459,9 +1463,16 @@ bool t55xxTryDetectModulationEx(uint8_t downlink_mode, bool print_config, uint32
                     ++hits;
                 }
             } // inverse waves does not affect this demod
-            //undo trim samples
-            restore_bufferS32(saveState, g_GraphBuffer);
-            g_GridOffset = saveState.offset;
+            if (psk_ctx) {
+                lfdemod_ctx_select(prev_ctx);
+                // hand the last PSK demod over, like the attempts on the trimmed samples did
+                if (psk_ctx->demod_len) {
+                    setDemodBuff(psk_ctx->demod, psk_ctx->demod_len, 0);
+                    g_DemodClock = psk_ctx->demod_clock;
+                    g_DemodStartIdx = psk_ctx->demod_start_idx + 160;
+                }
+                lfdemod_ctx_free(psk_ctx);
+            }
             // t55xx_search_config_psk(g_GraphBuffer, 1);
             // t55xx_search_config_psk(g_GraphBuffer, 2);
         }
@@ -18,6 +18,8 @@
 #include "cmdtrace.h"
 
 #include <ctype.h>
+#include <stdarg.h>
+#include <pthread.h>
 
 #include "cmdparser.h"    // command_t
 #include "protocols.h"
@@ -30,23 +32,33 @@
 #include "cmdlfhitag.h"         // annotate hitag
 #include "pm3_cmd.h"            // tracelog_hdr_t
 #include "cliparser.h"          // args..
+#include "util.h"               // g_printAndLog
 
 static int CmdHelp(const char *Cmd);
 
 // trace pointer
 static uint8_t *gs_trace;
-static uint16_t gs_traceLen = 0;
+static uint32_t gs_traceLen = 0;
 
-static bool is_last_record(uint16_t tracepos, uint16_t traceLen) {
+// record index of the trace buffer,  built once on first use and dropped whenever gs_trace changes
+typedef struct {
+    uint32_t pos;           // offset of the record header in gs_trace
+    uint32_t timestamp;     // copy of hdr->timestamp,  keeps time lookups out of the trace data
+} trace_record_t;
+
+static trace_record_t *gs_trace_index = NULL;
+static uint32_t gs_trace_records = 0;
+
+static bool is_last_record(uint32_t tracepos, uint32_t traceLen) {
     return ((tracepos + TRACELOG_HDR_LEN) >= traceLen);
 }
 
-static bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
+static bool next_record_is_response(uint32_t tracepos, uint8_t *trace) {
     const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
     return (hdr->isResponse);
 }
 
-static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint32_t *tracepos, uint32_t traceLen,
                                       uint8_t *trace, const uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
 
 #define MAX_TOPAZ_READER_CMD_LEN 16
@@ -93,12 +105,100 @@ static uint8_t calc_pos(const uint8_t *d) {
 
 // Copy an existing buffer into client trace buffer
 // I think this is cleaner than further globalizing gs_trace, and may lend itself to more modularity later?
-bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len) {
-    if (trace_len == 0 || trace_src == NULL) return (false);
-    if (gs_trace) {
-        free(gs_trace);
-        gs_traceLen = 0;
+static void trace_index_free(void) {
+    free(gs_trace_index);
+    gs_trace_index = NULL;
+    gs_trace_records = 0;
+}
+
+static void trace_free(void) {
+    free(gs_trace);
+    gs_trace = NULL;
+    gs_traceLen = 0;
+    trace_index_free();
+}
+
+// Walks the trace buffer once and records where each record starts.
+// Stops at the first record that doesn't fit in the buffer,  same as the list functions do.
+static int trace_index_build(void) {
+
+    if (gs_trace_index) {
+        return PM3_SUCCESS;
     }
+
+    if (gs_trace == NULL || gs_traceLen == 0) {
+        return PM3_EINVARG;
+    }
+
+    uint32_t cap = 1024;
+    trace_record_t *idx = calloc(cap, sizeof(trace_record_t));
+    if (idx == NULL) {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for trace index");
+        return PM3_EMALLOC;
+    }
+
+    uint32_t n = 0;
+    uint32_t tracepos = 0;
+    while (is_last_record(tracepos, gs_traceLen) == false) {
+
+        const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + tracepos);
+        uint64_t next = (uint64_t)tracepos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (next > gs_traceLen) {
+            break;
+        }
+
+        if (n == cap) {
+            cap *= 2;
+            trace_record_t *tmp = realloc(idx, cap * sizeof(trace_record_t));
+            if (tmp == NULL) {
+                free(idx);
+                PrintAndLogEx(FAILED, "Cannot allocate memory for trace index");
+                return PM3_EMALLOC;
+            }
+            idx = tmp;
+        }
+
+        idx[n].pos = tracepos;
+        idx[n].timestamp = hdr->timestamp;
+        n++;
+        tracepos = (uint32_t)next;
+    }
+
+    gs_trace_index = idx;
+    gs_trace_records = n;
+    PrintAndLogEx(DEBUG, "trace index built, %u records", n);
+    return PM3_SUCCESS;
+}
+
+// first record with a start time (relative to the first record) >= t.
+// Trace timestamps are monotonic within a capture,  so a binary search is enough.
+static uint32_t trace_index_lookup_time(uint32_t t) {
+    uint32_t lo = 0, hi = gs_trace_records;
+    uint32_t t0 = gs_trace_index[0].timestamp;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (gs_trace_index[mid].timestamp - t0 < t) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// --from / --to are given like the start column, in microseconds with -u (ticks / 13.56).
+// A record is shown when its displayed start is in range, so a lower bound rounds up
+static uint64_t trace_time_to_ticks(uint64_t t, bool use_us, bool round_up) {
+    if (use_us == false) {
+        return t;
+    }
+    t = MIN(t, UINT32_MAX);
+    return (t * 1356 + (round_up ? 99 : 0)) / 100;
+}
+
+bool ImportTraceBuffer(const uint8_t *trace_src, uint32_t trace_len) {
+    if (trace_len == 0 || trace_src == NULL) return (false);
+    trace_free();
     gs_trace = calloc(trace_len, sizeof(uint8_t));
     if (gs_trace == NULL) {
         return (false);
@@ -114,7 +214,7 @@ static uint8_t extract_epurse[8] = {0};
 
 #define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
 
-static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
+static uint32_t extractChall_ev2(uint32_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
     tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
     if (next_hdr->data_len != 21) {
         return 0;
@@ -135,7 +235,7 @@ static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdp
     return tracepos;
 }
 
-static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t *trace) {
+static uint32_t extractChallenges(uint32_t tracepos, uint32_t traceLen, uint8_t *trace) {
 
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -404,7 +504,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2F: {
                 PrintAndLogEx(INFO, "AUTH EV2 First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -413,7 +513,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2NF: {
                 PrintAndLogEx(INFO, "AUTH EV2 Non First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -425,7 +525,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
     return tracepos;
 }
 
-static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol) {
+static uint32_t printHexLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) return traceLen;
 
@@ -443,7 +543,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
         return tracepos;
     }
 
-    uint16_t ret;
+    uint32_t ret;
 
     switch (protocol) {
         case ISO_14443A: {
@@ -491,8 +591,57 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
     return ret;
 }
 
-static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
-                               const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
+// Output of printTraceLine().  NULL prints straight to the console,  otherwise the lines are
+// collected NUL separated so a decoding worker can hand them over to the main thread in order.
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t size;
+    bool oom;
+} trace_out_t;
+
+static void trace_print(trace_out_t *out, const char *fmt, ...) {
+    char line[MAX_PRINT_BUFFER];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (out == NULL) {
+        PrintAndLogEx(NORMAL, "%s", line);
+        return;
+    }
+
+    size_t n = strlen(line) + 1;
+    if (out->len + n > out->size) {
+        size_t size = MAX(out->size * 2, out->len + n + 4096);
+        char *tmp = realloc(out->buf, size);
+        if (tmp == NULL) {
+            out->oom = true;
+            return;
+        }
+        out->buf = tmp;
+        out->size = size;
+    }
+    memcpy(out->buf + out->len, line, n);
+    out->len += n;
+}
+
+static void trace_out_flush(trace_out_t *out) {
+    for (size_t i = 0; i < out->len; i += strlen(out->buf + i) + 1) {
+        PrintAndLogEx(NORMAL, "%s", out->buf + i);
+    }
+
+    if (out->oom) {
+        PrintAndLogEx(WARNING, "Cannot allocate memory for trace output, lines missing");
+    }
+
+    free(out->buf);
+    memset(out, 0, sizeof(trace_out_t));
+}
+
+static uint32_t printTraceLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
+                               const uint64_t *mfDicKeys, uint32_t mfDicKeysCount, trace_out_t *out) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
         PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %u  t-len %u", tracepos, traceLen);
@@ -867,7 +1016,7 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
             if (hdr->isResponse) {
                 // tag row
                 if (use_us) {
-                    PrintAndLogEx(NORMAL, " %10.1f | %10.1f | Tag |%-*s | %s| %s",
+                    trace_print(out, " %10.1f | %10.1f | Tag |%-*s | %s| %s",
                                   (float)time1 / 13.56,
                                   (float)time2 / 13.56,
                                   str_padder,
@@ -876,7 +1025,7 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                                   (last_line) ? explanation : ""
                                  );
                 } else {
-                    PrintAndLogEx(NORMAL, " %10u | %10u | Tag |%-*s | %s| %s",
+                    trace_print(out, " %10u | %10u | Tag |%-*s | %s| %s",
                                   time1,
                                   time2,
                                   str_padder,
@@ -888,7 +1037,7 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
             } else {
                 // reader row
                 if (use_us) {
-                    PrintAndLogEx(NORMAL,
+                    trace_print(out,
                                   _YELLOW_(" %10.1f") " | " _YELLOW_("%10.1f") " | " _YELLOW_("Rdr") " |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
                                   (float)time1 / 13.56,
                                   (float)time2 / 13.56,
@@ -898,7 +1047,7 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                                   (last_line) ? explanation : ""
                                  );
                 } else {
-                    PrintAndLogEx(NORMAL,
+                    trace_print(out,
                                   _YELLOW_(" %10u") " | " _YELLOW_("%10u") " | " _YELLOW_("Rdr") " |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
                                   time1,
                                   time2,
@@ -922,14 +1071,14 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
             }
 
             if (hdr->isResponse) {
-                PrintAndLogEx(NORMAL, "            |            |     |%-*s | %s| %s",
+                trace_print(out, "            |            |     |%-*s | %s| %s",
                               str_padder,
                               line[j],
                               last_line ? crc : "    ",
                               last_line ? explanation : ""
                              );
             } else {
-                PrintAndLogEx(NORMAL, "            |            |     |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
+                trace_print(out, "            |            |     |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
                               str_padder,
                               line[j],
                               last_line ? crc : "    ",
@@ -959,13 +1108,13 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                 int plen = MIN((mfDataLen - j), TRACE_MAX_HEX_BYTES);
 
                 if (hdr->isResponse) {
-                    PrintAndLogEx(NORMAL, "            |            |  *  |%-*s | %-4s| %s",
+                    trace_print(out, "            |            |  *  |%-*s | %-4s| %s",
                                   str_padder,
                                   sprint_hex_inrow_spaces(mfData + j, plen, 2),
                                   (crcc == 0 ? _RED_(" !! ") : (crcc == 1 ? _GREEN_(" ok ") : "    ")),
                                   explanation);
                 } else {
-                    PrintAndLogEx(NORMAL, "            |            |  *  |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
+                    trace_print(out, "            |            |  *  |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
                                   str_padder,
                                   sprint_hex_inrow_spaces(mfData + j, plen, 2),
                                   (crcc == 0 ? _RED_(" !! ") : (crcc == 1 ? _GREEN_(" ok ") : "    ")),
@@ -1016,13 +1165,13 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
 
             for (int j = 0; j < num_lines ; j++) {
                 if (hdr->isResponse) {
-                    PrintAndLogEx(NORMAL, "            |            |  *  |%-*s | %-4s| %s",
+                    trace_print(out, "            |            |  *  |%-*s | %-4s| %s",
                                   str_padder,
                                   line[j],
                                   "    ",
                                   explanation);
                 } else {
-                    PrintAndLogEx(NORMAL, "            |            |  *  |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
+                    trace_print(out, "            |            |  *  |" _YELLOW_("%-*s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
                                   str_padder,
                                   line[j],
                                   "    ",
@@ -1049,13 +1198,13 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
         }
 
         if (use_us) {
-            PrintAndLogEx(NORMAL, " %10.1f | %10.1f | %s |fdt (Frame Delay Time): " _YELLOW_("%.1f"),
+            trace_print(out, " %10.1f | %10.1f | %s |fdt (Frame Delay Time): " _YELLOW_("%.1f"),
                           (float)time1 / 13.56,
                           (float)time2 / 13.56,
                           "   ",
                           (float)(next_hdr->timestamp - end_of_transmission_timestamp) / 13.56);
         } else {
-            PrintAndLogEx(NORMAL, " %10u | %10u | %s |fdt (Frame Delay Time): " _YELLOW_("%d"),
+            trace_print(out, " %10u | %10u | %s |fdt (Frame Delay Time): " _YELLOW_("%d"),
                           time1,
                           time2,
                           "   ",
@@ -1066,6 +1215,246 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
     return tracepos;
 }
 
+// Protocols whose annotation doesn't depend on earlier frames,  or only on frames since the last
+// REQA / WUPA.  MIFARE Classic / Plus (crypto1), iCLASS and Hitag keep state across a whole trace.
+static bool trace_protocol_parallel(uint8_t protocol) {
+    switch (protocol) {
+        case ISO_14443A:
+        case ISO_14443B:
+        case ISO_15693:
+        case ISO_7816_4:
+        case PROTO_CRYPTORF:
+        case MFDES:
+        case FELICA:
+        case LEGIC:
+        case LTO:
+        case SEOS:
+        case THINFILM:
+        case TOPAZ:
+        case (uint8_t) -1:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// A chunk may start at a record when nothing decoded before it can change its output:
+// the previous record is a tag response (topaz merges consecutive reader frames) and for
+// the ISO14443-A based protocols the record is a REQA / WUPA starting a new session.
+static bool trace_is_chunk_start(uint32_t rec, uint8_t protocol) {
+    if (rec == 0) {
+        return true;
+    }
+
+    const tracelog_hdr_t *prev = (tracelog_hdr_t *)(gs_trace + gs_trace_index[rec - 1].pos);
+    if (prev->isResponse == false) {
+        return false;
+    }
+
+    switch (protocol) {
+        case ISO_14443A:
+        case ISO_7816_4:
+        case MFDES:
+        case SEOS: {
+            const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + gs_trace_index[rec].pos);
+            return (hdr->isResponse == false && hdr->data_len == 1 &&
+                    (hdr->frame[0] == ISO14443A_CMD_REQA || hdr->frame[0] == ISO14443A_CMD_WUPA));
+        }
+        default:
+            return true;
+    }
+}
+
+// end of transmission of a record,  what printTraceLine() passes on in prev_eot
+static uint32_t trace_record_eot(uint32_t rec, uint8_t protocol) {
+    const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + gs_trace_index[rec].pos);
+    uint32_t duration = hdr->duration;
+    if (protocol == ICLASS || protocol == ISO_15693) {
+        duration *= 32;
+    }
+    return hdr->timestamp + duration;
+}
+
+#define TRACE_CHUNK_RECORDS     4096
+#define TRACE_CHUNKS_PER_THREAD 4
+
+typedef struct {
+    uint32_t start;         // byte offsets in gs_trace
+    uint32_t end;
+    uint32_t prev_eot;
+    bool done;
+    trace_out_t out;
+} trace_chunk_t;
+
+typedef struct {
+    trace_chunk_t *chunks;
+    uint32_t count;
+    uint32_t next;          // next chunk to decode
+    uint32_t printed;       // chunks already handed to the console
+    uint32_t window;        // how far the workers may run ahead of the console
+    bool abort;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t protocol;
+    bool show_wait_cycles;
+    bool mark_crc;
+    bool use_relative;
+    bool use_us;
+} trace_job_t;
+
+static void *trace_decode_worker(void *arg) {
+    trace_job_t *job = (trace_job_t *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        while (job->abort == false && job->next < job->count && job->next >= job->printed + job->window) {
+            pthread_cond_wait(&job->cond, &job->lock);
+        }
+        if (job->abort || job->next >= job->count) {
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+        trace_chunk_t *chunk = &job->chunks[job->next++];
+        pthread_mutex_unlock(&job->lock);
+
+        // each chunk starts a new session
+        annotateIso14443a_init();
+
+        uint32_t tracepos = chunk->start;
+        while (tracepos < chunk->end) {
+            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, job->protocol, job->show_wait_cycles, job->mark_crc,
+                                      job->use_relative ? &chunk->prev_eot : NULL, job->use_us, NULL, 0, &chunk->out);
+        }
+
+        pthread_mutex_lock(&job->lock);
+        chunk->done = true;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+    return NULL;
+}
+
+// Decodes records [rec_first, rec_last) with a pool of worker threads.  The trace is cut into chunks at
+// boundaries where decoding can restart (see trace_is_chunk_start),  the console output stays in order
+// and is identical to the sequential listing.
+static int trace_list_parallel(uint32_t rec_first, uint32_t rec_last, uint8_t protocol, bool show_wait_cycles, bool mark_crc,
+                               uint32_t *prev_EOT, bool use_us, uint32_t threads) {
+
+    // the records in front of the first boundary may continue a session,  decode them here
+    uint32_t rec = rec_first;
+    while (rec < rec_last && trace_is_chunk_start(rec, protocol) == false) {
+        rec++;
+    }
+
+    uint32_t tracepos = gs_trace_index[rec_first].pos;
+    uint32_t head_end = (rec < gs_trace_records) ? gs_trace_index[rec].pos : gs_traceLen;
+    while (tracepos < head_end) {
+        tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, NULL, 0, NULL);
+    }
+
+    if (rec >= rec_last) {
+        return PM3_SUCCESS;
+    }
+
+    // cut the rest in chunks
+    uint32_t cap = (rec_last - rec) / TRACE_CHUNK_RECORDS + 2;
+    trace_chunk_t *chunks = calloc(cap, sizeof(trace_chunk_t));
+    if (chunks == NULL) {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for trace chunks");
+        return PM3_EMALLOC;
+    }
+
+    uint32_t count = 0;
+    uint32_t chunk_first = rec;
+    for (uint32_t r = rec + 1; r <= rec_last; r++) {
+        if (r < rec_last && (r - chunk_first < TRACE_CHUNK_RECORDS || trace_is_chunk_start(r, protocol) == false)) {
+            continue;
+        }
+
+        if (count == cap) {
+            cap *= 2;
+            trace_chunk_t *tmp = realloc(chunks, cap * sizeof(trace_chunk_t));
+            if (tmp == NULL) {
+                free(chunks);
+                PrintAndLogEx(FAILED, "Cannot allocate memory for trace chunks");
+                return PM3_EMALLOC;
+            }
+            chunks = tmp;
+        }
+
+        memset(&chunks[count], 0, sizeof(trace_chunk_t));
+        chunks[count].start = gs_trace_index[chunk_first].pos;
+        chunks[count].end = (r < gs_trace_records) ? gs_trace_index[r].pos : gs_traceLen;
+        chunks[count].prev_eot = (chunk_first == 0) ? 0 : trace_record_eot(chunk_first - 1, protocol);
+        count++;
+        chunk_first = r;
+    }
+
+    threads = MIN(threads, count);
+    PrintAndLogEx(DEBUG, "decoding %u chunks with %u threads", count, threads);
+
+    trace_job_t job = {
+        .chunks = chunks,
+        .count = count,
+        .window = threads * TRACE_CHUNKS_PER_THREAD,
+        .protocol = protocol,
+        .show_wait_cycles = show_wait_cycles,
+        .mark_crc = mark_crc,
+        .use_relative = (prev_EOT != NULL),
+        .use_us = use_us,
+    };
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    pthread_t thread_ids[threads];
+    uint32_t started = 0;
+    for (; started < threads; started++) {
+        if (pthread_create(&thread_ids[started], NULL, trace_decode_worker, &job) != 0) {
+            break;
+        }
+    }
+
+    int res = PM3_SUCCESS;
+    if (started == 0) {
+        PrintAndLogEx(WARNING, "Failed to create pthreads");
+        res = PM3_ESOFT;
+    }
+
+    for (uint32_t i = 0; started && i < count; i++) {
+        pthread_mutex_lock(&job.lock);
+        while (chunks[i].done == false) {
+            pthread_cond_wait(&job.cond, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        trace_out_flush(&chunks[i].out);
+
+        bool stop = kbd_enter_pressed();
+
+        pthread_mutex_lock(&job.lock);
+        job.printed = i + 1;
+        job.abort = stop;
+        pthread_cond_broadcast(&job.cond);
+        pthread_mutex_unlock(&job.lock);
+
+        if (stop) {
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(thread_ids[i], NULL);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        free(chunks[i].out.buf);
+    }
+    free(chunks);
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+    return res;
+}
+
 static int download_trace(void) {
 
     if (IfPm3Present() == false) {
@@ -1074,11 +1463,7 @@ static int download_trace(void) {
     }
 
     // reserve some space.
-    if (gs_trace) {
-        free(gs_trace);
-    }
-
-    gs_traceLen = 0;
+    trace_free();
 
     gs_trace = calloc(PM3_CMD_DATA_SIZE, sizeof(uint8_t));
     if (gs_trace == NULL) {
@@ -1092,8 +1477,7 @@ static int download_trace(void) {
     PacketResponseNG resp;
     if (!GetFromDevice(BIG_BUF, gs_trace, PM3_CMD_DATA_SIZE, 0, NULL, 0, &resp, 4000, true)) {
         PrintAndLogEx(WARNING, "timeout while waiting for reply.");
-        free(gs_trace);
-        gs_trace = NULL;
+        trace_free();
         return PM3_ETIMEOUT;
     }
 
@@ -1106,13 +1490,13 @@ static int download_trace(void) {
         gs_trace = calloc(gs_traceLen, sizeof(uint8_t));
         if (gs_trace == NULL) {
             PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
+            gs_traceLen = 0;
             return PM3_EMALLOC;
         }
 
         if (!GetFromDevice(BIG_BUF, gs_trace, gs_traceLen, 0, NULL, 0, NULL, 2500, false)) {
             PrintAndLogEx(WARNING, "command execution time out");
-            free(gs_trace);
-            gs_trace = NULL;
+            trace_free();
             return PM3_ETIMEOUT;
         }
     }
@@ -1162,7 +1546,7 @@ static int CmdTraceExtract(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     while (tracepos < gs_traceLen) {
         tracepos = extractChallenges(tracepos, gs_traceLen, gs_trace);
@@ -1195,11 +1579,7 @@ static int CmdTraceLoad(const char *Cmd) {
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
-    if (gs_trace) {
-        free(gs_trace); // maybe better to not clobber this until we have successful load?
-        gs_trace = NULL;
-        gs_traceLen = 0;
-    }
+    trace_free(); // maybe better to not clobber this until we have successful load?
 
     size_t len = 0;
     if (loadFile_safe(filename, ".trace", (void **)&gs_trace, &len) != PM3_SUCCESS) {
@@ -1207,7 +1587,13 @@ static int CmdTraceLoad(const char *Cmd) {
         return PM3_EIO;
     }
 
-    gs_traceLen = (long)len;
+    if (len > UINT32_MAX) {
+        PrintAndLogEx(FAILED, "Trace file too large");
+        trace_free();
+        return PM3_EOVFLOW;
+    }
+
+    gs_traceLen = (uint32_t)len;
 
     PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = " _YELLOW_("%u") " bytes)", gs_traceLen);
     PrintAndLogEx(HINT, "try " _YELLOW_("`trace list -1 -t ...`") " to view trace.  Remember the " _YELLOW_("`-1`") " param");
@@ -1258,8 +1644,9 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
     char example[200] = {0};
     snprintf(example, sizeof(example) - 1,
              "%s list --frame      -> show frame delay times\n"
-             "%s list -1           -> use trace buffer ",
-             alias, alias);
+             "%s list -1           -> use trace buffer\n"
+             "%s list -1 -n 50 --page 2   -> show records 100..149",
+             alias, alias, alias);
     char fullalias[100] = {0};
     snprintf(fullalias, sizeof(fullalias) - 1, "%s list", alias);
     CLIParserInit(&ctx, fullalias, desc, example);
@@ -1274,6 +1661,12 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
         arg_lit0("x", NULL, "show hexdump to convert to pcap(ng)\n"
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "start", "<dec>", "first record to show"),
+        arg_u64_0("n", "count", "<dec>", "number of records to show, page size with --page"),
+        arg_u64_0(NULL, "page", "<dec>", "page to show, first page is 0"),
+        arg_u64_0(NULL, "from", "<dec>", "skip records starting before this time (start column, us with -u)"),
+        arg_u64_0(NULL, "to", "<dec>", "skip records starting after this time (start column, us with -u)"),
+        arg_u64_0(NULL, "threads", "<dec>", "decode with n threads, not for mf/mfp/iclass/hitag (def 1)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1313,7 +1706,10 @@ int CmdTraceList(const char *Cmd) {
                   "\n"
                   "trace list -t mf -f mfc_default_keys.dic     -> use default dictionary file\n"
                   "trace list -t 14a --frame                    -> show frame delay times\n"
-                  "trace list -t 14a -1                         -> use trace buffer "
+                  "trace list -t 14a -1                         -> use trace buffer\n"
+                  "trace list -t 14a -1 -n 50 --page 2          -> show records 100..149\n"
+                  "trace list -t 14a -1 --from 2000000          -> start at the first record after 2000000 (start column)\n"
+                  "trace list -t 14a -1 -u --from 150000        -> start at the first record after 150000 us"
                  );
 
     void *argtable[] = {
@@ -1327,6 +1723,12 @@ int CmdTraceList(const char *Cmd) {
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("t", "type", NULL, "protocol to annotate the trace"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "start", "<dec>", "first record to show"),
+        arg_u64_0("n", "count", "<dec>", "number of records to show, page size with --page"),
+        arg_u64_0(NULL, "page", "<dec>", "page to show, first page is 0"),
+        arg_u64_0(NULL, "from", "<dec>", "skip records starting before this time (start column, us with -u)"),
+        arg_u64_0(NULL, "to", "<dec>", "skip records starting after this time (start column, us with -u)"),
+        arg_u64_0(NULL, "threads", "<dec>", "decode with n threads, not for mf/mfp/iclass/hitag (def 1)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1350,8 +1752,22 @@ int CmdTraceList(const char *Cmd) {
         diclen = 0;
     }
 
+    uint64_t rec_start = arg_get_u64_def(ctx, 9, 0);
+    uint64_t rec_count = arg_get_u64_def(ctx, 10, 0);
+    uint64_t page = arg_get_u64_def(ctx, 11, 0);
+    bool use_from = arg_get_u64_count(ctx, 12);
+    uint64_t time_from = arg_get_u64_def(ctx, 12, 0);
+    bool use_to = arg_get_u64_count(ctx, 13);
+    uint64_t time_to = arg_get_u64_def(ctx, 13, 0);
+    uint32_t threads = arg_get_u32_def(ctx, 14, 1);
+
     CLIParserFree(ctx);
 
+    if (page && rec_count == 0) {
+        PrintAndLogEx(FAILED, "`--page` needs a page size, use `-n`");
+        return PM3_EINVARG;
+    }
+
     clearCommandBuffer();
 
     // no crc, no annotations
@@ -1396,7 +1812,64 @@ int CmdTraceList(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    // whole trace,  unless a record or time range was asked for
+    uint32_t tracepos = 0;
+    uint32_t trace_end = gs_traceLen;
+    uint32_t rec_first = 0;
+    uint32_t rec_last = 0;
+    bool use_range = (rec_start || rec_count || use_from || use_to);
+
+    if (show_hex) {
+        threads = 1;
+    }
+
+    if (threads > 1 && trace_protocol_parallel(protocol) == false) {
+        PrintAndLogEx(INFO, "Annotations of this protocol depend on earlier frames, decoding with one thread");
+        threads = 1;
+    }
+
+    if (use_range || threads > 1) {
+
+        int res = trace_index_build();
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+
+        uint64_t first = 0;
+        uint64_t last = gs_trace_records;
+
+        if (gs_trace_records && use_from) {
+            uint64_t ticks = trace_time_to_ticks(time_from, use_us, true);
+            first = trace_index_lookup_time((uint32_t)MIN(ticks, UINT32_MAX));
+        }
+
+        if (gs_trace_records && use_to) {
+            uint64_t ticks = trace_time_to_ticks(time_to, use_us, false);
+            if (ticks < UINT32_MAX) {
+                last = trace_index_lookup_time((uint32_t)(ticks + 1));
+            }
+        }
+
+        first = MAX(first, rec_start);
+        first += page * rec_count;
+        if (rec_count) {
+            last = MIN(last, first + rec_count);
+        }
+
+        if (first >= last) {
+            PrintAndLogEx(INFO, "No records in selected range ( trace has " _YELLOW_("%u") " records )", gs_trace_records);
+            return PM3_SUCCESS;
+        }
+
+        rec_first = (uint32_t)first;
+        rec_last = (uint32_t)last;
+        tracepos = gs_trace_index[rec_first].pos;
+        trace_end = (rec_last < gs_trace_records) ? gs_trace_index[rec_last].pos : gs_traceLen;
+
+        if (use_range) {
+            PrintAndLogEx(INFO, "Showing records " _YELLOW_("%u") " - " _YELLOW_("%u") " of " _YELLOW_("%u"), rec_first, rec_last - 1, gs_trace_records);
+        }
+    }
 
     /*
     if (protocol == FELICA) {
@@ -1404,7 +1877,7 @@ int CmdTraceList(const char *Cmd) {
     } */
 
     if (show_hex) {
-        while (tracepos < gs_traceLen) {
+        while (tracepos < trace_end) {
             tracepos = printHexLine(tracepos, gs_traceLen, gs_trace, protocol);
         }
     } else {
@@ -1527,6 +2000,9 @@ int CmdTraceList(const char *Cmd) {
             ClearAuthData();
         }
 
+        // reset mifare auth / ntag / ul-c state of the 14a annotations
+        annotateIso14443a_init();
+
         // reset hitag state  machine
         if (protocol == PROTO_HITAG1 || protocol == PROTO_HITAG2 || protocol == PROTO_HITAGS) {
             annotateHitag2_init();
@@ -1538,14 +2014,43 @@ int CmdTraceList(const char *Cmd) {
             prev_EOT = &previous_EOT;
         }
 
-        while (tracepos < gs_traceLen) {
-            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+        if (tracepos) {
+            if (protocol == ISO_14443A || protocol == ISO_7816_4 || protocol == PROTO_MIFARE || protocol == PROTO_MFPLUS ||
+                    protocol == ICLASS || protocol == PROTO_HITAG1 || protocol == PROTO_HITAG2 || protocol == PROTO_HITAGS) {
+
+                // these annotations keep state between frames (crypto1 / hitag2 decryption, iclass / ntag / ulc auth),
+                // run the records in front of the selection through them without printing
+                uint8_t old_printAndLog = g_printAndLog;
+                g_printAndLog = 0;
+                uint32_t pos = 0;
+                while (pos < tracepos) {
+                    pos = printTraceLine(pos, gs_traceLen, gs_trace, protocol, false, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount, NULL);
+                }
+                g_printAndLog = old_printAndLog;
 
-            if (kbd_enter_pressed()) {
-                break;
+            } else if (use_relative) {
+                previous_EOT = trace_record_eot(rec_first - 1, protocol);
+            }
+        }
+
+        if (threads > 1) {
+            int res = trace_list_parallel(rec_first, rec_last, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, threads);
+            if (res != PM3_SUCCESS) {
+                return res;
+            }
+        } else {
+            while (tracepos < trace_end) {
+                tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount, NULL);
+
+                if (kbd_enter_pressed()) {
+                    break;
+                }
             }
         }
 
+        // bitsliced copy of the keys used by the mifare classic decrypt fct
+        ClearMifareDictionary();
+
         if (dictionaryLoad)  {
             free((void *) dicKeys);
         }
@@ -1555,6 +2060,22 @@ int CmdTraceList(const char *Cmd) {
         PrintAndLogEx(HINT, "syntax to use: " _YELLOW_("`text2pcap -t \"%%S.\" -l 264 -n <input-text-file> <output-pcapng-file>`"));
     }
 
+    if (rec_count && rec_last < gs_trace_records) {
+        // the pages are counted from the selected range, so it has to be given again
+        char range[80] = {0};
+        int len = 0;
+        if (rec_start) {
+            len += snprintf(range + len, sizeof(range) - len, " --start %" PRIu64, rec_start);
+        }
+        if (use_from) {
+            len += snprintf(range + len, sizeof(range) - len, " --from %" PRIu64, time_from);
+        }
+        if (use_to) {
+            snprintf(range + len, sizeof(range) - len, " --to %" PRIu64, time_to);
+        }
+        PrintAndLogEx(HINT, "next page: " _YELLOW_("`--page %" PRIu64 "%s`") " with " _YELLOW_("`-n %" PRIu64 "`"), page + 1, range, rec_count);
+    }
+
     return PM3_SUCCESS;
 }
 
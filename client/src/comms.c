@@ -19,7 +19,10 @@
 #include "comms.h"
 
 #include <inttypes.h>
+#include <errno.h>
+#include <stddef.h>
 #include <string.h>
+#include <sys/time.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -61,16 +64,34 @@ static pthread_cond_t txBufferSig = PTHREAD_COND_INITIALIZER;
 
 // Used by PacketResponseReceived as a ring buffer for messages that are yet to be
 // processed by a command handler (WaitForResponse{,Timeout})
+// There is a single producer (communication thread) and a single consumer (main thread),
+// cmd_head is only written by the producer and cmd_tail only by the consumer, so no lock
+// is taken to store or fetch a reply.
 static PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
 
+// usclock() timestamp of when each reply was stored
+static uint64_t rxBufferTime[CMD_BUFFER_SIZE];
+
 // Points to the next empty position to write to
-static int cmd_head = 0;
+static uint32_t cmd_head = 0;
 
 // Points to the position of the last unread command
-static int cmd_tail = 0;
+static uint32_t cmd_tail = 0;
 
-// to lock rxBuffer operations from different threads
+// only used to sleep until the other side made progress, never to access rxBuffer
 static pthread_mutex_t rxBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rxBufferDataSig = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rxBufferSpaceSig = PTHREAD_COND_INITIALIZER;
+static bool rx_consumer_waiting = false;
+static bool rx_producer_waiting = false;
+
+// set when the consumer didn't make room in time, replies are dropped until it does
+static bool rx_stalled = false;
+
+static comm_rx_stats_t rx_stats;
+
+// longest a waiting command handler sleeps before it re-checks timeouts
+#define RX_WAIT_SLICE 100
 
 // Global start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
 // as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
@@ -78,7 +99,8 @@ static uint64_t timeout_start_time;
 
 static uint64_t last_packet_time;
 
-static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd);
+typedef struct dl_state dl_state_t;
+static int dl_it(dl_state_t *st, uint32_t base, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd);
 
 // Simple alias to track usages linked to the Bootloader, these commands must not be migrated.
 // - commands sent to enter bootloader mode as we might have to talk to old firmwares
@@ -213,6 +235,50 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
 }
 
 
+static bool rx_has_data(void) {
+    return __atomic_load_n(&cmd_head, __ATOMIC_SEQ_CST) != __atomic_load_n(&cmd_tail, __ATOMIC_SEQ_CST);
+}
+
+static bool rx_has_space(void) {
+    return (__atomic_load_n(&cmd_head, __ATOMIC_SEQ_CST) + 1) % CMD_BUFFER_SIZE != __atomic_load_n(&cmd_tail, __ATOMIC_SEQ_CST);
+}
+
+// Sleep until ready() holds or ms milliseconds passed.
+// The waiting flag is raised before ready() is checked and the other side publishes its index
+// before it looks at the flag, so a wakeup can't get lost in between.
+static void rx_wait(bool *waiting, pthread_cond_t *sig, bool (*ready)(void), uint32_t ms) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t ns = ((uint64_t)now.tv_usec * 1000) + ((uint64_t)ms * 1000000);
+    struct timespec deadline = {
+        .tv_sec = now.tv_sec + (ns / 1000000000),
+        .tv_nsec = ns % 1000000000
+    };
+
+    pthread_mutex_lock(&rxBufferMutex);
+    __atomic_store_n(waiting, true, __ATOMIC_SEQ_CST);
+    int res = 0;
+    while ((ready() == false) && (res != ETIMEDOUT)) {
+        res = pthread_cond_timedwait(sig, &rxBufferMutex, &deadline);
+    }
+    __atomic_store_n(waiting, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&rxBufferMutex);
+}
+
+static void rx_wake(const bool *waiting, pthread_cond_t *sig) {
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&rxBufferMutex);
+        pthread_cond_signal(sig);
+        pthread_mutex_unlock(&rxBufferMutex);
+    }
+}
+
+// only the used part of the payload is copied
+static void copyReply(PacketResponseNG *dest, const PacketResponseNG *src) {
+    memcpy(dest, src, offsetof(PacketResponseNG, data) + MIN(src->length, PM3_CMD_DATA_SIZE));
+    dest->ng = src->ng;
+}
+
 /**
  * @brief This method should be called when sending a new command to the pm3. In case any old
  *  responses from previous commands are stored in the buffer, a call to this method should clear them.
@@ -221,29 +287,61 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
  */
 void clearCommandBuffer(void) {
     //This is a very simple operation
-    pthread_mutex_lock(&rxBufferMutex);
-    cmd_tail = cmd_head;
-    pthread_mutex_unlock(&rxBufferMutex);
+    __atomic_store_n(&cmd_tail, __atomic_load_n(&cmd_head, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    __atomic_clear(&rx_stalled, __ATOMIC_SEQ_CST);
+    rx_wake(&rx_producer_waiting, &rxBufferSpaceSig);
+}
+
+void GetCommunicationRxStats(comm_rx_stats_t *stats) {
+    stats->stored = __atomic_load_n(&rx_stats.stored, __ATOMIC_RELAXED);
+    stats->consumed = __atomic_load_n(&rx_stats.consumed, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&rx_stats.dropped, __ATOMIC_RELAXED);
+    stats->stalls = __atomic_load_n(&rx_stats.stalls, __ATOMIC_RELAXED);
+    stats->max_fill = __atomic_load_n(&rx_stats.max_fill, __ATOMIC_RELAXED);
+    stats->latency_us = __atomic_load_n(&rx_stats.latency_us, __ATOMIC_RELAXED);
+    stats->max_latency_us = __atomic_load_n(&rx_stats.max_latency_us, __ATOMIC_RELAXED);
 }
+
 /**
  * @brief storeCommand stores a USB command in a circular buffer
+ *  When the buffer is full, the communication thread waits for the command handler to make room,
+ *  which also throttles the device. Replies are only dropped if that doesn't happen in time.
  * @param UC
  */
 static void storeReply(const PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
-    if ((cmd_head + 1) % CMD_BUFFER_SIZE == cmd_tail) {
-        //If these two are equal, we're about to overwrite in the
-        // circular buffer.
-        PrintAndLogEx(FAILED, "WARNING: Command buffer about to overwrite command! This needs to be fixed!");
-        fflush(stdout);
+    uint32_t head = __atomic_load_n(&cmd_head, __ATOMIC_RELAXED);
+    uint32_t next = (head + 1) % CMD_BUFFER_SIZE;
+
+    if (next == __atomic_load_n(&cmd_tail, __ATOMIC_SEQ_CST)) {
+
+        if (__atomic_load_n(&rx_stalled, __ATOMIC_SEQ_CST) == false) {
+            __atomic_add_fetch(&rx_stats.stalls, 1, __ATOMIC_RELAXED);
+            rx_wait(&rx_producer_waiting, &rxBufferSpaceSig, rx_has_space, CMD_BUFFER_FULL_TIMEOUT);
+        }
+
+        if (next == __atomic_load_n(&cmd_tail, __ATOMIC_SEQ_CST)) {
+            if (__atomic_test_and_set(&rx_stalled, __ATOMIC_SEQ_CST) == false) {
+                PrintAndLogEx(WARNING, "Command buffer full, dropping replies until it is read");
+            }
+            __atomic_add_fetch(&rx_stats.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
     }
+
     //Store the command at the 'head' location
-    PacketResponseNG *destination = &rxBuffer[cmd_head];
-    memcpy(destination, packet, sizeof(PacketResponseNG));
+    copyReply(&rxBuffer[head], packet);
+    rxBufferTime[head] = usclock();
 
-    //increment head and wrap
-    cmd_head = (cmd_head + 1) % CMD_BUFFER_SIZE;
-    pthread_mutex_unlock(&rxBufferMutex);
+    //increment head and wrap, this publishes the reply
+    __atomic_store_n(&cmd_head, next, __ATOMIC_SEQ_CST);
+
+    __atomic_add_fetch(&rx_stats.stored, 1, __ATOMIC_RELAXED);
+    uint32_t fill = (next + CMD_BUFFER_SIZE - __atomic_load_n(&cmd_tail, __ATOMIC_SEQ_CST)) % CMD_BUFFER_SIZE;
+    if (fill > __atomic_load_n(&rx_stats.max_fill, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&rx_stats.max_fill, fill, __ATOMIC_RELAXED);
+    }
+
+    rx_wake(&rx_consumer_waiting, &rxBufferDataSig);
 }
 /**
  * @brief getCommand gets a command from an internal circular buffer.
@@ -251,23 +349,42 @@ static void storeReply(const PacketResponseNG *packet) {
  * @return 1 if response was returned, 0 if nothing has been received
  */
 static int getReply(PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
+    uint32_t tail = __atomic_load_n(&cmd_tail, __ATOMIC_RELAXED);
+
     //If head == tail, there's nothing to read, or if we just got initialized
-    if (cmd_head == cmd_tail)  {
-        pthread_mutex_unlock(&rxBufferMutex);
+    if (__atomic_load_n(&cmd_head, __ATOMIC_SEQ_CST) == tail) {
         return 0;
     }
 
     //Pick out the next unread command
-    memcpy(packet, &rxBuffer[cmd_tail], sizeof(PacketResponseNG));
+    copyReply(packet, &rxBuffer[tail]);
+    uint64_t latency = usclock() - rxBufferTime[tail];
 
     //Increment tail - this is a circular buffer, so modulo buffer size
-    cmd_tail = (cmd_tail + 1) % CMD_BUFFER_SIZE;
-
-    pthread_mutex_unlock(&rxBufferMutex);
+    __atomic_store_n(&cmd_tail, (tail + 1) % CMD_BUFFER_SIZE, __ATOMIC_SEQ_CST);
+    __atomic_clear(&rx_stalled, __ATOMIC_SEQ_CST);
+    rx_wake(&rx_producer_waiting, &rxBufferSpaceSig);
+
+    __atomic_add_fetch(&rx_stats.consumed, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&rx_stats.latency_us, latency, __ATOMIC_RELAXED);
+    if (latency > __atomic_load_n(&rx_stats.max_latency_us, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&rx_stats.max_latency_us, latency, __ATOMIC_RELAXED);
+    }
     return 1;
 }
 
+/**
+ * @brief getReplyWait gets a command from the buffer, sleeping up to ms_wait milliseconds for one to arrive
+ * @return 1 if response was returned, 0 if nothing has been received
+ */
+static int getReplyWait(PacketResponseNG *packet, uint32_t ms_wait) {
+    if (getReply(packet)) {
+        return 1;
+    }
+    rx_wait(&rx_consumer_waiting, &rxBufferDataSig, rx_has_data, ms_wait);
+    return getReply(packet);
+}
+
 //-----------------------------------------------------------------------------
 // Entry point into our code: called whenever we received a packet over USB
 // that we weren't necessarily expecting, for example a debug print.
@@ -432,6 +549,7 @@ __attribute__((force_align_arg_pointer))
                 PrintAndLogEx(WARNING, "\nCommunicating with Proxmark3 device " _RED_("failed"));
             }
             __atomic_test_and_set(&comm_thread_dead, __ATOMIC_SEQ_CST);
+            rx_wake(&rx_consumer_waiting, &rxBufferDataSig);
             break;
         }
 
@@ -1075,17 +1193,23 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
         }
 
         uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
-        if ((ms_timeout != (size_t) - 1) && (msclock() - tmp_clk > ms_timeout)) {
+        uint64_t elapsed = msclock() - tmp_clk;
+        if ((ms_timeout != (size_t) - 1) && (elapsed > ms_timeout)) {
             break;
         }
 
-        if (msclock() - tmp_clk > 3000 && show_warning) {
+        if (elapsed > 3000 && show_warning) {
             // 3 seconds elapsed (but this doesn't mean the timeout was exceeded)
             PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
             show_warning = false;
         }
-        // just to avoid CPU busy loop:
-        msleep(1);
+
+        // sleep until a reply is stored, wake up regularly to check the timeout and thread state
+        uint32_t ms_wait = RX_WAIT_SLICE;
+        if ((ms_timeout != (size_t) - 1) && (ms_timeout - elapsed < ms_wait)) {
+            ms_wait = ms_timeout - elapsed + 1;
+        }
+        rx_wait(&rx_consumer_waiting, &rxBufferDataSig, rx_has_data, ms_wait);
     }
     return false;
 }
@@ -1098,6 +1222,84 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response) {
     return WaitForResponseTimeoutW(cmd, response, -1, true);
 }
 
+// state of a running download
+struct dl_state {
+    uint8_t *dest;
+    uint32_t bytes;
+    uint8_t *received;      // one bit per byte of the download
+    download_chunk_cb_t callback;
+    void *cb_ctx;
+    download_stats_t *stats;
+};
+
+// marks [offset, offset + len) as received, returns false if all of it was received before
+static bool dl_mark(uint8_t *received, uint32_t offset, uint32_t len) {
+    bool fresh = false;
+    for (uint32_t i = offset; i < offset + len; i++) {
+        if ((received[i >> 3] & (1 << (i & 7))) == 0) {
+            received[i >> 3] |= (1 << (i & 7));
+            fresh = true;
+        }
+    }
+    return fresh;
+}
+
+// finds the next range not yet received, starting at *offset
+static bool dl_next_missing(const uint8_t *received, uint32_t bytes, uint32_t *offset, uint32_t *len) {
+    uint32_t i = *offset;
+    while (i < bytes && (received[i >> 3] & (1 << (i & 7)))) {
+        i++;
+    }
+    if (i == bytes) {
+        return false;
+    }
+    uint32_t j = i;
+    while (j < bytes && (received[j >> 3] & (1 << (j & 7))) == 0) {
+        j++;
+    }
+    *offset = i;
+    *len = j - i;
+    return true;
+}
+
+// sends the download request, returns the command the chunks arrive with
+static uint32_t dl_request(DeviceMemType_t memtype, uint32_t start_index, uint32_t bytes, uint8_t *data, uint32_t datalen) {
+    switch (memtype) {
+        case BIG_BUF: {
+            SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, 0, NULL, 0);
+            return CMD_DOWNLOADED_BIGBUF;
+        }
+        case BIG_BUF_EML: {
+            SendCommandMIX(CMD_DOWNLOAD_EML_BIGBUF, start_index, bytes, 0, NULL, 0);
+            return CMD_DOWNLOADED_EML_BIGBUF;
+        }
+        case SPIFFS: {
+            SendCommandMIX(CMD_SPIFFS_DOWNLOAD, start_index, bytes, 0, data, datalen);
+            return CMD_SPIFFS_DOWNLOADED;
+        }
+        case FLASH_MEM: {
+            SendCommandMIX(CMD_FLASHMEM_DOWNLOAD, start_index, bytes, 0, NULL, 0);
+            return CMD_FLASHMEM_DOWNLOADED;
+        }
+        case SIM_MEM: {
+            //SendCommandMIX(CMD_DOWNLOAD_SIM_MEM, start_index, bytes, 0, NULL, 0);
+            //return CMD_DOWNLOADED_SIMMEM;
+            return CMD_UNKNOWN;
+        }
+        case FPGA_MEM: {
+            SendCommandNG(CMD_FPGAMEM_DOWNLOAD, NULL, 0);
+            return CMD_FPGAMEM_DOWNLOADED;
+        }
+        case MCU_FLASH:
+        case MCU_MEM: {
+            uint32_t flags = (memtype == MCU_MEM) ? READ_MEM_DOWNLOAD_FLAG_RAW : 0;
+            SendCommandBL(CMD_READ_MEM_DOWNLOAD, start_index, bytes, flags, NULL, 0);
+            return CMD_READ_MEM_DOWNLOADED;
+        }
+    }
+    return CMD_UNKNOWN;
+}
+
 /**
 * Data transfer from Proxmark to client. This method times out after
 * ms_timeout milliseconds.
@@ -1114,8 +1316,28 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response) {
 * @return true if command was returned, otherwise false
 */
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
-
     if (dest == NULL) return false;
+    return GetFromDeviceStream(memtype, dest, bytes, start_index, data, datalen, response, ms_timeout, show_warning, NULL, NULL, NULL);
+}
+
+/**
+* Streaming data transfer from Proxmark to client.
+* Every chunk is handed to the callback as soon as it arrives, straight from the reply.
+* For memory types where the device always sends the full range (BigBuf, emulator memory,
+* flash memory, SPIFFS), chunks lost on the way are requested again once the device has
+* finished sending, up to DOWNLOAD_MAX_RETRIES times.
+* @brief GetFromDeviceStream
+* @param dest Destination address for transfer, can be NULL when a callback is given
+* @param callback called for every chunk, return anything but PM3_SUCCESS to abort
+* @param cb_ctx passed to the callback
+* @param stats if not NULL, receives size, duration and number of re-requests of the transfer
+* @return true if all data was transferred, otherwise false
+*/
+bool GetFromDeviceStream(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen,
+                         PacketResponseNG *response, size_t ms_timeout, bool show_warning,
+                         download_chunk_cb_t callback, void *cb_ctx, download_stats_t *stats) {
+
+    if (dest == NULL && callback == NULL) return false;
 
     PacketResponseNG resp;
     if (response == NULL) {
@@ -1134,51 +1356,96 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
     resp.oldarg[2] = 0;
     memset(resp.data.asBytes, 0, PM3_CMD_DATA_SIZE);
 
+    download_stats_t dl_stats = {0};
+    if (stats == NULL) {
+        stats = &dl_stats;
+    }
+    memset(stats, 0, sizeof(download_stats_t));
+
     if (bytes == 0) return true;
 
+    dl_state_t st = {
+        .dest = dest,
+        .bytes = bytes,
+        .received = calloc((bytes + 7) / 8, sizeof(uint8_t)),
+        .callback = callback,
+        .cb_ctx = cb_ctx,
+        .stats = stats,
+    };
+    if (st.received == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return false;
+    }
+
+    // only these send the whole requested range, so missing parts can be told apart from a short read
+    bool complete_range = (memtype == BIG_BUF || memtype == BIG_BUF_EML || memtype == FLASH_MEM || memtype == SPIFFS);
+    // and of those, these can send a part of it again
+    bool partial_request = (memtype == BIG_BUF || memtype == BIG_BUF_EML || memtype == FLASH_MEM);
+
+    uint64_t t1 = msclock();
 
     // clear
     clearCommandBuffer();
 
-    switch (memtype) {
-        case BIG_BUF: {
-            SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_BIGBUF);
-        }
-        case BIG_BUF_EML: {
-            SendCommandMIX(CMD_DOWNLOAD_EML_BIGBUF, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_EML_BIGBUF);
-        }
-        case SPIFFS: {
-            SendCommandMIX(CMD_SPIFFS_DOWNLOAD, start_index, bytes, 0, data, datalen);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_SPIFFS_DOWNLOADED);
-        }
-        case FLASH_MEM: {
-            SendCommandMIX(CMD_FLASHMEM_DOWNLOAD, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_FLASHMEM_DOWNLOADED);
-        }
-        case SIM_MEM: {
-            //SendCommandMIX(CMD_DOWNLOAD_SIM_MEM, start_index, bytes, 0, NULL, 0);
-            //return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_SIMMEM);
-            return false;
+    uint32_t rec_cmd = dl_request(memtype, start_index, bytes, data, datalen);
+    if (rec_cmd == CMD_UNKNOWN) {
+        free(st.received);
+        return false;
+    }
+
+    int res = dl_it(&st, 0, response, ms_timeout, show_warning, rec_cmd);
+
+    for (uint8_t retry = 0; (res == PM3_SUCCESS) && complete_range && (retry < DOWNLOAD_MAX_RETRIES); retry++) {
+
+        uint32_t offset = 0, len = 0;
+        if (dl_next_missing(st.received, bytes, &offset, &len) == false) {
+            break;
         }
-        case FPGA_MEM: {
-            SendCommandNG(CMD_FPGAMEM_DOWNLOAD, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_FPGAMEM_DOWNLOADED);
+
+        if (partial_request == false) {
+            PrintAndLogEx(DEBUG, "Download incomplete, requesting all %u bytes again", bytes);
+            stats->rerequests++;
+            dl_request(memtype, start_index, bytes, data, datalen);
+            res = dl_it(&st, 0, response, ms_timeout, show_warning, rec_cmd);
+            continue;
         }
-        case MCU_FLASH:
-        case MCU_MEM: {
-            uint32_t flags = (memtype == MCU_MEM) ? READ_MEM_DOWNLOAD_FLAG_RAW : 0;
-            SendCommandBL(CMD_READ_MEM_DOWNLOAD, start_index, bytes, flags, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_READ_MEM_DOWNLOADED);
+
+        do {
+            PrintAndLogEx(DEBUG, "Download incomplete, requesting %u bytes at offset %u again", len, offset);
+            stats->rerequests++;
+            dl_request(memtype, start_index + offset, len, data, datalen);
+            res = dl_it(&st, offset, response, ms_timeout, show_warning, rec_cmd);
+            offset += len;
+        } while ((res == PM3_SUCCESS) && dl_next_missing(st.received, bytes, &offset, &len));
+    }
+
+    stats->ms = msclock() - t1;
+
+    bool missing = false;
+    if (res == PM3_SUCCESS && complete_range) {
+        uint32_t offset = 0, len = 0;
+        missing = dl_next_missing(st.received, bytes, &offset, &len);
+        if (missing) {
+            PrintAndLogEx(FAILED, "Download incomplete, %u bytes at offset %u missing", len, offset);
         }
     }
-    return false;
+    free(st.received);
+
+    PrintAndLogEx(DEBUG, "Downloaded %u bytes in %" PRIu64 " ms ( %.1f kB/s ), %u chunks, %u re-requests"
+                  , stats->bytes
+                  , stats->ms
+                  , (stats->ms) ? (float)stats->bytes / stats->ms : 0.0f
+                  , stats->chunks
+                  , stats->rerequests
+                 );
+
+    return (res == PM3_SUCCESS) && (missing == false);
 }
 
-static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd) {
+// receives the chunks of one download request until the device says it is done.
+// base is the offset of this request within the whole download.
+static int dl_it(dl_state_t *st, uint32_t base, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd) {
 
-    uint32_t bytes_completed = 0;
     __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
 
     // Add delay depending on the communication channel & speed
@@ -1187,15 +1454,15 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
 
     while (true) {
 
-        if (getReply(response)) {
+        if (getReplyWait(response, RX_WAIT_SLICE)) {
 
             if (response->cmd == CMD_ACK)
-                return true;
+                return PM3_SUCCESS;
             if (response->cmd == CMD_SPIFFS_DOWNLOAD && response->status == PM3_EMALLOC)
-                return false;
+                return PM3_EMALLOC;
             // Spiffs // fpgamem-plot download is converted to NG,
             if (response->cmd == CMD_SPIFFS_DOWNLOAD || response->cmd == CMD_FPGAMEM_DOWNLOAD)
-                return true;
+                return PM3_SUCCESS;
 
             // sample_buf is a array pointer, located in data.c
             // arg0 = offset in transfer. Startindex of this chunk
@@ -1203,8 +1470,8 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
             // arg2 = bigbuff tracelength (?)
             if (response->cmd == rec_cmd) {
 
-                uint32_t offset = response->oldarg[0];
-                uint32_t copy_bytes = MIN(bytes - bytes_completed, response->oldarg[1]);
+                uint32_t offset = base + response->oldarg[0];
+                uint32_t copy_bytes = response->oldarg[1];
                 //uint32_t tracelen = response->oldarg[2];
 
                 // extended bounds check1.  upper limit is PM3_CMD_DATA_SIZE
@@ -1212,13 +1479,26 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
                 copy_bytes = MIN(copy_bytes, PM3_CMD_DATA_SIZE);
 
                 // extended bounds check2.
-                if (offset + copy_bytes > bytes) {
-                    PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %u | len %u | total len %u > buf_size %u", offset, copy_bytes,  offset + copy_bytes,  bytes);
-                    break;
+                if (offset > st->bytes || offset + copy_bytes > st->bytes) {
+                    PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %u | len %u | total len %u > buf_size %u", offset, copy_bytes,  offset + copy_bytes,  st->bytes);
+                    return PM3_EOVFLOW;
+                }
+
+                // chunks sent again for a whole range re-request are only delivered once
+                if (dl_mark(st->received, offset, copy_bytes) == false) {
+                    continue;
                 }
 
-                memcpy(dest + offset, response->data.asBytes, copy_bytes);
-                bytes_completed += copy_bytes;
+                if (st->dest) {
+                    memcpy(st->dest + offset, response->data.asBytes, copy_bytes);
+                }
+                st->stats->bytes += copy_bytes;
+                st->stats->chunks++;
+
+                if (st->callback && st->callback(response->data.asBytes, offset, copy_bytes, st->cb_ctx) != PM3_SUCCESS) {
+                    PrintAndLogEx(DEBUG, "Download aborted by callback at offset %u", offset);
+                    return PM3_EOPABORTED;
+                }
             } else if (response->cmd == CMD_WTX && response->length == sizeof(uint16_t)) {
                 uint16_t wtx = response->data.asDwords[0] & 0xFFFF;
                 PrintAndLogEx(DEBUG, "Got Waiting Time eXtension request %i ms", wtx);
@@ -1240,5 +1520,5 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
             show_warning = false;
         }
     }
-    return false;
+    return PM3_ETIMEOUT;
 }
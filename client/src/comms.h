@@ -45,8 +45,16 @@ extern "C" {
 #define CMD_BUFFER_SIZE 100
 #endif
 
+// how long the receiver waits for room in a full command buffer before it drops replies
+#ifndef CMD_BUFFER_FULL_TIMEOUT
+#define CMD_BUFFER_FULL_TIMEOUT 500
+#endif
+
 #define COMM_RAW_RECEIVE_LEN (1024)
 
+// how often missing parts of a download are requested again
+#define DOWNLOAD_MAX_RETRIES 3
+
 typedef enum {
     BIG_BUF,
     BIG_BUF_EML,
@@ -58,6 +66,17 @@ typedef enum {
     MCU_MEM,
 } DeviceMemType_t;
 
+// called for every chunk of a download as it arrives, offset is relative to the start of the download.
+// Return PM3_SUCCESS to continue, anything else aborts the download.
+typedef int (*download_chunk_cb_t)(const uint8_t *data, uint32_t offset, uint32_t len, void *ctx);
+
+typedef struct {
+    uint32_t bytes;         // bytes received
+    uint32_t chunks;        // chunks received
+    uint32_t rerequests;    // missing ranges requested again
+    uint64_t ms;            // duration of the whole transfer
+} download_stats_t;
+
 typedef enum {
     PM3_TCPv4,
     PM3_TCPv6,
@@ -86,6 +105,17 @@ typedef struct {
 
 extern communication_arg_t g_conn;
 
+// statistics of the receive buffer between the communication thread and command handlers
+typedef struct {
+    uint64_t stored;        // replies stored for command handlers
+    uint64_t consumed;      // replies picked up by command handlers
+    uint64_t dropped;       // replies dropped because the buffer stayed full
+    uint64_t stalls;        // times the communication thread had to wait for room
+    uint32_t max_fill;      // highest number of replies waiting at once
+    uint64_t latency_us;    // summed time between storing and picking up a reply
+    uint64_t max_latency_us;
+} comm_rx_stats_t;
+
 typedef struct pm3_device {
     communication_arg_t *g_conn;
     int script_embedded;
@@ -100,6 +130,7 @@ void SendCommandOLD(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
 void SendCommandNG(uint16_t cmd, uint8_t *data, size_t len);
 void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len);
 void clearCommandBuffer(void);
+void GetCommunicationRxStats(comm_rx_stats_t *stats);
 
 #define FLASHMODE_SPEED 460800
 
@@ -122,6 +153,9 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response);
 
 //bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
+bool GetFromDeviceStream(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen,
+                         PacketResponseNG *response, size_t ms_timeout, bool show_warning,
+                         download_chunk_cb_t callback, void *cb_ctx, download_stats_t *stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,584 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Signal kernels for the graph buffer,  SSE2 / AVX2 / NEON with a scalar fallback
+//
+// The kernels give the very same result as the plain loops they replace:
+//  - the autocovariance products are summed in integers,  int16 samples multiplied into
+//    int32 lanes which are flushed into an int64 total before they can overflow.
+//    The FFT is only trusted after every lag rounded cleanly and was spot checked.
+//  - normalizing divides in doubles,  a quotient below 2^53 truncates to the same integer
+//    as the integer division.
+//-----------------------------------------------------------------------------
+#include "dsp.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "commonutil.h"     // ARRAYLEN
+
+#if defined(DSP_HAS_SIMD_X86)
+#include <immintrin.h>
+#define DSP_TARGET(isa) __attribute__((target(isa)))
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// FFT below this many lags does not pay off
+#define DSP_AUTOCOV_MIN_FFT_LAGS   64
+// largest FFT,  keeps the rounding error of the products well below 0.5
+#define DSP_AUTOCOV_MAX_FFT        (1 << 25)
+#define DSP_AUTOCOV_MAX_ENERGY     (1ULL << 42)
+
+static dsp_isa_t dsp_isa = DSP_ISA_AUTO;
+
+void dsp_set_isa(dsp_isa_t isa) {
+    dsp_isa = isa;
+}
+
+dsp_isa_t dsp_get_isa(void) {
+    if (dsp_isa != DSP_ISA_AUTO) {
+        return dsp_isa;
+    }
+
+#if defined(DSP_HAS_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return DSP_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return DSP_ISA_SSE2;
+    }
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+    return DSP_ISA_NEON;
+#endif
+    return DSP_ISA_NONE;
+}
+
+const char *dsp_isa_name(dsp_isa_t isa) {
+    switch (isa) {
+#if defined(DSP_HAS_SIMD_X86)
+        case DSP_ISA_SSE2:
+            return "SSE2";
+        case DSP_ISA_AVX2:
+            return "AVX2";
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+        case DSP_ISA_NEON:
+            return "NEON";
+#endif
+        case DSP_ISA_AUTO:
+            return dsp_isa_name(dsp_get_isa());
+        case DSP_ISA_NONE:
+        default:
+            return "no SIMD";
+    }
+}
+
+//-----------------------------------------------------------------------------
+// dot products of int16 samples,  exact
+//
+// 'block' is the number of steps an int32 lane takes before it is flushed,  each step adds
+// at most two products to a lane
+//-----------------------------------------------------------------------------
+
+static int64_t dot_s16_scalar(const int16_t *a, const int16_t *b, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(DSP_HAS_SIMD_X86)
+DSP_TARGET("sse2")
+static int64_t dot_s16_sse2(const int16_t *a, const int16_t *b, size_t n, size_t block) {
+    int64_t sum = 0;
+    size_t i = 0;
+    while (i + 8 <= n) {
+        size_t steps = MIN(block, (n - i) / 8);
+        __m128i acc = _mm_setzero_si128();
+        for (size_t s = 0; s < steps; s++, i += 8) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        sum += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + dot_s16_scalar(a + i, b + i, n - i);
+}
+
+DSP_TARGET("avx2")
+static int64_t dot_s16_avx2(const int16_t *a, const int16_t *b, size_t n, size_t block) {
+    int64_t sum = 0;
+    size_t i = 0;
+    while (i + 16 <= n) {
+        size_t steps = MIN(block, (n - i) / 16);
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t s = 0; s < steps; s++, i += 16) {
+            __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+        }
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        for (int l = 0; l < 8; l++) {
+            sum += lanes[l];
+        }
+    }
+    return sum + dot_s16_scalar(a + i, b + i, n - i);
+}
+#endif
+
+#if defined(DSP_HAS_SIMD_NEON)
+static int64_t dot_s16_neon(const int16_t *a, const int16_t *b, size_t n, size_t block) {
+    int64_t sum = 0;
+    size_t i = 0;
+    while (i + 8 <= n) {
+        size_t steps = MIN(block, (n - i) / 8);
+        int32x4_t acc = vdupq_n_s32(0);
+        for (size_t s = 0; s < steps; s++, i += 8) {
+            int16x8_t va = vld1q_s16(a + i);
+            int16x8_t vb = vld1q_s16(b + i);
+            acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+            acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+        }
+        int32_t lanes[4];
+        vst1q_s32(lanes, acc);
+        sum += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + dot_s16_scalar(a + i, b + i, n - i);
+}
+#endif
+
+static int64_t dot_s16(dsp_isa_t isa, const int16_t *a, const int16_t *b, size_t n, size_t block) {
+    switch (isa) {
+#if defined(DSP_HAS_SIMD_X86)
+        case DSP_ISA_AVX2:
+            return dot_s16_avx2(a, b, n, block);
+        case DSP_ISA_SSE2:
+            return dot_s16_sse2(a, b, n, block);
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+        case DSP_ISA_NEON:
+            return dot_s16_neon(a, b, n, block);
+#endif
+        case DSP_ISA_AUTO:
+        case DSP_ISA_NONE:
+        default:
+            return dot_s16_scalar(a, b, n);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// radix-2 FFT over split real / imaginary arrays
+//-----------------------------------------------------------------------------
+
+// n points,  twiddles tw_re/tw_im hold exp(-2 pi i k / (n * stride)) at k * stride
+static void fft_radix2(double *re, double *im, size_t n, const double *tw_re, const double *tw_im, size_t stride, bool inverse) {
+
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    double sign = inverse ? -1.0 : 1.0;
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t half = len >> 1;
+        size_t step = (n / len) * stride;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < half; k++) {
+                double wr = tw_re[k * step];
+                double wi = sign * tw_im[k * step];
+                size_t p = i + k;
+                size_t q = p + half;
+                double xr = re[q] * wr - im[q] * wi;
+                double xi = re[q] * wi + im[q] * wr;
+                re[q] = re[p] - xr;
+                im[q] = im[p] - xi;
+                re[p] += xr;
+                im[p] += xi;
+            }
+        }
+    }
+}
+
+// Products of every lag through the power spectrum. The n real samples go into an n/2 point
+// complex FFT, even samples real and odd samples imaginary,  and the spectrum is untangled
+// from that. Returns false if a product did not round cleanly to an integer.
+static bool autocov_fft(const int16_t *y, size_t len, size_t lags, int64_t *out) {
+    size_t n = 2;
+    while (n < len + lags) {
+        n <<= 1;
+    }
+    size_t h = n / 2;
+
+    double *re = calloc(h, sizeof(double));
+    double *im = calloc(h, sizeof(double));
+    double *tw_re = calloc(h, sizeof(double));
+    double *tw_im = calloc(h, sizeof(double));
+    if (re == NULL || im == NULL || tw_re == NULL || tw_im == NULL) {
+        free(re);
+        free(im);
+        free(tw_re);
+        free(tw_im);
+        return false;
+    }
+
+    // exp(-2 pi i k / n),  every one computed on its own so the error does not add up
+    for (size_t k = 0; k < h; k++) {
+        double a = -2.0 * M_PI * (double)k / (double)n;
+        tw_re[k] = cos(a);
+        tw_im[k] = sin(a);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (i & 1) {
+            im[i / 2] = y[i];
+        } else {
+            re[i / 2] = y[i];
+        }
+    }
+
+    fft_radix2(re, im, h, tw_re, tw_im, 2, false);
+
+    // X[k] = E[k] + W^k O[k] and X[k + h] = E[k] - W^k O[k],  E and O the spectra of the even
+    // and odd samples. The power |X|^2 of both halves is folded back into an h point spectrum
+    // whose inverse holds the even lags in the real and the odd lags in the imaginary part.
+    for (size_t k = 0; k <= h / 2; k++) {
+        size_t m = (h - k) & (h - 1);
+
+        double p_k[2], p_m[2];
+        for (int pass = 0; pass < 2; pass++) {
+            size_t a = pass ? m : k;
+            size_t b = pass ? k : m;
+            double er = (re[a] + re[b]) / 2;
+            double ei = (im[a] - im[b]) / 2;
+            double or_ = (im[a] + im[b]) / 2;
+            double oi = (re[b] - re[a]) / 2;
+            double wr = tw_re[a], wi = tw_im[a];
+            double tr = or_ * wr - oi * wi;
+            double ti = or_ * wi + oi * wr;
+            double lo = (er + tr) * (er + tr) + (ei + ti) * (ei + ti);
+            double hi = (er - tr) * (er - tr) + (ei - ti) * (ei - ti);
+            // Z[a] = ((P[a] + P[a + h]) + i W^-a (P[a] - P[a + h])) / 2
+            double s = (lo + hi) / 2;
+            double d = (lo - hi) / 2;
+            if (pass) {
+                p_m[0] = s + d * wi;
+                p_m[1] = d * wr;
+            } else {
+                p_k[0] = s + d * wi;
+                p_k[1] = d * wr;
+            }
+        }
+        re[k] = p_k[0];
+        im[k] = p_k[1];
+        re[m] = p_m[0];
+        im[m] = p_m[1];
+    }
+
+    fft_radix2(re, im, h, tw_re, tw_im, 2, true);
+
+    bool ok = true;
+    for (size_t i = 0; i < lags; i++) {
+        double v = ((i & 1) ? im[i / 2] : re[i / 2]) / (double)h;
+        double r = nearbyint(v);
+        if (fabs(v - r) > 0.25) {
+            ok = false;
+            break;
+        }
+        out[i] = (int64_t)r;
+    }
+
+    free(re);
+    free(im);
+    free(tw_re);
+    free(tw_im);
+    return ok;
+}
+
+bool dsp_autocov(const int32_t *in, size_t len, size_t lags, int32_t offset, dsp_autocov_method_t method, int64_t *out) {
+    lags = MIN(lags, len);
+    if (lags == 0) {
+        return true;
+    }
+
+    int16_t *y = calloc(len, sizeof(int16_t));
+    if (y == NULL) {
+        return false;
+    }
+
+    uint32_t ymax = 0;
+    uint64_t energy = 0;
+    for (size_t i = 0; i < len; i++) {
+        int64_t v = (int64_t)in[i] - offset;
+        if (v < -INT16_MAX || v > INT16_MAX) {
+            free(y);
+            return false;
+        }
+        y[i] = v;
+        uint32_t a = (v < 0) ? -v : v;
+        ymax = MAX(ymax, a);
+        energy += (uint64_t)(a * a);
+    }
+
+    size_t n = 2;
+    while (n < len + lags) {
+        n <<= 1;
+    }
+
+    if (method == DSP_AUTOCOV_AUTO) {
+        // a dot product per lag against two FFTs of n points,  roughly
+        double direct = (double)lags * (double)(len - lags / 2) / 8;
+        double fft = (double)n * log2((double)n) * 2;
+        method = (lags >= DSP_AUTOCOV_MIN_FFT_LAGS && fft < direct) ? DSP_AUTOCOV_FFT : DSP_AUTOCOV_DIRECT;
+    }
+
+    dsp_isa_t isa = dsp_get_isa();
+
+    // two products per lane and step,  at most 2 * 32767^2 which still fits a lane
+    size_t block = (ymax == 0) ? SIZE_MAX : INT32_MAX / (2 * (uint64_t)ymax * ymax);
+
+    if (method == DSP_AUTOCOV_FFT && n <= DSP_AUTOCOV_MAX_FFT && energy <= DSP_AUTOCOV_MAX_ENERGY) {
+        if (autocov_fft(y, len, lags, out)) {
+            // spot check the first, the last and one lag in between
+            size_t check[] = {0, lags / 2, lags - 1};
+            bool ok = true;
+            for (size_t c = 0; c < ARRAYLEN(check); c++) {
+                size_t i = check[c];
+                ok &= (out[i] == dot_s16(isa, y, y + i, len - i, block));
+            }
+            if (ok) {
+                free(y);
+                return true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < lags; i++) {
+        out[i] = dot_s16(isa, y, y + i, len - i, block);
+    }
+    free(y);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// min / max
+//-----------------------------------------------------------------------------
+
+static void minmax_scalar(const int32_t *in, size_t len, int32_t *min, int32_t *max) {
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] > *max) *max = in[i];
+        if (in[i] < *min) *min = in[i];
+    }
+}
+
+#if defined(DSP_HAS_SIMD_X86)
+DSP_TARGET("sse2")
+static size_t minmax_sse2(const int32_t *in, size_t len, int32_t *min, int32_t *max) {
+    __m128i vmin = _mm_set1_epi32(*min);
+    __m128i vmax = _mm_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        // no pminsd / pmaxsd before SSE4.1,  select through a compare mask
+        __m128i lt = _mm_cmplt_epi32(v, vmin);
+        vmin = _mm_or_si128(_mm_and_si128(lt, v), _mm_andnot_si128(lt, vmin));
+        __m128i gt = _mm_cmpgt_epi32(v, vmax);
+        vmax = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, vmax));
+    }
+    int32_t lmin[4], lmax[4];
+    _mm_storeu_si128((__m128i *)lmin, vmin);
+    _mm_storeu_si128((__m128i *)lmax, vmax);
+    minmax_scalar(lmin, 4, min, max);
+    minmax_scalar(lmax, 4, min, max);
+    return i;
+}
+
+DSP_TARGET("avx2")
+static size_t minmax_avx2(const int32_t *in, size_t len, int32_t *min, int32_t *max) {
+    __m256i vmin = _mm256_set1_epi32(*min);
+    __m256i vmax = _mm256_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        vmin = _mm256_min_epi32(vmin, v);
+        vmax = _mm256_max_epi32(vmax, v);
+    }
+    int32_t lmin[8], lmax[8];
+    _mm256_storeu_si256((__m256i *)lmin, vmin);
+    _mm256_storeu_si256((__m256i *)lmax, vmax);
+    minmax_scalar(lmin, 8, min, max);
+    minmax_scalar(lmax, 8, min, max);
+    return i;
+}
+#endif
+
+#if defined(DSP_HAS_SIMD_NEON)
+static size_t minmax_neon(const int32_t *in, size_t len, int32_t *min, int32_t *max) {
+    int32x4_t vmin = vdupq_n_s32(*min);
+    int32x4_t vmax = vdupq_n_s32(*max);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        int32x4_t v = vld1q_s32(in + i);
+        vmin = vminq_s32(vmin, v);
+        vmax = vmaxq_s32(vmax, v);
+    }
+    int32_t lmin[4], lmax[4];
+    vst1q_s32(lmin, vmin);
+    vst1q_s32(lmax, vmax);
+    minmax_scalar(lmin, 4, min, max);
+    minmax_scalar(lmax, 4, min, max);
+    return i;
+}
+#endif
+
+void dsp_minmax(const int32_t *in, size_t len, int32_t *min, int32_t *max) {
+    *min = INT32_MAX;
+    *max = INT32_MIN;
+
+    size_t i = 0;
+    switch (dsp_get_isa()) {
+#if defined(DSP_HAS_SIMD_X86)
+        case DSP_ISA_AVX2:
+            i = minmax_avx2(in, len, min, max);
+            break;
+        case DSP_ISA_SSE2:
+            i = minmax_sse2(in, len, min, max);
+            break;
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+        case DSP_ISA_NEON:
+            i = minmax_neon(in, len, min, max);
+            break;
+#endif
+        case DSP_ISA_AUTO:
+        case DSP_ISA_NONE:
+        default:
+            break;
+    }
+    minmax_scalar(in + i, len - i, min, max);
+}
+
+//-----------------------------------------------------------------------------
+// normalize
+//-----------------------------------------------------------------------------
+
+static void normalize_scalar(int32_t *data, size_t len, int32_t mid, int32_t range) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = ((int64_t)(data[i] - mid) * 256) / range;
+    }
+}
+
+#if defined(DSP_HAS_SIMD_X86)
+DSP_TARGET("sse2")
+static size_t normalize_sse2(int32_t *data, size_t len, int32_t mid, int32_t range) {
+    __m128i vmid = _mm_set1_epi32(mid);
+    __m128d scale = _mm_set1_pd(256.0);
+    __m128d vrange = _mm_set1_pd(range);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i d = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(data + i)), vmid);
+        __m128d lo = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(d), scale), vrange);
+        __m128d hi = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(d, 0xEE)), scale), vrange);
+        __m128i r = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+        _mm_storeu_si128((__m128i *)(data + i), r);
+    }
+    return i;
+}
+
+DSP_TARGET("avx2")
+static size_t normalize_avx2(int32_t *data, size_t len, int32_t mid, int32_t range) {
+    __m128i vmid = _mm_set1_epi32(mid);
+    __m256d scale = _mm256_set1_pd(256.0);
+    __m256d vrange = _mm256_set1_pd(range);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i d = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(data + i)), vmid);
+        __m256d q = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(d), scale), vrange);
+        _mm_storeu_si128((__m128i *)(data + i), _mm256_cvttpd_epi32(q));
+    }
+    return i;
+}
+#endif
+
+#if defined(__aarch64__)
+static size_t normalize_neon(int32_t *data, size_t len, int32_t mid, int32_t range) {
+    int32x2_t vmid = vdup_n_s32(mid);
+    float64x2_t scale = vdupq_n_f64(256.0);
+    float64x2_t vrange = vdupq_n_f64(range);
+    size_t i = 0;
+    for (; i + 2 <= len; i += 2) {
+        int32x2_t d = vsub_s32(vld1_s32(data + i), vmid);
+        float64x2_t q = vdivq_f64(vmulq_f64(vcvtq_f64_s64(vmovl_s32(d)), scale), vrange);
+        vst1_s32(data + i, vmovn_s64(vcvtq_s64_f64(q)));
+    }
+    return i;
+}
+#endif
+
+void dsp_normalize(int32_t *data, size_t len, int32_t mid, int32_t range) {
+    int32_t min, max;
+    dsp_minmax(data, len, &min, &max);
+
+    // the vector paths need data - mid and the result to fit 32 bits
+    int64_t dmax = MAX((int64_t)max - mid, (int64_t)mid - min);
+    size_t i = 0;
+    if (len && dmax <= INT32_MAX && dmax * 256 / range <= INT32_MAX) {
+        switch (dsp_get_isa()) {
+#if defined(DSP_HAS_SIMD_X86)
+            case DSP_ISA_AVX2:
+                i = normalize_avx2(data, len, mid, range);
+                break;
+            case DSP_ISA_SSE2:
+                i = normalize_sse2(data, len, mid, range);
+                break;
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+            case DSP_ISA_NEON:
+#if defined(__aarch64__)
+                // no doubles in ARMv7 NEON
+                i = normalize_neon(data, len, mid, range);
+#endif
+                break;
+#endif
+            case DSP_ISA_AUTO:
+            case DSP_ISA_NONE:
+            default:
+                break;
+        }
+    }
+    normalize_scalar(data + i, len - i, mid, range);
+}
@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Signal kernels for the graph buffer,  SSE2 / AVX2 / NEON with a scalar fallback
+//-----------------------------------------------------------------------------
+
+#ifndef DSP_H__
+#define DSP_H__
+
+#include "common.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#define DSP_HAS_SIMD_X86
+#endif
+
+// ARM64 mandates NEON,  on ARMv7 only when the compiler targets it
+#if defined(__arm64__) || defined(__aarch64__) || defined(__ARM_NEON)
+#define DSP_HAS_SIMD_NEON
+#endif
+
+typedef enum {
+    DSP_ISA_AUTO,
+    DSP_ISA_NONE,
+#if defined(DSP_HAS_SIMD_X86)
+    DSP_ISA_SSE2,
+    DSP_ISA_AVX2,
+#endif
+#if defined(DSP_HAS_SIMD_NEON)
+    DSP_ISA_NEON,
+#endif
+} dsp_isa_t;
+
+typedef enum {
+    DSP_AUTOCOV_AUTO,
+    DSP_AUTOCOV_DIRECT,     // one dot product per lag, O(len * lags)
+    DSP_AUTOCOV_FFT,        // power spectrum, O(len log len)
+} dsp_autocov_method_t;
+
+// force an instruction set,  DSP_ISA_AUTO picks the best one the cpu supports
+void dsp_set_isa(dsp_isa_t isa);
+dsp_isa_t dsp_get_isa(void);
+const char *dsp_isa_name(dsp_isa_t isa);
+
+// out[i] = sum over j < len - i of (in[j] - offset) * (in[j + i] - offset),  for every lag i < lags.
+// The sums are exact whatever the method,  so every method and instruction set gives the same
+// result. Returns false if a sample minus offset does not fit in 16 bits or memory runs out.
+bool dsp_autocov(const int32_t *in, size_t len, size_t lags, int32_t offset, dsp_autocov_method_t method, int64_t *out);
+
+// smallest and largest sample,  INT32_MAX / INT32_MIN for len == 0
+void dsp_minmax(const int32_t *in, size_t len, int32_t *min, int32_t *max);
+
+// data[i] = (data[i] - mid) * 256 / range,  rounded towards zero like the integer division.
+// range must be positive
+void dsp_normalize(int32_t *data, size_t len, int32_t mid, int32_t range);
+
+#endif
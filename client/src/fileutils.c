@@ -862,6 +862,143 @@ out:
     return retval;
 }
 
+int loadFilePM3(const char *preferredName, int **pdata, size_t maxdatalen, size_t *datalen) {
+
+    if (pdata == NULL || datalen == NULL) {
+        return PM3_EINVARG;
+    }
+
+    char *path;
+    if (searchFile(&path, TRACES_SUBDIR, preferredName, ".pm3", false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", path);
+        free(path);
+        return PM3_EFILE;
+    }
+    free(path);
+
+    // one sample per line, grow as we go
+    int *data = NULL;
+    size_t cap = 0;
+    *datalen = 0;
+    char line[80];
+    while (*datalen < maxdatalen && fgets(line, sizeof(line), f)) {
+        if (*datalen == cap) {
+            cap = (cap) ? cap * 2 : 40000;
+            int *tmp = realloc(data, cap * sizeof(int));
+            if (tmp == NULL) {
+                PrintAndLogEx(WARNING, "failed to allocate memory");
+                free(data);
+                fclose(f);
+                return PM3_EMALLOC;
+            }
+            data = tmp;
+        }
+        data[(*datalen)++] = atoi(line);
+    }
+
+    fclose(f);
+    *pdata = data;
+    return PM3_SUCCESS;
+}
+
+int loadFileWAVE(const char *preferredName, int **pdata, size_t maxdatalen, size_t *datalen) {
+
+    if (pdata == NULL || datalen == NULL) {
+        return PM3_EINVARG;
+    }
+
+    char *path;
+    if (searchFile(&path, TRACES_SUBDIR, preferredName, ".wav", false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", path);
+        free(path);
+        return PM3_EFILE;
+    }
+
+    int retval = PM3_EFILE;
+    uint8_t hdr[12];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4)) {
+        PrintAndLogEx(FAILED, "error, `" _YELLOW_("%s") "` is not a wave file", path);
+        goto out;
+    }
+
+    uint16_t codec = 0, bits = 0, block_align = 0;
+
+    // walk the chunks,  "fmt " must come before "data"
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk)) {
+        uint32_t size = MemLeToUint4byte(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), f) != sizeof(fmt)) {
+                break;
+            }
+            codec = MemLeToUint2byte(fmt);
+            block_align = MemLeToUint2byte(fmt + 12);
+            bits = MemLeToUint2byte(fmt + 14);
+            size -= sizeof(fmt);
+
+        } else if (memcmp(chunk, "data", 4) == 0) {
+
+            if (codec != 1 || (bits != 8 && bits != 16) || block_align < bits / 8) {
+                PrintAndLogEx(FAILED, "error, `" _YELLOW_("%s") "` unsupported wave format, codec %u, %u bits", path, codec, bits);
+                goto out;
+            }
+
+            size_t n = size / block_align;
+            if (n > maxdatalen) {
+                n = maxdatalen;
+            }
+
+            int *data = calloc(n, sizeof(int));
+            if (data == NULL) {
+                PrintAndLogEx(WARNING, "failed to allocate memory");
+                retval = PM3_EMALLOC;
+                goto out;
+            }
+
+            uint8_t sample[block_align];
+            *datalen = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (fread(sample, 1, block_align, f) != block_align) {
+                    break;
+                }
+                // 8 bit samples are unsigned, 16 bit signed. Scale both to the graph range
+                if (bits == 8) {
+                    data[(*datalen)++] = sample[0] - 128;
+                } else {
+                    data[(*datalen)++] = (int16_t)MemLeToUint2byte(sample) / 256;
+                }
+            }
+            *pdata = data;
+            retval = PM3_SUCCESS;
+            goto out;
+        }
+
+        // chunks are word aligned
+        if (fseek(f, size + (size & 1), SEEK_CUR) != 0) {
+            break;
+        }
+    }
+
+    PrintAndLogEx(FAILED, "error, no samples found in `" _YELLOW_("%s") "`", path);
+
+out:
+    free(path);
+    fclose(f);
+    return retval;
+}
+
 // key file dump
 int createMfcKeyDump(const char *preferredName, uint8_t sectorsCnt, const sector_t *e_sector) {
 
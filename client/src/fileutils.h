@@ -163,6 +163,30 @@ int saveFileWAVE(const char *preferredName, const int *data, size_t datalen);
  */
 int saveFilePM3(const char *preferredName, int *data, size_t datalen);
 
+/**
+ * @brief Utility function to load samples from a PM3 signal trace file, one sample per line.
+ *
+ * @param preferredName
+ * @param pdata A pointer to a pointer (for referencing the loaded samples, allocated, caller frees)
+ * @param maxdatalen the max number of samples that can be loaded
+ * @param datalen the number of samples loaded
+ * @return PM3_SUCCESS for ok
+ */
+int loadFilePM3(const char *preferredName, int **pdata, size_t maxdatalen, size_t *datalen);
+
+/**
+ * @brief Utility function to load samples from a WAVE file. 8 bit and 16 bit PCM are supported,
+ * only the first channel is used.
+ *
+ * @param preferredName
+ * @param pdata A pointer to a pointer (for referencing the loaded samples, allocated, caller frees).
+ *              The samples are centered around zero like the graph buffer
+ * @param maxdatalen the max number of samples that can be loaded
+ * @param datalen the number of samples loaded
+ * @return PM3_SUCCESS for ok
+ */
+int loadFileWAVE(const char *preferredName, int **pdata, size_t maxdatalen, size_t *datalen);
+
 /**
  * @brief Utility function to save a keydump into a binary file.
  *
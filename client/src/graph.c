@@ -18,6 +18,9 @@
 #include "graph.h"
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include "ui.h"
 #include "proxgui.h"
 #include "util.h"           // param_get32ex
@@ -26,16 +29,196 @@
 #include "commonutil.h"     // Uint4bytetomemle
 
 
-int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
-int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+// first heap allocation of a graph buffer, it doubles from there
+#define GRAPH_BUFFER_MIN_LEN (40000 * 8)
+
+static uint8_t gs_demod_buffer[MAX_DEMOD_BUF_LEN];
+
+// the default context keeps its signal properties in lfdemod.c,  see lfdemod_ctx_select()
+// its graph is allocated on first use,  sessions without LF samples never pay for it
+static lfdemod_ctx_t gs_lfdemod_default = {
+    .graph = NULL,
+    .own_graph = true,
+    .demod = gs_demod_buffer,
+};
+__thread lfdemod_ctx_t *g_lfdemod_ctx = &gs_lfdemod_default;
+
+int32_t *g_OperationBuffer = NULL;
+int32_t *g_OverlayBuffer = NULL;
+static size_t gs_operation_cap = 0, gs_overlay_cap = 0;
+static bool gs_operation_mapped = false, gs_overlay_mapped = false;
 bool    g_useOverlays = false;
-size_t  g_GraphTraceLen;
 buffer_savestate_t g_saveState_gb;
 marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 marker_t *g_TempMarkers;
 uint8_t g_TempMarkerSize = 0;
 
+// Graph buffers on 64 bit posix systems are one anonymous mapping of MAX_GRAPH_TRACE_LEN samples.
+// Only the pages samples get written to are backed by memory and the buffer never moves,  the plot
+// window can keep drawing from it while the graph grows. Everywhere else, or when the mapping
+// fails, a buffer the plot window draws from (stable) is allocated at its full size at once,  like
+// the static arrays it replaces. Other buffers grow on the heap by doubling.
+static bool graph_storage_grow(int32_t **buf, size_t *cap, bool *mapped, size_t len, bool stable) {
+    if (len <= *cap) {
+        return true;
+    }
+
+    if (len > MAX_GRAPH_TRACE_LEN) {
+        return false;
+    }
+
+#ifndef _WIN32
+    if (*buf == NULL && sizeof(void *) >= 8) {
+        void *map = mmap(NULL, MAX_GRAPH_TRACE_LEN * sizeof(int32_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (map != MAP_FAILED) {
+            *buf = map;
+            *cap = MAX_GRAPH_TRACE_LEN;
+            *mapped = true;
+            return true;
+        }
+    }
+#endif
+
+    if (stable) {
+        if (*buf) {
+            return false;
+        }
+        *buf = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int32_t));
+        if (*buf == NULL) {
+            return false;
+        }
+        *cap = MAX_GRAPH_TRACE_LEN;
+        return true;
+    }
+
+    size_t n = (*cap) ? *cap : GRAPH_BUFFER_MIN_LEN;
+    while (n < len) {
+        n *= 2;
+    }
+    if (n > MAX_GRAPH_TRACE_LEN) {
+        n = MAX_GRAPH_TRACE_LEN;
+    }
+
+    int32_t *tmp = realloc(*buf, n * sizeof(int32_t));
+    if (tmp == NULL) {
+        return false;
+    }
+
+    // like fresh pages of the mapping, samples past the end read as zero
+    memset(tmp + *cap, 0x00, (n - *cap) * sizeof(int32_t));
+    *buf = tmp;
+    *cap = n;
+    return true;
+}
+
+static void graph_storage_free(int32_t *buf, size_t cap, bool mapped) {
+    if (buf == NULL) {
+        return;
+    }
+#ifndef _WIN32
+    if (mapped) {
+        munmap(buf, cap * sizeof(int32_t));
+        return;
+    }
+#else
+    (void)cap;
+    (void)mapped;
+#endif
+    free(buf);
+}
+
+bool reserveGraphBuffer(size_t len) {
+    lfdemod_ctx_t *ctx = g_lfdemod_ctx;
+
+    if (len <= ctx->graph_cap) {
+        return true;
+    }
+
+    // contexts working on borrowed samples can't grow them
+    if (ctx->own_graph == false || len > MAX_GRAPH_TRACE_LEN) {
+        PrintAndLogEx(DEBUG, "WARNING: graph buffer can't hold %zu samples", len);
+        return false;
+    }
+
+    // the operation and overlay buffers follow the graph shown in the plot window,
+    // which may be drawing them from its own thread,  so they must not move
+    bool plotted = (ctx == &gs_lfdemod_default);
+    bool ok = true;
+    if (plotted) {
+        ok = graph_storage_grow(&g_OperationBuffer, &gs_operation_cap, &gs_operation_mapped, len, true)
+             && graph_storage_grow(&g_OverlayBuffer, &gs_overlay_cap, &gs_overlay_mapped, len, true);
+    }
+
+    if (ok == false || graph_storage_grow(&ctx->graph, &ctx->graph_cap, &ctx->graph_mapped, len, plotted) == false) {
+        PrintAndLogEx(WARNING, "failed to allocate memory for %zu samples", len);
+        return false;
+    }
+    return true;
+}
+
+lfdemod_ctx_t *lfdemod_ctx_create(int32_t *samples, size_t len) {
+    lfdemod_ctx_t *ctx = calloc(1, sizeof(lfdemod_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    if (samples == NULL) {
+        // allocated by reserveGraphBuffer()
+        ctx->own_graph = true;
+        len = 0;
+    } else {
+        ctx->graph = samples;
+        ctx->graph_cap = len;
+    }
+
+    ctx->demod = calloc(MAX_DEMOD_BUF_LEN, sizeof(uint8_t));
+    if (ctx->demod == NULL) {
+        lfdemod_ctx_free(ctx);
+        return NULL;
+    }
+
+    ctx->graph_len = (len > MAX_GRAPH_TRACE_LEN) ? MAX_GRAPH_TRACE_LEN : len;
+    ctx->signal = *getSignalProperties();
+    return ctx;
+}
+
+void lfdemod_ctx_free(lfdemod_ctx_t *ctx) {
+    if (ctx == NULL || ctx == &gs_lfdemod_default) {
+        return;
+    }
+
+    if (g_lfdemod_ctx == ctx) {
+        lfdemod_ctx_select(NULL);
+    }
+
+    if (ctx->own_graph) {
+        graph_storage_free(ctx->graph, ctx->graph_cap, ctx->graph_mapped);
+    }
+    free(ctx->demod);
+    free(ctx);
+}
+
+lfdemod_ctx_t *lfdemod_ctx_select(lfdemod_ctx_t *ctx) {
+    lfdemod_ctx_t *prev = g_lfdemod_ctx;
+
+    if (ctx == NULL || ctx == &gs_lfdemod_default) {
+        g_lfdemod_ctx = &gs_lfdemod_default;
+        selectSignalProperties(NULL);
+    } else {
+        g_lfdemod_ctx = ctx;
+        selectSignalProperties(&ctx->signal);
+    }
+    return prev;
+}
+
+bool lfdemod_ctx_plotted(void) {
+    return (g_lfdemod_ctx == &gs_lfdemod_default);
+}
+
 /* write a manchester bit to the graph
 */
 void AppendGraph(bool redraw, uint16_t clock, int bit) {
@@ -43,18 +226,21 @@ void AppendGraph(bool redraw, uint16_t clock, int bit) {
     uint16_t end = clock;
     uint16_t i;
 
+    reserveGraphBuffer(g_GraphTraceLen + clock);
+    size_t room = g_lfdemod_ctx->graph_cap - g_GraphTraceLen;
+
     // overflow/underflow safe checks ... Assumptions:
     //     _Assert(g_GraphTraceLen >= 0);
-    //     _Assert(g_GraphTraceLen <= MAX_GRAPH_TRACE_LEN);
+    //     _Assert(g_GraphTraceLen <= graph_cap);
     // If this occurs, allow partial rendering, up to the last sample...
-    if ((MAX_GRAPH_TRACE_LEN - g_GraphTraceLen) < half) {
+    if (room < half) {
         PrintAndLogEx(DEBUG, "WARNING: AppendGraph() - Request exceeds max graph length");
-        end = MAX_GRAPH_TRACE_LEN - g_GraphTraceLen;
+        end = room;
         half = end;
     }
-    if ((MAX_GRAPH_TRACE_LEN - g_GraphTraceLen) < end) {
+    if (room < end) {
         PrintAndLogEx(DEBUG, "WARNING: AppendGraph() - Request exceeds max graph length");
-        end = MAX_GRAPH_TRACE_LEN - g_GraphTraceLen;
+        end = room;
     }
 
     //set first half the clock bit (all 1's or 0's for a 0 or 1 bit)
@@ -72,18 +258,41 @@ void AppendGraph(bool redraw, uint16_t clock, int bit) {
     }
 }
 
+static void resetPlot(size_t gtl);
+
 // clear out our graph window and all the buffers associated with it
 size_t ClearGraph(bool redraw) {
     size_t gtl = g_GraphTraceLen;
 
-    memset(g_GraphBuffer, 0x00, g_GraphTraceLen);
-    memset(g_OperationBuffer, 0x00, g_GraphTraceLen);
-    memset(g_OverlayBuffer, 0x00, g_GraphTraceLen);
-
+    if (g_GraphBuffer) {
+        memset(g_GraphBuffer, 0x00, g_GraphTraceLen);
+    }
     g_GraphTraceLen = 0;
+    g_DemodBufferLen = 0;
+
+    // the plot window only shows the default context
+    if (lfdemod_ctx_plotted() == false) {
+        return gtl;
+    }
+
+    resetPlot(gtl);
+
+    if (redraw) {
+        RepaintGraphWindow();
+    }
+
+    return gtl;
+}
+
+// back to a fresh plot,  gtl is the number of samples the plot showed
+static void resetPlot(size_t gtl) {
+    if (g_OperationBuffer && g_OverlayBuffer) {
+        memset(g_OperationBuffer, 0x00, gtl);
+        memset(g_OverlayBuffer, 0x00, gtl);
+    }
+
     g_GraphStart = 0;
     g_GraphStop = 0;
-    g_DemodBufferLen = 0;
     g_useOverlays = false;
 
     remove_temporary_markers();
@@ -91,12 +300,6 @@ size_t ClearGraph(bool redraw) {
     g_MarkerB.pos = 0;
     g_MarkerC.pos = 0;
     g_MarkerD.pos = 0;
-
-    if (redraw) {
-        RepaintGraphWindow();
-    }
-
-    return gtl;
 }
 
 void setGraphBuffer(const uint8_t *src, size_t size) {
@@ -106,17 +309,24 @@ void setGraphBuffer(const uint8_t *src, size_t size) {
 
     ClearGraph(false);
 
-    if (size > MAX_GRAPH_TRACE_LEN) {
-        size = MAX_GRAPH_TRACE_LEN;
+    if (reserveGraphBuffer(size) == false) {
+        size = g_lfdemod_ctx->graph_cap;
     }
 
     for (size_t i = 0; i < size; ++i) {
         g_GraphBuffer[i] = src[i] - 128;
+    }
+    g_GraphTraceLen = size;
+
+    if (lfdemod_ctx_plotted() == false) {
+        return;
+    }
+
+    for (size_t i = 0; i < size; ++i) {
         g_OperationBuffer[i] = src[i] - 128;
     }
 
     remove_temporary_markers();
-    g_GraphTraceLen = size;
     RepaintGraphWindow();
 }
 
@@ -135,22 +345,93 @@ size_t getFromGraphBufferEx(uint8_t *dest, size_t maxLen) {
         return 0;
     }
 
+    // the byte stores below may alias the context pointer,  keep it out of the loop
+    int32_t *graph = g_GraphBuffer;
+
     size_t i;
     maxLen = (maxLen < g_GraphTraceLen) ? maxLen : g_GraphTraceLen;
     for (i = 0; i < maxLen; ++i) {
         //trim
-        if (g_GraphBuffer[i] > 127) {
-            g_GraphBuffer[i] = 127;
+        if (graph[i] > 127) {
+            graph[i] = 127;
         }
 
-        if (g_GraphBuffer[i] < -127) {
-            g_GraphBuffer[i] = -127;
+        if (graph[i] < -127) {
+            graph[i] = -127;
         }
-        dest[i] = (uint8_t)(g_GraphBuffer[i] + 128);
+        dest[i] = (uint8_t)(graph[i] + 128);
     }
     return i;
 }
 
+// Histogram of the samples getFromGraphBuffer() would hand out, the first SIGNAL_IGNORE_FIRST_SAMPLES
+// left out. Clamps the graph the same way.
+static void getGraphHistogram(uint32_t *hist) {
+    memset(hist, 0x00, 256 * sizeof(uint32_t));
+
+    int32_t *graph = g_GraphBuffer;
+    size_t len = g_GraphTraceLen;
+    for (size_t i = 0; i < len; ++i) {
+        if (graph[i] > 127) {
+            graph[i] = 127;
+        }
+
+        if (graph[i] < -127) {
+            graph[i] = -127;
+        }
+
+        if (i >= SIGNAL_IGNORE_FIRST_SAMPLES) {
+            hist[graph[i] + 128]++;
+        }
+    }
+}
+
+// computeSignalProperties() over the graph, without copying the samples out
+void computeGraphSignalProperties(void) {
+    uint32_t hist[256];
+    getGraphHistogram(hist);
+    computeSignalPropertiesHistogram(hist);
+}
+
+// removeSignalOffset() and computeSignalProperties() on the graph in place. The samples, the
+// signal properties and the plot are the same as handing the corrected samples to setGraphBuffer()
+void removeGraphSignalOffset(void) {
+    uint32_t hist[256];
+    getGraphHistogram(hist);
+
+    int32_t *graph = g_GraphBuffer;
+    size_t len = g_GraphTraceLen;
+    int off = (len < SIGNAL_MIN_SAMPLES) ? 0 : getSignalOffsetHistogram(hist);
+
+    // shift and saturate, samples stay within -128..127
+    memset(hist, 0x00, sizeof(hist));
+    for (size_t i = 0; i < len; ++i) {
+        if (off > 0) {
+            graph[i] = (graph[i] + 128 >= off) ? graph[i] - off : -128;
+        }
+        if (off < 0) {
+            graph[i] = (127 - graph[i] >= -off) ? graph[i] - off : 127;
+        }
+
+        if (i >= SIGNAL_IGNORE_FIRST_SAMPLES) {
+            hist[graph[i] + 128]++;
+        }
+    }
+    computeSignalPropertiesHistogram(hist);
+
+    g_DemodBufferLen = 0;
+
+    if (lfdemod_ctx_plotted() == false) {
+        return;
+    }
+
+    resetPlot(len);
+    if (g_OperationBuffer) {
+        memcpy(g_OperationBuffer, graph, len * sizeof(int32_t));
+    }
+    RepaintGraphWindow();
+}
+
 //TODO: In progress function to get chunks of data from the GB w/o modifying the GB
 //Currently seems like it doesn't work correctly?
 size_t getGraphBufferChunk(uint8_t *dest, size_t start, size_t end) {
@@ -166,10 +447,11 @@ size_t getGraphBufferChunk(uint8_t *dest, size_t start, size_t end) {
         return 0;
     }
 
+    const int32_t *graph = g_GraphBuffer;
     size_t i, value;
     end = (end < g_GraphTraceLen) ? end : g_GraphTraceLen;
     for (i = 0; i < (end - start); i++) {
-        value = g_GraphBuffer[start + i];
+        value = graph[start + i];
 
         //Trim the data to fit into an uint8_t
         if (value > 127) {
@@ -251,7 +533,7 @@ int GetAskClock(const char *str, bool verbose) {
 
     // Auto-detect clock
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -288,7 +570,7 @@ int GetPskCarrier(bool verbose) {
         return -1;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -332,7 +614,7 @@ int GetPskClock(const char *str, bool verbose) {
     }
 
     // Auto-detect clock
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -374,7 +656,7 @@ int GetNrzClock(const char *str, bool verbose) {
     }
 
     // Auto-detect clock
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -435,7 +717,7 @@ bool fskClocks(uint8_t *fc1, uint8_t *fc2, uint8_t *rf1, int *firstClockEdge) {
         return false;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return false;
@@ -20,6 +20,7 @@
 #define GRAPH_H__
 
 #include "common.h"
+#include "lfdemod.h"        // signal_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,9 +44,13 @@ void AppendGraph(bool redraw, uint16_t clock, int bit);
 size_t ClearGraph(bool redraw);
 bool HasGraphData(void);
 void setGraphBuffer(const uint8_t *src, size_t size);
+// make room for len samples in the graph of the calling thread's context, the samples are kept
+bool reserveGraphBuffer(size_t len);
 size_t getFromGraphBuffer(uint8_t *dest);
 size_t getFromGraphBufferEx(uint8_t *dest, size_t maxLen);
 size_t getGraphBufferChunk(uint8_t *dest, size_t start, size_t end);
+void computeGraphSignalProperties(void);
+void removeGraphSignalOffset(void);
 void convertGraphFromBitstream(void);
 void convertGraphFromBitstreamEx(int hi, int low);
 bool isGraphBitstream(void);
@@ -67,15 +72,52 @@ size_t restore_buffer32(buffer_savestate_t saveState, uint32_t *dest);
 size_t restore_bufferS32(buffer_savestate_t saveState, int32_t *dest);
 size_t restore_buffer8(buffer_savestate_t saveState, uint8_t *dest);
 
-#define MAX_GRAPH_TRACE_LEN (40000 * 32)
+// upper bound of the graph buffers, about ten minutes of samples at 125 kHz
+#define MAX_GRAPH_TRACE_LEN (40000 * 32 * 64)
 #define GRAPH_SAVE 1
 #define GRAPH_RESTORE 0
 
-extern int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-extern int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
-extern int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
+// Demodulation context.
+// Holds everything the demodulators and lf decoders read and write: the samples, the
+// DemodBuffer with its clock grid and the signal properties of the samples.
+// g_GraphBuffer, g_GraphTraceLen, g_DemodBuffer, g_DemodBufferLen, g_DemodClock and
+// g_DemodStartIdx resolve to the context selected on the calling thread. That is the default
+// context, the one shown in the plot window, unless lfdemod_ctx_select() picked another one.
+// Threads working on their own context can run demods and decoders side by side.
+typedef struct {
+    int32_t *graph;
+    size_t graph_len;
+    size_t graph_cap;           // samples graph can hold,  see reserveGraphBuffer()
+    bool own_graph;
+    bool graph_mapped;
+    uint8_t *demod;
+    size_t demod_len;
+    int demod_clock;
+    int32_t demod_start_idx;
+    uint32_t demod_generation;  // bumped on every setDemodBuff()
+    signal_t signal;
+} lfdemod_ctx_t;
+
+// New context over 'len' samples. The samples are used in place, not copied,  so they must
+// outlive the context. Contexts sharing samples between threads must not modify them, run
+// getFromGraphBuffer() on the samples once before sharing so the clamping is done.
+// With samples == NULL the context gets its own empty graph,  allocated on first use.
+lfdemod_ctx_t *lfdemod_ctx_create(int32_t *samples, size_t len);
+void lfdemod_ctx_free(lfdemod_ctx_t *ctx);
+// select ctx for the calling thread,  NULL selects the default context. Returns the previous one
+lfdemod_ctx_t *lfdemod_ctx_select(lfdemod_ctx_t *ctx);
+// true if the calling thread works on the default context, the one behind the plot window
+bool lfdemod_ctx_plotted(void);
+
+extern __thread lfdemod_ctx_t *g_lfdemod_ctx;
+
+#define g_GraphBuffer   (g_lfdemod_ctx->graph)
+#define g_GraphTraceLen (g_lfdemod_ctx->graph_len)
+
+// sized along with the graph of the default context
+extern int32_t *g_OperationBuffer;
+extern int32_t *g_OverlayBuffer;
 extern bool    g_useOverlays;
-extern size_t  g_GraphTraceLen;
 
 extern marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 extern marker_t *g_TempMarkers;
@@ -40,6 +40,7 @@
 #include <stdint.h>
 #ifndef ON_DEVICE
 #include "fileutils.h"
+#include "iclass_bs_core.h"
 #endif
 
 
@@ -297,6 +298,42 @@ int testMAC(void) {
         printarr("    Correct_MAC   ", correct_MAC, 4);
         return PM3_ESOFT;
     }
+
+    // bitsliced engine must agree with doMAC, including a partial last batch
+    uint32_t count = ICLASS_BS_BATCH + 3;
+    uint8_t *keys = calloc(count, 8);
+    uint8_t *macs = calloc(count, 4);
+    if (keys == NULL || macs == NULL) {
+        free(keys);
+        free(macs);
+        return PM3_EMALLOC;
+    }
+
+    uint32_t x = 0x12345678;
+    memcpy(keys, div_key, 8);
+    for (uint32_t i = 8; i < count * 8; i++) {
+        x = x * 1103515245 + 12345;
+        keys[i] = x >> 24;
+    }
+
+    iclass_mac_bitsliced(cc_nr, keys, macs, count);
+
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        doMAC(cc_nr, keys + (i * 8), calculated_mac);
+        if (memcmp(calculated_mac, macs + (i * 4), 4) != 0) {
+            errors++;
+        }
+    }
+    free(keys);
+    free(macs);
+
+    if (errors == 0) {
+        PrintAndLogEx(SUCCESS, "    Bitsliced MAC calculation ( %s )", _GREEN_("ok"));
+    } else {
+        PrintAndLogEx(FAILED, "    Bitsliced MAC calculation ( %s ) %u / %u differ", _RED_("fail"), errors, count);
+        return PM3_ESOFT;
+    }
     return PM3_SUCCESS;
 }
 #endif
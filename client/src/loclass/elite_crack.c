@@ -44,6 +44,7 @@
 #include "fileutils.h"
 #include "mbedtls/des.h"
 #include "util_posix.h"
+#include "iclass_bs_core.h"
 
 /**
  * @brief Permutes a key from standard NIST format to Iclass specific format
@@ -172,21 +173,25 @@ static void rk(const uint8_t *key, uint8_t n, uint8_t *outp_key) {
     }
 }
 
-static mbedtls_des_context ctx_enc;
-static mbedtls_des_context ctx_dec;
-
+// DES contexts are kept on the stack, hash2() is called concurrently from worker threads
 static void desdecrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *output) {
     uint8_t key_std_format[8] = {0};
     permutekey_rev(iclass_key, key_std_format);
+    mbedtls_des_context ctx_dec;
+    mbedtls_des_init(&ctx_dec);
     mbedtls_des_setkey_dec(&ctx_dec, key_std_format);
     mbedtls_des_crypt_ecb(&ctx_dec, input, output);
+    mbedtls_des_free(&ctx_dec);
 }
 
 static void desencrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *output) {
     uint8_t key_std_format[8] = {0};
     permutekey_rev(iclass_key, key_std_format);
+    mbedtls_des_context ctx_enc;
+    mbedtls_des_init(&ctx_enc);
     mbedtls_des_setkey_enc(&ctx_enc, key_std_format);
     mbedtls_des_crypt_ecb(&ctx_enc, input, output);
+    mbedtls_des_free(&ctx_enc);
 }
 
 /**
@@ -325,69 +330,80 @@ static void *bf_thread(void *thread_arg) {
     memcpy(bytes_to_recover, targ->bytes_to_recover, sizeof(bytes_to_recover));
     memcpy(keytable, targ->keytable, sizeof(keytable));
 
+    // candidates are diversified one by one, their MACs are calculated a batch at a time
+    uint32_t batch_brute[ICLASS_BS_BATCH];
+    uint8_t div_keys[ICLASS_BS_BATCH * 8];
+    uint8_t macs[ICLASS_BS_BATCH * 4];
+
     while (!(brute & endmask)) {
 
         int found = __atomic_load_n(&loclass_found, __ATOMIC_SEQ_CST);
 
         if (found != 0xFF) return NULL;
 
-        //Update the keytable with the brute-values
-        for (uint8_t i = 0; i < numbytes_to_recover; i++) {
-            keytable[bytes_to_recover[i]] &= 0xFF00;
-            keytable[bytes_to_recover[i]] |= (brute >> (i * 8) & 0xFF);
-        }
+        uint32_t n = 0;
+        for (; n < ICLASS_BS_BATCH && !(brute & endmask); n++, brute += loclass_tc) {
 
-        uint8_t key_sel[8] = {0};
+            //Update the keytable with the brute-values
+            for (uint8_t i = 0; i < numbytes_to_recover; i++) {
+                keytable[bytes_to_recover[i]] &= 0xFF00;
+                keytable[bytes_to_recover[i]] |= (brute >> (i * 8) & 0xFF);
+            }
 
-        // Piece together the key
-        key_sel[0] = keytable[key_index[0]] & 0xFF;
-        key_sel[1] = keytable[key_index[1]] & 0xFF;
-        key_sel[2] = keytable[key_index[2]] & 0xFF;
-        key_sel[3] = keytable[key_index[3]] & 0xFF;
-        key_sel[4] = keytable[key_index[4]] & 0xFF;
-        key_sel[5] = keytable[key_index[5]] & 0xFF;
-        key_sel[6] = keytable[key_index[6]] & 0xFF;
-        key_sel[7] = keytable[key_index[7]] & 0xFF;
+            uint8_t key_sel[8] = {0};
 
-        // Permute from iclass format to standard format
+            // Piece together the key
+            key_sel[0] = keytable[key_index[0]] & 0xFF;
+            key_sel[1] = keytable[key_index[1]] & 0xFF;
+            key_sel[2] = keytable[key_index[2]] & 0xFF;
+            key_sel[3] = keytable[key_index[3]] & 0xFF;
+            key_sel[4] = keytable[key_index[4]] & 0xFF;
+            key_sel[5] = keytable[key_index[5]] & 0xFF;
+            key_sel[6] = keytable[key_index[6]] & 0xFF;
+            key_sel[7] = keytable[key_index[7]] & 0xFF;
 
-        uint8_t key_sel_p[8] = {0};
-        permutekey_rev(key_sel, key_sel_p);
+            // Permute from iclass format to standard format
 
-        // Diversify
-        uint8_t div_key[8] = {0};
-        diversifyKey(csn, key_sel_p, div_key);
+            uint8_t key_sel_p[8] = {0};
+            permutekey_rev(key_sel, key_sel_p);
 
-        // Calc mac
-        uint8_t calculated_MAC[4] = {0};
-        doMAC(cc_nr, div_key, calculated_MAC);
+            // Diversify
+            diversifyKey(csn, key_sel_p, div_keys + (n * 8));
+            batch_brute[n] = brute;
+        }
 
-        // success
-        if (memcmp(calculated_MAC, mac, 4) == 0) {
+        // Calc macs
+        iclass_mac_bitsliced(cc_nr, div_keys, macs, n);
 
-            loclass_thread_ret_t *r = (loclass_thread_ret_t *)calloc(sizeof(loclass_thread_ret_t), sizeof(uint8_t));
+        for (uint32_t b = 0; b < n; b++) {
 
-            for (uint8_t i = 0 ; i < numbytes_to_recover; i++) {
-                r->values[i] = keytable[bytes_to_recover[i]] & 0xFF;
+            // success
+            if (memcmp(macs + (b * 4), mac, 4) == 0) {
+
+                loclass_thread_ret_t *r = (loclass_thread_ret_t *)calloc(sizeof(loclass_thread_ret_t), sizeof(uint8_t));
+
+                for (uint8_t i = 0 ; i < numbytes_to_recover; i++) {
+                    r->values[i] = (batch_brute[b] >> (i * 8)) & 0xFF;
+                }
+                __atomic_store_n(&loclass_found, targ->thread_idx, __ATOMIC_SEQ_CST);
+                pthread_exit((void *)r);
             }
-            __atomic_store_n(&loclass_found, targ->thread_idx, __ATOMIC_SEQ_CST);
-            pthread_exit((void *)r);
-        }
 
-        brute += loclass_tc;
+            uint32_t next = batch_brute[b] + loclass_tc;
 
 #define _CLR_ "\x1b[0K"
 
-        if (numbytes_to_recover == 3) {
-            if ((brute > 0) && ((brute & 0xFFFF) == 0)) {
-                PrintAndLogEx(INPLACE, "[ %02x %02x %02x ] %8u / %u", bytes_to_recover[0], bytes_to_recover[1], bytes_to_recover[2], brute, 0xFFFFFF);
+            if (numbytes_to_recover == 3) {
+                if ((next > 0) && ((next & 0xFFFF) == 0)) {
+                    PrintAndLogEx(INPLACE, "[ %02x %02x %02x ] %8u / %u", bytes_to_recover[0], bytes_to_recover[1], bytes_to_recover[2], next, 0xFFFFFF);
+                }
+            } else if (numbytes_to_recover == 2) {
+                if ((next > 0) && ((next & 0x3F) == 0))
+                    PrintAndLogEx(INPLACE, "[ %02x %02x ] %5u / %u" _CLR_, bytes_to_recover[0], bytes_to_recover[1], next, 0xFFFF);
+            } else {
+                if ((next > 0) && ((next & 0x1F) == 0))
+                    PrintAndLogEx(INPLACE, "[ %02x ] %3u / %u" _CLR_, bytes_to_recover[0], next, 0xFF);
             }
-        } else if (numbytes_to_recover == 2) {
-            if ((brute > 0) && ((brute & 0x3F) == 0))
-                PrintAndLogEx(INPLACE, "[ %02x %02x ] %5u / %u" _CLR_, bytes_to_recover[0], bytes_to_recover[1], brute, 0xFFFF);
-        } else {
-            if ((brute > 0) && ((brute & 0x1F) == 0))
-                PrintAndLogEx(INPLACE, "[ %02x ] %3u / %u" _CLR_, bytes_to_recover[0], brute, 0xFF);
         }
     }
     pthread_exit(NULL);
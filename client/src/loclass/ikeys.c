@@ -68,7 +68,7 @@ From "Dismantling iclass":
 #include "cipherutils.h"
 #include "mbedtls/des.h"
 
-uint8_t pi[35] = {
+static const uint8_t pi[35] = {
     0x0F, 0x17, 0x1B, 0x1D, 0x1E, 0x27, 0x2B, 0x2D,
     0x2E, 0x33, 0x35, 0x39, 0x36, 0x3A, 0x3C, 0x47,
     0x4B, 0x4D, 0x4E, 0x53, 0x55, 0x56, 0x59, 0x5A,
@@ -351,6 +351,7 @@ void diversifyKey(uint8_t *csn, uint8_t *key, uint8_t *div_key) {
 
     // Calculate DES(CSN, KEY)
     mbedtls_des_context ctx_enc;
+    mbedtls_des_init(&ctx_enc);
     mbedtls_des_setkey_enc(&ctx_enc, key);
     mbedtls_des_crypt_ecb(&ctx_enc, csn, crypted_csn);
     mbedtls_des_free(&ctx_enc);
@@ -19,6 +19,7 @@
 #include "mfkey.h"
 
 #include "crapto1/crapto1.h"
+#include "util.h"               // num_CPUs
 
 // MIFARE
 int inline compare_uint64(const void *a, const void *b) {
@@ -96,6 +97,27 @@ uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t
     return i;
 }
 
+// each recovery thread needs ~50 MB of scratch memory
+#define MFKEY32_RECOVERY_MAX_THREADS 8
+
+// recovery scratch memory shared by the mfkey32 variants, which are typically
+// called in a loop over all collected reader authentications.
+// Released with mfkey32_free_recovery() once the attack is done.
+static crypto1_recovery_ctx_t *mfkey32_rctx = NULL;
+
+static struct Crypto1State *mfkey32_recovery(uint32_t ks2) {
+    if (mfkey32_rctx == NULL) {
+        mfkey32_rctx = crypto1_recovery_ctx_create();
+        crypto1_recovery_ctx_set_threads(mfkey32_rctx, MIN(num_CPUs(), MFKEY32_RECOVERY_MAX_THREADS));
+    }
+    return lfsr_recovery32_ctx(mfkey32_rctx, ks2, 0);
+}
+
+void mfkey32_free_recovery(void) {
+    crypto1_recovery_ctx_free(mfkey32_rctx);
+    mfkey32_rctx = NULL;
+}
+
 // recover key from 2 different reader responses on same tag challenge
 bool mfkey32(nonces_t *data, uint64_t *outputkey) {
     struct Crypto1State *s, *t;
@@ -106,7 +128,11 @@ bool mfkey32(nonces_t *data, uint64_t *outputkey) {
 
     uint32_t p640 = prng_successor(data->nonce, 64);
 
-    s = lfsr_recovery32(data->ar ^ p640, 0);
+    s = mfkey32_recovery(data->ar ^ p640);
+    if (s == NULL) {
+        *outputkey = 0;
+        return false;
+    }
 
     for (t = s; t->odd | t->even; ++t) {
         lfsr_rollback_word(t, 0, 0);
@@ -123,7 +149,6 @@ bool mfkey32(nonces_t *data, uint64_t *outputkey) {
     }
     isSuccess = (counter == 1);
     *outputkey = (isSuccess) ? outkey : 0;
-    crypto1_destroy(s);
     return isSuccess;
 }
 
@@ -138,7 +163,11 @@ bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey) {
     uint32_t p640 = prng_successor(data->nonce, 64);
     uint32_t p641 = prng_successor(data->nonce2, 64);
 
-    s = lfsr_recovery32(data->ar ^ p640, 0);
+    s = mfkey32_recovery(data->ar ^ p640);
+    if (s == NULL) {
+        *outputkey = 0;
+        return false;
+    }
 
     for (t = s; t->odd | t->even; ++t) {
         lfsr_rollback_word(t, 0, 0);
@@ -156,7 +185,6 @@ bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey) {
     }
     isSuccess  = (counter == 1);
     *outputkey = (isSuccess) ? outkey : 0;
-    crypto1_destroy(s);
     return isSuccess;
 }
 
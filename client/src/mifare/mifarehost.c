@@ -416,6 +416,37 @@ inline static int Compare16Bits(const void *a, const void *b) {
     return -1;
 }
 
+// recovery scratch memory, kept across nested runs. One per worker thread,
+// each worker spreads its recovery over half of the available cores.
+static crypto1_recovery_ctx_t *nested_rctx[2] = {NULL, NULL};
+
+// Every recovery thread needs ~50 MB of scratch memory. Both workers together
+// use at most an eighth of the physical memory, and at least one thread each.
+static uint32_t nested_recovery_threads(void) {
+    uint64_t threads = MAX(num_CPUs() / 2, 1);
+    uint64_t mem = detect_physical_memory();
+    if (mem) {
+        uint64_t max_threads = mem / 8 / 2 / crypto1_recovery_ctx_thread_mem();
+        threads = MAX(MIN(threads, max_threads), 1);
+    }
+    return (uint32_t)threads;
+}
+
+static crypto1_recovery_ctx_t *get_nested_rctx(uint8_t idx) {
+    if (nested_rctx[idx] == NULL) {
+        nested_rctx[idx] = crypto1_recovery_ctx_create();
+        crypto1_recovery_ctx_set_threads(nested_rctx[idx], nested_recovery_threads());
+    }
+    return nested_rctx[idx];
+}
+
+void mfnested_free_recovery(void) {
+    for (uint8_t i = 0; i < 2; i++) {
+        crypto1_recovery_ctx_free(nested_rctx[i]);
+        nested_rctx[i] = NULL;
+    }
+}
+
 // wrapper function for multi-threaded lfsr_recovery32
 static void
 #ifdef __has_attribute
@@ -426,7 +457,11 @@ __attribute__((force_align_arg_pointer))
 *nested_worker_thread(void *arg) {
     struct Crypto1State *p1;
     StateList_t *statelist = arg;
-    statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+    if (statelist->rctx && lfsr_recovery32_ctx(statelist->rctx, statelist->ks1, statelist->nt_enc ^ statelist->uid)) {
+        statelist->head.slhead = crypto1_recovery_ctx_detach(statelist->rctx);
+    } else {
+        statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+    }
 
     for (p1 = statelist->head.slhead; p1->odd | p1->even; p1++) {};
 
@@ -502,8 +537,10 @@ int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo,
     pthread_t thread_id[2];
 
     // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
+    for (uint8_t i = 0; i < 2; i++) {
+        statelists[i].rctx = get_nested_rctx(i);
         pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
+    }
 
     // wait for threads to terminate:
     for (uint8_t i = 0; i < 2; i++)
@@ -666,8 +703,10 @@ int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBl
     pthread_t thread_id[2];
 
     // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
+    for (uint8_t i = 0; i < 2; i++) {
+        statelists[i].rctx = get_nested_rctx(i);
         pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
+    }
 
     // wait for threads to terminate:
     for (uint8_t i = 0; i < 2; i++)
@@ -735,6 +774,7 @@ int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBl
         pthread_t t;
 
         // create and run worker thread
+        statelists[0].rctx = get_nested_rctx(0);
         pthread_create(&t, NULL, nested_worker_thread, &statelists[0]);
 
         // wait for thread to terminate:
@@ -24,6 +24,7 @@
 
 #include "util.h"       // FILE_PATH_SIZE
 #include "protocol_vigik.h"
+#include "crapto1/crapto1.h"
 
 #define MIFARE_SECTOR_RETRY     10
 
@@ -52,6 +53,7 @@ typedef struct {
     uint32_t keyType;
     uint32_t nt_enc;
     uint32_t ks1;
+    crypto1_recovery_ctx_t *rctx;
 } StateList_t;
 
 typedef struct {
@@ -72,6 +74,8 @@ typedef struct {
 int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key);
 int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate);
 int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey);
+// release the recovery scratch memory that mfnested / mfStaticNested keep between runs
+void mfnested_free_recovery(void);
 int mfCheckKeys(uint8_t blockNo, uint8_t keyType, bool clear_trace, uint8_t keycnt, uint8_t *keyBlock, uint64_t *key);
 int mfCheckKeys_fast(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastChunk,
                      uint8_t strategy, uint32_t size, uint8_t *keyBlock, sector_t *e_sector,
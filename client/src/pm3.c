@@ -19,7 +19,9 @@
 #include "pm3.h"
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "jansson.h"
 #include "proxmark3.h"
 #include "cmdmain.h"
 #include "ui.h"
@@ -66,5 +68,214 @@ const char *pm3_name_get(pm3_device_t *dev) {
 }
 
 pm3_device_t *pm3_get_current_dev(void) {
+    // offline,  scripts still get a handle to run commands with
+    static pm3_device_t offline_device = { .g_conn = &g_conn, .script_embedded = 1 };
+    if (g_session.current_device == NULL) {
+        return &offline_device;
+    }
     return g_session.current_device;
 }
+
+// what one pm3_console_capture() call kept
+typedef struct {
+    json_t *log;
+    json_t *results;
+    char *output;
+    size_t output_len;
+    size_t output_size;
+    char *log_str;
+    char *results_str;
+} pm3_capture_t;
+
+// the capture of the last pm3_console_capture() call,  every call captures into
+// its own so a capture running inside another one doesn't touch the outer one
+static __thread pm3_capture_t *gs_capture = NULL;
+static const pm3_capture_t gs_capture_empty = {0};
+
+static const char *capture_level_name(logLevel_t level) {
+    switch (level) {
+        case NORMAL:
+            return "normal";
+        case SUCCESS:
+            return "success";
+        case INFO:
+            return "info";
+        case FAILED:
+            return "failed";
+        case WARNING:
+            return "warning";
+        case ERR:
+            return "error";
+        case DEBUG:
+            return "debug";
+        case INPLACE:
+            return "inplace";
+        case HINT:
+            return "hint";
+    }
+    return "normal";
+}
+
+static void capture_reset(pm3_capture_t *cap) {
+    json_decref(cap->log);
+    json_decref(cap->results);
+    free(cap->output);
+    free(cap->log_str);
+    free(cap->results_str);
+    memset(cap, 0, sizeof(pm3_capture_t));
+}
+
+static void capture_append(pm3_capture_t *cap, const char *text, size_t len) {
+    if (cap->output_len + len + 1 > cap->output_size) {
+        size_t size = MAX(cap->output_size * 2, cap->output_len + len + 1);
+        size = MAX(size, 4096);
+        char *tmp = realloc(cap->output, size);
+        if (tmp == NULL) {
+            return;
+        }
+        cap->output = tmp;
+        cap->output_size = size;
+    }
+    memcpy(cap->output + cap->output_len, text, len);
+    cap->output_len += len;
+    cap->output[cap->output_len] = '\0';
+}
+
+// text may carry raw card bytes,  which are not UTF-8
+static json_t *capture_string(const char *text, size_t len) {
+    json_t *str = json_stringn(text, len);
+    if (str) {
+        return str;
+    }
+    char *clean = calloc(len + 1, sizeof(char));
+    if (clean == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        clean[i] = ((uint8_t)text[i] < 0x80) ? text[i] : '?';
+    }
+    str = json_stringn(clean, len);
+    free(clean);
+    return str;
+}
+
+static void capture_log_sink(void *arg, logLevel_t level, const char *text) {
+    pm3_capture_t *cap = (pm3_capture_t *)arg;
+
+    // NOLF marks text to be continued on the same line
+    size_t len = strlen(text);
+    bool newline = true;
+    if (len && text[len - 1] == NOLF[0]) {
+        len--;
+        newline = false;
+    }
+
+    json_t *rec = json_object();
+    json_object_set_new(rec, "level", json_string(capture_level_name(level)));
+    json_object_set_new(rec, "text", capture_string(text, len));
+    json_array_append_new(cap->log, rec);
+
+    // progress and spinners only make sense on a terminal
+    if (level == INPLACE) {
+        return;
+    }
+    capture_append(cap, text, len);
+    if (newline) {
+        capture_append(cap, "\n", 1);
+    }
+}
+
+static void capture_result_sink(void *arg, const char *key, resultType_t type, const char *str, int64_t num) {
+    pm3_capture_t *cap = (pm3_capture_t *)arg;
+
+    json_t *value = NULL;
+    switch (type) {
+        case RESULT_STR:
+        case RESULT_HEX:
+            value = capture_string(str, strlen(str));
+            break;
+        case RESULT_INT:
+            value = json_integer(num);
+            break;
+        case RESULT_BOOL:
+            value = json_boolean(num);
+            break;
+    }
+    if (value == NULL) {
+        return;
+    }
+
+    // reported again,  e.g. every tag `lf search -c` finds
+    json_t *prev = json_object_get(cap->results, key);
+    if (prev == NULL) {
+        json_object_set_new(cap->results, key, value);
+    } else if (json_is_array(prev)) {
+        json_array_append_new(prev, value);
+    } else {
+        json_t *arr = json_array();
+        json_array_append(arr, prev);
+        json_array_append_new(arr, value);
+        json_object_set_new(cap->results, key, arr);
+    }
+}
+
+int pm3_console_capture(pm3_device_t *dev, const char *cmd) {
+    // For now, there is no real device context:
+    (void) dev;
+
+    pm3_capture_t *cap = calloc(1, sizeof(pm3_capture_t));
+    if (cap == NULL) {
+        return PM3_EMALLOC;
+    }
+    cap->log = json_array();
+    cap->results = json_object();
+
+    // restored afterwards,  the caller may be capturing itself
+    printAndLogSink_t prev_sink;
+    void *prev_sink_arg;
+    printAndLogResultSink_t prev_result_sink;
+    void *prev_result_sink_arg;
+    PrintAndLogGetSink(&prev_sink, &prev_sink_arg);
+    PrintAndLogGetResultSink(&prev_result_sink, &prev_result_sink_arg);
+
+    PrintAndLogSetSink(capture_log_sink, cap);
+    PrintAndLogSetResultSink(capture_result_sink, cap);
+    int res = CommandReceived(cmd);
+    PrintAndLogSetResultSink(prev_result_sink, prev_result_sink_arg);
+    PrintAndLogSetSink(prev_sink, prev_sink_arg);
+
+    if (gs_capture) {
+        capture_reset(gs_capture);
+        free(gs_capture);
+    }
+    gs_capture = cap;
+    return res;
+}
+
+const char *pm3_output_get(pm3_device_t *dev) {
+    (void) dev;
+    const pm3_capture_t *cap = (gs_capture) ? gs_capture : &gs_capture_empty;
+    return (cap->output) ? cap->output : "";
+}
+
+const char *pm3_log_get(pm3_device_t *dev) {
+    (void) dev;
+    if (gs_capture == NULL || gs_capture->log == NULL) {
+        return "[]";
+    }
+    if (gs_capture->log_str == NULL) {
+        gs_capture->log_str = json_dumps(gs_capture->log, JSON_COMPACT);
+    }
+    return (gs_capture->log_str) ? gs_capture->log_str : "[]";
+}
+
+const char *pm3_results_get(pm3_device_t *dev) {
+    (void) dev;
+    if (gs_capture == NULL || gs_capture->results == NULL) {
+        return "{}";
+    }
+    if (gs_capture->results_str == NULL) {
+        gs_capture->results_str = json_dumps(gs_capture->results, JSON_COMPACT | JSON_PRESERVE_ORDER);
+    }
+    return (gs_capture->results_str) ? gs_capture->results_str : "{}";
+}
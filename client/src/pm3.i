@@ -31,7 +31,11 @@ typedef struct {
             }
         }
         int console(char *cmd);
+        int console_capture(char *cmd);
         char const * const name;
+        char const * const output;
+        char const * const log;
+        char const * const results;
     }
 } pm3;
 //%nodefaultctor device;
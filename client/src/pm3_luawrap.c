@@ -2791,6 +2791,33 @@ fail:
 }
 
 
+static int _wrap_pm3_console_capture(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    char *arg2 = (char *) 0 ;
+    int result;
+
+    SWIG_check_num_args("pm3::console_capture", 2, 2)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::console_capture", 1, "pm3 *");
+    if (!SWIG_lua_isnilstring(L, 2)) SWIG_fail_arg("pm3::console_capture", 2, "char *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_console_capture", 1, SWIGTYPE_p_pm3);
+    }
+
+    arg2 = (char *)lua_tostring(L, 2);
+    result = (int)pm3_console_capture(arg1, arg2);
+    lua_pushnumber(L, (lua_Number) result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
 static int _wrap_pm3_name_get(lua_State *L) {
     int SWIG_arg = 0;
     pm3 *arg1 = (pm3 *) 0 ;
@@ -2815,6 +2842,78 @@ fail:
 }
 
 
+static int _wrap_pm3_output_get(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    char *result = 0 ;
+
+    SWIG_check_num_args("pm3::output", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::output", 1, "pm3 *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_output_get", 1, SWIGTYPE_p_pm3);
+    }
+
+    result = (char *)pm3_output_get(arg1);
+    lua_pushstring(L, (const char *)result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_pm3_log_get(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    char *result = 0 ;
+
+    SWIG_check_num_args("pm3::log", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::log", 1, "pm3 *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_log_get", 1, SWIGTYPE_p_pm3);
+    }
+
+    result = (char *)pm3_log_get(arg1);
+    lua_pushstring(L, (const char *)result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_pm3_results_get(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    char *result = 0 ;
+
+    SWIG_check_num_args("pm3::results", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::results", 1, "pm3 *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_results_get", 1, SWIGTYPE_p_pm3);
+    }
+
+    result = (char *)pm3_results_get(arg1);
+    lua_pushstring(L, (const char *)result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
 static void swig_delete_pm3(void *obj) {
     pm3 *arg1 = (pm3 *) obj;
     delete_pm3(arg1);
@@ -2829,10 +2928,14 @@ static int _proxy__wrap_new_pm3(lua_State *L) {
 }
 static swig_lua_attribute swig_pm3_attributes[] = {
     { "name", _wrap_pm3_name_get, SWIG_Lua_set_immutable },
+    { "output", _wrap_pm3_output_get, SWIG_Lua_set_immutable },
+    { "log", _wrap_pm3_log_get, SWIG_Lua_set_immutable },
+    { "results", _wrap_pm3_results_get, SWIG_Lua_set_immutable },
     {0, 0, 0}
 };
 static swig_lua_method swig_pm3_methods[] = {
     { "console", _wrap_pm3_console},
+    { "console_capture", _wrap_pm3_console_capture},
     {0, 0}
 };
 static swig_lua_method swig_pm3_meta[] = {
@@ -0,0 +1,501 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Headless device emulator,  a stand-in for the firmware on a `socket:` port.
+// It speaks the same frames as armsrc/cmd.c so the client comms path
+// (SendCommandNG, WaitForResponseTimeoutW, GetFromDevice) can be exercised
+// and timed without hardware.
+//-----------------------------------------------------------------------------
+
+#include "pm3emu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pm3_cmd.h"
+#include "usart_defs.h"
+#include "util_posix.h"     // msleep
+
+#if !defined(_WIN32)
+
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "crc16.h"
+#include "ui.h"
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+// how often the emulator thread looks at the stop flag while waiting, in ms
+#define EMU_POLL_MS 50
+
+typedef struct {
+    pm3emu_config_t cfg;
+    char port[64];
+    int listen_fd;
+    int fd;
+    bool stop;
+    uint32_t frame;         // download frames sent, for dbg_every / drop_every
+    pm3emu_stats_t stats;
+} emu_t;
+
+static emu_t *g_emu = NULL;
+static pthread_t emu_thread;
+static pthread_mutex_t emu_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool emu_stopped(emu_t *emu) {
+    return __atomic_load_n(&emu->stop, __ATOMIC_SEQ_CST);
+}
+
+// waits until fd is readable,  false if the emulator is stopped meanwhile
+static bool emu_wait_readable(emu_t *emu, int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (emu_stopped(emu) == false) {
+        int res = poll(&pfd, 1, EMU_POLL_MS);
+        if (res > 0) {
+            return true;
+        }
+        if (res < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static int emu_read(emu_t *emu, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len) {
+        if (emu_wait_readable(emu, emu->fd) == false) {
+            return PM3_EOPABORTED;
+        }
+        ssize_t n = recv(emu->fd, p, len, 0);
+        if (n == 0) {
+            return PM3_ENODATA;     // client went away
+        }
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return PM3_EIO;
+        }
+        p += n;
+        len -= n;
+    }
+    return PM3_SUCCESS;
+}
+
+static int emu_write(emu_t *emu, const void *buf, size_t len) {
+
+    if (emu->cfg.latency_us) {
+        usleep(emu->cfg.latency_us);
+    }
+
+    const uint8_t *p = buf;
+    size_t left = len;
+    while (left) {
+        ssize_t n = send(emu->fd, p, left, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return PM3_EIO;
+        }
+        p += n;
+        left -= n;
+    }
+
+    pthread_mutex_lock(&emu_stats_lock);
+    emu->stats.replies++;
+    emu->stats.bytes += len;
+    pthread_mutex_unlock(&emu_stats_lock);
+    return PM3_SUCCESS;
+}
+
+// mirrors reply_old() in armsrc/cmd.c
+static int emu_reply_old(emu_t *emu, uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    PacketResponseOLD txcmd;
+    memset(&txcmd, 0, sizeof(txcmd));
+    txcmd.cmd = cmd;
+    txcmd.arg[0] = arg0;
+    txcmd.arg[1] = arg1;
+    txcmd.arg[2] = arg2;
+    if (data && len) {
+        memcpy(txcmd.d.asBytes, data, MIN(len, PM3_CMD_DATA_SIZE));
+    }
+    return emu_write(emu, &txcmd, sizeof(txcmd));
+}
+
+// mirrors reply_ng_internal() in armsrc/cmd.c
+static int emu_reply_ng_internal(emu_t *emu, uint16_t cmd, int16_t status, const uint8_t *data, size_t len, bool ng) {
+    PacketResponseNGRaw txBufferNG;
+
+    txBufferNG.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
+    txBufferNG.pre.cmd = cmd;
+    txBufferNG.pre.status = status;
+    txBufferNG.pre.ng = ng;
+    if (len > PM3_CMD_DATA_SIZE) {
+        len = PM3_CMD_DATA_SIZE;
+        txBufferNG.pre.status = PM3_EOVFLOW;
+    }
+    txBufferNG.pre.length = (len & 0x7FFF);
+
+    if (data && len) {
+        memcpy(txBufferNG.data, data, len);
+    }
+
+    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)((uint8_t *)&txBufferNG + sizeof(PacketResponseNGPreamble) + len);
+    if (emu->cfg.crc) {
+        uint8_t first, second;
+        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, sizeof(PacketResponseNGPreamble) + len, &first, &second);
+        tx_post->crc = ((first << 8) | second);
+    } else {
+        tx_post->crc = RESPONSENG_POSTAMBLE_MAGIC;
+    }
+
+    return emu_write(emu, &txBufferNG, sizeof(PacketResponseNGPreamble) + len + sizeof(PacketResponseNGPostamble));
+}
+
+static int emu_reply_ng(emu_t *emu, uint16_t cmd, int16_t status, const uint8_t *data, size_t len) {
+    return emu_reply_ng_internal(emu, cmd, status, data, len, true);
+}
+
+static int emu_reply_mix(emu_t *emu, uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    uint64_t arg[3] = {arg0, arg1, arg2};
+    len = MIN(len, PM3_CMD_DATA_SIZE - sizeof(arg));
+    uint8_t cmddata[PM3_CMD_DATA_SIZE];
+    memcpy(cmddata, arg, sizeof(arg));
+    if (len && data) {
+        memcpy(cmddata + sizeof(arg), data, len);
+    }
+    return emu_reply_ng_internal(emu, (cmd & 0xFFFF), PM3_SUCCESS, cmddata, len + sizeof(arg), false);
+}
+
+// same layout as DbpStringEx() on the device
+static int emu_dbprint(emu_t *emu, const char *s) {
+    struct {
+        uint16_t flag;
+        uint8_t buf[PM3_CMD_DATA_SIZE - sizeof(uint16_t)];
+    } PACKED data;
+    data.flag = FLAG_LOG;
+    size_t len = MIN(strlen(s), sizeof(data.buf));
+    memcpy(data.buf, s, len);
+    return emu_reply_ng(emu, CMD_DEBUG_PRINT_STRING, PM3_SUCCESS, (uint8_t *)&data, sizeof(data.flag) + len);
+}
+
+static int emu_wtx(emu_t *emu) {
+    if (emu->cfg.wtx_ms == 0) {
+        return PM3_SUCCESS;
+    }
+    uint16_t wtx = emu->cfg.wtx_ms;
+    int res = emu_reply_ng(emu, CMD_WTX, PM3_SUCCESS, (uint8_t *)&wtx, sizeof(wtx));
+    msleep(wtx);
+    return res;
+}
+
+static int emu_capabilities(emu_t *emu) {
+    capabilities_t caps;
+    memset(&caps, 0, sizeof(caps));
+    caps.version = CAPABILITIES_VERSION;
+    caps.baudrate = USART_BAUD_RATE;
+    caps.bigbuf_size = emu->cfg.bigbuf_size;
+    caps.via_fpc = false;
+    caps.via_usb = true;
+    return emu_reply_ng(emu, CMD_CAPABILITIES, PM3_SUCCESS, (uint8_t *)&caps, sizeof(caps));
+}
+
+// same frames as CMD_DOWNLOAD_BIGBUF in armsrc/appmain.c
+static int emu_download_bigbuf(emu_t *emu, uint32_t startidx, uint32_t numofbytes) {
+
+    int res = emu_wtx(emu);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    uint8_t chunk[PM3_CMD_DATA_SIZE];
+    for (uint32_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
+        uint32_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+
+        emu->frame++;
+        if (emu->cfg.dbg_every && (emu->frame % emu->cfg.dbg_every) == 0) {
+            char s[64];
+            snprintf(s, sizeof(s), "download frame %u, bytes %u - %u", emu->frame, i, i + len);
+            res = emu_dbprint(emu, s);
+            if (res != PM3_SUCCESS) {
+                return res;
+            }
+        }
+        if (emu->cfg.drop_every && (emu->frame % emu->cfg.drop_every) == 0) {
+            pthread_mutex_lock(&emu_stats_lock);
+            emu->stats.dropped++;
+            pthread_mutex_unlock(&emu_stats_lock);
+            continue;
+        }
+
+        for (uint32_t j = 0; j < len; j++) {
+            chunk[j] = pm3emu_pattern(startidx + i + j);
+        }
+        res = emu_reply_old(emu, CMD_DOWNLOADED_BIGBUF, i, len, 0, chunk, len);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+
+    sample_config config;
+    memset(&config, 0, sizeof(config));
+    return emu_reply_mix(emu, CMD_ACK, 1, 0, 0, &config, sizeof(config));
+}
+
+static int emu_handle(emu_t *emu, const PacketCommandNG *packet) {
+    switch (packet->cmd) {
+        case CMD_PING: {
+            int res = emu_wtx(emu);
+            if (res != PM3_SUCCESS) {
+                return res;
+            }
+            return emu_reply_ng(emu, CMD_PING, PM3_SUCCESS, packet->data.asBytes, packet->length);
+        }
+        case CMD_CAPABILITIES:
+            return emu_capabilities(emu);
+        case CMD_DOWNLOAD_BIGBUF:
+            return emu_download_bigbuf(emu, packet->oldarg[0], packet->oldarg[1]);
+        case CMD_BREAK_LOOP:
+        case CMD_QUIT_SESSION:
+            return PM3_SUCCESS;
+        default: {
+            char s[64];
+            snprintf(s, sizeof(s), "unknown command: 0x%04x", packet->cmd);
+            return emu_dbprint(emu, s);
+        }
+    }
+}
+
+// reads one command frame,  NG, MIX or OLD,  the way receive_ng_internal() in armsrc/cmd.c does
+static int emu_receive(emu_t *emu, PacketCommandNG *rx) {
+
+    PacketCommandNGRaw rx_raw;
+    int res = emu_read(emu, &rx_raw.pre, sizeof(PacketCommandNGPreamble));
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    memset(rx, 0, sizeof(PacketCommandNG));
+    rx->magic = rx_raw.pre.magic;
+    rx->ng = rx_raw.pre.ng;
+
+    if (rx->magic == COMMANDNG_PREAMBLE_MAGIC) {
+        uint16_t length = rx_raw.pre.length;
+        rx->cmd = rx_raw.pre.cmd;
+
+        if (length > PM3_CMD_DATA_SIZE) {
+            return PM3_EOVFLOW;
+        }
+        if (length) {
+            res = emu_read(emu, rx_raw.data, length);
+            if (res != PM3_SUCCESS) {
+                return res;
+            }
+        }
+        res = emu_read(emu, &rx_raw.foopost, sizeof(PacketCommandNGPostamble));
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+
+        rx->crc = rx_raw.foopost.crc;
+        if (rx->crc != COMMANDNG_POSTAMBLE_MAGIC) {
+            uint8_t first, second;
+            compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, sizeof(PacketCommandNGPreamble) + length, &first, &second);
+            if ((first << 8) + second != rx->crc) {
+                return PM3_ECRC;
+            }
+        }
+
+        if (rx->ng) {
+            memcpy(rx->data.asBytes, rx_raw.data, length);
+            rx->length = length;
+        } else {
+            uint64_t arg[3];
+            if (length < sizeof(arg)) {
+                return PM3_EIO;
+            }
+            memcpy(arg, rx_raw.data, sizeof(arg));
+            rx->oldarg[0] = arg[0];
+            rx->oldarg[1] = arg[1];
+            rx->oldarg[2] = arg[2];
+            memcpy(rx->data.asBytes, rx_raw.data + sizeof(arg), length - sizeof(arg));
+            rx->length = length - sizeof(arg);
+        }
+        return PM3_SUCCESS;
+    }
+
+    // OLD frame,  the preamble just read is the start of its 64 bit command
+    PacketCommandOLD rx_old;
+    memcpy(&rx_old, &rx_raw.pre, sizeof(PacketCommandNGPreamble));
+    res = emu_read(emu, ((uint8_t *)&rx_old) + sizeof(PacketCommandNGPreamble), sizeof(PacketCommandOLD) - sizeof(PacketCommandNGPreamble));
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+    rx->ng = false;
+    rx->magic = 0;
+    rx->crc = 0;
+    rx->cmd = rx_old.cmd;
+    rx->oldarg[0] = rx_old.arg[0];
+    rx->oldarg[1] = rx_old.arg[1];
+    rx->oldarg[2] = rx_old.arg[2];
+    rx->length = PM3_CMD_DATA_SIZE;
+    memcpy(rx->data.asBytes, rx_old.d.asBytes, rx->length);
+    return PM3_SUCCESS;
+}
+
+static void *emu_run(void *arg) {
+    emu_t *emu = arg;
+
+    // one client at a time,  once it disconnects the next one can connect
+    while (emu_wait_readable(emu, emu->listen_fd)) {
+
+        emu->fd = accept(emu->listen_fd, NULL, NULL);
+        if (emu->fd == -1) {
+            continue;
+        }
+
+        PacketCommandNG rx;
+        int res;
+        while ((res = emu_receive(emu, &rx)) != PM3_ENODATA && res != PM3_EOPABORTED && res != PM3_EIO) {
+            if (res != PM3_SUCCESS) {
+                // garbage or a bad CRC, the firmware just drops it as well
+                continue;
+            }
+            pthread_mutex_lock(&emu_stats_lock);
+            emu->stats.commands++;
+            pthread_mutex_unlock(&emu_stats_lock);
+
+            if (emu_handle(emu, &rx) == PM3_EIO) {
+                break;
+            }
+        }
+        close(emu->fd);
+        emu->fd = -1;
+    }
+    return NULL;
+}
+
+int pm3emu_start(const pm3emu_config_t *config, char *port, size_t port_len) {
+
+    if (g_emu != NULL) {
+        PrintAndLogEx(WARNING, "Device emulator already running on " _YELLOW_("%s"), g_emu->port);
+        return PM3_EINVARG;
+    }
+
+    emu_t *emu = calloc(1, sizeof(emu_t));
+    if (emu == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+    emu->cfg = *config;
+    emu->fd = -1;
+
+    // abstract namespace, the same naming uart_open() expects after "socket:"
+    char name[48];
+    snprintf(name, sizeof(name), "pm3emu-%d", (int)getpid());
+    snprintf(emu->port, sizeof(emu->port), "socket:%s", name);
+
+    struct sockaddr_un local;
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_LOCAL;
+    local.sun_path[0] = '\0';
+    memcpy(local.sun_path + 1, name, strlen(name));
+    socklen_t len = offsetof(struct sockaddr_un, sun_path) + 1 + strlen(name);
+
+    emu->listen_fd = socket(PF_LOCAL, SOCK_STREAM, 0);
+    if (emu->listen_fd == -1) {
+        PrintAndLogEx(WARNING, "Failed to create device emulator socket, errno %d", errno);
+        free(emu);
+        return PM3_EFAILED;
+    }
+
+    if (bind(emu->listen_fd, (struct sockaddr *)&local, len) == -1 || listen(emu->listen_fd, 1) == -1) {
+        PrintAndLogEx(WARNING, "Failed to listen on " _YELLOW_("%s") ", errno %d", emu->port, errno);
+        close(emu->listen_fd);
+        free(emu);
+        return PM3_EFAILED;
+    }
+
+    if (pthread_create(&emu_thread, NULL, emu_run, emu) != 0) {
+        PrintAndLogEx(WARNING, "Failed to start device emulator thread");
+        close(emu->listen_fd);
+        free(emu);
+        return PM3_EFAILED;
+    }
+
+    g_emu = emu;
+    if (port) {
+        snprintf(port, port_len, "%s", emu->port);
+    }
+    return PM3_SUCCESS;
+}
+
+void pm3emu_stop(void) {
+    if (g_emu == NULL) {
+        return;
+    }
+    __atomic_store_n(&g_emu->stop, true, __ATOMIC_SEQ_CST);
+    pthread_join(emu_thread, NULL);
+    close(g_emu->listen_fd);
+    free(g_emu);
+    g_emu = NULL;
+}
+
+const char *pm3emu_port(void) {
+    return (g_emu) ? g_emu->port : NULL;
+}
+
+void pm3emu_get_stats(pm3emu_stats_t *stats) {
+    memset(stats, 0, sizeof(pm3emu_stats_t));
+    if (g_emu == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&emu_stats_lock);
+    *stats = g_emu->stats;
+    pthread_mutex_unlock(&emu_stats_lock);
+}
+
+#else // _WIN32
+
+// uart_win32.c has no `socket:` ports
+int pm3emu_start(const pm3emu_config_t *config, char *port, size_t port_len) {
+    (void) config;
+    (void) port;
+    (void) port_len;
+    return PM3_ENOTIMPL;
+}
+
+void pm3emu_stop(void) {
+}
+
+const char *pm3emu_port(void) {
+    return NULL;
+}
+
+void pm3emu_get_stats(pm3emu_stats_t *stats) {
+    memset(stats, 0, sizeof(pm3emu_stats_t));
+}
+
+#endif // _WIN32
@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Headless device emulator,  a stand-in for the firmware on a `socket:` port
+//-----------------------------------------------------------------------------
+
+#ifndef PM3EMU_H__
+#define PM3EMU_H__
+
+#include "common.h"
+
+typedef struct {
+    uint32_t bigbuf_size;   // reported in the capabilities
+    uint32_t latency_us;    // delay before every reply frame
+    uint16_t wtx_ms;        // waiting time extension sent, and then waited, before every ping and download reply
+    uint32_t dbg_every;     // debug print every n download frames, 0 = never
+    uint32_t drop_every;    // drop every n-th download frame, 0 = never
+    bool crc;               // CRC on reply frames like over FPC,  else the postamble magic like over USB
+} pm3emu_config_t;
+
+typedef struct {
+    uint64_t commands;      // command frames received
+    uint64_t replies;       // reply frames sent
+    uint64_t dropped;       // download frames dropped on purpose
+    uint64_t bytes;         // bytes sent
+} pm3emu_stats_t;
+
+// The emulator answers
+//   CMD_PING              echo of the payload
+//   CMD_CAPABILITIES      a device without any optional feature compiled in
+//   CMD_DOWNLOAD_BIGBUF   OLD frames filled with pm3emu_pattern(), then the CMD_ACK end marker
+//   CMD_BREAK_LOOP, CMD_QUIT_SESSION   nothing
+// and anything else with an "unknown command" debug print, like the firmware does.
+
+// starts listening on an abstract unix socket,  connect to it with the returned port name.
+// Only one emulator runs at a time.
+int pm3emu_start(const pm3emu_config_t *config, char *port, size_t port_len);
+// disconnect the client first,  the emulator serves until it is stopped
+void pm3emu_stop(void);
+// port name of the running emulator,  NULL if none
+const char *pm3emu_port(void);
+void pm3emu_get_stats(pm3emu_stats_t *stats);
+
+// content of the emulated BigBuf at index idx
+static inline uint8_t pm3emu_pattern(uint32_t idx) {
+    return (uint8_t)((idx * 31) ^ (idx >> 8));
+}
+
+#endif
@@ -112,6 +112,7 @@ const static vocabulary_t vocabulary[] = {
     { 1, "data zerocrossings" },
     { 1, "data asn1" },
     { 1, "data atr" },
+    { 1, "data bench" },
     { 0, "data bitsamples" },
     { 1, "data bmap" },
     { 1, "data crypto" },
@@ -279,6 +280,7 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hf iclass chk" },
     { 1, "hf iclass loclass" },
     { 1, "hf iclass lookup" },
+    { 1, "hf iclass bench" },
     { 0, "hf iclass sim" },
     { 0, "hf iclass eload" },
     { 0, "hf iclass esave" },
@@ -532,10 +534,12 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hw tearoff" },
     { 1, "hw timeout" },
     { 1, "hw version" },
+    { 0, "hw bench" },
     { 0, "hw break" },
     { 0, "hw bootloader" },
     { 1, "hw connect" },
     { 0, "hw dbg" },
+    { 1, "hw emu" },
     { 0, "hw fpgaoff" },
     { 0, "hw lcd" },
     { 0, "hw lcdreset" },
@@ -549,6 +553,7 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hw tia" },
     { 0, "hw tune" },
     { 1, "lf help" },
+    { 1, "lf batch" },
     { 0, "lf config" },
     { 0, "lf cmdread" },
     { 0, "lf read" },
@@ -760,6 +760,11 @@ void Plot::PlotGraph(int *buffer, size_t len, QRect plotRect, QRect annotationRe
     painter->drawText(20, annotationRect.bottom() - (48 - (12 * graphNum)), str);
 }
 
+// sample under a marker. The graph buffers are allocated on demand, markers can point past them
+static int graphValueAt(const int *buffer, uint32_t pos) {
+    return (buffer && pos < g_GraphTraceLen) ? buffer[pos] : 0;
+}
+
 void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
     char *annotation;
     uint32_t length = 0;
@@ -836,17 +841,17 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         strcat(textA, markerText);
         strcat(textA, " (%s%u)");
 
-        if (g_GraphBuffer[pos] <= g_OperationBuffer[pos]) {
+        if (graphValueAt(g_GraphBuffer, pos) <= graphValueAt(g_OperationBuffer, pos)) {
             flag = true;
-            value = (g_OperationBuffer[pos] - g_GraphBuffer[pos]);
+            value = (graphValueAt(g_OperationBuffer, pos) - graphValueAt(g_GraphBuffer, pos));
         } else {
-            value = (g_GraphBuffer[pos] - g_OperationBuffer[pos]);
+            value = (graphValueAt(g_GraphBuffer, pos) - graphValueAt(g_OperationBuffer, pos));
         }
 
         snprintf(annotation, length, textA,
                  "A",
                  pos,
-                 g_GraphBuffer[pos],
+                 graphValueAt(g_GraphBuffer, pos),
                  flag ? "+" : "-",
                  value
                 );
@@ -867,7 +872,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         snprintf(annotation, length, markerText,
                  "B",
                  pos,
-                 g_GraphBuffer[pos]
+                 graphValueAt(g_GraphBuffer, pos)
                 );
 
         painter->drawText(loc, annotationRect.bottom() - 36, annotation);
@@ -884,7 +889,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         snprintf(annotation, length, markerText,
                  "C",
                  pos,
-                 g_GraphBuffer[pos]
+                 graphValueAt(g_GraphBuffer, pos)
                 );
 
         painter->drawText(loc, annotationRect.bottom() - 24, annotation);
@@ -901,7 +906,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         snprintf(annotation, length, markerText,
                  "D",
                  pos,
-                 g_GraphBuffer[pos]
+                 graphValueAt(g_GraphBuffer, pos)
                 );
 
         painter->drawText(loc, annotationRect.bottom() - 12, annotation);
@@ -1451,6 +1456,9 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Equal:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
             if (event->modifiers() & Qt::ControlModifier) {
                 g_OperationBuffer[g_MarkerA.pos] += 5;
             } else {
@@ -1461,6 +1469,9 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Minus:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
             if (event->modifiers() & Qt::ControlModifier) {
                 g_OperationBuffer[g_MarkerA.pos] -= 5;
             } else {
@@ -1471,6 +1482,9 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Plus:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
             if (event->modifiers() & Qt::ControlModifier) {
                 g_GraphBuffer[g_MarkerA.pos] += 5;
             } else {
@@ -1481,6 +1495,9 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Underscore:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
             if (event->modifiers() & Qt::ControlModifier) {
                 g_GraphBuffer[g_MarkerA.pos] -= 5;
             } else {
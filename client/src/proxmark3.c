@@ -38,6 +38,7 @@
 #include "flash.h"
 #include "preferences.h"
 #include "commonutil.h"
+#include "mifare/mifarehost.h"     // mfnested_free_recovery
 
 #ifndef _WIN32
 #include <locale.h>
@@ -1462,6 +1463,8 @@ int main(int argc, char *argv[]) {
         preferences_save();
     }
 
+    mfnested_free_recovery();
+
     return mainret;
 }
 #endif //LIBPM3
@@ -193,6 +193,71 @@ void PrintAndLogOptions(const char *str[][2], size_t size, size_t space) {
 
 static uint8_t PrintAndLogEx_spinidx = 0;
 
+static __thread printAndLogSink_t gs_print_sink = NULL;
+static __thread void *gs_print_sink_arg = NULL;
+
+void PrintAndLogSetSink(printAndLogSink_t sink, void *arg) {
+    gs_print_sink = sink;
+    gs_print_sink_arg = arg;
+}
+
+void PrintAndLogGetSink(printAndLogSink_t *sink, void **arg) {
+    *sink = gs_print_sink;
+    *arg = gs_print_sink_arg;
+}
+
+static __thread printAndLogResultSink_t gs_result_sink = NULL;
+static __thread void *gs_result_sink_arg = NULL;
+
+void PrintAndLogSetResultSink(printAndLogResultSink_t sink, void *arg) {
+    gs_result_sink = sink;
+    gs_result_sink_arg = arg;
+}
+
+void PrintAndLogGetResultSink(printAndLogResultSink_t *sink, void **arg) {
+    *sink = gs_result_sink;
+    *arg = gs_result_sink_arg;
+}
+
+void PrintAndLogResultStr(const char *key, const char *fmt, ...) {
+    if (gs_result_sink == NULL)
+        return;
+
+    char text[MAX_PRINT_BUFFER] = {0};
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    gs_result_sink(gs_result_sink_arg, key, RESULT_STR, text, 0);
+}
+
+void PrintAndLogResultInt(const char *key, int64_t value) {
+    if (gs_result_sink == NULL)
+        return;
+
+    gs_result_sink(gs_result_sink_arg, key, RESULT_INT, NULL, value);
+}
+
+void PrintAndLogResultBool(const char *key, bool value) {
+    if (gs_result_sink == NULL)
+        return;
+
+    gs_result_sink(gs_result_sink_arg, key, RESULT_BOOL, NULL, value);
+}
+
+// bytes as one upper case hex string without spaces
+void PrintAndLogResultHex(const char *key, const uint8_t *data, size_t len) {
+    if (gs_result_sink == NULL)
+        return;
+
+    char text[MAX_PRINT_BUFFER] = {0};
+    len = MIN(len, (sizeof(text) - 1) / 2);
+    for (size_t i = 0; i < len; i++) {
+        snprintf(text + (i * 2), 3, "%02X", data[i]);
+    }
+    gs_result_sink(gs_result_sink_arg, key, RESULT_HEX, text, 0);
+}
+
 void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
 
     // skip debug messages if client debugging is turned off i.e. 'DATA SETDEBUG -0'
@@ -203,6 +268,18 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
     if (g_session.show_hints == false && level == HINT)
         return;
 
+    if (gs_print_sink != NULL) {
+        char text[MAX_PRINT_BUFFER] = {0};
+        char clean[MAX_PRINT_BUFFER] = {0};
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        memcpy_filter_ansi(clean, text, sizeof(text), true);
+        gs_print_sink(gs_print_sink_arg, level, clean);
+        return;
+    }
+
     char prefix[40] = {0};
     char buffer[MAX_PRINT_BUFFER] = {0};
     char buffer2[MAX_PRINT_BUFFER + sizeof(prefix)] = {0};
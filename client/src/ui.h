@@ -75,6 +75,22 @@ extern session_arg_t g_session;
 #define PROMPT_CLEARLINE PrintAndLogEx(INPLACE, "                                          \r")
 void PrintAndLogOptions(const char *str[][2], size_t size, size_t space);
 void PrintAndLogEx(logLevel_t level, const char *fmt, ...);
+// Divert PrintAndLogEx output of the calling thread to sink, text without colours or prefix.
+// Lets a worker collect what a command printed. NULL restores console output.
+// Sinks nest: get the current one first and set it again when done
+typedef void (*printAndLogSink_t)(void *arg, logLevel_t level, const char *text);
+void PrintAndLogSetSink(printAndLogSink_t sink, void *arg);
+void PrintAndLogGetSink(printAndLogSink_t *sink, void **arg);
+// Typed key / value results a command reports next to what it prints, e.g. "hf14a.uid".
+// They go to the result sink of the calling thread and are dropped when there is none
+typedef enum {RESULT_STR, RESULT_INT, RESULT_BOOL, RESULT_HEX} resultType_t;
+typedef void (*printAndLogResultSink_t)(void *arg, const char *key, resultType_t type, const char *str, int64_t num);
+void PrintAndLogSetResultSink(printAndLogResultSink_t sink, void *arg);
+void PrintAndLogGetResultSink(printAndLogResultSink_t *sink, void **arg);
+void PrintAndLogResultStr(const char *key, const char *fmt, ...);
+void PrintAndLogResultInt(const char *key, int64_t value);
+void PrintAndLogResultBool(const char *key, bool value);
+void PrintAndLogResultHex(const char *key, const uint8_t *data, size_t len);
 void SetFlushAfterWrite(bool value);
 bool GetFlushAfterWrite(void);
 void memcpy_filter_ansi(void *dest, const void *src, size_t n, bool filter);
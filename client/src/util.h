@@ -146,6 +146,7 @@ uint64_t HornerScheme(uint64_t num, uint64_t divider, uint64_t factor);
 
 int num_CPUs(void);
 int detect_num_CPUs(void); // number of logical CPUs
+uint64_t detect_physical_memory(void);
 
 void str_lower(char *s); // converts string to lower case
 void str_upper(char *s); // converts string to UPPER case
@@ -19,8 +19,13 @@
 #include "bucketsort.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include "parity.h"
 
+#if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks pthreads
+#include <pthread.h>
+#endif
+
 
 #if !defined LOWMEM
 #define CONSTRUCTOR
@@ -155,46 +160,269 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
 
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+/** crypto1_recovery_ctx
+ * scratch memory used by lfsr_recovery32/64. Allocating it once and reusing it
+ * avoids ~40 MB of calloc/free (and page faults) for every single recovery.
+ */
+#define RECOVERY_TABLE_SIZE     (1 << 21)
+#define RECOVERY_STATELIST_SIZE (1 << 18)
+#define RECOVERY_BUCKET_SIZE    (1 << 14)
+
+#define RECOVERY_MAX_THREADS    64
+
+struct crypto1_recovery_ctx {
+    uint32_t *odd;
+    uint32_t *even;
+    uint32_t *bucket_mem;
+    bucket_array_t bucket;
+    struct Crypto1State *statelist;
+    // parallel recovery, each worker has its own scratch memory
+    uint32_t num_threads;
+    crypto1_recovery_ctx_t *workers[RECOVERY_MAX_THREADS];
+};
+
+crypto1_recovery_ctx_t *crypto1_recovery_ctx_create(void) {
+    crypto1_recovery_ctx_t *ctx = calloc(1, sizeof(crypto1_recovery_ctx_t));
+    if (!ctx)
+        return NULL;
+
+    // the tables are always written before being read, no need to zero them.
+    ctx->odd = malloc(sizeof(uint32_t) * RECOVERY_TABLE_SIZE);
+    ctx->even = malloc(sizeof(uint32_t) * RECOVERY_TABLE_SIZE);
+    ctx->bucket_mem = malloc(sizeof(uint32_t) * 2 * 0x100 * RECOVERY_BUCKET_SIZE);
+    if (!ctx->odd || !ctx->even || !ctx->bucket_mem) {
+        crypto1_recovery_ctx_free(ctx);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            ctx->bucket[i][j].head = ctx->bucket_mem + ((i << 8 | j) * RECOVERY_BUCKET_SIZE);
+        }
+    }
+    ctx->num_threads = 1;
+    return ctx;
+}
+
+/** crypto1_recovery_ctx_set_threads
+ * number of threads used by lfsr_recovery32_ctx. 1 selects the sequential
+ * reference implementation. Every extra thread costs another ~50 MB of scratch memory,
+ * allocated on the first parallel recovery.
+ * returns the number of threads actually set.
+ */
+uint32_t crypto1_recovery_ctx_set_threads(crypto1_recovery_ctx_t *ctx, uint32_t num_threads) {
+    if (!ctx)
+        return 0;
+    if (num_threads < 1)
+        num_threads = 1;
+    if (num_threads > RECOVERY_MAX_THREADS)
+        num_threads = RECOVERY_MAX_THREADS;
+    ctx->num_threads = num_threads;
+    return num_threads;
+}
+
+/** crypto1_recovery_ctx_thread_mem
+ * scratch memory of one recovery thread, to size the number of threads
+ */
+size_t crypto1_recovery_ctx_thread_mem(void) {
+    return sizeof(uint32_t) * 2 * RECOVERY_TABLE_SIZE
+           + sizeof(uint32_t) * 2 * 0x100 * RECOVERY_BUCKET_SIZE
+           + sizeof(struct Crypto1State) * RECOVERY_STATELIST_SIZE;
+}
+
+void crypto1_recovery_ctx_free(crypto1_recovery_ctx_t *ctx) {
+    if (!ctx)
+        return;
+    for (uint32_t i = 0; i < RECOVERY_MAX_THREADS; i++)
+        crypto1_recovery_ctx_free(ctx->workers[i]);
+    free(ctx->odd);
+    free(ctx->even);
+    free(ctx->bucket_mem);
+    free(ctx->statelist);
+    free(ctx);
+}
+
+/** crypto1_recovery_ctx_detach
+ * hand the statelist of the last recovery over to the caller, who then has to free() it.
+ * The context allocates a new one on the next recovery.
+ */
+struct Crypto1State *crypto1_recovery_ctx_detach(crypto1_recovery_ctx_t *ctx) {
+    struct Crypto1State *sl = ctx->statelist;
+    ctx->statelist = NULL;
+    return sl;
+}
+
+static struct Crypto1State *recovery_statelist(crypto1_recovery_ctx_t *ctx) {
+    if (!ctx->statelist)
+        ctx->statelist = malloc(sizeof(struct Crypto1State) * RECOVERY_STATELIST_SIZE);
+    return ctx->statelist;
+}
+
+typedef struct {
+    struct Crypto1State *head, *tail;
+} recover_range_t;
+
+typedef struct {
+    crypto1_recovery_ctx_t *worker;
+    bucket_info_t *bucket_info;
+    pthread_mutex_t *lock;
+    uint32_t *next;
+    uint32_t oks, eks, in;
+    int rem;
+    recover_range_t *result;
+} recover_job_t;
+
+// worker thread, picks the next unprocessed bucket pair until all are done
+static void *recover_worker(void *arg) {
+    recover_job_t *job = arg;
+    crypto1_recovery_ctx_t *w = job->worker;
+    struct Crypto1State *sl = w->statelist;
+    uint32_t numbuckets = job->bucket_info->numbuckets;
+
+    for (;;) {
+        pthread_mutex_lock(job->lock);
+        uint32_t idx = (*job->next)++;
+        pthread_mutex_unlock(job->lock);
+        if (idx >= numbuckets)
+            break;
+
+        // recover() walks the buckets from the last one to the first
+        uint32_t b = numbuckets - 1 - idx;
+        uint32_t *o_head = job->bucket_info->bucket_info[1][b].head;
+        uint32_t *e_head = job->bucket_info->bucket_info[0][b].head;
+        size_t o_len = job->bucket_info->bucket_info[1][b].tail - o_head + 1;
+        size_t e_len = job->bucket_info->bucket_info[0][b].tail - e_head + 1;
+
+        // private copies, recover() extends the tables in place beyond the bucket tail
+        memcpy(w->odd, o_head, o_len * sizeof(uint32_t));
+        memcpy(w->even, e_head, e_len * sizeof(uint32_t));
+
+        job->result[idx].head = sl;
+        sl = recover(w->odd, w->odd + o_len - 1, job->oks,
+                     w->even, w->even + e_len - 1, job->eks,
+                     job->rem, sl, job->in, w->bucket);
+        job->result[idx].tail = sl;
+    }
+    return NULL;
+}
+
+/** recover_parallel
+ * same as recover(), but the intersecting buckets of the first level are
+ * distributed over the worker threads. Each bucket is recovered in the scratch
+ * memory of a worker and the results are merged in the same order as recover()
+ * would produce them.
+ */
+static struct Crypto1State *
+recover_parallel(crypto1_recovery_ctx_t *ctx, uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
+                 uint32_t *e_head, uint32_t *e_tail, uint32_t eks, int rem,
+                 struct Crypto1State *sl, uint32_t in) {
+    bucket_info_t bucket_info;
+    uint32_t num_threads = ctx->num_threads;
+
+    for (uint32_t i = 0; i < num_threads; i++) {
+        if (ctx->workers[i] == NULL)
+            ctx->workers[i] = crypto1_recovery_ctx_create();
+        if (ctx->workers[i] == NULL || recovery_statelist(ctx->workers[i]) == NULL)
+            return recover(o_head, o_tail, oks, e_head, e_tail, eks, rem, sl, in, ctx->bucket);
+    }
+
+    for (uint32_t i = 0; i < 4 && rem--; i++) {
+        oks >>= 1;
+        eks >>= 1;
+        in >>= 2;
+        extend_table(o_head, &o_tail, oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1, 0);
+        if (o_head > o_tail)
+            return sl;
+
+        extend_table(e_head, &e_tail, eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1, in & 3);
+        if (e_head > e_tail)
+            return sl;
+    }
+
+    bucket_sort_intersect(e_head, e_tail, o_head, o_tail, &bucket_info, ctx->bucket);
+    if (bucket_info.numbuckets == 0) {
+        sl->odd = sl->even = 0;
+        return sl;
+    }
+
+    if (num_threads > bucket_info.numbuckets)
+        num_threads = bucket_info.numbuckets;
+
+    pthread_mutex_t lock;
+    pthread_mutex_init(&lock, NULL);
+    uint32_t next = 0;
+    recover_range_t result[0x100];
+
+    pthread_t threads[RECOVERY_MAX_THREADS];
+    recover_job_t jobs[RECOVERY_MAX_THREADS];
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < num_threads; i++) {
+        jobs[i].worker = ctx->workers[i];
+        jobs[i].bucket_info = &bucket_info;
+        jobs[i].lock = &lock;
+        jobs[i].next = &next;
+        jobs[i].oks = oks;
+        jobs[i].eks = eks;
+        jobs[i].in = in;
+        jobs[i].rem = rem;
+        jobs[i].result = result;
+    }
+    for (uint32_t i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, recover_worker, &jobs[i]))
+            break;
+        started++;
+    }
+    // the threads take buckets until none are left, so fewer threads still cover all of them.
+    // Without any thread, the buckets are recovered serially here.
+    if (started == 0)
+        recover_worker(&jobs[0]);
+    for (uint32_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&lock);
+
+    // merge in bucket order
+    for (uint32_t i = 0; i < bucket_info.numbuckets; i++) {
+        size_t n = result[i].tail - result[i].head;
+        memcpy(sl, result[i].head, n * sizeof(struct Crypto1State));
+        sl += n;
+    }
+    sl->odd = sl->even = 0;
+    return sl;
+}
+
 /** lfsr_recovery
  * recover the state of the lfsr given 32 bits of the keystream
  * additionally you can use the in parameter to specify the value
  * that was fed into the lfsr at the time the keystream was generated
+ * The returned statelist is owned by ctx and valid until the next recovery.
  */
-struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
+struct Crypto1State *lfsr_recovery32_ctx(crypto1_recovery_ctx_t *ctx, uint32_t ks2, uint32_t in) {
     struct Crypto1State *statelist;
-    uint32_t *odd_head = 0, *odd_tail = 0, oks = 0;
-    uint32_t *even_head = 0, *even_tail = 0, eks = 0;
+    uint32_t *odd_head, *odd_tail, oks = 0;
+    uint32_t *even_head, *even_tail, eks = 0;
     register int i;
 
+    if (!ctx)
+        return NULL;
+
+    statelist = recovery_statelist(ctx);
+    if (!statelist)
+        return NULL;
+
     // split the keystream into an odd and even part
     for (i = 31; i >= 0; i -= 2)
         oks = oks << 1 | BEBIT(ks2, i);
     for (i = 30; i >= 0; i -= 2)
         eks = eks << 1 | BEBIT(ks2, i);
 
-    odd_head = odd_tail = calloc(1, sizeof(uint32_t) << 21);
-    even_head = even_tail = calloc(1, sizeof(uint32_t) << 21);
-    statelist =  calloc(1, sizeof(struct Crypto1State) << 18);
-    if (!odd_tail-- || !even_tail-- || !statelist) {
-        free(statelist);
-        statelist = 0;
-        goto out;
-    }
+    odd_head = ctx->odd;
+    odd_tail = odd_head - 1;
+    even_head = ctx->even;
+    even_tail = even_head - 1;
 
     statelist->odd = statelist->even = 0;
 
-    // allocate memory for out of place bucket_sort
-    bucket_array_t bucket;
-
-    for (i = 0; i < 2; i++) {
-        for (uint32_t j = 0; j <= 0xff; j++) {
-            bucket[i][j].head = calloc(1, sizeof(uint32_t) << 14);
-            if (!bucket[i][j].head) {
-                goto out;
-            }
-        }
-    }
-
     // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream
     uint8_t oks_b1 = oks & 1;
     uint8_t eks_b1 = eks & 1;
@@ -217,14 +445,24 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
     // parameter into account.
     in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
-    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+    if (ctx->num_threads > 1)
+        recover_parallel(ctx, odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1);
+    else
+        recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, ctx->bucket);
 
-out:
-    for (i = 0; i < 2; i++)
-        for (uint32_t j = 0; j <= 0xff; j++)
-            free(bucket[i][j].head);
-    free(odd_head);
-    free(even_head);
+    return statelist;
+}
+
+struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
+    crypto1_recovery_ctx_t *ctx = crypto1_recovery_ctx_create();
+    if (!ctx)
+        return NULL;
+
+    struct Crypto1State *statelist = NULL;
+    if (lfsr_recovery32_ctx(ctx, ks2, in))
+        statelist = crypto1_recovery_ctx_detach(ctx);
+
+    crypto1_recovery_ctx_free(ctx);
     return statelist;
 }
 
@@ -255,16 +493,13 @@ static const uint32_t C2[] = { 0x1A822E0, 0x21A822E0, 0x21A822E0};
 /** Reverse 64 bits of keystream into possible cipher states
  * Variation mentioned in the paper. Somewhat optimized version
  */
-struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
-    struct Crypto1State *statelist, *sl;
+static struct Crypto1State *recovery64(struct Crypto1State *statelist, uint32_t ks2, uint32_t ks3) {
+    struct Crypto1State *sl = statelist;
     uint8_t oks[32], eks[32], hi[32];
     uint32_t low = 0,  win = 0;
     uint32_t *tail, table[1 << 16];
     int i, j;
 
-    sl = statelist = calloc(1, sizeof(struct Crypto1State) << 4);
-    if (!sl)
-        return 0;
     sl->odd = sl->even = 0;
 
     for (i = 30; i >= 0; i -= 2) {
@@ -321,6 +556,26 @@ continue2:
     }
     return statelist;
 }
+
+struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
+    struct Crypto1State *statelist = calloc(1, sizeof(struct Crypto1State) << 4);
+    if (!statelist)
+        return 0;
+    return recovery64(statelist, ks2, ks3);
+}
+
+/** lfsr_recovery64_ctx
+ * same as lfsr_recovery64, the returned statelist is owned by ctx
+ * and valid until the next recovery.
+ */
+struct Crypto1State *lfsr_recovery64_ctx(crypto1_recovery_ctx_t *ctx, uint32_t ks2, uint32_t ks3) {
+    if (!ctx)
+        return NULL;
+    struct Crypto1State *statelist = recovery_statelist(ctx);
+    if (!statelist)
+        return NULL;
+    return recovery64(statelist, ks2, ks3);
+}
 #endif
 
 /** lfsr_rollback_bit
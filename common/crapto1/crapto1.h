@@ -37,6 +37,16 @@ uint32_t prng_successor(uint32_t x, uint32_t n);
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in);
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3);
+
+// reusable scratch memory for repeated recoveries, one per thread
+typedef struct crypto1_recovery_ctx crypto1_recovery_ctx_t;
+crypto1_recovery_ctx_t *crypto1_recovery_ctx_create(void);
+void crypto1_recovery_ctx_free(crypto1_recovery_ctx_t *ctx);
+uint32_t crypto1_recovery_ctx_set_threads(crypto1_recovery_ctx_t *ctx, uint32_t num_threads);
+size_t crypto1_recovery_ctx_thread_mem(void);
+struct Crypto1State *crypto1_recovery_ctx_detach(crypto1_recovery_ctx_t *ctx);
+struct Crypto1State *lfsr_recovery32_ctx(crypto1_recovery_ctx_t *ctx, uint32_t ks2, uint32_t in);
+struct Crypto1State *lfsr_recovery64_ctx(crypto1_recovery_ctx_t *ctx, uint32_t ks2, uint32_t ks3);
 struct Crypto1State *
 lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par);
 #endif
@@ -55,12 +55,10 @@ void crc_update2(crc_t *crc, uint32_t data, int data_width) {
     // Bring the next byte into the remainder.
     crc->state ^= data << (crc->order - data_width);
 
+    // branchless, the mask is all ones when the top bit is set
     for (uint8_t bit = data_width; bit > 0; --bit) {
-
-        if (crc->state & crc->topbit)
-            crc->state = (crc->state << 1) ^ crc->polynom;
-        else
-            crc->state = (crc->state << 1);
+        uint32_t feedback = -(uint32_t)((crc->state & crc->topbit) != 0);
+        crc->state = (crc->state << 1) ^ (crc->polynom & feedback);
     }
 }
 
@@ -68,13 +66,9 @@ void crc_update(crc_t *crc, uint32_t data, int data_width) {
     if (crc->refin)
         data = reflect(data, data_width);
 
-    int i;
-    for (i = 0; i < data_width; i++) {
-        int oldstate = crc->state;
-        crc->state = crc->state >> 1;
-        if ((oldstate ^ data) & 1) {
-            crc->state ^= crc->polynom;
-        }
+    for (int i = 0; i < data_width; i++) {
+        uint32_t feedback = -((crc->state ^ data) & 1);
+        crc->state = (crc->state >> 1) ^ (crc->polynom & feedback);
         data >>= 1;
     }
 }
@@ -102,23 +96,119 @@ static void print_crc(crc_t *crc) {
 }
 */
 
+#ifndef ON_DEVICE
+// Byte tables for the fixed CRC-8 helpers below. A 8 bit crc shifted through a table
+// needs the same update in both bit orders, the reflected variants just use a table
+// built from the reflected polynom. The firmware keeps the generic bit loop.
+static const uint8_t crc8_maxim_table[256] = {
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+    0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+    0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+    0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+    0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+    0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+    0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+    0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+    0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+    0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+    0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+    0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+    0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+    0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+    0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+
+static const uint8_t crc8_legic_table[256] = {
+    0x00, 0x13, 0x26, 0x35, 0x4C, 0x5F, 0x6A, 0x79, 0x98, 0x8B, 0xBE, 0xAD, 0xD4, 0xC7, 0xF2, 0xE1,
+    0xBD, 0xAE, 0x9B, 0x88, 0xF1, 0xE2, 0xD7, 0xC4, 0x25, 0x36, 0x03, 0x10, 0x69, 0x7A, 0x4F, 0x5C,
+    0xF7, 0xE4, 0xD1, 0xC2, 0xBB, 0xA8, 0x9D, 0x8E, 0x6F, 0x7C, 0x49, 0x5A, 0x23, 0x30, 0x05, 0x16,
+    0x4A, 0x59, 0x6C, 0x7F, 0x06, 0x15, 0x20, 0x33, 0xD2, 0xC1, 0xF4, 0xE7, 0x9E, 0x8D, 0xB8, 0xAB,
+    0x63, 0x70, 0x45, 0x56, 0x2F, 0x3C, 0x09, 0x1A, 0xFB, 0xE8, 0xDD, 0xCE, 0xB7, 0xA4, 0x91, 0x82,
+    0xDE, 0xCD, 0xF8, 0xEB, 0x92, 0x81, 0xB4, 0xA7, 0x46, 0x55, 0x60, 0x73, 0x0A, 0x19, 0x2C, 0x3F,
+    0x94, 0x87, 0xB2, 0xA1, 0xD8, 0xCB, 0xFE, 0xED, 0x0C, 0x1F, 0x2A, 0x39, 0x40, 0x53, 0x66, 0x75,
+    0x29, 0x3A, 0x0F, 0x1C, 0x65, 0x76, 0x43, 0x50, 0xB1, 0xA2, 0x97, 0x84, 0xFD, 0xEE, 0xDB, 0xC8,
+    0xC6, 0xD5, 0xE0, 0xF3, 0x8A, 0x99, 0xAC, 0xBF, 0x5E, 0x4D, 0x78, 0x6B, 0x12, 0x01, 0x34, 0x27,
+    0x7B, 0x68, 0x5D, 0x4E, 0x37, 0x24, 0x11, 0x02, 0xE3, 0xF0, 0xC5, 0xD6, 0xAF, 0xBC, 0x89, 0x9A,
+    0x31, 0x22, 0x17, 0x04, 0x7D, 0x6E, 0x5B, 0x48, 0xA9, 0xBA, 0x8F, 0x9C, 0xE5, 0xF6, 0xC3, 0xD0,
+    0x8C, 0x9F, 0xAA, 0xB9, 0xC0, 0xD3, 0xE6, 0xF5, 0x14, 0x07, 0x32, 0x21, 0x58, 0x4B, 0x7E, 0x6D,
+    0xA5, 0xB6, 0x83, 0x90, 0xE9, 0xFA, 0xCF, 0xDC, 0x3D, 0x2E, 0x1B, 0x08, 0x71, 0x62, 0x57, 0x44,
+    0x18, 0x0B, 0x3E, 0x2D, 0x54, 0x47, 0x72, 0x61, 0x80, 0x93, 0xA6, 0xB5, 0xCC, 0xDF, 0xEA, 0xF9,
+    0x52, 0x41, 0x74, 0x67, 0x1E, 0x0D, 0x38, 0x2B, 0xCA, 0xD9, 0xEC, 0xFF, 0x86, 0x95, 0xA0, 0xB3,
+    0xEF, 0xFC, 0xC9, 0xDA, 0xA3, 0xB0, 0x85, 0x96, 0x77, 0x64, 0x51, 0x42, 0x3B, 0x28, 0x1D, 0x0E
+};
+
+static const uint8_t crc8_poly1d_table[256] = {
+    0x00, 0x1D, 0x3A, 0x27, 0x74, 0x69, 0x4E, 0x53, 0xE8, 0xF5, 0xD2, 0xCF, 0x9C, 0x81, 0xA6, 0xBB,
+    0xCD, 0xD0, 0xF7, 0xEA, 0xB9, 0xA4, 0x83, 0x9E, 0x25, 0x38, 0x1F, 0x02, 0x51, 0x4C, 0x6B, 0x76,
+    0x87, 0x9A, 0xBD, 0xA0, 0xF3, 0xEE, 0xC9, 0xD4, 0x6F, 0x72, 0x55, 0x48, 0x1B, 0x06, 0x21, 0x3C,
+    0x4A, 0x57, 0x70, 0x6D, 0x3E, 0x23, 0x04, 0x19, 0xA2, 0xBF, 0x98, 0x85, 0xD6, 0xCB, 0xEC, 0xF1,
+    0x13, 0x0E, 0x29, 0x34, 0x67, 0x7A, 0x5D, 0x40, 0xFB, 0xE6, 0xC1, 0xDC, 0x8F, 0x92, 0xB5, 0xA8,
+    0xDE, 0xC3, 0xE4, 0xF9, 0xAA, 0xB7, 0x90, 0x8D, 0x36, 0x2B, 0x0C, 0x11, 0x42, 0x5F, 0x78, 0x65,
+    0x94, 0x89, 0xAE, 0xB3, 0xE0, 0xFD, 0xDA, 0xC7, 0x7C, 0x61, 0x46, 0x5B, 0x08, 0x15, 0x32, 0x2F,
+    0x59, 0x44, 0x63, 0x7E, 0x2D, 0x30, 0x17, 0x0A, 0xB1, 0xAC, 0x8B, 0x96, 0xC5, 0xD8, 0xFF, 0xE2,
+    0x26, 0x3B, 0x1C, 0x01, 0x52, 0x4F, 0x68, 0x75, 0xCE, 0xD3, 0xF4, 0xE9, 0xBA, 0xA7, 0x80, 0x9D,
+    0xEB, 0xF6, 0xD1, 0xCC, 0x9F, 0x82, 0xA5, 0xB8, 0x03, 0x1E, 0x39, 0x24, 0x77, 0x6A, 0x4D, 0x50,
+    0xA1, 0xBC, 0x9B, 0x86, 0xD5, 0xC8, 0xEF, 0xF2, 0x49, 0x54, 0x73, 0x6E, 0x3D, 0x20, 0x07, 0x1A,
+    0x6C, 0x71, 0x56, 0x4B, 0x18, 0x05, 0x22, 0x3F, 0x84, 0x99, 0xBE, 0xA3, 0xF0, 0xED, 0xCA, 0xD7,
+    0x35, 0x28, 0x0F, 0x12, 0x41, 0x5C, 0x7B, 0x66, 0xDD, 0xC0, 0xE7, 0xFA, 0xA9, 0xB4, 0x93, 0x8E,
+    0xF8, 0xE5, 0xC2, 0xDF, 0x8C, 0x91, 0xB6, 0xAB, 0x10, 0x0D, 0x2A, 0x37, 0x64, 0x79, 0x5E, 0x43,
+    0xB2, 0xAF, 0x88, 0x95, 0xC6, 0xDB, 0xFC, 0xE1, 0x5A, 0x47, 0x60, 0x7D, 0x2E, 0x33, 0x14, 0x09,
+    0x7F, 0x62, 0x45, 0x58, 0x0B, 0x16, 0x31, 0x2C, 0x97, 0x8A, 0xAD, 0xB0, 0xE3, 0xFE, 0xD9, 0xC4
+};
+
+static const uint8_t crc8_poly07_table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+
+static uint8_t crc8_table_update(const uint8_t *table, uint8_t crc, const uint8_t *d, size_t n) {
+    while (n--) {
+        crc = table[crc ^ *d++];
+    }
+    return crc;
+}
+#endif
+
 // width=8  poly=0x31  init=0x00  refin=true  refout=true  xorout=0x00  check=0xA1  name="CRC-8/MAXIM"
 uint32_t CRC8Maxim(uint8_t *buff, size_t size) {
+#ifndef ON_DEVICE
+    return crc8_table_update(crc8_maxim_table, 0x00, buff, size);
+#else
     crc_t crc;
     crc_init_ref(&crc, 8, 0x31, 0, 0, true, true);
     for (size_t i = 0; i < size; ++i) {
         crc_update2(&crc, buff[i], 8);
     }
     return crc_finish(&crc);
+#endif
 }
 // width=8 poly=0x1d, init=0xc7 (0xe3 - WRONG! but it mentioned in MAD datasheet) refin=false  refout=false  xorout=0x00 name="CRC-8/MIFARE-MAD"
 uint32_t CRC8Mad(uint8_t *buff, size_t size) {
+#ifndef ON_DEVICE
+    return crc8_table_update(crc8_poly1d_table, 0xC7, buff, size);
+#else
     crc_t crc;
     crc_init_ref(&crc, 8, 0x1d, 0xc7, 0, false, false);
     for (size_t i = 0; i < size; ++i) {
         crc_update2(&crc, buff[i], 8);
     }
     return crc_finish(&crc);
+#endif
 }
 // width=4  poly=0xC, reversed poly=0x7  init=0x5   refin=true  refout=true  xorout=0x0000  check=  name="CRC-4/LEGIC"
 uint32_t CRC4Legic(uint8_t *buff, size_t size) {
@@ -132,30 +222,42 @@ uint32_t CRC4Legic(uint8_t *buff, size_t size) {
 // width=8  poly=0x63, reversed poly=0x8D  init=0x55  refin=true  refout=true  xorout=0x0000  check=0xC6  name="CRC-8/LEGIC"
 // the CRC needs to be reversed before returned.
 uint32_t CRC8Legic(uint8_t *buff, size_t size) {
+#ifndef ON_DEVICE
+    return reflect8(crc8_table_update(crc8_legic_table, 0x55, buff, size));
+#else
     crc_t crc;
     crc_init_ref(&crc, 8, 0x63, 0x55, 0, true, true);
     for (size_t i = 0; i < size; ++i) {
         crc_update2(&crc, buff[i], 8);
     }
     return reflect8(crc_finish(&crc));
+#endif
 }
 // width=8  poly=0x7, init=0x2C  refin=false  refout=false  xorout=0x0000  check=0 name="CRC-8/CARDX"
 uint32_t CRC8Cardx(uint8_t *buff, size_t size) {
+#ifndef ON_DEVICE
+    return crc8_table_update(crc8_poly07_table, 0x2C, buff, size);
+#else
     crc_t crc;
     crc_init_ref(&crc, 8, 0x7, 0x2C, 0, false, false);
     for (size_t i = 0; i < size; ++i) {
         crc_update2(&crc, buff[i], 8);
     }
     return crc_finish(&crc);
+#endif
 }
 
 uint32_t CRC8Hitag1(uint8_t *buff, size_t size) {
+#ifndef ON_DEVICE
+    return crc8_table_update(crc8_poly1d_table, 0xFF, buff, size);
+#else
     crc_t crc;
     crc_init_ref(&crc, 8, 0x1d, 0xff, 0, false, false);
     for (size_t i = 0; i < size; i++) {
         crc_update2(&crc, buff[i], 8);
     }
     return crc_finish(&crc);
+#endif
 }
 
 uint32_t CRC8Hitag1Bits(const uint8_t *buff, size_t bitsize) {
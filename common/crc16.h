@@ -83,9 +83,11 @@ uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc);
 uint16_t crc16_philips(uint8_t const *d, size_t n);
 
 // table implementation
+// compute_crc(), check_crc(), Crc16ex() and the crc16_* functions above use fixed
+// per type tables and are safe to call from several threads.
+// crc16_fast() and crc16_legic() use the table selected with init_table(), which is shared.
 void init_table(CrcType_t crctype);
 void reset_table(void);
-void generate_table(uint16_t polynomial, bool refin);
 uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout);
 
 #endif
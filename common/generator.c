@@ -590,6 +590,7 @@ int mfc_generate4b_nuid(uint8_t *uid, uint8_t *nuid) {
     nuid[1] = b1;
     crc = b1;
     crc |= b2 << 8;
+    init_table(CRC_14443_A);
     crc = crc16_fast(&uid[3], 4, reflect16(crc), true, true);
     nuid[2] = (crc >> 8) & 0xFF ;
     nuid[3] = crc & 0xFF;
@@ -45,7 +45,6 @@
 
 #include "lfdemod.h"
 #include <string.h>  // for memset, memcmp and size_t
-#include <stdlib.h>  // qsort
 #include "parity.h"  // for parity test
 #include "pm3_cmd.h" // error codes
 #include "commonutil.h"  // Arraylen
@@ -69,7 +68,20 @@ uint8_t g_debugMode = 0;
 # define prnt Dbprintf
 #endif
 
+#ifndef ON_DEVICE
+// the client runs demods on several threads,  each thread points to the signal properties
+// of its demodulation context
+static signal_t gs_signalprop = { 255, -255, 0, 0, true };
+static __thread signal_t *gs_signalprop_p = &gs_signalprop;
+# define signalprop (*gs_signalprop_p)
+
+void selectSignalProperties(signal_t *sp) {
+    gs_signalprop_p = (sp) ? sp : &gs_signalprop;
+}
+#else
 static signal_t signalprop = { 255, -255, 0, 0, true };
+#endif
+
 signal_t *getSignalProperties(void) {
     return &signalprop;
 }
@@ -93,92 +105,132 @@ static void printSignal(void) {
 }
 
 #ifndef ON_DEVICE
-static int cmp_uint8(const void *a, const void *b) {
-    if (*(const uint8_t *)a < * (const uint8_t *)b)
-        return -1;
-    else
-        return *(const uint8_t *)a > *(const uint8_t *)b;
+// sample value at index n of the sorted samples
+static uint8_t histogramNth(const uint32_t *hist, uint32_t n) {
+    uint32_t acc = 0;
+    for (int v = 0; v < 256; v++) {
+        acc += hist[v];
+        if (acc > n) {
+            return v;
+        }
+    }
+    return 255;
 }
-#endif
 
-void computeSignalProperties(const uint8_t *samples, uint32_t size) {
-    resetSignal();
+static uint32_t histogramCount(const uint32_t *hist) {
+    uint32_t cnt = 0;
+    for (int v = 0; v < 256; v++) {
+        cnt += hist[v];
+    }
+    return cnt;
+}
 
-    if (samples == NULL || size < SIGNAL_MIN_SAMPLES) return;
+static void signalHistogram(const uint8_t *samples, uint32_t size, uint32_t *hist) {
+    memset(hist, 0, 256 * sizeof(uint32_t));
+    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
+        hist[samples[i]]++;
+    }
+}
+#endif
 
-    uint32_t sum = 0;
-    uint32_t offset_size = size - SIGNAL_IGNORE_FIRST_SAMPLES;
+static void finishSignalProperties(void) {
+    // measure amplitude of signal
+    signalprop.amplitude = signalprop.high - signalprop.mean;
+    // By measuring mean and look at amplitude of signal from HIGH / LOW,
+    // we can detect noise
+    signalprop.isnoise =  signalprop.amplitude < NOISE_AMPLITUDE_THRESHOLD;
+
+    if (g_debugMode)
+        printSignal();
+}
 
 #ifndef ON_DEVICE
-    uint8_t tmp[offset_size];
-    memcpy(tmp, samples + SIGNAL_IGNORE_FIRST_SAMPLES, sizeof(tmp));
-    qsort(tmp, sizeof(tmp), sizeof(uint8_t), cmp_uint8);
+// The client sees captures of millions of samples. The percentiles are read from a histogram
+// of the 256 sample values instead of sorting a copy of the samples on the stack.
+void computeSignalPropertiesHistogram(const uint32_t *hist) {
+    resetSignal();
+
+    uint32_t offset_size = histogramCount(hist);
+    if (offset_size + SIGNAL_IGNORE_FIRST_SAMPLES < SIGNAL_MIN_SAMPLES) return;
 
-    uint8_t low10 = 0.5 * (tmp[(int)(offset_size * 0.1)] + tmp[(int)((offset_size - 1) * 0.1)]);
-    uint8_t hi90 =  0.5 * (tmp[(int)(offset_size * 0.9)] + tmp[(int)((offset_size - 1) * 0.9)]);
+    uint8_t low10 = 0.5 * (histogramNth(hist, offset_size * 0.1) + histogramNth(hist, (offset_size - 1) * 0.1));
+    uint8_t hi90 =  0.5 * (histogramNth(hist, offset_size * 0.9) + histogramNth(hist, (offset_size - 1) * 0.9));
+    uint64_t sum = 0;
     uint32_t cnt = 0;
-    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
+    for (int v = 0; v < 256; v++) {
+        if (hist[v] == 0)
+            continue;
 
-        if (samples[i] < signalprop.low) signalprop.low = samples[i];
-        if (samples[i] > signalprop.high) signalprop.high = samples[i];
+        if (v < signalprop.low) signalprop.low = v;
+        if (v > signalprop.high) signalprop.high = v;
 
-        if (samples[i] < low10 || samples[i] > hi90)
+        if (v < low10 || v > hi90)
             continue;
 
-        sum += samples[i];
-        cnt++;
+        sum += (uint64_t)v * hist[v];
+        cnt += hist[v];
     }
     if (cnt > 0)
         signalprop.mean = sum / cnt;
     else
         signalprop.mean = 0;
+
+    finishSignalProperties();
+}
+
+int getSignalOffsetHistogram(const uint32_t *hist) {
+    uint32_t offset_size = histogramCount(hist);
+    if (offset_size + SIGNAL_IGNORE_FIRST_SAMPLES < SIGNAL_MIN_SAMPLES) return 0;
+
+    uint8_t low10 = 0.5 * (histogramNth(hist, offset_size * 0.05) + histogramNth(hist, (offset_size - 1) * 0.05));
+    uint8_t hi90 =  0.5 * (histogramNth(hist, offset_size * 0.95) + histogramNth(hist, (offset_size - 1) * 0.95));
+    int64_t acc_off = 0;
+    uint32_t cnt = 0;
+    for (int v = low10; v <= hi90; v++) {
+        acc_off += (int64_t)(v - 128) * hist[v];
+        cnt += hist[v];
+    }
+    if (cnt > 0)
+        return acc_off / (int64_t)cnt;
+
+    return 0;
+}
+#endif
+
+void computeSignalProperties(const uint8_t *samples, uint32_t size) {
+    resetSignal();
+
+    if (samples == NULL || size < SIGNAL_MIN_SAMPLES) return;
+
+#ifndef ON_DEVICE
+    uint32_t hist[256];
+    signalHistogram(samples, size, hist);
+    computeSignalPropertiesHistogram(hist);
 #else
+    uint32_t sum = 0;
+    uint32_t offset_size = size - SIGNAL_IGNORE_FIRST_SAMPLES;
     for (uint32_t i =  SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
         if (samples[i] < signalprop.low) signalprop.low = samples[i];
         if (samples[i] > signalprop.high) signalprop.high = samples[i];
         sum += samples[i];
     }
     signalprop.mean = sum / offset_size;
-#endif
-
-    // measure amplitude of signal
-    signalprop.amplitude = signalprop.high - signalprop.mean;
-    // By measuring mean and look at amplitude of signal from HIGH / LOW,
-    // we can detect noise
-    signalprop.isnoise =  signalprop.amplitude < NOISE_AMPLITUDE_THRESHOLD;
 
-    if (g_debugMode)
-        printSignal();
+    finishSignalProperties();
+#endif
 }
 
 void removeSignalOffset(uint8_t *samples, uint32_t size) {
     if (samples == NULL || size < SIGNAL_MIN_SAMPLES) return;
 
     int acc_off = 0;
-    uint32_t offset_size = size - SIGNAL_IGNORE_FIRST_SAMPLES;
 
 #ifndef ON_DEVICE
-
-    uint8_t tmp[offset_size];
-    memcpy(tmp, samples + SIGNAL_IGNORE_FIRST_SAMPLES, sizeof(tmp));
-    qsort(tmp, sizeof(tmp), sizeof(uint8_t), cmp_uint8);
-
-    uint8_t low10 = 0.5 * (tmp[(int)(offset_size * 0.05)] + tmp[(int)((offset_size - 1) * 0.05)]);
-    uint8_t hi90 =  0.5 * (tmp[(int)(offset_size * 0.95)] + tmp[(int)((offset_size - 1) * 0.95)]);
-    int32_t cnt = 0;
-    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
-
-        if (samples[i] < low10 || samples[i] > hi90)
-            continue;
-
-        acc_off += samples[i] - 128;
-        cnt++;
-    }
-    if (cnt > 0)
-        acc_off /= cnt;
-    else
-        acc_off = 0;
+    uint32_t hist[256];
+    signalHistogram(samples, size, hist);
+    acc_off = getSignalOffsetHistogram(hist);
 #else
+    uint32_t offset_size = size - SIGNAL_IGNORE_FIRST_SAMPLES;
     for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++)
         acc_off += samples[i] - 128;
 
@@ -475,12 +527,12 @@ static int getClosestClock(int testclk) {
 }
 
 void getNextLow(const uint8_t *samples, size_t size, int low, size_t *i) {
-    while ((samples[*i] > low) && (*i < size))
+    while ((*i < size) && (samples[*i] > low))
         *i += 1;
 }
 
 void getNextHigh(const uint8_t *samples, size_t size, int high, size_t *i) {
-    while ((samples[*i] < high) && (*i < size))
+    while ((*i < size) && (samples[*i] < high))
         *i += 1;
 }
 
@@ -532,7 +584,11 @@ size_t pskFindFirstPhaseShift(const uint8_t *samples, size_t size, uint8_t *curP
     size_t i = waveStart, waveEnd, waveLenCnt, firstFullWave;
     for (; i < loopCnt; i++) {
         // find peak // was "samples[i] + fc" but why?  must have been used to weed out some wave error... removed..
-        if (samples[i] < samples[i + 1] && samples[i + 1] >= samples[i + 2]) {
+        // past the end of the samples counts as zero
+        uint8_t cur = samples[i];
+        uint8_t peak = (i + 1 < size) ? samples[i + 1] : 0;
+        uint8_t next = (i + 2 < size) ? samples[i + 2] : 0;
+        if (cur < peak && peak >= next) {
             waveEnd = i + 1;
             if (g_debugMode == 2) prnt("DEBUG PSK: waveEnd: %zu, waveStart: %zu", waveEnd, waveStart);
             waveLenCnt = waveEnd - waveStart;
@@ -547,7 +603,7 @@ size_t pskFindFirstPhaseShift(const uint8_t *samples, size_t size, uint8_t *curP
             waveStart = i + 1;
             avgWaveVal = 0;
         }
-        avgWaveVal += samples[i + 2];
+        avgWaveVal += next;
     }
     return 0;
 }
@@ -1502,7 +1558,7 @@ bool DetectST(uint8_t *buffer, size_t *size, int *foundclock, size_t *ststart, s
         for (i = 0; i < datalen; ++i) {
             if (i + newloc < bufsize) {
                 if (i + newloc < dataloc)
-                    buffer[i + newloc] = buffer[dataloc];
+                    buffer[i + newloc] = (dataloc < bufsize) ? buffer[dataloc] : 0;
 
                 dataloc++;
             }
@@ -1512,7 +1568,8 @@ bool DetectST(uint8_t *buffer, size_t *size, int *foundclock, size_t *ststart, s
         if (g_debugMode == 2) prnt("DEBUG STT: skipping STT at %zu to %zu", dataloc, dataloc + (clk * 4));
         dataloc += clk * 4;
     }
-    *size = newloc;
+    // newloc counts whole blocks, the last one may run past the samples we have
+    *size = (newloc < bufsize) ? newloc : bufsize;
     return true;
 }
 
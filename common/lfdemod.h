@@ -42,6 +42,14 @@ typedef struct {
     bool isnoise;
 } signal_t;
 signal_t *getSignalProperties(void);
+#ifndef ON_DEVICE
+// signal properties used by the calling thread, NULL selects the shared default
+void selectSignalProperties(signal_t *sp);
+// same as computeSignalProperties() / the offset removeSignalOffset() takes away, measured from a
+// histogram of 256 sample values without the first SIGNAL_IGNORE_FIRST_SAMPLES samples
+void computeSignalPropertiesHistogram(const uint32_t *hist);
+int getSignalOffsetHistogram(const uint32_t *hist);
+#endif
 
 void computeSignalProperties(const uint8_t *samples, uint32_t size);
 void removeSignalOffset(uint8_t *samples, uint32_t size);
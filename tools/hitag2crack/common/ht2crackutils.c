@@ -151,6 +151,50 @@ void buildlfsr(Hitag_State *hstate) {
                    ^ (temp >> 42) ^ (temp >> 46);
 }
 
+// builds a jump table: d[i] is the shift register 'steps' steps on from the state with
+// only bit i set.  The shift register is linear, so any state jumps by xoring the d[i]
+// of its set bits
+void buildjump(uint64_t *d, uint32_t steps) {
+    Hitag_State hstate;
+
+    for (int i = 0; i < 48; i++) {
+        hstate.shiftreg = 1ULL << i;
+        buildlfsr(&hstate);
+        hitag2_nstep(&hstate, steps);
+        d[i] = hstate.shiftreg;
+    }
+}
+
+// jumps the shift register by the steps of jump table d
+uint64_t jumpstate(const uint64_t *d, uint64_t shiftreg) {
+    uint64_t out = 0;
+
+    for (int i = 0; i < 48; i++) {
+        if ((shiftreg >> i) & 1)
+            out ^= d[i];
+    }
+    return out;
+}
+
+// jumps the shift register n times the steps of jump table d
+uint64_t jumpnstate(const uint64_t *d, uint64_t shiftreg, uint64_t n) {
+    uint64_t p[48], sq[48];
+
+    memcpy(p, d, sizeof(p));
+    while (n) {
+        if (n & 1)
+            shiftreg = jumpstate(p, shiftreg);
+        n >>= 1;
+        if (n) {
+            // square the jump
+            for (int i = 0; i < 48; i++)
+                sq[i] = jumpstate(p, p[i]);
+            memcpy(p, sq, sizeof(p));
+        }
+    }
+    return shiftreg;
+}
+
 // convert byte-reversed 8 digit hex to unsigned long
 unsigned long hexreversetoulong(char *hex) {
     unsigned long ret = 0L;
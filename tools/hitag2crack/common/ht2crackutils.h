@@ -32,6 +32,9 @@ int fb(unsigned int i);
 int fc(unsigned int i);
 int fnf(uint64_t s);
 void buildlfsr(Hitag_State *hstate);
+void buildjump(uint64_t *d, uint32_t steps);
+uint64_t jumpstate(const uint64_t *d, uint64_t shiftreg);
+uint64_t jumpnstate(const uint64_t *d, uint64_t shiftreg, uint64_t n);
 
 /*
  * Hitag Crypto support macros
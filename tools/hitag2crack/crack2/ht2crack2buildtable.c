@@ -1,539 +1,811 @@
 /*
  * ht2crack2buildtable.c
  * This builds the 1.2TB table and sorts it.
+ *
+ * The table holds 2^37 entries, one every 2048 PRNG steps from a fixed start state: 48 bits of
+ * keystream and the 48 bit PRNG state it starts at.  They end up in sorted/XX/YY.bin, one file per
+ * first two bytes of keystream, each entry 10 bytes (4 bytes of keystream + 6 bytes of state) and
+ * sorted by keystream, then state.
+ *
+ * It works in two phases.  Both can be interrupted and are resumed by running it again in the same
+ * directory:
+ *
+ * build: the entries are made in runs of consecutive table indexes, as large as the memory allows.
+ *        Each run is sorted in memory and written out as one file per first byte of keystream,
+ *        table/XX/rNNNNNNN.bin.  Finished runs are recorded in table/progress.
+ * merge: for each first byte XX, the runs in table/XX/ are merged into sorted/XX/ with large
+ *        sequential reads.  Then sorted/XX/done is written and table/XX/ removed.
+ *
+ * Next to each sorted/XX/YY.bin, sorted/XX/YY.idx holds the first 4 bytes of keystream of every
+ * INDEXSTEP entries, so ht2crack2search can go straight to the right part of the file.  -i writes
+ * them for a table that was sorted without.
+ *
+ * The number of threads and the memory used are taken from the machine unless given with -t and -m.
+ * -s builds a smaller table of 2^BITS entries, the search finds keys with 2^(37-BITS) times less
+ * probability but it only takes minutes to build.
  */
 
 #include "ht2crackutils.h"
 #include <stdlib.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
 
-// DATAMAX is the size of each bucket (bytes).  There are 65536 buckets so choose a value such that
-// DATAMAX * 65536 < RAM available.  For ex, if you want to use 12GB of RAM (for a 16GB machine
-// leaving some RAM free for OS and other stuff), DATAMAX = 12GB / 65536 = 196608.  Round this down
-// to a power of 10; DATAMAX = 196600.
-#define DATAMAX 196600 // around 192K rounded down to a power of 10
-
-// NUM_BUILD_THREADS and NUM_SORT_THREADS are the number of threads to run concurrently.  These should
-// ideally be equal to the number of virtual cores you have available.  A quad-core machine will
-// likely have 8 virtual cores, so set them to 8.
-//
-// If sorting fails with a 'bus error' then that is likely because your disk I/O can't keep up with
-// the read/write demands of the multi-threaded sorting.  In this case, reduce the number of sorting
-// threads.  This will most likely only be a problem with network disks; SATA should be okay;
-// USB2/3 should keep up.
-//
-// These MUST be a power of 2 for the maths to work - you have been warned!
-// Also, sort threads MUST be <= build threads or a horrible buffer overflow will happen!
-#define NUM_BUILD_THREADS 8
-#define NUM_SORT_THREADS 8
+// TABLEBITS is the log2 of the number of entries in the full table.  Each entry is 2048 PRNG steps
+// on from the last one.
+#define TABLEBITS 37
+#define JUMPSTEPS 2048
 
 // DATASIZE is the number of bytes in an entry.  This is 10; 4 bytes of keystream (2 are in the filepath) +
 // 6 bytes of PRNG state.
 #define DATASIZE 10
 
-int debug = 0;
-
-// table entry for a bucket
-struct table {
-    char path[32];
-    pthread_mutex_t mutex;
-    unsigned char *data;
-    unsigned char *ptr;
-};
+// one index entry for every INDEXSTEP table entries, must match ht2crack2search.c
+#define INDEXSTEP 4096
 
+// a run file starts with the number of entries for each second byte of keystream
+#define RUNHEADER (0x100 * sizeof(uint32_t))
 
-// actual table
-struct table *t;
+#define PROGRESSFILE "table/progress"
+#define PROGRESSMAGIC "ht2crack2buildtable"
 
-// jump table 1
-uint64_t d[48];
-int nsteps;
+// an entry while building: 48 bits of keystream and the state it starts at
+typedef struct {
+    uint64_t ks;
+    uint64_t state;
+} entry_t;
 
-// jump table 2
-uint64_t d2[48];
-int nsteps2;
-
-// create table entry
-static void create_table(struct table *tt, int d_1, int d_2) {
-    if (!tt) {
-        printf("create_table: t is NULL\n");
-        exit(1);
+// merge cursor of a run
+typedef struct {
+    unsigned char *ptr;
+    uint32_t left;
+} cursor_t;
+
+static unsigned int tablebits = TABLEBITS;
+static uint64_t numentries;
+static uint64_t runsize;
+static uint64_t numruns;
+static int numthreads;
+static uint64_t threadmem;
+
+// jump table for 2048 steps, and the same split into lookups per byte of state
+static uint64_t d[48];
+static uint64_t dbyte[6][0x100];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char *rundone;
+static uint64_t nextrun;
+static uint64_t runsfinished;
+static FILE *progress;
+static int nextprefix;
+
+
+// memory we can use, in bytes
+static uint64_t availmem(void) {
+    char line[128];
+    uint64_t kb;
+    long pages, pagesize;
+
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (f) {
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "MemAvailable: %" SCNu64 " kB", &kb) == 1) {
+                fclose(f);
+                return kb * 1024 / 4 * 3;
+            }
+        }
+        fclose(f);
     }
 
-    // create some space
-    tt->data = (unsigned char *)calloc(1, DATAMAX);
-    if (!(tt->data)) {
-        printf("create_table: cannot calloc data\n");
-        exit(1);
+    pages = sysconf(_SC_PHYS_PAGES);
+    pagesize = sysconf(_SC_PAGESIZE);
+    if ((pages > 0) && (pagesize > 0)) {
+        return (uint64_t)pages * pagesize / 2;
     }
 
-    // set data ptr to start of data table
-    tt->ptr = tt->data;
+    return 1ULL << 30;
+}
+
+static int numcpus(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? count : 1;
+}
 
-    // init the mutex
-    if (pthread_mutex_init(&(tt->mutex), NULL)) {
-        printf("create_table: cannot init mutex\n");
+// make a dir, it is fine if it is already there
+static void makedir(const char *path) {
+    if (mkdir(path, 0755) && (errno != EEXIST)) {
+        printf("cannot make dir %s\n", path);
         exit(1);
     }
-
-    // create the path
-//    snprintf(tt->path, sizeof(tt->path), "/Volumes/2tb/%02X/%02X.bin", d_1 & 0xff, d_2 & 0xff);
-    snprintf(tt->path, sizeof(tt->path), "table/%02x/%02x.bin", d_1 & 0xff, d_2 & 0xff);
 }
 
+static int isdir(const char *path) {
+    struct stat filestat;
+    return (stat(path, &filestat) == 0) && S_ISDIR(filestat.st_mode);
+}
 
-// create all table entries
-static void create_tables(struct table *tt) {
-    int i, j;
-
-    if (!tt) {
-        printf("create_tables: t is NULL\n");
+// the files are synced all at once with sync() before they are recorded as done
+static void writefile(const char *path, const unsigned char *data, size_t len) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("cannot create file %s\n", path);
         exit(1);
     }
 
-    for (i = 0; i < 0x100; i++) {
-        for (j = 0; j < 0x100; j++) {
-            create_table(tt + ((i * 0x100) + j), i, j);
+    while (len) {
+        ssize_t ret = write(fd, data, len);
+        if (ret <= 0) {
+            printf("cannot write all of the data to %s\n", path);
+            exit(1);
         }
+        data += ret;
+        len -= ret;
     }
-}
 
+    if (close(fd)) {
+        printf("cannot close file %s\n", path);
+        exit(1);
+    }
+}
 
-// free the table memory
-static void free_tables(struct table *tt) {
-    if (!tt) {
-        printf("free_tables: tt is NULL\n");
+static void readfile(const char *path, unsigned char *data, size_t len, off_t offset) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("cannot open file %s\n", path);
         exit(1);
     }
 
-    for (int i = 0; i < 0x10000; i++) {
-        struct table *ttmp = tt + i;
-        free(ttmp->data);
+    while (len) {
+        ssize_t ret = pread(fd, data, len, offset);
+        if (ret <= 0) {
+            printf("cannot read all of the data from %s\n", path);
+            exit(1);
+        }
+        data += ret;
+        len -= ret;
+        offset += ret;
     }
+    close(fd);
 }
 
+static void runpath(char *path, size_t len, int prefix, uint64_t run) {
+    snprintf(path, len, "table/%02x/r%07" PRIu64 ".bin", prefix, run);
+}
 
 
-// write (partial) table to file
-static void writetable(struct table *t1) {
-    int fd;
+// jump the state 2048 steps
+static inline uint64_t jumpstep(uint64_t shiftreg) {
+    return dbyte[0][shiftreg & 0xff] ^ dbyte[1][(shiftreg >> 8) & 0xff] ^ dbyte[2][(shiftreg >> 16) & 0xff] ^
+           dbyte[3][(shiftreg >> 24) & 0xff] ^ dbyte[4][(shiftreg >> 32) & 0xff] ^ dbyte[5][(shiftreg >> 40) & 0xff];
+}
 
-    if (debug) printf("writetable %s\n", t1->path);
+static void buildjumps(void) {
+    buildjump(d, JUMPSTEPS);
 
-    fd = open(t1->path, O_WRONLY | O_CREAT | O_APPEND, 0644);
-    if (fd <= 0) {
-        printf("writetable cannot open file %s for appending\n", t1->path);
-        exit(1);
+    for (int i = 0; i < 6; i++) {
+        for (int j = 0; j < 0x100; j++) {
+            dbyte[i][j] = jumpstate(d, (uint64_t)j << (i * 8));
+        }
     }
+}
 
-    if (debug) printf("writetable %s opened\n", t1->path);
+static int entrycmp(const void *p1, const void *p2) {
+    const entry_t *e1 = (const entry_t *)p1;
+    const entry_t *e2 = (const entry_t *)p2;
 
-    if (write(fd, t1->data, t1->ptr - t1->data) < (t1->ptr - t1->data)) {
-        printf("writetable cannot write all of the data\n");
+    if (e1->ks != e2->ks)
+        return (e1->ks < e2->ks) ? -1 : 1;
+    if (e1->state != e2->state)
+        return (e1->state < e2->state) ? -1 : 1;
+    return 0;
+}
+
+// write the index of a sorted file
+static void writeindex(const char *path, const unsigned char *data, uint64_t count) {
+    uint64_t n = (count + INDEXSTEP - 1) / INDEXSTEP;
+    unsigned char *index = (unsigned char *)malloc(n * 4 + 1);
+    if (!index) {
+        printf("writeindex: cannot malloc index\n");
         exit(1);
     }
 
-    if (debug) printf("writetable %s written\n", t1->path);
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy(index + (i * 4), data + (i * INDEXSTEP * DATASIZE), 4);
+    }
 
-    close(fd);
+    writefile(path, index, n * 4);
+    free(index);
 }
 
+// make the entries of a run, sort them and write one file per first byte of keystream
+static void buildrun(uint64_t run, entry_t *entries, entry_t *sorted, uint64_t *bucket, unsigned char **out, size_t *outlen) {
+    Hitag_State hstate;
+    uint64_t first = run * runsize;
+    uint64_t count = ((numentries - first) < runsize) ? (numentries - first) : runsize;
+    uint64_t shiftreg;
+    char path[64];
 
-// store value in table
-static void store(unsigned char *data) {
-    unsigned char d_1, d_2;
-    int offset;
-    struct table *t1;
-
-    // use the first two bytes as an index
-    d_1 = data[0];
-    d_2 = data[1];
-    offset = (d_1 * 0x100) + d_2;
+    // jump to the first entry of the run
+    shiftreg = jumpnstate(d, 0x123456789abc, first);
 
-    if (debug) printf("store, d1=%02X, d2=%02X, offset = %d\n", d_1, d_2, offset);
+    for (uint64_t i = 0; i < count; i++) {
+        // get 48 bits of keystream, this is split into 2 x 24 bit
+        hstate.shiftreg = shiftreg;
+        buildlfsr(&hstate);
+        uint64_t ks1 = hitag2_nstep(&hstate, 24);
+        uint64_t ks2 = hitag2_nstep(&hstate, 24);
 
-    // get pointer to table entry
-    t1 = t + offset;
+        entries[i].ks = (ks1 << 24) | ks2;
+        entries[i].state = shiftreg;
 
-    // wait for a lock on this entry
-    if (pthread_mutex_lock(&(t1->mutex))) {
-        printf("store: cannot lock mutex at offset %d\n", offset);
-        exit(1);
+        shiftreg = jumpstep(shiftreg);
     }
 
-    if (debug) printf("store, offset = %d, got lock\n", offset);
+    // counting sort on the first two bytes of keystream, then sort each bucket
+    memset(bucket, 0, 0x10001 * sizeof(uint64_t));
+    for (uint64_t i = 0; i < count; i++) {
+        bucket[(entries[i].ks >> 32) + 1]++;
+    }
+    for (int i = 0; i < 0x10000; i++) {
+        bucket[i + 1] += bucket[i];
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        sorted[bucket[entries[i].ks >> 32]++] = entries[i];
+    }
+    // bucket[i] is now the end of bucket i
+    for (int i = 0; i < 0x10000; i++) {
+        uint64_t start = i ? bucket[i - 1] : 0;
+        qsort(sorted + start, bucket[i] - start, sizeof(entry_t), entrycmp);
+    }
 
-    // store the entry
-    memcpy(t1->ptr, data + 2, 10);
+    for (int i = 0; i < 0x100; i++) {
+        uint64_t start = i ? bucket[(i * 0x100) - 1] : 0;
+        uint64_t end = bucket[(i * 0x100) + 0xff];
+        size_t len = RUNHEADER + ((end - start) * DATASIZE);
+        unsigned char *ptr;
+
+        if (len > *outlen) {
+            free(*out);
+            *out = (unsigned char *)malloc(len);
+            if (!*out) {
+                printf("buildrun: cannot malloc output buffer\n");
+                exit(1);
+            }
+            *outlen = len;
+        }
 
-    if (debug) printf("store, offset = %d, copied data\n", offset);
+        for (int j = 0; j < 0x100; j++) {
+            int b = (i * 0x100) + j;
+            uint32_t n = bucket[b] - (b ? bucket[b - 1] : 0);
+            memcpy(*out + (j * sizeof(uint32_t)), &n, sizeof(uint32_t));
+        }
 
-    // update the ptr
-    t1->ptr += 10;
+        ptr = *out + RUNHEADER;
+        for (uint64_t k = start; k < end; k++) {
+            writebuf(ptr, sorted[k].ks, 4);
+            writebuf(ptr + 4, sorted[k].state, 6);
+            ptr += DATASIZE;
+        }
 
-    // check if table is full
-    if ((t1->ptr - t1->data) >= DATAMAX) {
-        // write the table to disk
-        writetable(t1);
-        // reset ptr
-        t1->ptr = t1->data;
+        runpath(path, sizeof(path), i, run);
+        writefile(path, *out, len);
     }
+}
 
-    if (debug) printf("store, offset = %d, after possible write\n", offset);
-
-    // release the lock
-    if (pthread_mutex_unlock(&(t1->mutex))) {
-        printf("store: cannot unlock mutex at offset %d\n", offset);
+// thread to build runs until there are none left
+static void *buildthread(void *dd) {
+    unsigned char *out = NULL;
+    size_t outlen = 0;
+    uint64_t run;
+
+    entry_t *entries = (entry_t *)malloc(runsize * sizeof(entry_t));
+    entry_t *sorted = (entry_t *)malloc(runsize * sizeof(entry_t));
+    uint64_t *bucket = (uint64_t *)malloc(0x10001 * sizeof(uint64_t));
+    if (!entries || !sorted || !bucket) {
+        printf("buildthread: cannot malloc run buffers\n");
         exit(1);
     }
 
-    if (debug) printf("store, offset = %d, unlocked\n", offset);
-
-}
-
-// writes the ks (keystream) and s (state)
-static void write_ks_s(uint32_t ks1, uint32_t ks2, uint64_t shiftreg) {
-    unsigned char buf[16];
-
-    // create buffer
-    writebuf(buf, ks1, 3);
-    writebuf(buf + 3, ks2, 3);
-    writebuf(buf + 6, shiftreg, 6);
-
-    // store buffer
-    store(buf);
-}
-
+    while (1) {
+        pthread_mutex_lock(&lock);
+        while ((nextrun < numruns) && rundone[nextrun]) {
+            nextrun++;
+        }
+        run = nextrun++;
+        pthread_mutex_unlock(&lock);
 
-// builds the di table for jumping
-static void builddi(int steps, int table) {
-    uint64_t statemask;
-    int i;
-    Hitag_State mystate;
-    uint64_t *thisd = NULL;
+        if (run >= numruns) {
+            break;
+        }
 
-    statemask = 1;
+        buildrun(run, entries, sorted, bucket, &out, &outlen);
 
-    // select jump table
-    if (table == 1) {
-        nsteps = steps;
-        thisd = d;
-    } else if (table == 2) {
-        nsteps2 = steps;
-        thisd = d2;
-    } else {
-        printf("builddi: invalid table num\n");
-        exit(1);
+        // record the run once its files are on disk
+        sync();
+        pthread_mutex_lock(&lock);
+        fprintf(progress, "done %" PRIu64 "\n", run);
+        if (fflush(progress) || fsync(fileno(progress))) {
+            printf("cannot write %s\n", PROGRESSFILE);
+            exit(1);
+        }
+        rundone[run] = 1;
+        runsfinished++;
+        printf("build: run %" PRIu64 " finished, %" PRIu64 " of %" PRIu64 " runs done\n", run, runsfinished, numruns);
+        pthread_mutex_unlock(&lock);
     }
 
-    // build di states
-    for (i = 0; i < 48; i++) {
-        mystate.shiftreg = statemask;
-        buildlfsr(&mystate);
-        hitag2_nstep(&mystate, steps);
-        thisd[i] = mystate.shiftreg;
+    free(out);
+    free(bucket);
+    free(sorted);
+    free(entries);
 
-        statemask = statemask << 1;
-    }
+    return NULL;
 }
 
-// jump function - quickly jumps a load of steps
-static void jumpnsteps(Hitag_State *hstate, int table) {
-    uint64_t output = 0;
-    uint64_t bitmask;
-    int i;
-    uint64_t *thisd = NULL;
 
-
-    // select jump table
-    if (table == 1) {
-        thisd = d;
-    } else if (table == 2) {
-        thisd = d2;
-    } else {
-        printf("jumpnsteps: invalid table num\n");
-        exit(1);
+// the run heads are kept in a heap, smallest entry first
+static void siftdown(cursor_t *heap, int n, int i) {
+    while (1) {
+        int smallest = i;
+        int l = (2 * i) + 1;
+        int r = l + 1;
+
+        if ((l < n) && (memcmp(heap[l].ptr, heap[smallest].ptr, DATASIZE) < 0))
+            smallest = l;
+        if ((r < n) && (memcmp(heap[r].ptr, heap[smallest].ptr, DATASIZE) < 0))
+            smallest = r;
+        if (smallest == i)
+            return;
+
+        cursor_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
     }
+}
 
-    // xor all di.si where di is a d state and si is a bit
-    // we do this by multiplying di by si:
-    // if si is 1, di.si = di; if si is 0, di.si = 0
+// remove table/XX/ once sorted/XX/ is done, some runs may be gone already
+static void removeruns(int prefix) {
+    char path[64];
 
-    bitmask = 1;
-    for (i = 0; i < 48; i++) {
-        if (hstate->shiftreg & bitmask) {
-            output = output ^ thisd[i];
+    for (uint64_t r = 0; r < numruns; r++) {
+        runpath(path, sizeof(path), prefix, r);
+        if (unlink(path) && (errno != ENOENT)) {
+            printf("cannot remove file %s\n", path);
+            exit(1);
         }
-
-        bitmask = bitmask << 1;
     }
-
-    hstate->shiftreg = output;
-    buildlfsr(hstate);
+    snprintf(path, sizeof(path), "table/%02x", prefix);
+    if (rmdir(path) && (errno != ENOENT)) {
+        printf("cannot remove dir %s\n", path);
+        exit(1);
+    }
 }
 
+// merge all runs of a first byte of keystream into sorted/XX/
+static void mergeprefix(int prefix, uint32_t *counts, uint64_t *offsets, uint64_t *spans, cursor_t *heap,
+                        unsigned char **in, size_t *inlen, unsigned char **out, size_t *outlen) {
+    char path[64];
+    size_t incap = threadmem / 2;
+    int first = 0;
+
+    // read the headers, offsets[r] is where the next bucket of run r starts
+    for (uint64_t r = 0; r < numruns; r++) {
+        runpath(path, sizeof(path), prefix, r);
+        readfile(path, (unsigned char *)(counts + (r * 0x100)), RUNHEADER, 0);
+        offsets[r] = RUNHEADER;
+    }
 
-// thread to build a part of the table
-static void *buildtable(void *dd) {
-    Hitag_State hstate;
-    Hitag_State hstate2;
-    unsigned long maxentries = 1;
-    int index = (int)(long)dd;
-    int tnum = NUM_BUILD_THREADS;
+    while (first < 0x100) {
+        uint64_t size = 0;
+        int last = first;
+
+        // as many buckets as fit in memory, at least one
+        while (last < 0x100) {
+            uint64_t bsize = 0;
+            for (uint64_t r = 0; r < numruns; r++) {
+                bsize += (uint64_t)counts[(r * 0x100) + last] * DATASIZE;
+            }
+            if ((last > first) && ((size + bsize) > incap)) {
+                break;
+            }
+            size += bsize;
+            last++;
+        }
 
-    /* set random state */
-    hstate.shiftreg = 0x123456789abc;
-    buildlfsr(&hstate);
+        if (size > *inlen) {
+            free(*in);
+            *in = (unsigned char *)malloc(size);
+            if (!*in) {
+                printf("mergeprefix: cannot malloc input buffer\n");
+                exit(1);
+            }
+            *inlen = size;
+        }
 
-    /* jump to offset using jump table 2 (2048) */
-    for (unsigned long i = 0; i < index; i++) {
-        jumpnsteps(&hstate, 2);
-    }
+        // one sequential read per run
+        size = 0;
+        for (uint64_t r = 0; r < numruns; r++) {
+            uint64_t len = 0;
+            for (int b = first; b < last; b++) {
+                len += (uint64_t)counts[(r * 0x100) + b] * DATASIZE;
+            }
+            if (len) {
+                runpath(path, sizeof(path), prefix, r);
+                readfile(path, *in + size, len, offsets[r]);
+            }
+            spans[r] = size;
+            offsets[r] += len;
+            size += len;
+        }
 
-    /* set max entries - this is a fraction of 2^37 depending on how many threads we are running.
-       1 thread  = 2^37
-       2 threads = 2^36
-       4 threads = 2^35
-       8 threads = 2^34
-       etc
-    */
-    maxentries = maxentries << 37;
-    while (!(tnum & 0x1)) {
-        maxentries = maxentries >> 1;
-        tnum = tnum >> 1;
-    }
+        for (int b = first; b < last; b++) {
+            uint64_t total = 0;
+            int n = 0;
+
+            for (uint64_t r = 0; r < numruns; r++) {
+                uint32_t count = counts[(r * 0x100) + b];
+                if (count) {
+                    heap[n].ptr = *in + spans[r];
+                    heap[n].left = count;
+                    n++;
+                    spans[r] += (uint64_t)count * DATASIZE;
+                    total += count;
+                }
+            }
 
-    /* make the entries */
-    for (unsigned long i = 0; i < maxentries; i++) {
+            if ((total * DATASIZE) > *outlen) {
+                free(*out);
+                *out = (unsigned char *)malloc(total * DATASIZE);
+                if (!*out) {
+                    printf("mergeprefix: cannot malloc output buffer\n");
+                    exit(1);
+                }
+                *outlen = total * DATASIZE;
+            }
 
-        // copy the current state
-        hstate2.shiftreg = hstate.shiftreg;
-        hstate2.lfsr = hstate.lfsr;
+            for (int i = (n / 2) - 1; i >= 0; i--) {
+                siftdown(heap, n, i);
+            }
 
-        // get 48 bits of keystream from hstate2
-        // this is split into 2 x 24 bit
-        uint32_t ks1 = hitag2_nstep(&hstate2, 24);
-        uint32_t ks2 = hitag2_nstep(&hstate2, 24);
+            unsigned char *ptr = *out;
+            while (n) {
+                memcpy(ptr, heap[0].ptr, DATASIZE);
+                ptr += DATASIZE;
+                heap[0].ptr += DATASIZE;
+                if (!--heap[0].left) {
+                    heap[0] = heap[--n];
+                }
+                siftdown(heap, n, 0);
+            }
 
-        write_ks_s(ks1, ks2, hstate.shiftreg);
+            snprintf(path, sizeof(path), "sorted/%02x/%02x.bin", prefix, b);
+            writefile(path, *out, total * DATASIZE);
+            snprintf(path, sizeof(path), "sorted/%02x/%02x.idx", prefix, b);
+            writeindex(path, *out, total);
+        }
 
-        // jump hstate forward 2048 * NUM_BUILD_THREADS states using di table
-        // this is because we're running NUM_BUILD_THREADS threads at once, from NUM_BUILD_THREADS
-        // different offsets that are 2048 states apart.
-        jumpnsteps(&hstate, 1);
+        first = last;
     }
 
-    return NULL;
-}
-
+    // mark it done once the files are on disk, then the runs can go
+    sync();
+    snprintf(path, sizeof(path), "sorted/%02x/done", prefix);
+    writefile(path, (const unsigned char *)"", 0);
 
-// make 'table/' (unsorted) and 'sorted/' dir structures
-static void makedirs(void) {
-    char path[32];
-    int i;
+    removeruns(prefix);
+}
 
-    if (mkdir("table", 0755)) {
-        printf("cannot make dir table\n");
-        exit(1);
-    }
-    if (mkdir("sorted", 0755)) {
-        printf("cannot make dir sorted\n");
+// thread to merge first bytes of keystream until there are none left
+static void *mergethread(void *dd) {
+    unsigned char *in = NULL, *out = NULL;
+    size_t inlen = 0, outlen = 0;
+    char path[64];
+    int prefix;
+
+    uint32_t *counts = (uint32_t *)malloc(numruns * RUNHEADER);
+    uint64_t *offsets = (uint64_t *)malloc(numruns * sizeof(uint64_t));
+    uint64_t *spans = (uint64_t *)malloc(numruns * sizeof(uint64_t));
+    cursor_t *heap = (cursor_t *)malloc(numruns * sizeof(cursor_t));
+    if (!counts || !offsets || !spans || !heap) {
+        printf("mergethread: cannot malloc run tables\n");
         exit(1);
     }
 
-    for (i = 0; i < 0x100; i++) {
-        snprintf(path, sizeof(path), "table/%02x", i);
-        if (mkdir(path, 0755)) {
-            printf("cannot make dir %s\n", path);
-            exit(1);
+    while (1) {
+        pthread_mutex_lock(&lock);
+        prefix = nextprefix++;
+        pthread_mutex_unlock(&lock);
+
+        if (prefix >= 0x100) {
+            break;
         }
-        snprintf(path, sizeof(path), "sorted/%02x", i);
-        if (mkdir(path, 0755)) {
-            printf("cannot make dir %s\n", path);
-            exit(1);
+
+        snprintf(path, sizeof(path), "sorted/%02x/done", prefix);
+        if (access(path, F_OK) == 0) {
+            removeruns(prefix);
+            continue;
         }
+
+        mergeprefix(prefix, counts, offsets, spans, heap, &in, &inlen, &out, &outlen);
+        printf("merge: sorted/%02x finished\n", prefix);
     }
-}
 
-static int datacmp(const void *p1, const void *p2, void *dummy) {
-    unsigned char *d_1 = (unsigned char *)p1;
-    unsigned char *d_2 = (unsigned char *)p2;
+    free(heap);
+    free(spans);
+    free(offsets);
+    free(counts);
+    free(in);
+    free(out);
 
-    return memcmp(d_1, d_2, DATASIZE);
+    return NULL;
 }
 
-static void *sorttable(void *dd) {
-    int i, j;
-    int fdin;
-    int fdout;
-    char infile[64];
-    char outfile[64];
-    unsigned char *data = NULL;
+
+// write the index files of a table that is already sorted
+static void indexsorted(void) {
+    char path[64];
     struct stat filestat;
-    int index = (int)(long)dd;
-    int space = 0x100 / NUM_SORT_THREADS;
+    unsigned char *data;
 
-    // create table - 50MB should be enough
-    unsigned char *table = (unsigned char *)calloc(1, 50UL * 1024UL * 1024UL);
-    if (!table) {
-        printf("sorttable: cannot calloc table\n");
+    if (isdir("table") || !isdir("sorted")) {
+        printf("there is no finished table in sorted/ to index\n");
         exit(1);
     }
 
-    // loop over our first byte values
-    for (i = (index * space); i < ((index + 1) * space); i++) {
-        // loop over all second byte values
-        for (j = 0; j < 0x100; j++) {
-
-            printf("sorttable: processing bytes 0x%02x/0x%02x\n", i, j);
-
-            // open file, stat it and mmap it
-            snprintf(infile, sizeof(infile), "table/%02x/%02x.bin", i, j);
-
-            fdin = open(infile, O_RDONLY);
-            if (fdin <= 0) {
-                printf("cannot open file %s\n", infile);
+    for (int i = 0; i < 0x100; i++) {
+        for (int j = 0; j < 0x100; j++) {
+            snprintf(path, sizeof(path), "sorted/%02x/%02x.bin", i, j);
+            int fd = open(path, O_RDONLY);
+            if (fd < 0) {
+                printf("cannot open file %s\n", path);
                 exit(1);
             }
-
-            if (fstat(fdin, &filestat)) {
-                printf("cannot stat file %s\n", infile);
+            if (fstat(fd, &filestat)) {
+                printf("cannot stat file %s\n", path);
                 exit(1);
             }
 
-            data = mmap((caddr_t)0, filestat.st_size, PROT_READ, MAP_PRIVATE, fdin, 0);
-            if (data == MAP_FAILED) {
-                printf("cannot mmap file %s\n", infile);
-                exit(1);
+            data = NULL;
+            if (filestat.st_size) {
+                data = mmap((caddr_t)0, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    printf("cannot mmap file %s\n", path);
+                    exit(1);
+                }
+                // only one entry in INDEXSTEP is read
+                madvise(data, filestat.st_size, MADV_RANDOM);
             }
 
-            // copy data into table
-            memcpy(table, data, filestat.st_size);
-
-            uint64_t numentries = filestat.st_size / DATASIZE;
+            snprintf(path, sizeof(path), "sorted/%02x/%02x.idx", i, j);
+            writeindex(path, data, filestat.st_size / DATASIZE);
 
-            // unmap file and close it
-            if (munmap(data, filestat.st_size)) {
-                printf("cannot munmap %s\n", infile);
-                exit(1);
+            if (data) {
+                munmap(data, filestat.st_size);
             }
+            close(fd);
+        }
+        printf("index: sorted/%02x finished\n", i);
+    }
+    sync();
+}
 
-            close(fdin);
+// pick up a table/ that was started before, or start a new one
+static void setup(unsigned int bits, int bitsgiven) {
+    char path[64];
+    char line[128];
+    unsigned int pbits;
+    uint64_t prunsize, run;
 
-            // sort it
-            void *dummy = NULL; // clang
-            qsort_r(table, numentries, DATASIZE, datacmp, dummy);
+    if (!isdir("table")) {
+        if (isdir("sorted")) {
+            printf("sorted/ is already there and there is no table/ to finish, remove sorted/ to build again\n");
+            exit(1);
+        }
 
-            // write to file
-            snprintf(outfile, sizeof(outfile), "sorted/%02x/%02x.bin", i, j);
-            fdout = open(outfile, O_WRONLY | O_CREAT, 0644);
-            if (fdout <= 0) {
-                printf("cannot create outfile %s\n", outfile);
-                exit(1);
-            }
-            if (write(fdout, table, numentries * DATASIZE)) {
-                printf("writetable cannot write all of the data\n");
-                exit(1);
-            }
-            close(fdout);
+        tablebits = bits;
+        numentries = 1ULL << tablebits;
+        runsize = threadmem / (2 * sizeof(entry_t));
+        // don't leave threads idle on small tables
+        if (runsize > ((numentries + numthreads - 1) / numthreads)) {
+            runsize = (numentries + numthreads - 1) / numthreads;
+        }
+        if (runsize < 0x10000) {
+            runsize = 0x10000;
+        }
 
-            // remove input file
-            if (unlink(infile)) {
-                printf("cannot remove file %s\n", infile);
-                exit(1);
-            }
+        makedir("table");
+        makedir("sorted");
+        for (int i = 0; i < 0x100; i++) {
+            snprintf(path, sizeof(path), "table/%02x", i);
+            makedir(path);
+            snprintf(path, sizeof(path), "sorted/%02x", i);
+            makedir(path);
         }
-    }
 
-    return NULL;
-}
+        progress = fopen(PROGRESSFILE, "w");
+        if (!progress) {
+            printf("cannot create %s\n", PROGRESSFILE);
+            exit(1);
+        }
+        fprintf(progress, PROGRESSMAGIC " %u %" PRIu64 "\n", tablebits, runsize);
+        if (fflush(progress) || fsync(fileno(progress))) {
+            printf("cannot write %s\n", PROGRESSFILE);
+            exit(1);
+        }
+    } else {
+        progress = fopen(PROGRESSFILE, "r+");
+        if (!progress) {
+            printf("table/ is there but %s is not, remove table/ and sorted/ to build again\n", PROGRESSFILE);
+            exit(1);
+        }
+        if (!fgets(line, sizeof(line), progress) ||
+                (sscanf(line, PROGRESSMAGIC " %u %" SCNu64, &pbits, &prunsize) != 2) ||
+                (pbits > TABLEBITS) || (prunsize == 0)) {
+            printf("%s is not valid\n", PROGRESSFILE);
+            exit(1);
+        }
+        if (bitsgiven && (pbits != bits)) {
+            printf("table/ is for a table of 2^%u entries, not 2^%u\n", pbits, bits);
+            exit(1);
+        }
 
-int main(int argc, char *argv[]) {
-    pthread_t threads[NUM_BUILD_THREADS];
-    void *status;
+        // the runs were cut with the memory of the first start, keep to it
+        tablebits = pbits;
+        numentries = 1ULL << tablebits;
+        runsize = prunsize;
+        if (threadmem < (runsize * 2 * sizeof(entry_t))) {
+            threadmem = runsize * 2 * sizeof(entry_t);
+        }
+    }
 
-    // make the table of tables
-    t = (struct table *)calloc(sizeof(struct table) * 65536, sizeof(uint8_t));
-    if (!t) {
-        printf("malloc failed\n");
+    numruns = (numentries + runsize - 1) / runsize;
+    rundone = (unsigned char *)calloc(numruns, sizeof(unsigned char));
+    if (!rundone) {
+        printf("cannot calloc run list\n");
         exit(1);
     }
 
-    // init the table
-    create_tables(t);
-
-    // create the directories
-    makedirs();
-
-    // build the jump table for incremental steps
-    builddi(2048 * NUM_BUILD_THREADS, 1);
-
-    // build the jump table for setting the offset
-    builddi(2048, 2);
-
-    // start the threads
-    for (long i = 0; i < NUM_BUILD_THREADS; i++) {
-        int ret = pthread_create(&(threads[i]), NULL, buildtable, (void *)(i));
-        if (ret) {
-            printf("cannot start buildtable thread %ld\n", i);
-            exit(1);
+    while (fgets(line, sizeof(line), progress)) {
+        if ((sscanf(line, "done %" SCNu64, &run) == 1) && (run < numruns) && !rundone[run]) {
+            rundone[run] = 1;
+            runsfinished++;
         }
     }
+    fseek(progress, 0, SEEK_END);
+}
 
-    if (debug) printf("main, started buildtable threads\n");
+static void usage(char *name) {
+    printf("%s [-t threads] [-m MiB] [-s bits] [-i]\n", name);
+    printf("  builds the table in table/ and sorted/ in the current directory\n");
+    printf("  -t  number of threads (default: number of cores)\n");
+    printf("  -m  memory to use in MiB (default: 3/4 of the available memory)\n");
+    printf("  -s  log2 of the number of table entries, %u for the full table (default: %u)\n", TABLEBITS, TABLEBITS);
+    printf("  -i  only write the index files of a table in sorted/\n");
+    printf("  run it again in the same directory to resume an interrupted build\n");
+    exit(1);
+}
 
-    // wait for threads to finish
-    for (long i = 0; i < NUM_BUILD_THREADS; i++) {
-        int ret = pthread_join(threads[i], &status);
-        if (ret) {
-            printf("cannot join buildtable thread %ld\n", i);
-            exit(1);
+int main(int argc, char *argv[]) {
+    pthread_t *threads;
+    uint64_t mem = 0;
+    unsigned int bits = TABLEBITS;
+    int bitsgiven = 0;
+    int opt;
+    time_t start;
+
+    numthreads = 0;
+
+    while ((opt = getopt(argc, argv, "t:m:s:ih")) != -1) {
+        switch (opt) {
+            case 't':
+                numthreads = atoi(optarg);
+                if (numthreads < 1) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'm':
+                mem = strtoull(optarg, NULL, 10) * 1024 * 1024;
+                if (!mem) {
+                    usage(argv[0]);
+                }
+                break;
+            case 's':
+                bits = atoi(optarg);
+                if ((bits < 16) || (bits > TABLEBITS)) {
+                    printf("table bits must be between 16 and %u\n", TABLEBITS);
+                    exit(1);
+                }
+                bitsgiven = 1;
+                break;
+            case 'i':
+                indexsorted();
+                return 0;
+            default:
+                usage(argv[0]);
         }
-        printf("buildtable thread %ld finished\n", i);
     }
 
-    // write all remaining files
-    for (long i = 0; i < 0x10000; i++) {
-        struct table *t1 = t + i;
-        if (t1->ptr > t1->data) {
-            writetable(t1);
-        }
+    if (!numthreads) {
+        numthreads = numcpus();
     }
+    if (!mem) {
+        mem = availmem();
+    }
+    threadmem = mem / numthreads;
+
+    setup(bits, bitsgiven);
 
-    // dump the memory
-    free_tables(t);
-    free(t);
+    threads = (pthread_t *)calloc(numthreads, sizeof(pthread_t));
+    if (!threads) {
+        printf("cannot calloc threads\n");
+        exit(1);
+    }
 
+    buildjumps();
 
+    printf("table of 2^%u entries in %" PRIu64 " runs of %" PRIu64 ", %d threads with %" PRIu64 " MiB each\n",
+           tablebits, numruns, runsize, numthreads, threadmem >> 20);
 
-    // now for the sorting
+    // build
+    start = time(NULL);
+    if (runsfinished < numruns) {
+        if (runsfinished) {
+            printf("build: resuming, %" PRIu64 " of %" PRIu64 " runs already done\n", runsfinished, numruns);
+        }
 
+        for (long i = 0; i < numthreads; i++) {
+            int ret = pthread_create(&(threads[i]), NULL, buildthread, (void *)(i));
+            if (ret) {
+                printf("cannot start buildthread %ld\n", i);
+                exit(1);
+            }
+        }
+
+        for (long i = 0; i < numthreads; i++) {
+            int ret = pthread_join(threads[i], NULL);
+            if (ret) {
+                printf("cannot join buildthread %ld\n", i);
+                exit(1);
+            }
+        }
+        printf("build: finished in %ld seconds\n", (long)(time(NULL) - start));
+    }
 
-    // start the threads
-    for (long i = 0; i < NUM_SORT_THREADS; i++) {
-        int ret = pthread_create(&(threads[i]), NULL, sorttable, (void *)(i));
+    // merge
+    start = time(NULL);
+    for (long i = 0; i < numthreads; i++) {
+        int ret = pthread_create(&(threads[i]), NULL, mergethread, (void *)(i));
         if (ret) {
-            printf("cannot start sorttable thread %ld\n", i);
+            printf("cannot start mergethread %ld\n", i);
             exit(1);
         }
     }
 
-    if (debug) printf("main, started sorttable threads\n");
-
-    // wait for threads to finish
-    for (long i = 0; i < NUM_SORT_THREADS; i++) {
-        int ret = pthread_join(threads[i], &status);
+    for (long i = 0; i < numthreads; i++) {
+        int ret = pthread_join(threads[i], NULL);
         if (ret) {
-            printf("cannot join sorttable thread %ld\n", i);
+            printf("cannot join mergethread %ld\n", i);
             exit(1);
         }
-        printf("sorttable thread %ld finished\n", i);
     }
+    printf("merge: finished in %ld seconds\n", (long)(time(NULL) - start));
 
-    pthread_exit(NULL);
+    // all done, clear up
+    fclose(progress);
+    if (unlink(PROGRESSFILE) || rmdir("table")) {
+        printf("cannot remove table/\n");
+        exit(1);
+    }
+    for (int i = 0; i < 0x100; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "sorted/%02x/done", i);
+        unlink(path);
+    }
+
+    free(threads);
+    free(rundone);
 
     return 0;
 }
-
-
-
-
@@ -1,6 +1,10 @@
 /*
  * ht2crack2gentests.c
  * this uses the RFIDler hitag2 PRNG code to generate test cases to test the tables
+ *
+ * With a second argument, the tests are made for a smaller table built with
+ * ht2crack2buildtable -s BITS: the key is worked back from a state in that table, so
+ * the search can find it.
  */
 
 #include "ht2crackutils.h"
@@ -32,6 +36,51 @@ static int makerandom(char *hex, unsigned int len, int fd) {
 }
 
 
+// makes a key for the given uid and nR that puts a state of the small table in the keystream,
+// this is recoverkey() of ht2crack2search the other way round
+static void makekey(char *key, size_t keylen, const uint64_t *d, unsigned int bits, char *uid, char *nR, int fd) {
+    Hitag_State hstate;
+    uint64_t index, keyrev, key64, init;
+    uint32_t offset, uidtmp, b = 0;
+
+    if (read(fd, &index, sizeof(index)) != sizeof(index) || read(fd, &offset, sizeof(offset)) != sizeof(offset)) {
+        printf("makekey: cannot read random bytes\n");
+        exit(1);
+    }
+
+    // a table state, 64 + offset steps into the keystream so the search window holds it
+    hstate.shiftreg = jumpnstate(d, 0x123456789abc, index & ((1ULL << bits) - 1));
+    rollback(&hstate, (offset % 2000) + 64);
+    init = hstate.shiftreg;
+
+    // key lower 16 bits are lower 16 bits of prng state
+    keyrev = init & 0xffff;
+
+    // rollback through the uid and extract bits b
+    uidtmp = rev32(hexreversetoulong(uid));
+    for (int i = 0; i < 32; i++) {
+        hstate.shiftreg = (hstate.shiftreg << 1) | ((uidtmp >> 31) & 0x1);
+        uidtmp = uidtmp << 1;
+        b = (b << 1) | fnf(hstate.shiftreg);
+    }
+
+    keyrev |= (uint64_t)(((init >> 16) & 0xffffffff) ^ rev32(hexreversetoulong(nR)) ^ b) << 16;
+
+    key64 = rev64(keyrev);
+    for (int i = 0; i < 6; i++) {
+        snprintf(key + (2 * i), keylen - (2 * i), "%02X", (int)(key64 & 0xff));
+        key64 = key64 >> 8;
+    }
+
+    // check it
+    hitag2_init(&hstate, rev64(hexreversetoulonglong(key)), rev32(hexreversetoulong(uid)), rev32(hexreversetoulong(nR)));
+    if (hstate.shiftreg != init) {
+        printf("makekey: key %s does not give the table state\n", key);
+        exit(1);
+    }
+}
+
+
 int main(int argc, char *argv[]) {
     Hitag_State hstate;
     char key[32];
@@ -41,9 +90,11 @@ int main(int argc, char *argv[]) {
     int i, j;
     int numtests;
     int urandomfd;
+    unsigned int tablebits = 0;
+    uint64_t d[48];
 
     if (argc < 2) {
-        printf("%s number\n", argv[0]);
+        printf("%s number [tablebits]\n", argv[0]);
         exit(1);
     }
 
@@ -53,6 +104,15 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
+    if (argc > 2) {
+        tablebits = atoi(argv[2]);
+        if ((tablebits < 1) || (tablebits > 37)) {
+            printf("tablebits must be between 1 and 37\n");
+            exit(1);
+        }
+        buildjump(d, 2048);
+    }
+
     urandomfd = open("/dev/urandom", O_RDONLY);
     if (urandomfd <= 0) {
         printf("cannot open /dev/urandom\n");
@@ -62,9 +122,13 @@ int main(int argc, char *argv[]) {
 
     for (i = 0; i < numtests; i++) {
 
-        makerandom(key, 6, urandomfd);
         makerandom(uid, 4, urandomfd);
         makerandom(nR, 4, urandomfd);
+        if (tablebits) {
+            makekey(key, sizeof(key), d, tablebits, uid, nR, urandomfd);
+        } else {
+            makerandom(key, 6, urandomfd);
+        }
         snprintf(filename, sizeof(filename), "keystream.key-%s.uid-%s.nR-%s", key, uid, nR);
 
         FILE *fp = fopen(filename, "w");
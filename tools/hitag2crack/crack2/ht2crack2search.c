@@ -2,18 +2,39 @@
  * ht2crack2search.c
  * this searches the sorted tables for the given RNG data, retrieves the matching
  * PRNG state, checks it is correct, and then rolls back the PRNG to recover the key
+ *
+ * All 48 bit windows of the RNG data are looked up in one go, sorted in table order, so
+ * each table file is opened once and read front to back.  With the sorted/XX/YY.idx index
+ * that ht2crack2buildtable writes, each lookup reads one block of the file, else it falls
+ * back to a binary search of the whole file.
  */
 
 #include "ht2crackutils.h"
+#include <time.h>
 
 #define INPUTFILE "sorted/%02x/%02x.bin"
+#define INDEXFILE "sorted/%02x/%02x.idx"
 #define DATASIZE 10
 
+// one index entry for every INDEXSTEP table entries, must match ht2crack2buildtable.c
+#define INDEXSTEP 4096
+
 struct rngdata {
     unsigned char *data;
     int len;
 };
 
+// a 48 bit window of the rng data to look up
+struct cand {
+    unsigned char c[6];         // keystream at bitoffset
+    unsigned char rngtest[6];   // keystream 48 bits on, or back, to confirm a match
+    int fwd;
+    int bitoffset;
+    uint64_t start;             // table entry to start the scan at
+    unsigned char match[6];
+    unsigned char state[6];
+};
+
 static int datacmp(const void *p1, const void *p2) {
     unsigned char *d1 = (unsigned char *)p1;
     unsigned char *d2 = (unsigned char *)p2;
@@ -152,21 +173,85 @@ static int testcand(const unsigned char *f, unsigned char *rt, int fwd) {
     }
 }
 
-static int searchcand(unsigned char *c, unsigned char *rt, int fwd, unsigned char *m, unsigned char *s) {
-    int fd;
-    struct stat filestat;
+// compare candidates by table file and keystream, so each file is swept once and in order
+static int candcmp(const void *p1, const void *p2) {
+    const struct cand *c1 = (const struct cand *)p1;
+    const struct cand *c2 = (const struct cand *)p2;
+    int ret = memcmp(c1->c, c2->c, 6);
+
+    if (ret)
+        return ret;
+    return c1->bitoffset - c2->bitoffset;
+}
+
+// load the index of a table file, returns the number of index entries or 0 if there is none
+static uint64_t loadindex(unsigned char **index, int d1, int d2) {
     char file[64];
-    unsigned char *data;
-    unsigned char item[10];
-    unsigned char *found = NULL;
+    struct stat filestat;
+    int fd;
 
+    snprintf(file, sizeof(file), INDEXFILE, d1, d2);
 
-    if (!c || !rt || !m || !s) {
-        printf("searchcand: invalid params\n");
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
         return 0;
     }
 
-    snprintf(file, sizeof(file), INPUTFILE, c[0], c[1]);
+    if (fstat(fd, &filestat) || (filestat.st_size < 4)) {
+        close(fd);
+        return 0;
+    }
+
+    *index = (unsigned char *)malloc(filestat.st_size);
+    if (!*index) {
+        printf("cannot malloc index\n");
+        exit(1);
+    }
+
+    if (read(fd, *index, filestat.st_size) != filestat.st_size) {
+        printf("cannot read index %s\n", file);
+        exit(1);
+    }
+
+    close(fd);
+
+    return filestat.st_size / 4;
+}
+
+// first entry of the table block that can hold item, from the index
+static uint64_t indexstart(const unsigned char *index, uint64_t n, const unsigned char *item) {
+    uint64_t lo = 0;
+    uint64_t hi = n;
+
+    // find the first index entry >= item, the block before it starts lower
+    while (lo < hi) {
+        uint64_t mid = lo + ((hi - lo) / 2);
+        if (memcmp(index + (mid * 4), item, 4) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (lo ? lo - 1 : 0) * INDEXSTEP;
+}
+
+// look up all candidates of one table file, returns the number of candidates done
+static int searchfile(struct cand *cands, int numcands, struct cand **best) {
+    int fd;
+    struct stat filestat;
+    char file[64];
+    unsigned char *data;
+    unsigned char *index = NULL;
+    uint64_t numindex;
+    uint64_t numentries;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    int n;
+
+    // all candidates with the same first two bytes
+    for (n = 1; (n < numcands) && !memcmp(cands[n].c, cands[0].c, 2); n++);
+
+    snprintf(file, sizeof(file), INPUTFILE, cands[0].c[0], cands[0].c[1]);
 
     fd = open(file, O_RDONLY);
     if (fd <= 0) {
@@ -179,53 +264,90 @@ static int searchcand(unsigned char *c, unsigned char *rt, int fwd, unsigned cha
         exit(1);
     }
 
+    numentries = filestat.st_size / DATASIZE;
+    if (!numentries) {
+        close(fd);
+        return n;
+    }
+
     data = mmap((caddr_t)0, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
     if (data == MAP_FAILED) {
         printf("cannot mmap file %s\n", file);
         exit(1);
     }
 
-    memcpy(item, c + 2, 4);
+    // no read-ahead for the lookups, only for the blocks we ask for
+    madvise(data, filestat.st_size, MADV_RANDOM);
 
-    found = (unsigned char *)bsearch(item, data, filestat.st_size / DATASIZE, DATASIZE, datacmp);
+    numindex = loadindex(&index, cands[0].c[0], cands[0].c[1]);
+
+    // find where each candidate starts, and ask for all the blocks before reading any of them
+    for (int i = 0; i < n; i++) {
+        if (numindex) {
+            cands[i].start = indexstart(index, numindex, cands[i].c + 2);
+
+            uint64_t from = (cands[i].start * DATASIZE) & ~(pagesize - 1);
+            uint64_t len = (cands[i].start * DATASIZE) - from + ((INDEXSTEP + 1) * DATASIZE);
+            if ((from + len) > (uint64_t)filestat.st_size) {
+                len = filestat.st_size - from;
+            }
+            madvise(data + from, len, MADV_WILLNEED);
+        } else {
+            unsigned char *found = (unsigned char *)bsearch(cands[i].c + 2, data, numentries, DATASIZE, datacmp);
+            if (found) {
+                // go backwards to the first match
+                while (((found - data) >= DATASIZE) && (!memcmp(found - DATASIZE, cands[i].c + 2, 4))) {
+                    found = found - DATASIZE;
+                }
+                cands[i].start = (found - data) / DATASIZE;
+            } else {
+                cands[i].start = numentries;
+            }
+        }
+    }
 
-    if (found) {
+    // now test all matches
+    for (int i = 0; i < n; i++) {
+        unsigned char *found = data + (cands[i].start * DATASIZE);
+        unsigned char *end = data + (numentries * DATASIZE);
 
-        // our candidate is in the table
-        // go backwards and see if there are other matches
-        while (((found - data) >= DATASIZE) && (!memcmp(found - DATASIZE, item, 4))) {
-            found = found - DATASIZE;
+        // a match at a lower bit offset is already there
+        if (*best && ((*best)->bitoffset < cands[i].bitoffset)) {
+            continue;
         }
 
-        // now test all matches
-        while (((found - data) <= (filestat.st_size - DATASIZE)) && (!memcmp(found, item, 4))) {
-            if (testcand(found, rt, fwd)) {
-                memcpy(m, c, 2);
-                memcpy(m + 2, found, 4);
-                memcpy(s, found + 4, 6);
+        while ((found < end) && (memcmp(found, cands[i].c + 2, 4) < 0)) {
+            found = found + DATASIZE;
+        }
 
-                munmap(data, filestat.st_size);
-                close(fd);
-                return 1;
+        while ((found < end) && (!memcmp(found, cands[i].c + 2, 4))) {
+            if (testcand(found, cands[i].rngtest, cands[i].fwd)) {
+                memcpy(cands[i].match, cands[i].c, 2);
+                memcpy(cands[i].match + 2, found, 4);
+                memcpy(cands[i].state, found + 4, 6);
+                *best = cands + i;
+                break;
             }
 
             found = found + DATASIZE;
         }
     }
 
+    free(index);
     munmap(data, filestat.st_size);
     close(fd);
 
-    return 0;
-
+    return n;
 }
 
 static int findmatch(struct rngdata *r, unsigned char *outmatch, unsigned char *outstate, int *bitoffset) {
     int i;
     int bitlen;
-    unsigned char cand[6];
-    unsigned char rngtest[6];
-    int fwd;
+    int numcands;
+    struct cand *cands;
+    struct cand *best = NULL;
+    struct timespec start, now;
+    double elapsed;
 
     if (!r || !outmatch || !outstate || !bitoffset) {
         printf("findmatch: invalid params\n");
@@ -233,42 +355,73 @@ static int findmatch(struct rngdata *r, unsigned char *outmatch, unsigned char *
     }
 
     bitlen = r->len * 8;
+    if (bitlen < 96) {
+        printf("findmatch: need at least 96 bits of rng data\n");
+        return 0;
+    }
 
-    for (i = 0; i <= bitlen - 48; i++) {
-        // print progress
-        if ((i % 100) == 0) {
-            printf("searching on bit %d\n", i);
-        }
+    numcands = bitlen - 48 + 1;
+    cands = (struct cand *)calloc(numcands, sizeof(struct cand));
+    if (!cands) {
+        printf("findmatch: cannot calloc candidates\n");
+        return 0;
+    }
+
+    for (i = 0; i < numcands; i++) {
+        cands[i].bitoffset = i;
 
-        if (!makecand(cand, r, i)) {
+        if (!makecand(cands[i].c, r, i)) {
             printf("cannot makecand, %d\n", i);
+            free(cands);
             return 0;
         }
-//        printf("cand: %02x %02x %02x %02x %02x %02x : ", cand[0], cand[1], cand[2], cand[3], cand[4], cand[5]);
-//        printbin(cand);
 
         /* make following or preceding RNG test data to confirm match */
         if (i < (bitlen - 96)) {
-            if (!makecand(rngtest, r, i + 48)) {
+            if (!makecand(cands[i].rngtest, r, i + 48)) {
                 printf("cannot makecand rngtest %d + 48\n", i);
+                free(cands);
                 return 0;
             }
-            fwd = 1;
+            cands[i].fwd = 1;
         } else {
-            if (!makecand(rngtest, r, i - 48)) {
+            if (!makecand(cands[i].rngtest, r, i - 48)) {
                 printf("cannot makecand rngtest %d - 48\n", i);
+                free(cands);
                 return 0;
             }
-            fwd = 0;
+            cands[i].fwd = 0;
         }
+    }
+
+    // look them up in table order
+    qsort(cands, numcands, sizeof(struct cand), candcmp);
 
-        if (searchcand(cand, rngtest, fwd, outmatch, outstate)) {
-            *bitoffset = i;
-            return 1;
+    printf("searching on bits 0 to %d\n", numcands - 1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < numcands;) {
+        i += searchfile(cands + i, numcands - i, &best);
+
+        // print progress
+        if ((i / 100) != ((i - 1) / 100)) {
+            printf("searched %d of %d\n", i, numcands);
         }
     }
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    return 0;
+    elapsed = (now.tv_sec - start.tv_sec) + ((now.tv_nsec - start.tv_nsec) / 1e9);
+    printf("%d lookups in %.3f seconds, %.0f lookups/s\n", numcands, elapsed, (elapsed > 0) ? numcands / elapsed : 0.0);
+
+    if (best) {
+        memcpy(outmatch, best->match, 6);
+        memcpy(outstate, best->state, 6);
+        *bitoffset = best->bitoffset;
+    }
+
+    free(cands);
+
+    return best != NULL;
 }
 
 static void rollbackrng(Hitag_State *hstate, const unsigned char *s, int offset) {
@@ -1,3 +1,5 @@
+RET=0
 for i in keystream*; do
-./runtest.sh $i
+./runtest.sh $i || RET=1
 done
+exit $RET
@@ -19,7 +19,18 @@ echo "UID           = $UIDV"
 echo "NR            = $NR"
 echo "Expected KEY  = $KEYV"
 
-./ht2crack2search $filename $UIDV $NR
+LOG=`mktemp`
+./ht2crack2search $filename $UIDV $NR | tee $LOG
+FOUNDV=`grep "^KEY:" $LOG | cut -f3`
+rm -f $LOG
 echo "Expected KEY  = $KEYV"
+if [ "$FOUNDV" == "$KEYV" ]; then
+echo "Key recovered"
+RET=0
+else
+echo "Key not recovered"
+RET=1
+fi
 echo "********************"
 echo ""
+exit $RET
@@ -0,0 +1,66 @@
+/* ht2crack5_core.h
+ *
+ * The bitsliced search of ht2crack5.  ht2crack5_core.c is compiled once per
+ * instruction set, the one to use is chosen at runtime.
+ */
+
+#ifndef HT2CRACK5_CORE_H__
+#define HT2CRACK5_CORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if ( defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) ) && \
+    ( !defined(__APPLE__) || \
+      (defined(__APPLE__) && (__clang_major__ > 8 || __clang_major__ == 8 && __clang_minor__ >= 1)) )
+#  define COMPILER_HAS_SIMD_X86
+#  if defined(COMPILER_HAS_SIMD_X86) && ((__GNUC__ >= 5) && (__GNUC__ > 5 || __GNUC_MINOR__ > 2))
+#    define COMPILER_HAS_SIMD_AVX512
+#  endif
+#endif
+
+// ARM64 mandates implementation of NEON
+#if defined(__arm64__) || defined(__aarch64__)
+#define COMPILER_HAS_SIMD_NEON
+#define arm_has_neon() (true)
+// ARMv7 or older, NEON is optional and autodetection is difficult
+#elif defined(__ARM_NEON)
+#define COMPILER_HAS_SIMD_NEON
+#define arm_has_neon() (false)
+#endif
+
+typedef enum {
+    SIMD_AUTO,
+#if defined(COMPILER_HAS_SIMD_AVX512)
+    SIMD_AVX512,
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+    SIMD_AVX2,
+    SIMD_AVX,
+    SIMD_SSE2,
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+    SIMD_NEON,
+#endif
+    SIMD_NONE,
+} SIMDExecInstr;
+
+// called with every state that produces the whole first aR
+typedef void crack5_try_state_t(uint64_t state);
+
+typedef struct {
+    SIMDExecInstr instr;
+    const char *name;
+    unsigned int slices;                                    // states tested at once
+    void (*init)(uint32_t target);                          // once, before any search
+    void (*search)(uint64_t state0, crack5_try_state_t *try_state);   // all states following a layer 0 state
+} crack5_impl_t;
+
+// best instruction set of this CPU
+SIMDExecInstr crack5_simd_auto(void);
+// false if the instruction set is not usable on this CPU
+bool crack5_get_impl(SIMDExecInstr instr, crack5_impl_t *impl);
+// SIMD_AUTO if the name is not known
+SIMDExecInstr crack5_simd_from_name(const char *name);
+
+#endif
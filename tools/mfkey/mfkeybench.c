@@ -0,0 +1,135 @@
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "crapto1/crapto1.h"
+
+// Benchmark lfsr_recovery32: allocating per call (legacy API) vs reusing a recovery context,
+// sequential and multi-threaded.
+
+typedef struct {
+    uint64_t key;
+    uint32_t uid;
+    uint32_t nt;
+    uint32_t nr;
+    uint32_t ks2;
+} sample_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rand32(void) {
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static void make_sample(sample_t *s) {
+    s->key = ((uint64_t)rand32() << 16 ^ rand32()) & 0xFFFFFFFFFFFF;
+    s->uid = rand32();
+    s->nt = rand32();
+    s->nr = rand32();
+
+    struct Crypto1State *cs = crypto1_create(s->key);
+    crypto1_word(cs, s->uid ^ s->nt, 0);
+    crypto1_word(cs, s->nr, 1);
+    s->ks2 = crypto1_word(cs, 0, 0);
+    crypto1_destroy(cs);
+}
+
+// roll back all candidate states, returns true if the real key is among them
+static bool check_states(struct Crypto1State *sl, const sample_t *s, uint32_t *count) {
+    bool found = false;
+    *count = 0;
+    for (struct Crypto1State *t = sl; t->odd | t->even; ++t) {
+        uint64_t key;
+        lfsr_rollback_word(t, 0, 0);
+        lfsr_rollback_word(t, s->nr, 1);
+        lfsr_rollback_word(t, s->uid ^ s->nt, 0);
+        crypto1_get_lfsr(t, &key);
+        if (key == s->key)
+            found = true;
+        (*count)++;
+    }
+    return found;
+}
+
+// recover all samples with the given context, returns number of failures
+static int run_ctx(crypto1_recovery_ctx_t *ctx, const sample_t *samples, const uint32_t *counts, int n) {
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        uint32_t count = 0;
+        struct Crypto1State *sl = lfsr_recovery32_ctx(ctx, samples[i].ks2, 0);
+        if (sl == NULL || check_states(sl, &samples[i], &count) == false || count != counts[i])
+            failed++;
+    }
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int n = 50;
+    int threads = 4;
+
+    printf("MIFARE Classic lfsr_recovery32 benchmark\n\n");
+
+    if (argc > 1)
+        n = atoi(argv[1]);
+    if (argc > 2)
+        threads = atoi(argv[2]);
+
+    if (n <= 0 || threads <= 0) {
+        printf("syntax: %s [iterations] [threads]\n\n", argv[0]);
+        return 1;
+    }
+
+    srand(0x1337);
+    sample_t *samples = calloc(n, sizeof(sample_t));
+    uint32_t *counts = calloc(n, sizeof(uint32_t));
+    if (samples == NULL || counts == NULL) {
+        printf("Memory allocation error\n");
+        return 1;
+    }
+    for (int i = 0; i < n; i++)
+        make_sample(&samples[i]);
+
+    // legacy API, allocates and frees all tables on every call
+    int failed = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < n; i++) {
+        struct Crypto1State *sl = lfsr_recovery32(samples[i].ks2, 0);
+        if (sl == NULL || check_states(sl, &samples[i], &counts[i]) == false)
+            failed++;
+        free(sl);
+    }
+    double t_legacy = now_sec() - t0;
+
+    // context API, tables allocated once
+    t0 = now_sec();
+    crypto1_recovery_ctx_t *ctx = crypto1_recovery_ctx_create();
+    if (ctx == NULL) {
+        printf("Memory allocation error\n");
+        return 1;
+    }
+    failed += run_ctx(ctx, samples, counts, n);
+    double t_ctx = now_sec() - t0;
+
+    // context API, first level buckets spread over threads
+    threads = crypto1_recovery_ctx_set_threads(ctx, threads);
+    t0 = now_sec();
+    failed += run_ctx(ctx, samples, counts, n);
+    double t_mt = now_sec() - t0;
+    crypto1_recovery_ctx_free(ctx);
+
+    printf("recoveries          : %d\n", n);
+    printf("lfsr_recovery32     : %8.3f s  %8.1f recoveries/s\n", t_legacy, n / t_legacy);
+    printf("lfsr_recovery32_ctx : %8.3f s  %8.1f recoveries/s  ( %.2fx )\n", t_ctx, n / t_ctx, t_legacy / t_ctx);
+    printf("  with %2d threads   : %8.3f s  %8.1f recoveries/s  ( %.2fx )\n", threads, t_mt, n / t_mt, t_legacy / t_mt);
+    printf("\n%s\n", failed ? "Benchmark FAILED, results differ" : "Results match");
+
+    free(samples);
+    free(counts);
+    return failed ? 1 : 0;
+}
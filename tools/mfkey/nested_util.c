@@ -77,7 +77,7 @@ static countKeys *uniqsort(uint64_t *possibleKeys, uint32_t size) {
 
 // nested decrypt
 static void *nested_revover(void *args) {
-    struct Crypto1State *revstate, * revstate_start = NULL;
+    struct Crypto1State *revstate;
     uint64_t lfsr = 0;
     uint32_t i, kcount = 0;
     bool is_ok = true;
@@ -87,6 +87,13 @@ static void *nested_revover(void *args) {
     rp->keyCount = 0;
     rp->keys = NULL;
 
+    // scratch memory reused for all recoveries done by this thread
+    crypto1_recovery_ctx_t *rctx = crypto1_recovery_ctx_create();
+    if (rctx == NULL) {
+        printf("Memory allocation error for recovery context\n");
+        return NULL;
+    }
+
     //printf("Start pos is %d, End pos is %d\r\n", rp->startPos, rp->endPos);
 
     for (i = rp->startPos; i < rp->endPos; i++) {
@@ -100,9 +107,11 @@ static void *nested_revover(void *args) {
         */
 
         // And finally recover the first 32 bits of the key
-        revstate = lfsr_recovery32(ks1, nt_probe);
-        if (revstate_start == NULL) {
-            revstate_start = revstate;
+        revstate = lfsr_recovery32_ctx(rctx, ks1, nt_probe);
+        if (revstate == NULL) {
+            printf("Memory allocation error for recovery statelist\n");
+            is_ok = false;
+            break;
         }
 
         while ((revstate->odd != 0x0) || (revstate->even != 0x0)) {
@@ -125,8 +134,6 @@ static void *nested_revover(void *args) {
             revstate++;
         }
         --kcount;
-        free(revstate_start);
-        revstate_start = NULL;
         if (!is_ok) {
             break;
         }
@@ -147,6 +154,7 @@ static void *nested_revover(void *args) {
         rp->keyCount = 0;
         free(rp->keys);
     }
+    crypto1_recovery_ctx_free(rctx);
     return NULL;
 }
 
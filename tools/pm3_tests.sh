@@ -328,6 +328,11 @@ while true; do
       if ! CheckFileExist "ht2crack2search exists"         "$HT2CRACK2PATH/ht2crack2search"; then break; fi
       # 1.5Tb tables are supposed to be absent, so it's just a fast check without real cracking
       if ! CheckExecute "ht2crack2 quick test"             "cd $HT2CRACK2PATH; ./ht2crack2gentest 1 && ./runalltests.sh; rm keystream*" "searching on bit"; then break; fi
+      # a 2^20 entries table built in a temporary dir, with tests made to be found in it
+      if ! CheckExecute "ht2crack2 small table test"       "cd $HT2CRACK2PATH; HT2CRACK2TMP=\$(mktemp -d) && \
+                                                            ln -s \$PWD/ht2crack2search \$PWD/runtest.sh \$PWD/runalltests.sh \$HT2CRACK2TMP && \
+                                                            cd \$HT2CRACK2TMP && \$OLDPWD/ht2crack2buildtable -s 20 >/dev/null && \$OLDPWD/ht2crack2gentest 2 20 && \
+                                                            ./runalltests.sh >/dev/null 2>&1 && echo SUCCESS; rm -rf \$HT2CRACK2TMP" "SUCCESS"; then break; fi
 
       echo -e "\n${C_BLUE}Testing ht2crack3:${C_NC} ${HT2CRACK3PATH:=./tools/hitag2crack/crack3/}"
       if ! CheckFileExist "ht2crack3 exists"               "$HT2CRACK3PATH/ht2crack3"; then break; fi
@@ -363,6 +368,7 @@ while true; do
       HT2CRACK5NRAR="71DA20AA 7EFDF3FA 2A4265F9 59653B07"
       # Order of magnitude to crack it: ~12s on 1 core, ~3s on 4 cores -> tagged as "slow"
       if ! CheckExecute slow "ht2crack5 test"              "cd $HT2CRACK5PATH; ./ht2crack5 $HT2CRACK5UID $HT2CRACK5NRAR" "Key: $HT2CRACK5KEY"; then break; fi
+      if ! CheckExecute slow "ht2crack5 nosimd test"       "cd $HT2CRACK5PATH; ./ht2crack5 -s nosimd $HT2CRACK5UID $HT2CRACK5NRAR" "Key: $HT2CRACK5KEY"; then break; fi
 
       echo -e "\n${C_BLUE}Testing ht2crack5opencl:${C_NC} ${HT2CRACK5OPENCLPATH:=./tools/hitag2crack/crack5opencl/}"
       if ! CheckFileExist "ht2crack5opencl exists"            "$HT2CRACK5OPENCLPATH/ht2crack5opencl"; then break; fi
@@ -399,15 +405,33 @@ while true; do
         if ! CheckExecute "script run pyscript"              "$CLIENTBIN -c 'script run parity.py 10 1234'" "Even parity"; then break; fi
       fi
 
+      CheckExecute ignore "check Lua SWIG support"      "$CLIENTBIN -c 'hw version'" "Lua SWIG support.*present"
+      if [ $RESULT -eq 0 ]; then
+        if ! CheckExecute "script run lua capture"           "$CLIENTBIN -c 'script run client/experimental_client_with_swig/testembedded_capture.lua'" "id:.*010872E77C"; then break; fi
+      fi
+      CheckExecute ignore "check Python SWIG support"   "$CLIENTBIN -c 'hw version'" "Python SWIG support.*present"
+      if [ $RESULT -eq 0 ]; then
+        if ! CheckExecute "script run python capture"        "$CLIENTBIN -c 'script run client/experimental_client_with_swig/testembedded_capture.py'" "id: 010872E77C"; then break; fi
+      fi
+
       echo -e "\n${C_BLUE}Testing data manipulation:${C_NC}"
       if ! CheckExecute "reveng readline test"    "$CLIENTBIN -c 'reveng -h;reveng -D'" "CRC-64/GO-ISO"; then break; fi
       if ! CheckExecute "reveng -g test"          "$CLIENTBIN -c 'reveng -g abda202c'" "CRC-16/ISO-IEC-14443-3-A"; then break; fi
       if ! CheckExecute "reveng -w test"          "$CLIENTBIN -c 'reveng -w 8 -s 01020304e3 010204039d'" "CRC-8/SMBUS"; then break; fi
+      if ! CheckExecute "reveng -s search test"   "$CLIENTBIN -c 'reveng -w 16 -F -s 01020304059304 a1b2c3d4e5864f 0a0b0c0d0e0fbb6e'" "poly=0x1021  init=0xffff"; then break; fi
+      if ! CheckExecute "reveng -T bench test"    "$CLIENTBIN -c 'reveng -w 12 -T'" "total .*x  ok"; then break; fi
+      if ! CheckExecute "analyse crc bench test"  "$CLIENTBIN -c 'analyse crc --bench'" "match the bitwise reference"; then break; fi
+      if ! CheckExecute "data bench test"         "$CLIENTBIN -c 'data bench --max 100000'" "match the reference"; then break; fi
+      if ! CheckExecute "hw emu bench test"       "$CLIENTBIN -c 'hw emu; hw bench -n 20 --dl 2'" "Download content \( ok \)"; then break; fi
+      if ! CheckExecute "hw emu lossy bench test" "$CLIENTBIN -c 'hw emu --drop 7 --wtx 20 --crc; hw bench -n 5 --dl 2'" "Download content \( ok \)"; then break; fi
       if ! CheckExecute "mfu pwdgen test"         "$CLIENTBIN -c 'hf mfu pwdgen -t'" "Selftest ok"; then break; fi
       if ! CheckExecute "mfu keygen test"         "$CLIENTBIN -c 'hf mfu keygen --uid 11223344556677'" "80 B1 C2 71 D8 A0"; then break; fi
       if ! CheckExecute "jooki encode test"       "$CLIENTBIN -c 'hf jooki encode -t'" "04 28 F4 DA F0 4A 81  \( ok \)"; then break; fi
       if ! CheckExecute "trace load/list 14a"     "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a;'" "READBLOCK\(8\)"; then break; fi
       if ! CheckExecute "trace load/list x"       "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -x1 -t 14a;'" "0.0101840425"; then break; fi
+      if ! CheckExecute "trace load/list range"   "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a --start 20 -n 1;'" "Showing records 20 - 20 of 22"; then break; fi
+      if ! CheckExecute "trace load/list threads" "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfuc_defaultkey.trace; trace list -1 -t 14a --threads 2;'" "AUTH-2 ANSW OK"; then break; fi
+      if ! CheckExecute "trace load/list mf keys" "$CLIENTBIN -c 'trace load -f traces/hf_mf_hid_sio_sim.trace; trace list -1 -t mf;'" "key 3B7E4FD575AD"; then break; fi
       if ! CheckExecute "nfc decode test - oob"          "$CLIENTBIN -c 'nfc decode -d DA2010016170706C69636174696F6E2F766E642E626C7565746F6F74682E65702E6F6F62301000649201B96DFB0709466C65782032'" "Flex 2"; then break; fi
       if ! CheckExecute "nfc decode test - device info"  "$CLIENTBIN -c 'nfc decode -d d1025744690004536f6e79010752432d533338300220426c61636b204e46432052656164657220636f6e6e656374656420746f2050430310123e4567e89b12d3a45642665544000004124e464320506f72742d3130302076312e3032'" "NFC Port-100 v1.02"; then break; fi
       if ! CheckExecute "nfc decode test - vcard"        "$CLIENTBIN -c 'nfc decode -d d20ca3746578742f782d7643617264424547494e3a56434152440a56455253494f4e3a332e300a4e3a43687269733b4963656d616e3b3b3b0a464e3a476f7468656e627572670a5245563a323032312d30362d32345432303a31353a30385a0a6974656d322e582d4142444154453b747970653d707265663a323032302d30362d32340a4954454d322e582d41424c4142454c3a5f24213c416e6e69766572736172793e21245f0a454e443a56434152440a'" "END:VCARD"; then break; fi
@@ -420,6 +444,8 @@ while true; do
                                                                      "COTAG Found: FC 220, CN: 8331 Raw: FFB841170363FFFE00001E7F00000000"; then break; fi
       if ! CheckExecute "lf AWID test"               "$CLIENTBIN -c 'data load -f traces/lf_AWID-15-259.pm3;lf search -1'" "AWID ID found"; then break; fi
       if ! CheckExecute "lf EM410x test"             "$CLIENTBIN -c 'data load -f traces/lf_EM4102-1.pm3;lf search -1'" "EM410x ID found"; then break; fi
+      if ! CheckExecute "lf search timing test"      "$CLIENTBIN -c 'data load -f traces/lf_EM4102-1.pm3;lf search -1c --timing'" "demodulations, [0-9]+ reused"; then break; fi
+      if ! CheckExecute "lf batch test"              "$CLIENTBIN -c 'lf batch -d traces --threads 2'" "\"file\":\"traces/lf_EM4102-1.pm3\".*EM 410x ID 010872E77C"; then break; fi
       if ! CheckExecute "lf EM4x05 test"             "$CLIENTBIN -c 'data load -f traces/lf_EM4x05.pm3;lf search -1'" "FDX-B ID found"; then break; fi
       if ! CheckExecute "lf EM4x70 calc test"        "$CLIENTBIN -c 'lf em 4x70 calc --key F32AA98CF5BE4ADFA6D3480B --rnd 45F54ADA252AAC'" "FRN: 4866BB70  GRN: 9BD180"; then break; fi
       if ! CheckExecute "lf EM4x70 recover test 1/3" "$CLIENTBIN -c 'lf em 4x70 recover --key 022A028C02BE --rnd 7D5167003571F8 --frn 982DBCC0 --grn 36C0E0'" "022a028c02be000102030405"; then break; fi
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+
+# Benchmark of `trace list` decoding,  one thread against a worker pool.
+# Every trace in traces/ with a protocol that can be decoded in parallel is repeated
+# until it is a few MB,  listed both ways and the output compared.
+#
+# usage: tools/pm3_trace_bench.sh [threads] [size in kB]
+
+PM3PATH="$(dirname "$0")/.."
+cd "$PM3PATH" || exit 1
+
+CLIENTBIN="./client/proxmark3"
+THREADS=${1:-4}
+SIZEKB=${2:-4096}
+
+if [ ! -x "$CLIENTBIN" ]; then
+    echo "$CLIENTBIN not found, build the client first"
+    exit 1
+fi
+
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# trace file : protocol
+TRACES="
+hf_14a_mfu:14a
+hf_14a_mfuc:14a
+hf_14a_reader_7b_rats:14a
+hf_14b_xerox_info:14b
+hf_14b_cryptorf_select:cryptorf
+hf_15_reader:15
+hf_mfdes_sniff:des
+hf_seos_sniff_fc60_cn640001:seos
+hf_visa_apple_normal:14a
+"
+
+# strip the lines that differ between two runs (log file name, echoed command)
+filter() {
+    grep -v -e "pm3 -->" -e "Session log" -e "execute command" "$1"
+}
+
+FAILED=0
+printf "%-32s %-8s %8s %10s %10s %8s  %s\n" "trace" "type" "kB" "1 thread" "$THREADS threads" "speedup" "output"
+for entry in $TRACES; do
+    name=${entry%%:*}
+    proto=${entry##*:}
+    src="traces/$name.trace"
+    big="$TMPDIR/$name.trace"
+
+    : > "$big"
+    while [ "$(stat -c %s "$big")" -lt $((SIZEKB * 1024)) ]; do
+        cat "$src" "$src" "$src" "$src" "$src" "$src" "$src" "$src" >> "$big"
+    done
+
+    start=$(date +%s%N)
+    $CLIENTBIN -c "trace load -f $big; trace list -1 -t $proto -c --frame" > "$TMPDIR/seq.txt" 2>&1
+    t_seq=$(( ($(date +%s%N) - start) / 1000000 ))
+
+    start=$(date +%s%N)
+    $CLIENTBIN -c "trace load -f $big; trace list -1 -t $proto -c --frame --threads $THREADS" > "$TMPDIR/par.txt" 2>&1
+    t_par=$(( ($(date +%s%N) - start) / 1000000 ))
+
+    if cmp -s <(filter "$TMPDIR/seq.txt") <(filter "$TMPDIR/par.txt"); then
+        res="identical"
+    else
+        res="DIFFERS"
+        FAILED=1
+    fi
+
+    printf "%-32s %-8s %8d %8dms %8dms %7sx  %s\n" "$name" "$proto" $(( $(stat -c %s "$big") / 1024 )) \
+        "$t_seq" "$t_par" "$(awk "BEGIN { printf \"%.2f\", $t_seq / ($t_par + 1) }")" "$res"
+done
+
+if [ $FAILED -ne 0 ]; then
+    echo "Parallel output differs from sequential output"
+    exit 1
+fi
+echo "All outputs identical"